@@ -0,0 +1,96 @@
+// libFuzzer entry point for the CLI's command parser (see src/Command.h).
+//
+// Each input is a script, one command per line, run against a fresh
+// undirected Graph and then a fresh directed one. After each script the
+// Graph's counters are checked against its contents, so a command that
+// corrupts the Graph without crashing is caught too. Build with
+// "make fuzzcommand" (which needs clang), and run as
+//
+//    ./fuzzcommand [corpus directory]
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/Command.h"
+#include "src/Graph.h"
+#include "src/Graph_priv.h"
+
+// Longer scripts only slow the fuzzer down without reaching new code.
+#define MAX_SCRIPT 4096
+
+// Helper function declarations
+void RunScript(const char *script, size_t size, bool directed);
+void CheckGraph(Graph g);
+
+static FILE *sink = NULL;
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (sink == NULL) {
+    sink = fopen("/dev/null", "w");
+    if (sink == NULL) {
+      abort();
+    }
+  }
+  if (size > MAX_SCRIPT) {
+    return 0;
+  }
+  RunScript((const char *)data, size, false);
+  RunScript((const char *)data, size, true);
+  return 0;
+}
+
+// Runs each line of the script, which need not be NUL terminated, until
+// the end or a quit command.
+void RunScript(const char *script, size_t size, bool directed) {
+  char line[MAX_SCRIPT + 1];
+  size_t start, end;
+  Graph g;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  if (g == NULL) {
+    return;
+  }
+  for (start = 0; start < size; start = end + 1) {
+    for (end = start; end < size && script[end] != '\n'; end++) {
+    }
+    memcpy(line, script + start, end - start);
+    line[end - start] = '\0';
+    if (RunCommand(g, line, sink)) {
+      break;
+    }
+  }
+  CheckGraph(g);
+  FreeGraph(g);
+}
+
+// Aborts unless the Graph's counters agree with its edge lists, and every
+// undirected edge is stored from both ends.
+void CheckGraph(Graph g) {
+  GraphSummary s;
+  ListItem *item;
+  EdgeItem *e;
+  long degrees = 0;
+  int n = 0, count;
+
+  GetGraphSummary(g, &s);
+  for (item = g->front; item != NULL; item = item->next) {
+    if (item->id != n++) {
+      abort();
+    }
+    count = 0;
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      count++;
+      if (!IsDirectedGraph(g) && !AreAdjacent(g, e->data, item->data)) {
+        abort();
+      }
+    }
+    if (count != item->count || count < s.minDegree || count > s.maxDegree) {
+      abort();
+    }
+    degrees += count;
+  }
+  if (n != s.vertices || degrees != (IsDirectedGraph(g) ? 1 : 2) * s.edges) {
+    abort();
+  }
+}
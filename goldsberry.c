@@ -1,205 +1,326 @@
 // Original Author: Trevor Killeen (2014)
 //
 // Simple CLI interface to our Graph ADT. Supports creating a graph and running 
-// various API operations over that graph.
+// various API operations over that graph (see src/Command.h).
+//
+// Run as "goldsberry serve" instead, it serves a Graph to many clients at
+// once over a Unix domain socket (see src/GraphServer.h). Run as
+// "goldsberry batch", it replays a trace of commands and reports how long
+// they took (see src/CommandBatch.h). Run as "goldsberry walks", it writes
+// random walks over a Graph to a file (see src/RandomWalk.h).
 
+#include <getopt.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include "src/Command.h"
+#include "src/CommandBatch.h"
 #include "src/Graph.h"
+#include "src/GraphBuilder.h"
+#include "src/GraphServer.h"
+#include "src/RandomWalk.h"
 
-#define BUF_SIZE 24
-
-// displays commands to the user
-void help() {
-  printf("Commands (x, y and w must be integers):\n\n");
-  printf("add x => adds vertex with value x to the Graph\n");
-  printf("contains x => returns whether x is present in the Graph\n");
-  printf("adj x y => returns whether there exists an edge from x to y in the Graph\n");
-  printf("edge x y w => adds an edge between x and y with weight w to the Graph\n");
-  printf("remove x y => removes an edge between x and y from the Graph\n");
-  printf("neighbors x => lists a series of (y,w) pairs, where each y is a neighbor of x and w is the weight of the edge between them\n"); 
-  printf("help => show this menu\n");
-  printf("quit => quit the application\n");
-}
-
-// functions associated with the commands the user can call
+#define BUF_SIZE 256
 
-void add(Graph g, int x) {
-  AddVertex(g, x);
-}
+// Reads a Graph from a file holding one edge per line, as "x y w" (the
+// weight is optional, and defaults to 1). Returns NULL if the file cannot
+// be read or on memory error.
+Graph loadEdges(const char *path, bool directed) {
+  GraphEdge *edges = NULL, *grown;
+  size_t n = 0, capacity = 0;
+  char line[128], *p, *end;
+  Graph g;
+  FILE *f;
 
-void contains(Graph g, int x) {
-  if (ContainsVertex(g, x)) {
-    printf("the graph contains %d\n", x);
-  } else {
-    printf("the graph does not contain %d\n", x);
+  f = fopen(path, "r");
+  if (f == NULL) {
+    return NULL;
   }
-}
-
-void adj(Graph g, int x, int y) {
-  if (AreAdjacent(g, x, y)) {
-    printf("%d and %d are neighbors\n", x, y);
-  } else {
-    printf("%d and %d are not neighbors\n", x, y);
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (n == capacity) {
+      capacity = (capacity == 0) ? 1024 : 2 * capacity;
+      grown = (GraphEdge *)realloc(edges, sizeof(GraphEdge) * capacity);
+      if (grown == NULL) {
+        free(edges);
+        fclose(f);
+        return NULL;
+      }
+      edges = grown;
+    }
+    edges[n].v1 = (GVertex_t)strtoll(line, &p, 10);
+    if (p == line) {
+      // blank line or comment
+      continue;
+    }
+    edges[n].v2 = (GVertex_t)strtoll(p, &end, 10);
+    if (end == p) {
+      continue;
+    }
+    edges[n].weight = (GWeight_t)strtod(end, &p);
+    if (p == end) {
+      edges[n].weight = 1;
+    }
+    n++;
   }
-}
+  fclose(f);
 
-void addEdge(Graph g, int x, int y, int w) {
-  AddGraphEdge(g, x, y, w);
+  g = directed ? BuildDirectedGraphParallel(edges, n, 0) :
+    BuildGraphParallel(edges, n, 0);
+  free(edges);
+  return g;
 }
 
-void removeEdge(Graph g, int x, int y) {
-  RemoveGraphEdge(g, x, y);
-}
+// Runs the server until interrupted.
+int serve(int argc, char **argv) {
+  GraphServerOptions opts;
+  GraphServer server;
+  GraphSummary s;
+  sigset_t signals;
+  bool directed = false;
+  char *file = NULL;
+  Graph g;
+  int opt, sig;
 
-void neighbors(Graph g, int x) {
-  Neighbor *out;
-  Neighbor nb;
-  int i, ret;
-  
-  ret = GetNeighbors(g, x, &out);
-  if (ret == -1) {
-    printf("%d is not in the graph\n", x);
-  } else if (ret == 0) {
-    printf("%d has no neighbors\n", x);
-  } else {
-    printf("%d has edges to:", x);
-    for (i = 0; i < ret;  i++) {
-      nb = out[i];
-      printf(" (%d, weight: %d)", nb.v, nb.weight);
+  DefaultGraphServerOptions(&opts);
+  while ((opt = getopt(argc, argv, "dw:f:")) != -1) {
+    switch (opt) {
+      case 'd':
+        directed = true;
+        break;
+      case 'w':
+        opts.workers = atoi(optarg);
+        break;
+      case 'f':
+        file = optarg;
+        break;
+      default:
+        optind = argc + 1;
+        break;
     }
-    printf("\n");
   }
-  free(out);
-}
-
-void error(char *msg) {
-  printf("error: %s\n", msg);
-}
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: goldsberry serve [-d] [-w workers] "
+            "[-f edge file] socket\n");
+    return 1;
+  }
 
-// Unsafe integer extraction functions incoming! Because this is a small
-// personal project so atoi!, atoi!, atoi!
+  if (file != NULL) {
+    g = loadEdges(file, directed);
+  } else {
+    g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  }
+  if (g == NULL) {
+    fprintf(stderr, "error: could not create the graph\n");
+    return 1;
+  }
 
-// helper function to extract one int from a user-input string
-// using strtok and atoi. Assumesthe the client has already called
-// strtok for the first time. Returns true if int extracted, placing
-// it in the location specified by out. Otherwise returns false.
-bool extractOneInt(int *out) {
-    char *str;
+  // block the signals we wait for before starting the workers, so that
+  // they are delivered to sigwait rather than to a worker
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
 
-    str = strtok(NULL, " ");
-    if (str == NULL) {
-      return false;
-    }
-    *out = atoi(str);
+  server = StartGraphServer(g, argv[optind], &opts);
+  if (server == NULL) {
+    fprintf(stderr, "error: could not listen on %s\n", argv[optind]);
+    FreeGraph(g);
+    return 1;
+  }
+  GetGraphSummary(g, &s);
+  printf("serving %d vertices and %ld edges on %s with %d workers\n",
+         s.vertices, s.edges, argv[optind], opts.workers);
+  fflush(stdout);
 
-    return true;
+  sigwait(&signals, &sig);
+  StopGraphServer(server);
+  FreeGraph(g);
+  return 0;
 }
 
-// helper function to extract two ints, in a similar fashion
-bool extractTwoInts(int *out1, int *out2) {
-    char *str;
+// Replays a trace of commands, writing the results to stdout (or a file)
+// and the report to stderr.
+int batch(int argc, char **argv) {
+  CommandFormat format = COMMAND_TERSE;
+  BatchReport report;
+  bool directed = false;
+  char *file = NULL, *output = NULL;
+  FILE *in, *out;
+  Graph g;
+  int opt, ret;
 
-    str = strtok(NULL, " ");
-    if (str == NULL) {
-      return false;
+  while ((opt = getopt(argc, argv, "dvf:o:")) != -1) {
+    switch (opt) {
+      case 'd':
+        directed = true;
+        break;
+      case 'v':
+        format = COMMAND_TEXT;
+        break;
+      case 'f':
+        file = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      default:
+        optind = argc + 1;
+        break;
     }
-    *out1 = atoi(str);
-    return extractOneInt(out2);
-}
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: goldsberry batch [-d] [-v] [-f edge file] "
+            "[-o output] trace\n");
+    return 1;
+  }
+
+  in = (strcmp(argv[optind], "-") == 0) ? stdin : fopen(argv[optind], "r");
+  if (in == NULL) {
+    fprintf(stderr, "error: could not open %s\n", argv[optind]);
+    return 1;
+  }
+  out = (output == NULL) ? stdout : fopen(output, "w");
+  if (out == NULL) {
+    fprintf(stderr, "error: could not open %s\n", output);
+    return 1;
+  }
 
-// helper function to extract three ints, in the same way!
-bool extractThreeInts(int *out1, int *out2, int *out3) {
-    char *str;
+  if (file != NULL) {
+    g = loadEdges(file, directed);
+  } else {
+    g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  }
+  if (g == NULL) {
+    fprintf(stderr, "error: could not create the graph\n");
+    return 1;
+  }
 
-    str = strtok(NULL, " ");
-    if (str == NULL) {
-      return false;
-    }
-    *out1 = atoi(str);
-    return extractTwoInts(out2, out3);
+  ret = RunCommandBatch(g, in, format, out, &report);
+  if (ret == -1) {
+    fprintf(stderr, "error: could not read %s\n", argv[optind]);
+  }
+  fflush(out);
+  PrintBatchReport(&report, stderr);
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  FreeGraph(g);
+  return ret == 0 ? 0 : 1;
 }
 
-// Parses the user input string, calling the appropriate function or
-// printing an error if an invalid command is used. Returns true if
-// we should prompt for another command, false if we should quit.
-bool parseInput(Graph g, char *input) {
-  int x = 0, y = 0, w = 0;
-  char *split;
-  bool should_exit = false;
+// Writes random walks over a Graph read from an edge file.
+int walks(int argc, char **argv) {
+  WalkOptions opts;
+  WalkSampler s;
+  bool directed = false, weighted = true;
+  char *file = NULL;
+  long written;
+  Graph g;
+  int opt;
 
-  // remove trailing newline
-  split = strtok(input, "\n");
+  DefaultWalkOptions(&opts);
+  while ((opt = getopt(argc, argv, "dun:l:p:q:s:t:f:")) != -1) {
+    switch (opt) {
+      case 'd':
+        directed = true;
+        break;
+      case 'u':
+        weighted = false;
+        break;
+      case 'n':
+        opts.walksPerVertex = atoi(optarg);
+        break;
+      case 'l':
+        opts.length = atoi(optarg);
+        break;
+      case 'p':
+        opts.p = atof(optarg);
+        break;
+      case 'q':
+        opts.q = atof(optarg);
+        break;
+      case 's':
+        opts.seed = strtoull(optarg, NULL, 10);
+        break;
+      case 't':
+        opts.threads = atoi(optarg);
+        break;
+      case 'f':
+        file = optarg;
+        break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind != argc - 1 || file == NULL || opts.p <= 0 || opts.q <= 0) {
+    fprintf(stderr, "usage: goldsberry walks [-d] [-u] [-n walks per vertex] "
+            "[-l length] [-p p] [-q q] [-s seed] [-t threads] -f edge file "
+            "output\n");
+    return 1;
+  }
 
-  split = strtok(input, " ");
-  if (split == NULL) {
-    error("unknown command");
-    return should_exit;
+  g = loadEdges(file, directed);
+  if (g == NULL) {
+    fprintf(stderr, "error: could not load %s\n", file);
+    return 1;
   }
-  
-  // gross if/else ladder to figure out what function to call and
-  // verify proper input to that function
-  if (strcmp(split, "add") == 0) {
-    if (!extractOneInt(&x)) {
-      error("invalid arguments to add");
-    }
-    add(g, x);
-  } else if (strcmp(split, "contains") == 0) {
-    if (!extractOneInt(&x)) {
-      error("invalid arguments to contains");
-    }
-    contains(g, x);
-  } else if (strcmp(split, "adj") == 0) {
-    if (!extractTwoInts(&x, &y)) {
-      error("invalid arguments to adj");
-    }
-    adj(g, x, y);
-  } else if (strcmp(split, "edge") == 0) {
-    if (!extractThreeInts(&x, &y, &w)) {
-      error("invalid arguments to edge");
-    }
-    addEdge(g, x, y, w);
-  } else if (strcmp(split, "remove") == 0) {
-    if (!extractTwoInts(&x, &y)) {
-      error("invalid argument to remove");
-    }
-    removeEdge(g, x, y);
-  } else if (strcmp(split, "neighbors") == 0) {
-    // try to get the vertex it wants
-    if (!extractOneInt(&x)) {
-      error("invalid argument to neighbors");
-    }
-    neighbors(g, x); 
-  } else if (strcmp(split, "help") == 0) {
-    help();
-  } else if (strcmp(split, "quit") == 0) {
-    should_exit = true;
-  } else {
-    error("invalid command");
+  s = AllocateWalkSampler(g, weighted);
+  if (s == NULL) {
+    fprintf(stderr, "error: out of memory\n");
+    FreeGraph(g);
+    return 1;
   }
 
-  return should_exit;
+  written = WriteRandomWalks(s, &opts, argv[optind]);
+  if (written == -1) {
+    fprintf(stderr, "error: could not write %s\n", argv[optind]);
+  } else if (written == -2) {
+    fprintf(stderr, "error: out of memory\n");
+  } else {
+    fprintf(stderr, "wrote %ld walks\n", written);
+  }
+  FreeWalkSampler(s);
+  FreeGraph(g);
+  return written < 0 ? 1 : 0;
 }
 
 int main(int argc, char **argv) {
   Graph g;
   char buf[BUF_SIZE];
 
-  g = AllocateGraph();
+  if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+    return serve(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+    return batch(argc - 1, argv + 1);
+  }
+  if (argc > 1 && strcmp(argv[1], "walks") == 0) {
+    return walks(argc - 1, argv + 1);
+  }
+
+  // -d makes the Graph directed
+  if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+    g = AllocateDirectedGraph();
+  } else {
+    g = AllocateGraph();
+  }
   if (g == NULL) {
     return 1;
   }
 
   printf("Hello! Welcome to Goldsberry. Type 'help' for help.\n");
 
-  while(1) {
-    fgets(buf, BUF_SIZE, stdin);
-    if (parseInput(g, buf)) {
+  while (fgets(buf, BUF_SIZE, stdin) != NULL) {
+    if (RunCommand(g, buf, stdout)) {
       break;
     }
-
   }
   
   printf("Exiting\n");
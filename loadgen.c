@@ -0,0 +1,224 @@
+// Load generator for the Graph server ("goldsberry serve"). Opens several
+// connections, keeps a fixed number of requests in flight on each, and
+// reports the throughput and latency percentiles it saw.
+//
+//    loadgen [-c connections] [-n requests] [-p depth] [-r range]
+//            [-w write%] [-g neighbors%] [-a adjacent%] socket
+//
+// Vertices are drawn uniformly from [0, range). Requests that are not
+// writes, neighbor or adjacency queries are contains queries.
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/Graph.h"
+#include "src/GraphClient.h"
+#include "src/GraphProtocol.h"
+
+// The run's settings.
+typedef struct LoadOptions {
+  const char *path;
+  int connections;
+  long requests;    // per connection
+  int depth;        // requests in flight per connection
+  long range;
+  int writes;       // percentages of the mix
+  int neighbors;
+  int adjacent;
+} LoadOptions;
+
+// One connection's run.
+typedef struct LoadThread {
+  pthread_t thread;
+  const LoadOptions *opts;
+  unsigned int seed;
+  double *latencies;  // in microseconds, one per request
+  long done;
+  long errors;
+  int failed;
+} LoadThread;
+
+double Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Queues one request drawn from the mix.
+int QueueRandom(LoadThread *t, GraphClient c, uint32_t id) {
+  const LoadOptions *o = t->opts;
+  GVertex_t v1, v2;
+  int pick;
+
+  pick = rand_r(&t->seed) % 100;
+  v1 = (GVertex_t)(rand_r(&t->seed) % o->range);
+  v2 = (GVertex_t)(rand_r(&t->seed) % o->range);
+  if (pick < o->writes) {
+    return QueueAddEdge(c, id, v1, v2, 1);
+  }
+  pick -= o->writes;
+  if (pick < o->neighbors) {
+    return QueueNeighbors(c, id, v1);
+  }
+  pick -= o->neighbors;
+  if (pick < o->adjacent) {
+    return QueueAdjacent(c, id, v1, v2);
+  }
+  return QueueContains(c, id, v1);
+}
+
+// Runs one connection: fills the pipeline, and tops it back up whenever
+// half of it has been answered, so that sends are batched.
+void *RunConnection(void *arg) {
+  LoadThread *t = (LoadThread *)arg;
+  const LoadOptions *o = t->opts;
+  GraphResponse r;
+  GraphClient c;
+  double *sent;
+  long next = 0;
+  int inFlight = 0;
+
+  c = ConnectGraphClient(o->path);
+  sent = (double *)malloc(sizeof(double) * o->depth);
+  if (c == NULL || sent == NULL) {
+    t->failed = 1;
+    goto done;
+  }
+
+  while (t->done < o->requests) {
+    if (inFlight <= o->depth / 2) {
+      while (inFlight < o->depth && next < o->requests) {
+        if (QueueRandom(t, c, (uint32_t)next) == -1) {
+          t->failed = 1;
+          goto done;
+        }
+        sent[next % o->depth] = Now();
+        next++;
+        inFlight++;
+      }
+      if (FlushGraphClient(c) == -1) {
+        t->failed = 1;
+        goto done;
+      }
+    }
+
+    if (ReadGraphResponse(c, &r) == -1) {
+      t->failed = 1;
+      goto done;
+    }
+    // responses come back in order, so r.id is the oldest in flight
+    t->latencies[t->done] = (Now() - sent[r.id % o->depth]) * 1e6;
+    if (r.status == GRAPH_STATUS_FAILED) {
+      t->errors++;
+    }
+    t->done++;
+    inFlight--;
+  }
+
+ done:
+  if (c != NULL) {
+    CloseGraphClient(c);
+  }
+  free(sent);
+  return NULL;
+}
+
+int CompareDoubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+double Percentile(const double *sorted, long n, double p) {
+  long i = (long)(p / 100.0 * (n - 1) + 0.5);
+  return sorted[i];
+}
+
+void usage(void) {
+  fprintf(stderr, "usage: loadgen [-c connections] [-n requests] "
+          "[-p depth] [-r range] [-w write%%] [-g neighbors%%] "
+          "[-a adjacent%%] socket\n");
+}
+
+int main(int argc, char **argv) {
+  LoadOptions o = {NULL, 4, 100000, 64, 1000, 5, 20, 25};
+  LoadThread *threads;
+  double start, elapsed, *all;
+  long total = 0, errors = 0;
+  int opt, i, failed = 0;
+
+  while ((opt = getopt(argc, argv, "c:n:p:r:w:g:a:")) != -1) {
+    switch (opt) {
+      case 'c': o.connections = atoi(optarg); break;
+      case 'n': o.requests = atol(optarg); break;
+      case 'p': o.depth = atoi(optarg); break;
+      case 'r': o.range = atol(optarg); break;
+      case 'w': o.writes = atoi(optarg); break;
+      case 'g': o.neighbors = atoi(optarg); break;
+      case 'a': o.adjacent = atoi(optarg); break;
+      default: usage(); return 1;
+    }
+  }
+  if (optind != argc - 1 || o.connections < 1 || o.requests < 1 ||
+      o.depth < 1 || o.range < 1 ||
+      o.writes + o.neighbors + o.adjacent > 100) {
+    usage();
+    return 1;
+  }
+  o.path = argv[optind];
+
+  threads = (LoadThread *)calloc(o.connections, sizeof(LoadThread));
+  all = (double *)malloc(sizeof(double) * o.requests * o.connections);
+  if (threads == NULL || all == NULL) {
+    fprintf(stderr, "error: out of memory\n");
+    return 1;
+  }
+
+  start = Now();
+  for (i = 0; i < o.connections; i++) {
+    threads[i].opts = &o;
+    threads[i].seed = 1 + i;
+    threads[i].latencies = all + (long)i * o.requests;
+    pthread_create(&threads[i].thread, NULL, RunConnection, &threads[i]);
+  }
+
+  // gather every connection's latencies into one contiguous run
+  for (i = 0; i < o.connections; i++) {
+    pthread_join(threads[i].thread, NULL);
+    memmove(all + total, threads[i].latencies,
+            sizeof(double) * threads[i].done);
+    total += threads[i].done;
+    errors += threads[i].errors;
+    failed += threads[i].failed;
+  }
+  elapsed = Now() - start;
+
+  if (failed > 0) {
+    fprintf(stderr, "error: %d connection(s) failed\n", failed);
+  }
+  if (total == 0) {
+    free(all);
+    free(threads);
+    return 1;
+  }
+
+  qsort(all, total, sizeof(double), CompareDoubles);
+  printf("%ld requests over %d connections (depth %d) in %.3f s\n",
+         total, o.connections, o.depth, elapsed);
+  printf("throughput: %.0f requests/s\n", total / elapsed);
+  printf("latency (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  "
+         "max %.1f\n", Percentile(all, total, 50), Percentile(all, total, 90),
+         Percentile(all, total, 99), Percentile(all, total, 99.9),
+         all[total - 1]);
+  if (errors > 0) {
+    printf("failed requests: %ld\n", errors);
+  }
+
+  free(all);
+  free(threads);
+  return failed > 0;
+}
@@ -0,0 +1,368 @@
+// Implementation of the CLI's command language.
+//
+// Each command is a word followed by its arguments, separated by spaces.
+// Arguments are checked in full before anything runs: a vertex must be an
+// integer that fits a GVertex_t, and a weight a non-negative number that
+// fits a GWeight_t.
+
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./Command.h"
+#include "./GraphStats.h"
+#include "./Neighborhood.h"
+#include "./ShortestPath.h"
+
+#define DELIMITERS " \t\r\n"
+
+// Helper function declarations
+bool ParseVertex(char **save, GVertex_t *out);
+bool ParseWeight(char **save, GWeight_t *out);
+void PrintNeighbors(Graph g, GVertex_t x, bool in, bool terse, FILE *out);
+void PrintKHop(Graph g, GVertex_t x, int k, bool terse, FILE *out);
+void PrintPath(Graph g, GVertex_t x, GVertex_t y, bool terse, FILE *out);
+void PrintSummary(Graph g, FILE *out);
+void PrintStats(FILE *out);
+
+static const char *commandNames[NUM_COMMAND_KINDS] = {
+  "add",
+  "contains",
+  "adj",
+  "edge",
+  "remove",
+  "neighbors",
+  "in",
+  "khop",
+  "path",
+  "summary",
+  "stats",
+  "help",
+  "quit",
+  "invalid",
+};
+
+const char *CommandName(CommandKind kind) {
+  if (kind < 0 || kind >= NUM_COMMAND_KINDS) {
+    return "unknown";
+  }
+  return commandNames[kind];
+}
+
+void PrintCommandHelp(FILE *out) {
+  fprintf(out, "Commands (x and y must be integers, w a number):\n\n");
+  fprintf(out, "add x => adds vertex with value x to the Graph\n");
+  fprintf(out, "contains x => returns whether x is present in the Graph\n");
+  fprintf(out, "adj x y => returns whether there exists an edge from x to y in the Graph\n");
+  fprintf(out, "edge x y w => adds an edge between x and y with weight w to the Graph\n");
+  fprintf(out, "remove x y => removes an edge between x and y from the Graph\n");
+  fprintf(out, "neighbors x => lists a series of (y,w) pairs, where each y is a neighbor of x and w is the weight of the edge between them\n");
+  fprintf(out, "in x => lists a series of (y,w) pairs, where each y has an edge to x (the same as neighbors unless the Graph is directed)\n");
+  fprintf(out, "khop x k => lists the vertices within k hops of x, with the fewest hops and least weight to reach each\n");
+  fprintf(out, "path x y => finds a shortest path from x to y\n");
+  fprintf(out, "summary => shows the size of the Graph and its degree distribution\n");
+  fprintf(out, "stats => shows call counts, latencies and work counters for the Graph operations\n");
+  fprintf(out, "help => show this menu\n");
+  fprintf(out, "quit => quit the application\n");
+}
+
+bool RunCommand(Graph g, char *input, FILE *out) {
+  return RunCommandFormatted(g, input, COMMAND_TEXT, out) == COMMAND_QUIT;
+}
+
+CommandKind RunCommandFormatted(Graph g, char *input, CommandFormat format,
+                                FILE *out) {
+  CommandKind kind;
+  GVertex_t x, y;
+  GWeight_t w;
+  char *save, *cmd;
+  bool terse = (format == COMMAND_TERSE);
+
+  cmd = strtok_r(input, DELIMITERS, &save);
+  if (cmd == NULL) {
+    fprintf(out, "error: unknown command\n");
+    return COMMAND_INVALID;
+  }
+  for (kind = 0; kind < COMMAND_INVALID; kind++) {
+    if (strcmp(cmd, commandNames[kind]) == 0) {
+      break;
+    }
+  }
+
+  switch (kind) {
+    case COMMAND_ADD:
+      if (!ParseVertex(&save, &x)) {
+        fprintf(out, "error: invalid arguments to add\n");
+      } else if (AddVertex(g, x) == -1) {
+        fprintf(out, "error: out of memory\n");
+      }
+      break;
+    case COMMAND_CONTAINS:
+      if (!ParseVertex(&save, &x)) {
+        fprintf(out, "error: invalid arguments to contains\n");
+      } else if (terse) {
+        fprintf(out, "%d\n", ContainsVertex(g, x));
+      } else if (ContainsVertex(g, x)) {
+        fprintf(out, "the graph contains %" GVERTEX_FMT "\n", x);
+      } else {
+        fprintf(out, "the graph does not contain %" GVERTEX_FMT "\n", x);
+      }
+      break;
+    case COMMAND_ADJ:
+      if (!ParseVertex(&save, &x) || !ParseVertex(&save, &y)) {
+        fprintf(out, "error: invalid arguments to adj\n");
+      } else if (terse) {
+        fprintf(out, "%d\n", AreAdjacent(g, x, y));
+      } else if (AreAdjacent(g, x, y)) {
+        fprintf(out, "%" GVERTEX_FMT " and %" GVERTEX_FMT " are neighbors\n",
+                x, y);
+      } else {
+        fprintf(out, "%" GVERTEX_FMT " and %" GVERTEX_FMT
+                " are not neighbors\n", x, y);
+      }
+      break;
+    case COMMAND_EDGE:
+      if (!ParseVertex(&save, &x) || !ParseVertex(&save, &y) ||
+          !ParseWeight(&save, &w)) {
+        fprintf(out, "error: invalid arguments to edge\n");
+      } else if (x == y) {
+        fprintf(out, "error: self-loops are not permitted\n");
+      } else if (AddGraphEdge(g, x, y, w) == -1) {
+        fprintf(out, "error: out of memory\n");
+      }
+      break;
+    case COMMAND_REMOVE:
+      if (!ParseVertex(&save, &x) || !ParseVertex(&save, &y)) {
+        fprintf(out, "error: invalid arguments to remove\n");
+      } else {
+        RemoveGraphEdge(g, x, y);
+      }
+      break;
+    case COMMAND_NEIGHBORS:
+    case COMMAND_IN:
+      if (!ParseVertex(&save, &x)) {
+        fprintf(out, "error: invalid arguments to %s\n", cmd);
+      } else {
+        PrintNeighbors(g, x, kind == COMMAND_IN, terse, out);
+      }
+      break;
+    case COMMAND_KHOP:
+      if (!ParseVertex(&save, &x) || !ParseVertex(&save, &y) || y < 0 ||
+          y > INT_MAX) {
+        fprintf(out, "error: invalid arguments to khop\n");
+      } else {
+        PrintKHop(g, x, (int)y, terse, out);
+      }
+      break;
+    case COMMAND_PATH:
+      if (!ParseVertex(&save, &x) || !ParseVertex(&save, &y)) {
+        fprintf(out, "error: invalid arguments to path\n");
+      } else {
+        PrintPath(g, x, y, terse, out);
+      }
+      break;
+    case COMMAND_SUMMARY:
+      PrintSummary(g, out);
+      break;
+    case COMMAND_STATS:
+      PrintStats(out);
+      break;
+    case COMMAND_HELP:
+      PrintCommandHelp(out);
+      break;
+    case COMMAND_QUIT:
+      break;
+    default:
+      fprintf(out, "error: invalid command\n");
+      break;
+  }
+  return kind;
+}
+
+// Parses the next argument as a vertex. Returns false if there is none, or
+// it is not an integer in the range of a GVertex_t.
+bool ParseVertex(char **save, GVertex_t *out) {
+  char *str, *end;
+  long long v;
+
+  str = strtok_r(NULL, DELIMITERS, save);
+  if (str == NULL) {
+    return false;
+  }
+  errno = 0;
+  v = strtoll(str, &end, 10);
+  if (end == str || *end != '\0' || errno == ERANGE ||
+      (long long)(GVertex_t)v != v) {
+    return false;
+  }
+  *out = (GVertex_t)v;
+  return true;
+}
+
+// Parses the next argument as a weight. Returns false if there is none, or
+// it is not a non-negative number in the range of a GWeight_t.
+bool ParseWeight(char **save, GWeight_t *out) {
+  char *str, *end;
+  double w;
+
+  str = strtok_r(NULL, DELIMITERS, save);
+  if (str == NULL) {
+    return false;
+  }
+  w = strtod(str, &end);
+  if (end == str || *end != '\0' || !isfinite(w) || w < 0) {
+    return false;
+  }
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_FLOAT
+  if (w > FLT_MAX) {
+    return false;
+  }
+#else
+  if (w > INT_MAX) {
+    return false;
+  }
+#endif
+  *out = (GWeight_t)w;
+  return true;
+}
+
+void PrintNeighbors(Graph g, GVertex_t x, bool in, bool terse, FILE *out) {
+  Neighbor *nbs;
+  int i, ret;
+
+  ret = in ? GetInNeighbors(g, x, &nbs) : GetNeighbors(g, x, &nbs);
+  if (terse) {
+    fprintf(out, "%d", ret);
+    for (i = 0; i < ret; i++) {
+      fprintf(out, " %" GVERTEX_FMT ":%" GWEIGHT_FMT, nbs[i].v,
+              nbs[i].weight);
+    }
+    fprintf(out, "\n");
+    if (ret > 0) {
+      free(nbs);
+    }
+  } else if (ret == -1) {
+    fprintf(out, "%" GVERTEX_FMT " is not in the graph\n", x);
+  } else if (ret == -2) {
+    fprintf(out, "error: out of memory\n");
+  } else if (ret == 0) {
+    fprintf(out, "%" GVERTEX_FMT " has no neighbors\n", x);
+  } else {
+    fprintf(out, "%" GVERTEX_FMT " has edges %s:", x, in ? "from" : "to");
+    for (i = 0; i < ret; i++) {
+      fprintf(out, " (%" GVERTEX_FMT ", weight: %" GWEIGHT_FMT ")", nbs[i].v,
+              nbs[i].weight);
+    }
+    fprintf(out, "\n");
+    free(nbs);
+  }
+}
+
+void PrintKHop(Graph g, GVertex_t x, int k, bool terse, FILE *out) {
+  const HopVertex *hood;
+  int i, ret;
+
+  ret = GetKHopNeighborhood(g, x, k, &hood);
+  if (terse) {
+    fprintf(out, "%d", ret);
+    for (i = 0; i < ret; i++) {
+      fprintf(out, " %" GVERTEX_FMT ":%d:%" GWEIGHT_FMT, hood[i].v,
+              hood[i].hops, hood[i].distance);
+    }
+    fprintf(out, "\n");
+  } else if (ret == -1) {
+    fprintf(out, "%" GVERTEX_FMT " is not in the graph\n", x);
+  } else if (ret == -2) {
+    fprintf(out, "error: out of memory\n");
+  } else {
+    fprintf(out, "%d vertices within %d hops of %" GVERTEX_FMT ":", ret, k, x);
+    for (i = 0; i < ret; i++) {
+      fprintf(out, " (%" GVERTEX_FMT ", hops: %d, weight: %" GWEIGHT_FMT ")",
+              hood[i].v, hood[i].hops, hood[i].distance);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void PrintPath(Graph g, GVertex_t x, GVertex_t y, bool terse, FILE *out) {
+  PathResult result;
+  int i, ret;
+
+  ret = BidirectionalPath(g, x, y, &result);
+  if (terse) {
+    fprintf(out, "%d", ret);
+    if (ret == 1) {
+      fprintf(out, " %" GWEIGHT_FMT, result.distance);
+      for (i = 0; i <= result.hops; i++) {
+        fprintf(out, " %" GVERTEX_FMT, result.path[i]);
+      }
+    }
+    fprintf(out, "\n");
+  } else if (ret == -1) {
+    fprintf(out, "%" GVERTEX_FMT " or %" GVERTEX_FMT " is not in the graph\n",
+            x, y);
+  } else if (ret == -2) {
+    fprintf(out, "error: out of memory\n");
+  } else if (ret == 0) {
+    fprintf(out, "no path from %" GVERTEX_FMT " to %" GVERTEX_FMT "\n", x, y);
+  } else {
+    fprintf(out, "weight %" GWEIGHT_FMT ", %d hops:", result.distance,
+            result.hops);
+    for (i = 0; i <= result.hops; i++) {
+      fprintf(out, " %" GVERTEX_FMT, result.path[i]);
+    }
+    fprintf(out, "\n");
+  }
+}
+
+void PrintSummary(Graph g, FILE *out) {
+  GraphSummary s;
+  int i;
+
+  GetGraphSummary(g, &s);
+  fprintf(out, "%d vertices, %ld edges\n", s.vertices, s.edges);
+  fprintf(out, "degree: min %d, max %d, mean %.2f\n", s.minDegree,
+          s.maxDegree, s.meanDegree);
+  for (i = 0; i < GRAPH_DEGREE_BUCKETS; i++) {
+    if (s.degreeHistogram[i] == 0) {
+      continue;
+    }
+    if (i == 0) {
+      fprintf(out, "  degree 0: %ld\n", s.degreeHistogram[i]);
+    } else {
+      fprintf(out, "  degree %u-%u: %ld\n", 1U << (i - 1), (1U << i) - 1,
+              s.degreeHistogram[i]);
+    }
+  }
+  fprintf(out, "memory: %zu bytes for vertices, %zu for edges, %zu overhead\n",
+          s.vertexBytes, s.edgeBytes, s.overheadBytes);
+}
+
+void PrintStats(FILE *out) {
+  GraphStats s;
+  GraphOpStats *op;
+  int i;
+
+  if (GetGraphStats(&s) == -1) {
+    fprintf(out, "statistics are not available (built without GRAPH_STATS)\n");
+    return;
+  }
+
+  fprintf(out, "%-14s %10s %12s %10s %10s\n", "op", "calls", "mean (ns)",
+          "p50 (ns)", "p99 (ns)");
+  for (i = 0; i < GRAPH_NUM_OPS; i++) {
+    op = &s.ops[i];
+    fprintf(out, "%-14s %10llu %12llu %10llu %10llu\n", GraphOpName(i),
+            op->calls, op->calls == 0 ? 0 : op->totalNs / op->calls,
+            GraphOpPercentile(op, 50), GraphOpPercentile(op, 99));
+  }
+
+  fprintf(out, "vertex lookups: %llu (%llu vertices scanned)\n",
+          s.vertexLookups, s.verticesScanned);
+  fprintf(out, "edges walked: %llu\n", s.edgesWalked);
+  fprintf(out, "allocations: %llu vertex, %llu edge, %llu neighbor list\n",
+          s.vertexAllocs, s.edgeAllocs, s.neighborAllocs);
+}
@@ -0,0 +1,81 @@
+// The command language of the goldsberry CLI: one command per line, run
+// against a Graph, with the results written out as text.
+//
+// It lives apart from the CLI's read loop so that the parser can be tested,
+// and fuzzed (see fuzzcommand.c), on its own. A line that does not parse
+// writes an error and leaves the Graph alone.
+//
+// Results are written either as English sentences, for people, or tersely,
+// for replaying traces of commands (see CommandBatch.h). A terse result is
+// one line, starting with the return value of the Graph call behind it:
+//
+//    -- add, edge, remove   nothing.
+//    -- contains, adj       1 or 0.
+//    -- neighbors, in       the number of neighbors, or -1 or -2, then
+//                           "v:weight" for each.
+//    -- khop                the number of vertices, or -1 or -2, then
+//                           "v:hops:weight" for each.
+//    -- path                1 if there is a path, then its weight and
+//                           vertices; otherwise 0, -1 or -2.
+//
+// Errors, and the results of summary, stats and help, are the same either
+// way.
+
+#ifndef _COMMAND_H_
+#define _COMMAND_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "./Graph.h"
+
+// The commands, and a kind for lines that are not one.
+typedef enum CommandKind {
+  COMMAND_ADD,
+  COMMAND_CONTAINS,
+  COMMAND_ADJ,
+  COMMAND_EDGE,
+  COMMAND_REMOVE,
+  COMMAND_NEIGHBORS,
+  COMMAND_IN,
+  COMMAND_KHOP,
+  COMMAND_PATH,
+  COMMAND_SUMMARY,
+  COMMAND_STATS,
+  COMMAND_HELP,
+  COMMAND_QUIT,
+  COMMAND_INVALID,
+  NUM_COMMAND_KINDS
+} CommandKind;
+
+// How results are written.
+typedef enum CommandFormat {
+  COMMAND_TEXT,
+  COMMAND_TERSE
+} CommandFormat;
+
+// Returns the name of the given kind of command.
+const char *CommandName(CommandKind kind);
+
+// Writes the list of commands to out.
+void PrintCommandHelp(FILE *out);
+
+// Parses one line of input and runs it against the Graph.
+//
+// Arguments:
+//
+//    -- g      the Graph to run the command against.
+//    -- input  the line, NUL terminated. It is modified by parsing.
+//    -- out    where to write the command's results and errors.
+//
+// Returns true if the command was quit, false otherwise.
+bool RunCommand(Graph g, char *input, FILE *out);
+
+// Parses one line of input and runs it against the Graph, like RunCommand,
+// writing the results in the given format. Returns the kind of command the
+// line named, whether or not its arguments were valid, or COMMAND_INVALID
+// if it named none.
+CommandKind RunCommandFormatted(Graph g, char *input, CommandFormat format,
+                                FILE *out);
+
+#endif
@@ -0,0 +1,77 @@
+// Implementation of command trace replay.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "./CommandBatch.h"
+#include "./GraphStats_priv.h"
+
+// Helper function declarations
+unsigned long long ElapsedNs(const struct timespec *start);
+
+int RunCommandBatch(Graph g, FILE *in, CommandFormat format, FILE *out,
+                    BatchReport *report) {
+  struct timespec start;
+  unsigned long long ns;
+  CommandKind kind;
+  char *line = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+  int ret = 0;
+
+  memset(report, 0, sizeof(BatchReport));
+  while ((length = getline(&line, &capacity, in)) != -1) {
+    // skip blank lines and comments
+    if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#') {
+      continue;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    kind = RunCommandFormatted(g, line, format, out);
+    ns = ElapsedNs(&start);
+
+    report->lines++;
+    report->totalNs += ns;
+    RecordGraphOpLatency(&report->commands[kind], ns);
+    if (kind == COMMAND_QUIT) {
+      break;
+    }
+  }
+  if (ferror(in)) {
+    ret = -1;
+  }
+
+  free(line);
+  return ret;
+}
+
+void PrintBatchReport(const BatchReport *report, FILE *out) {
+  const GraphOpStats *op;
+  int i;
+
+  fprintf(out, "%llu commands in %.3f s (%.0f per second)\n", report->lines,
+          report->totalNs / 1e9,
+          report->totalNs == 0 ? 0.0 : report->lines * 1e9 / report->totalNs);
+  fprintf(out, "%-10s %10s %12s %10s %10s %10s %10s\n", "command", "count",
+          "mean (ns)", "p50 (ns)", "p90 (ns)", "p99 (ns)", "p99.9 (ns)");
+  for (i = 0; i < NUM_COMMAND_KINDS; i++) {
+    op = &report->commands[i];
+    if (op->calls == 0) {
+      continue;
+    }
+    fprintf(out, "%-10s %10llu %12llu %10llu %10llu %10llu %10llu\n",
+            CommandName(i), op->calls, op->totalNs / op->calls,
+            GraphOpPercentile(op, 50), GraphOpPercentile(op, 90),
+            GraphOpPercentile(op, 99), GraphOpPercentile(op, 99.9));
+  }
+}
+
+// Returns the nanoseconds since start.
+unsigned long long ElapsedNs(const struct timespec *start) {
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (unsigned long long)(end.tv_sec - start->tv_sec) * 1000000000ULL +
+    (unsigned long long)(end.tv_nsec - start->tv_nsec);
+}
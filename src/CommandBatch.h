@@ -0,0 +1,46 @@
+// Non-interactive replay of command traces, such as those captured from
+// production, with the time each command took.
+//
+// A trace is a file of commands in the CLI's language (see Command.h), one
+// per line. Blank lines and lines starting with '#' are skipped, and a quit
+// command ends the trace early. Each command is timed from the start of
+// parsing to the end of writing its result, so the cheaper the output the
+// closer the times are to those of the Graph calls themselves: replaying
+// with terse results written to /dev/null measures little else.
+
+#ifndef _COMMAND_BATCH_H_
+#define _COMMAND_BATCH_H_
+
+#include <stdio.h>
+
+#include "./Command.h"
+#include "./Graph.h"
+#include "./GraphStats.h"
+
+// What a replay saw. The latencies of each kind of command are kept as in
+// GraphStats.h, so that GraphOpPercentile works on them.
+typedef struct BatchReport {
+  unsigned long long lines;     // commands run, quit included
+  unsigned long long totalNs;   // time taken by all of them
+  GraphOpStats       commands[NUM_COMMAND_KINDS];
+} BatchReport;
+
+// Runs the commands read from in against the Graph.
+//
+// Arguments:
+//
+//    -- g       the Graph to run the commands against.
+//    -- in      the trace.
+//    -- format  the format of the results.
+//    -- out     where to write the results.
+//    -- report  filled in with what the replay saw.
+//
+// Returns 0 if the whole trace was run, or -1 if reading it failed (the
+// report then covers the commands before the failure).
+int RunCommandBatch(Graph g, FILE *in, CommandFormat format, FILE *out,
+                    BatchReport *report);
+
+// Writes a report as a table of command counts and latencies.
+void PrintBatchReport(const BatchReport *report, FILE *out);
+
+#endif
@@ -0,0 +1,1026 @@
+// Implementation of the DeltaGraph.
+//
+// The DeltaGraph has up to three layers: the base, the live overlay taking
+// updates, and while a merge runs, the overlay being merged. An overlay
+// maps each vertex it touches to a row: a sorted array of entries, each
+// either an edge or a tombstone. A lookup asks the live overlay first, then
+// the one being merged, then the base, and takes the first answer it gets.
+// A vertex exists if any layer has it; vertices are never removed.
+//
+// Only a merge replaces the base or the overlay being merged, and merges
+// are serialized by mergeLock. A merge can therefore read both without
+// holding the DeltaGraph's lock, which it only takes to set the live
+// overlay aside at the start and to swap in the new base at the end.
+//
+// The overlays take their memory from the DeltaGraph's allocator, and are
+// only ever allocated or freed under the DeltaGraph's lock, held
+// exclusively, which keeps its accounts (see GraphAlloc_priv.h) consistent.
+// The bases, which merges build without the lock, come from malloc.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./DeltaGraph.h"
+#include "./GraphAlloc_priv.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+// The number of slots in a new overlay's row table. Always a power of 2.
+#define INITIAL_ROW_SLOTS 16
+
+// An overlay entry: an edge to v, or if removed, a tombstone hiding the
+// edge to v in the layers below.
+typedef struct DeltaEdge {
+  GVertex_t  v;
+  GWeight_t  weight;
+  bool       removed;
+} DeltaEdge;
+
+// The entries of one vertex in an overlay, sorted by v.
+typedef struct DeltaRow {
+  GVertex_t  v;
+  int        count;
+  int        capacity;
+  DeltaEdge *edges;
+} DeltaRow;
+
+// A slot of an overlay's row table, which is an open addressing hash table
+// with linear probing, kept at most half full (as in VertexIndex.h). A
+// slot is empty if its row is NULL.
+typedef struct RowSlot {
+  GVertex_t  key;
+  DeltaRow  *row;
+} RowSlot;
+
+typedef struct DeltaLayer {
+  RowSlot  *slots;
+  uint32_t  mask;     // number of slots - 1
+  int       shift;    // 64 - log2(number of slots)
+  int       rows;
+  size_t    entries;  // across all rows
+} DeltaLayer;
+
+// The base, in compressed sparse row form. The edges of vertices[i] are
+// targets[offsets[i]] to targets[offsets[i + 1] - 1], sorted, with their
+// weights at the same positions in weights (which an unweighted build
+// leaves NULL).
+typedef struct DeltaBase {
+  size_t     n;
+  GVertex_t *vertices;
+  size_t    *offsets;
+  GVertex_t *targets;
+  GWeight_t *weights;
+} DeltaBase;
+
+struct deltagraph {
+  bool              directed;
+  size_t            threshold;
+  pthread_rwlock_t  lock;
+  GraphMemory       memory;      // where the overlays come from
+  DeltaBase        *base;
+  DeltaLayer       *layers[2];   // live, then being merged (or NULL)
+  int               vertices;
+  long              edges;
+  long              merges;
+
+  pthread_mutex_t   mergeLock;   // held for the whole of a merge
+  pthread_mutex_t   signalLock;  // guards the three fields below
+  pthread_cond_t    signal;
+  bool              pending;     // a background merge has been asked for
+  bool              stopping;
+  bool              hasMerger;
+  pthread_t         merger;
+};
+
+// Helper function declarations
+DeltaGraph NewDeltaGraph(bool directed, size_t threshold,
+                         const GraphAllocator *a, DeltaBase *base);
+DeltaLayer *NewDeltaLayer(GraphMemory *m);
+void FreeDeltaLayer(GraphMemory *m, DeltaLayer *l);
+DeltaBase *NewDeltaBase(size_t n, size_t edges);
+void FreeDeltaBase(DeltaBase *b);
+DeltaRow *FindDeltaRow(const DeltaLayer *l, GVertex_t v);
+DeltaRow *AddDeltaRow(GraphMemory *m, DeltaLayer *l, GVertex_t v);
+int FindDeltaEdge(const DeltaRow *r, GVertex_t v, bool *found);
+bool ReserveDeltaEdge(GraphMemory *m, DeltaRow *r);
+void PutDeltaEdge(DeltaLayer *l, DeltaRow *r, GVertex_t v, GWeight_t w,
+                  bool removed);
+long FindBaseVertex(const DeltaBase *b, GVertex_t v);
+bool HasVertex(DeltaGraph d, GVertex_t v);
+DeltaRow *LiveRow(DeltaGraph d, GVertex_t v);
+void DropLiveRow(DeltaGraph d, GVertex_t v);
+bool LookupEdge(DeltaGraph d, int layer, GVertex_t v1, GVertex_t v2);
+void RemoveDeltaEdge(DeltaGraph d, DeltaRow *r, GVertex_t v1, GVertex_t v2);
+void StartIterator(DeltaNeighborIterator *it, const DeltaBase *b,
+                   long index, const DeltaRow *live, const DeltaRow *merging);
+void RequestMerge(DeltaGraph d, size_t entries);
+void *MergerThread(void *arg);
+int Merge(DeltaGraph d);
+DeltaBase *BuildMergedBase(const DeltaBase *b, const DeltaLayer *l);
+int CompareVertices(const void *a, const void *b);
+
+DeltaGraph AllocateDeltaGraph(bool directed, size_t threshold) {
+  return AllocateDeltaGraphWithAllocator(directed, threshold,
+                                         SystemGraphAllocator());
+}
+
+DeltaGraph AllocateDeltaGraphWithAllocator(bool directed, size_t threshold,
+                                           const GraphAllocator *a) {
+  DeltaBase *base;
+
+  base = NewDeltaBase(0, 0);
+  if (base == NULL) {
+    return NULL;
+  }
+  return NewDeltaGraph(directed, threshold, a, base);
+}
+
+DeltaGraph FreezeGraph(Graph g, size_t threshold) {
+  DeltaBase *base;
+  GVertex_t *order;
+  ListItem *item;
+  EdgeItem *e;
+  size_t i, n, pos, stored = 0;
+  long j;
+
+  // sort the vertices, then copy each one's edges into place and sort them;
+  // a view freezes only what it shows
+  order = (GVertex_t *)malloc(sizeof(GVertex_t) * (g->numVertices + 1));
+  if (order == NULL) {
+    return NULL;
+  }
+  n = 0;
+  for (item = g->front; item != NULL; item = item->next) {
+    if (VertexVisible(g, item)) {
+      order[n++] = item->data;
+      stored += VisibleDegree(g, item);
+    }
+  }
+  qsort(order, n, sizeof(GVertex_t), CompareVertices);
+
+  base = NewDeltaBase(n, stored);
+  if (base == NULL) {
+    free(order);
+    return NULL;
+  }
+  memcpy(base->vertices, order, sizeof(GVertex_t) * n);
+  free(order);
+
+  pos = 0;
+  for (i = 0; i < n; i++) {
+    base->offsets[i] = pos;
+    item = FindVertex(g, base->vertices[i]);
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, item, e, false)) {
+        continue;
+      }
+      // insertion sort, keeping targets and weights together
+      for (j = (long)pos - 1; j >= (long)base->offsets[i] &&
+             base->targets[j] > e->data; j--) {
+        base->targets[j + 1] = base->targets[j];
+        if (base->weights != NULL) {
+          base->weights[j + 1] = base->weights[j];
+        }
+      }
+      base->targets[j + 1] = e->data;
+      if (base->weights != NULL) {
+        base->weights[j + 1] = EdgeWeight(e);
+      }
+      pos++;
+    }
+  }
+  base->offsets[n] = pos;
+
+  return NewDeltaGraph(g->directed, threshold, SystemGraphAllocator(), base);
+}
+
+// Allocates a DeltaGraph around the given base, which it takes ownership
+// of (and frees on failure), whose overlays come from the given allocator.
+DeltaGraph NewDeltaGraph(bool directed, size_t threshold,
+                         const GraphAllocator *a, DeltaBase *base) {
+  DeltaGraph d;
+
+  d = (DeltaGraph)calloc(1, sizeof(struct deltagraph));
+  if (d == NULL) {
+    FreeDeltaBase(base);
+    return NULL;
+  }
+  d->directed = directed;
+  d->threshold = threshold;
+  d->memory.allocator = a;
+  d->base = base;
+  d->vertices = (int)base->n;
+  d->edges = (long)base->offsets[base->n];
+  if (!directed) {
+    d->edges /= 2;
+  }
+  pthread_rwlock_init(&d->lock, NULL);
+  pthread_mutex_init(&d->mergeLock, NULL);
+  pthread_mutex_init(&d->signalLock, NULL);
+  pthread_cond_init(&d->signal, NULL);
+
+  d->layers[0] = NewDeltaLayer(&d->memory);
+  if (d->layers[0] == NULL) {
+    FreeDeltaGraph(d);
+    return NULL;
+  }
+  if (threshold > 0) {
+    if (pthread_create(&d->merger, NULL, MergerThread, d) != 0) {
+      FreeDeltaGraph(d);
+      return NULL;
+    }
+    d->hasMerger = true;
+  }
+  return d;
+}
+
+void FreeDeltaGraph(DeltaGraph d) {
+  if (d->hasMerger) {
+    pthread_mutex_lock(&d->signalLock);
+    d->stopping = true;
+    pthread_cond_signal(&d->signal);
+    pthread_mutex_unlock(&d->signalLock);
+    pthread_join(d->merger, NULL);
+  }
+
+  FreeDeltaBase(d->base);
+  FreeDeltaLayer(&d->memory, d->layers[0]);
+  FreeDeltaLayer(&d->memory, d->layers[1]);
+  pthread_rwlock_destroy(&d->lock);
+  pthread_mutex_destroy(&d->mergeLock);
+  pthread_mutex_destroy(&d->signalLock);
+  pthread_cond_destroy(&d->signal);
+  free(d);
+}
+
+bool IsDirectedDeltaGraph(DeltaGraph d) {
+  return d->directed;
+}
+
+int DeltaAddVertex(DeltaGraph d, GVertex_t v) {
+  int result = 0;
+
+  pthread_rwlock_wrlock(&d->lock);
+  if (!HasVertex(d, v) && LiveRow(d, v) == NULL) {
+    result = -1;
+  }
+  pthread_rwlock_unlock(&d->lock);
+  return result;
+}
+
+bool DeltaContainsVertex(DeltaGraph d, GVertex_t v) {
+  bool result;
+
+  pthread_rwlock_rdlock(&d->lock);
+  result = HasVertex(d, v);
+  pthread_rwlock_unlock(&d->lock);
+  return result;
+}
+
+bool DeltaAreAdjacent(DeltaGraph d, GVertex_t v1, GVertex_t v2) {
+  bool result;
+
+  pthread_rwlock_rdlock(&d->lock);
+  result = LookupEdge(d, 0, v1, v2);
+  pthread_rwlock_unlock(&d->lock);
+  return result;
+}
+
+int DeltaGetNeighbors(DeltaGraph d, GVertex_t v, Neighbor **out) {
+  DeltaNeighborIterator it;
+  Neighbor *neighbors, *grown;
+  int count = 0, capacity;
+  size_t upper;
+
+  if (!StartDeltaNeighbors(d, v, &it)) {
+    EndDeltaNeighbors(&it);
+    return -1;
+  }
+
+  // the layers hold at most this many entries between them
+  upper = (it.baseEnd - it.basePos) + (it.deltaEnd[0] - it.delta[0]) +
+    (it.deltaEnd[1] - it.delta[1]);
+  if (upper == 0) {
+    EndDeltaNeighbors(&it);
+    return 0;
+  }
+  capacity = (int)upper;
+  neighbors = (Neighbor *)malloc(sizeof(Neighbor) * capacity);
+  if (neighbors == NULL) {
+    EndDeltaNeighbors(&it);
+    return -2;
+  }
+  while (NextDeltaNeighbor(&it, &neighbors[count])) {
+    count++;
+  }
+  EndDeltaNeighbors(&it);
+
+  if (count == 0) {
+    free(neighbors);
+    return 0;
+  }
+  if (count < capacity) {
+    grown = (Neighbor *)realloc(neighbors, sizeof(Neighbor) * count);
+    if (grown != NULL) {
+      neighbors = grown;
+    }
+  }
+  *out = neighbors;
+  return count;
+}
+
+int DeltaAddEdge(DeltaGraph d, GVertex_t v1, GVertex_t v2, GWeight_t w) {
+  DeltaRow *r1, *r2 = NULL;
+  size_t entries;
+  bool existed, added1, added2 = false;
+
+  if (v1 == v2) {
+    return -1;
+  }
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_NONE
+  w = 1;
+#endif
+
+  pthread_rwlock_wrlock(&d->lock);
+  // make room in every row first, so that nothing fails halfway through,
+  // and if something does, take back the rows added for the edge
+  added1 = FindDeltaRow(d->layers[0], v1) == NULL;
+  r1 = LiveRow(d, v1);
+  if (r1 == NULL || !ReserveDeltaEdge(&d->memory, r1)) {
+    goto fail;
+  }
+  added2 = FindDeltaRow(d->layers[0], v2) == NULL;
+  if (!d->directed) {
+    r2 = LiveRow(d, v2);
+    if (r2 == NULL || !ReserveDeltaEdge(&d->memory, r2)) {
+      goto fail;
+    }
+  } else if (!HasVertex(d, v2) && LiveRow(d, v2) == NULL) {
+    goto fail;
+  }
+
+  existed = LookupEdge(d, 0, v1, v2);
+  PutDeltaEdge(d->layers[0], r1, v2, w, false);
+  if (r2 != NULL) {
+    PutDeltaEdge(d->layers[0], r2, v1, w, false);
+  }
+  if (!existed) {
+    d->edges++;
+  }
+  entries = d->layers[0]->entries;
+  pthread_rwlock_unlock(&d->lock);
+
+  RequestMerge(d, entries);
+  return 0;
+
+fail:
+  if (added2) {
+    DropLiveRow(d, v2);
+  }
+  if (added1) {
+    DropLiveRow(d, v1);
+  }
+  pthread_rwlock_unlock(&d->lock);
+  return -1;
+}
+
+int DeltaRemoveEdge(DeltaGraph d, GVertex_t v1, GVertex_t v2) {
+  DeltaRow *r1, *r2 = NULL;
+  size_t entries;
+
+  pthread_rwlock_wrlock(&d->lock);
+  if (!LookupEdge(d, 0, v1, v2)) {
+    pthread_rwlock_unlock(&d->lock);
+    return 0;
+  }
+  r1 = LiveRow(d, v1);
+  if (r1 == NULL || !ReserveDeltaEdge(&d->memory, r1)) {
+    pthread_rwlock_unlock(&d->lock);
+    return -1;
+  }
+  if (!d->directed) {
+    r2 = LiveRow(d, v2);
+    if (r2 == NULL || !ReserveDeltaEdge(&d->memory, r2)) {
+      pthread_rwlock_unlock(&d->lock);
+      return -1;
+    }
+  }
+
+  RemoveDeltaEdge(d, r1, v1, v2);
+  if (r2 != NULL) {
+    RemoveDeltaEdge(d, r2, v2, v1);
+  }
+  d->edges--;
+  entries = d->layers[0]->entries;
+  pthread_rwlock_unlock(&d->lock);
+
+  RequestMerge(d, entries);
+  return 0;
+}
+
+bool StartDeltaNeighbors(DeltaGraph d, GVertex_t v,
+                         DeltaNeighborIterator *it) {
+  const DeltaRow *live, *merging = NULL;
+  long index;
+
+  pthread_rwlock_rdlock(&d->lock);
+  index = FindBaseVertex(d->base, v);
+  live = FindDeltaRow(d->layers[0], v);
+  if (d->layers[1] != NULL) {
+    merging = FindDeltaRow(d->layers[1], v);
+  }
+  StartIterator(it, d->base, index, live, merging);
+  it->g = d;
+  return index != -1 || live != NULL || merging != NULL;
+}
+
+bool NextDeltaNeighbor(DeltaNeighborIterator *it, Neighbor *n) {
+  const DeltaEdge *newest;
+  bool fromBase;
+  GVertex_t next;
+  int i;
+
+  for (;;) {
+    // find the smallest neighbor left in any layer, and the newest layer
+    // that has it
+    newest = NULL;
+    fromBase = false;
+    for (i = 0; i < 2; i++) {
+      if (it->delta[i] < it->deltaEnd[i] &&
+          (newest == NULL || it->delta[i]->v < newest->v)) {
+        newest = it->delta[i];
+      }
+    }
+    if (it->basePos < it->baseEnd &&
+        (newest == NULL || it->baseTargets[it->basePos] < newest->v)) {
+      fromBase = true;
+    } else if (newest == NULL) {
+      return false;
+    }
+
+    next = fromBase ? it->baseTargets[it->basePos] : newest->v;
+    memset(n, 0, sizeof(Neighbor));
+    n->v = next;
+    if (fromBase) {
+      n->weight = (it->baseWeights != NULL) ?
+        it->baseWeights[it->basePos] : 1;
+    } else {
+      n->weight = newest->weight;
+    }
+
+    // step every layer past it, since the newest layer overrides the rest
+    for (i = 0; i < 2; i++) {
+      if (it->delta[i] < it->deltaEnd[i] && it->delta[i]->v == next) {
+        it->delta[i]++;
+      }
+    }
+    if (it->basePos < it->baseEnd && it->baseTargets[it->basePos] == next) {
+      it->basePos++;
+    }
+    if (fromBase || !newest->removed) {
+      return true;
+    }
+  }
+}
+
+void EndDeltaNeighbors(DeltaNeighborIterator *it) {
+  if (it->g != NULL) {
+    pthread_rwlock_unlock(&it->g->lock);
+    it->g = NULL;
+  }
+}
+
+int MergeDeltaGraph(DeltaGraph d) {
+  int result;
+
+  pthread_mutex_lock(&d->mergeLock);
+  result = Merge(d);
+  pthread_mutex_unlock(&d->mergeLock);
+  return result;
+}
+
+void GetDeltaGraphSummary(DeltaGraph d, DeltaGraphSummary *out) {
+  pthread_rwlock_rdlock(&d->lock);
+  out->vertices = d->vertices;
+  out->edges = d->edges;
+  out->baseEdges = d->base->offsets[d->base->n];
+  out->deltaEntries = d->layers[0]->entries;
+  if (d->layers[1] != NULL) {
+    out->deltaEntries += d->layers[1]->entries;
+  }
+  out->merges = d->merges;
+  pthread_rwlock_unlock(&d->lock);
+}
+
+// Allocates an empty overlay. Returns NULL on memory error.
+DeltaLayer *NewDeltaLayer(GraphMemory *m) {
+  DeltaLayer *l;
+
+  l = (DeltaLayer *)MemoryCalloc(m, sizeof(DeltaLayer));
+  if (l == NULL) {
+    return NULL;
+  }
+  l->slots = (RowSlot *)MemoryCalloc(m, sizeof(RowSlot) * INITIAL_ROW_SLOTS);
+  if (l->slots == NULL) {
+    MemoryFree(m, l, sizeof(DeltaLayer));
+    return NULL;
+  }
+  l->mask = INITIAL_ROW_SLOTS - 1;
+  l->shift = 64 - __builtin_ctz(INITIAL_ROW_SLOTS);
+  return l;
+}
+
+void FreeDeltaLayer(GraphMemory *m, DeltaLayer *l) {
+  DeltaRow *row;
+  uint32_t i;
+
+  if (l == NULL) {
+    return;
+  }
+  for (i = 0; i <= l->mask; i++) {
+    row = l->slots[i].row;
+    if (row != NULL) {
+      MemoryFree(m, row->edges, sizeof(DeltaEdge) * row->capacity);
+      MemoryFree(m, row, sizeof(DeltaRow));
+    }
+  }
+  MemoryFree(m, l->slots, sizeof(RowSlot) * (l->mask + 1));
+  MemoryFree(m, l, sizeof(DeltaLayer));
+}
+
+// Allocates a base with room for n vertices and the given number of
+// stored edges. Returns NULL on memory error.
+DeltaBase *NewDeltaBase(size_t n, size_t edges) {
+  DeltaBase *b;
+
+  b = (DeltaBase *)calloc(1, sizeof(DeltaBase));
+  if (b == NULL) {
+    return NULL;
+  }
+  b->n = n;
+  b->vertices = (GVertex_t *)malloc(sizeof(GVertex_t) * (n + 1));
+  b->offsets = (size_t *)calloc(n + 1, sizeof(size_t));
+  b->targets = (GVertex_t *)malloc(sizeof(GVertex_t) * (edges + 1));
+#if GRAPH_WEIGHT != GRAPH_WEIGHT_NONE
+  b->weights = (GWeight_t *)malloc(sizeof(GWeight_t) * (edges + 1));
+  if (b->weights == NULL) {
+    FreeDeltaBase(b);
+    return NULL;
+  }
+#endif
+  if (b->vertices == NULL || b->offsets == NULL || b->targets == NULL) {
+    FreeDeltaBase(b);
+    return NULL;
+  }
+  return b;
+}
+
+void FreeDeltaBase(DeltaBase *b) {
+  if (b == NULL) {
+    return;
+  }
+  free(b->vertices);
+  free(b->offsets);
+  free(b->targets);
+  free(b->weights);
+  free(b);
+}
+
+// Returns the row for v in the given overlay, or NULL if it has none.
+DeltaRow *FindDeltaRow(const DeltaLayer *l, GVertex_t v) {
+  uint64_t h = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+  uint32_t i;
+
+  for (i = h >> l->shift; l->slots[i].row != NULL; i = (i + 1) & l->mask) {
+    if (l->slots[i].key == v) {
+      return l->slots[i].row;
+    }
+  }
+  return NULL;
+}
+
+// Adds an empty row for v, which must not have one, to the given overlay.
+// Returns the row, or NULL on memory error.
+DeltaRow *AddDeltaRow(GraphMemory *m, DeltaLayer *l, GVertex_t v) {
+  RowSlot *old, *slots;
+  uint32_t oldSlots, i, j;
+  DeltaRow *row;
+  uint64_t h;
+
+  if (2 * (uint32_t)(l->rows + 1) > l->mask + 1) {
+    oldSlots = l->mask + 1;
+    slots = (RowSlot *)MemoryCalloc(m, sizeof(RowSlot) * 2 * oldSlots);
+    if (slots == NULL) {
+      return NULL;
+    }
+    old = l->slots;
+    l->slots = slots;
+    l->mask = 2 * oldSlots - 1;
+    l->shift--;
+    for (i = 0; i < oldSlots; i++) {
+      if (old[i].row == NULL) {
+        continue;
+      }
+      h = (uint64_t)old[i].key * 0x9E3779B97F4A7C15ULL;
+      for (j = h >> l->shift; slots[j].row != NULL; j = (j + 1) & l->mask) {
+      }
+      slots[j] = old[i];
+    }
+    MemoryFree(m, old, sizeof(RowSlot) * oldSlots);
+  }
+
+  row = (DeltaRow *)MemoryCalloc(m, sizeof(DeltaRow));
+  if (row == NULL) {
+    return NULL;
+  }
+  row->v = v;
+  h = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+  for (i = h >> l->shift; l->slots[i].row != NULL; i = (i + 1) & l->mask) {
+  }
+  l->slots[i].key = v;
+  l->slots[i].row = row;
+  l->rows++;
+  return row;
+}
+
+// Returns the position of the entry for v in the row, setting found, or if
+// there is none, the position where it would go.
+int FindDeltaEdge(const DeltaRow *r, GVertex_t v, bool *found) {
+  int lo = 0, hi = r->count, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (r->edges[mid].v < v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *found = (lo < r->count && r->edges[lo].v == v);
+  return lo;
+}
+
+// Makes sure the row has room for one more entry. Returns false on memory
+// error.
+bool ReserveDeltaEdge(GraphMemory *m, DeltaRow *r) {
+  DeltaEdge *edges;
+  int capacity;
+
+  if (r->count < r->capacity) {
+    return true;
+  }
+  if (r->capacity == 0) {
+    capacity = 4;
+    edges = (DeltaEdge *)MemoryAlloc(m, sizeof(DeltaEdge) * capacity);
+  } else {
+    capacity = 2 * r->capacity;
+    edges = (DeltaEdge *)MemoryRealloc(m, r->edges,
+                                       sizeof(DeltaEdge) * r->capacity,
+                                       sizeof(DeltaEdge) * capacity);
+  }
+  if (edges == NULL) {
+    return false;
+  }
+  r->edges = edges;
+  r->capacity = capacity;
+  return true;
+}
+
+// Sets the row's entry for v, adding it if need be. The row must have room
+// for it (see ReserveDeltaEdge).
+void PutDeltaEdge(DeltaLayer *l, DeltaRow *r, GVertex_t v, GWeight_t w,
+                  bool removed) {
+  bool found;
+  int i;
+
+  i = FindDeltaEdge(r, v, &found);
+  if (!found) {
+    memmove(&r->edges[i + 1], &r->edges[i],
+            sizeof(DeltaEdge) * (r->count - i));
+    r->count++;
+    l->entries++;
+  }
+  r->edges[i].v = v;
+  r->edges[i].weight = w;
+  r->edges[i].removed = removed;
+}
+
+// Returns the index of v in the base, or -1 if it is not there.
+long FindBaseVertex(const DeltaBase *b, GVertex_t v) {
+  size_t lo = 0, hi = b->n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (b->vertices[mid] < v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < b->n && b->vertices[lo] == v) ? (long)lo : -1;
+}
+
+// Returns true if any layer has v. The caller holds the lock.
+bool HasVertex(DeltaGraph d, GVertex_t v) {
+  return FindDeltaRow(d->layers[0], v) != NULL ||
+    (d->layers[1] != NULL && FindDeltaRow(d->layers[1], v) != NULL) ||
+    FindBaseVertex(d->base, v) != -1;
+}
+
+// Returns the live overlay's row for v, adding v to the DeltaGraph if no
+// layer has it. Returns NULL on memory error. The caller holds the lock
+// exclusively.
+DeltaRow *LiveRow(DeltaGraph d, GVertex_t v) {
+  DeltaRow *row;
+  bool isNew;
+
+  row = FindDeltaRow(d->layers[0], v);
+  if (row != NULL) {
+    return row;
+  }
+  isNew = !HasVertex(d, v);
+  row = AddDeltaRow(&d->memory, d->layers[0], v);
+  if (row != NULL && isNew) {
+    d->vertices++;
+  }
+  return row;
+}
+
+// Takes v's row back out of the live overlay, for an update that added it
+// with LiveRow and then failed, so that the row holds no entries; and v
+// with it, if no other layer has v. The caller holds the lock exclusively.
+void DropLiveRow(DeltaGraph d, GVertex_t v) {
+  DeltaLayer *l = d->layers[0];
+  uint32_t i, j, home;
+  DeltaRow *row;
+  uint64_t h;
+
+  h = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+  for (i = h >> l->shift; l->slots[i].row != NULL; i = (i + 1) & l->mask) {
+    if (l->slots[i].key == v) {
+      break;
+    }
+  }
+  row = l->slots[i].row;
+  if (row == NULL) {
+    return;
+  }
+  MemoryFree(&d->memory, row->edges, sizeof(DeltaEdge) * row->capacity);
+  MemoryFree(&d->memory, row, sizeof(DeltaRow));
+  l->rows--;
+
+  // close the gap, moving back every later row in the probe run that may
+  // sit in it
+  for (j = (i + 1) & l->mask; l->slots[j].row != NULL;
+       j = (j + 1) & l->mask) {
+    h = (uint64_t)l->slots[j].key * 0x9E3779B97F4A7C15ULL;
+    home = h >> l->shift;
+    if (((j - home) & l->mask) >= ((j - i) & l->mask)) {
+      l->slots[i] = l->slots[j];
+      i = j;
+    }
+  }
+  l->slots[i].row = NULL;
+
+  if (!HasVertex(d, v)) {
+    d->vertices--;
+  }
+}
+
+// Returns true if the edge from v1 to v2 exists, looking through the
+// overlays from the given one down, then the base. The caller holds the
+// lock (or, from a merge, mergeLock, if starting below the live overlay).
+bool LookupEdge(DeltaGraph d, int layer, GVertex_t v1, GVertex_t v2) {
+  const DeltaRow *row;
+  const DeltaBase *b = d->base;
+  size_t lo, hi, mid;
+  bool found;
+  long index;
+  int i;
+
+  for (; layer < 2 && d->layers[layer] != NULL; layer++) {
+    row = FindDeltaRow(d->layers[layer], v1);
+    if (row != NULL) {
+      i = FindDeltaEdge(row, v2, &found);
+      if (found) {
+        return !row->edges[i].removed;
+      }
+    }
+  }
+
+  index = FindBaseVertex(b, v1);
+  if (index == -1) {
+    return false;
+  }
+  lo = b->offsets[index];
+  hi = b->offsets[index + 1];
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (b->targets[mid] < v2) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo < b->offsets[index + 1] && b->targets[lo] == v2;
+}
+
+// Removes the edge from v1 to v2 from the live overlay's row r for v1. If
+// a lower layer holds the edge, it takes a tombstone; otherwise the edge
+// only lives in the row, and is simply dropped. The caller holds the lock
+// exclusively, and has reserved room in the row.
+void RemoveDeltaEdge(DeltaGraph d, DeltaRow *r, GVertex_t v1, GVertex_t v2) {
+  bool found;
+  int i;
+
+  if (LookupEdge(d, 1, v1, v2)) {
+    PutDeltaEdge(d->layers[0], r, v2, 0, true);
+    return;
+  }
+  i = FindDeltaEdge(r, v2, &found);
+  if (found) {
+    memmove(&r->edges[i], &r->edges[i + 1],
+            sizeof(DeltaEdge) * (r->count - i - 1));
+    r->count--;
+    d->layers[0]->entries--;
+  }
+}
+
+// Points an iterator at the given rows of each layer. An index of -1 or a
+// NULL row leaves that layer out.
+void StartIterator(DeltaNeighborIterator *it, const DeltaBase *b,
+                   long index, const DeltaRow *live, const DeltaRow *merging) {
+  const DeltaRow *rows[2] = {live, merging};
+  int i;
+
+  memset(it, 0, sizeof(DeltaNeighborIterator));
+  it->baseTargets = b->targets;
+  it->baseWeights = b->weights;
+  if (index != -1) {
+    it->basePos = b->offsets[index];
+    it->baseEnd = b->offsets[index + 1];
+  }
+  for (i = 0; i < 2; i++) {
+    if (rows[i] != NULL) {
+      it->delta[i] = rows[i]->edges;
+      it->deltaEnd[i] = rows[i]->edges + rows[i]->count;
+    }
+  }
+}
+
+// Wakes the background merger if the live overlay, which an update has
+// just left with the given number of entries, has outgrown the threshold.
+void RequestMerge(DeltaGraph d, size_t entries) {
+  if (!d->hasMerger || entries < d->threshold) {
+    return;
+  }
+
+  pthread_mutex_lock(&d->signalLock);
+  if (!d->pending) {
+    d->pending = true;
+    pthread_cond_signal(&d->signal);
+  }
+  pthread_mutex_unlock(&d->signalLock);
+}
+
+// The background merger: merges whenever asked to, until the DeltaGraph is
+// freed.
+void *MergerThread(void *arg) {
+  DeltaGraph d = (DeltaGraph)arg;
+
+  for (;;) {
+    pthread_mutex_lock(&d->signalLock);
+    while (!d->pending && !d->stopping) {
+      pthread_cond_wait(&d->signal, &d->signalLock);
+    }
+    if (d->stopping) {
+      pthread_mutex_unlock(&d->signalLock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&d->signalLock);
+
+    // on memory error the overlay just stays as it is until the next try
+    MergeDeltaGraph(d);
+
+    // updates made during the merge may have asked again; they are in the
+    // new live overlay, which is checked afresh on the next update
+    pthread_mutex_lock(&d->signalLock);
+    d->pending = false;
+    pthread_mutex_unlock(&d->signalLock);
+  }
+}
+
+// Folds the overlays into a new base. The caller holds mergeLock. Returns
+// -1 on memory error, 0 on success.
+int Merge(DeltaGraph d) {
+  DeltaLayer *fresh, *merged;
+  DeltaBase *base, *old;
+
+  // set the live overlay aside, unless a failed merge left one there
+  pthread_rwlock_wrlock(&d->lock);
+  if (d->layers[1] == NULL) {
+    if (d->layers[0]->entries == 0 && d->layers[0]->rows == 0) {
+      pthread_rwlock_unlock(&d->lock);
+      return 0;
+    }
+    fresh = NewDeltaLayer(&d->memory);
+    if (fresh == NULL) {
+      pthread_rwlock_unlock(&d->lock);
+      return -1;
+    }
+    d->layers[1] = d->layers[0];
+    d->layers[0] = fresh;
+  }
+  pthread_rwlock_unlock(&d->lock);
+
+  // nothing else replaces the base or the overlay being merged, so both
+  // can be read without the lock
+  base = BuildMergedBase(d->base, d->layers[1]);
+  if (base == NULL) {
+    return -1;
+  }
+
+  pthread_rwlock_wrlock(&d->lock);
+  old = d->base;
+  merged = d->layers[1];
+  d->base = base;
+  d->layers[1] = NULL;
+  d->merges++;
+  FreeDeltaLayer(&d->memory, merged);
+  pthread_rwlock_unlock(&d->lock);
+
+  FreeDeltaBase(old);
+  return 0;
+}
+
+// Builds the base that results from applying the given overlay to the
+// given base. Returns NULL on memory error.
+DeltaBase *BuildMergedBase(const DeltaBase *b, const DeltaLayer *l) {
+  DeltaNeighborIterator it;
+  const DeltaRow *row;
+  GVertex_t *touched;
+  DeltaBase *merged;
+  Neighbor n;
+  size_t i = 0, j = 0, k = 0, count = 0, pos = 0;
+  uint32_t s;
+  GVertex_t v;
+
+  // the overlay's vertices, sorted, so they can be merged with the base's
+  touched = (GVertex_t *)malloc(sizeof(GVertex_t) * (l->rows + 1));
+  if (touched == NULL) {
+    return NULL;
+  }
+  for (s = 0; s <= l->mask; s++) {
+    if (l->slots[s].row != NULL) {
+      touched[count++] = l->slots[s].key;
+    }
+  }
+  qsort(touched, count, sizeof(GVertex_t), CompareVertices);
+
+  // size for the worst case, where no entry cancels a base edge
+  merged = NewDeltaBase(b->n + count, b->offsets[b->n] + l->entries);
+  if (merged == NULL) {
+    free(touched);
+    return NULL;
+  }
+
+  while (i < b->n || j < count) {
+    if (j == count || (i < b->n && b->vertices[i] < touched[j])) {
+      v = b->vertices[i];
+    } else {
+      v = touched[j];
+    }
+    row = (j < count && touched[j] == v) ? FindDeltaRow(l, v) : NULL;
+    StartIterator(&it, b, (i < b->n && b->vertices[i] == v) ? (long)i : -1,
+                  row, NULL);
+
+    merged->vertices[k] = v;
+    merged->offsets[k] = pos;
+    while (NextDeltaNeighbor(&it, &n)) {
+      merged->targets[pos] = n.v;
+      if (merged->weights != NULL) {
+        merged->weights[pos] = n.weight;
+      }
+      pos++;
+    }
+    k++;
+    if (i < b->n && b->vertices[i] == v) {
+      i++;
+    }
+    if (j < count && touched[j] == v) {
+      j++;
+    }
+  }
+  merged->n = k;
+  merged->offsets[k] = pos;
+
+  free(touched);
+  return merged;
+}
+
+int CompareVertices(const void *a, const void *b) {
+  GVertex_t x = *(const GVertex_t *)a, y = *(const GVertex_t *)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,136 @@
+// A Graph kept as an immutable, contiguous base with a delta overlay of
+// recent updates, for workloads that want the read performance of a
+// snapshot while updates keep arriving.
+//
+// The base is a compressed sparse row snapshot: one sorted array of
+// vertices, and for each vertex a sorted run of neighbors in a shared
+// array. It is never modified. Updates go into the overlay instead, which
+// holds, for each vertex it touches, a sorted run of inserted edges and
+// tombstones for removed ones. Reads merge the overlay with the base on the
+// fly.
+//
+// Once the overlay holds more entries than the merge threshold, a
+// background thread folds it into a new base. The overlay being folded is
+// set aside, and later updates start a fresh one, so updates and reads
+// carry on while the new base is built; only swapping it in takes the
+// DeltaGraph exclusively.
+//
+// A DeltaGraph is safe to use from several threads at once. Reads run
+// concurrently; updates take the DeltaGraph exclusively for as long as they
+// take to apply to the overlay. Edges follow the same rules as in a Graph
+// (see Graph.h), and a DeltaGraph may be directed, but it stores no
+// payloads.
+
+#ifndef _DELTA_GRAPH_H_
+#define _DELTA_GRAPH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./Graph.h"
+#include "./GraphAllocator.h"
+
+struct deltagraph;
+typedef struct deltagraph *DeltaGraph;
+
+struct DeltaEdge;
+
+// The merge threshold used when none is given: the number of overlay
+// entries past which a background merge starts.
+#define DELTA_DEFAULT_THRESHOLD 65536
+
+// Walks the neighbors of one vertex, merging the overlay with the base as
+// it goes. The fields are private to DeltaGraph.c.
+typedef struct DeltaNeighborIterator {
+  DeltaGraph               g;
+  const GVertex_t         *baseTargets;
+  const GWeight_t         *baseWeights;
+  size_t                   basePos;
+  size_t                   baseEnd;
+  const struct DeltaEdge  *delta[2];     // the live overlay, then the one
+  const struct DeltaEdge  *deltaEnd[2];  // being merged
+} DeltaNeighborIterator;
+
+// A summary of a DeltaGraph.
+//
+//    -- vertices      the number of vertices.
+//    -- edges         the number of edges (each undirected edge once).
+//    -- baseEdges     the number of edges stored in the base (each
+//                     undirected edge twice).
+//    -- deltaEntries  the number of entries in the overlay, tombstones
+//                     included (each undirected edge twice).
+//    -- merges        the number of merges completed so far.
+typedef struct DeltaGraphSummary {
+  int    vertices;
+  long   edges;
+  size_t baseEdges;
+  size_t deltaEntries;
+  long   merges;
+} DeltaGraphSummary;
+
+// Allocates an empty DeltaGraph.
+//
+// Arguments:
+//
+//    -- directed   whether edges run one way only.
+//    -- threshold  the number of overlay entries past which a background
+//                  merge starts, or 0 to merge only when asked to (see
+//                  MergeDeltaGraph).
+//
+// Returns NULL on memory error.
+DeltaGraph AllocateDeltaGraph(bool directed, size_t threshold);
+
+// Allocates an empty DeltaGraph whose overlay takes its memory from the
+// given allocator, which must outlive it. The base always comes from
+// malloc. Returns NULL on memory error.
+DeltaGraph AllocateDeltaGraphWithAllocator(bool directed, size_t threshold,
+                                           const GraphAllocator *a);
+
+// Allocates a DeltaGraph whose base is a snapshot of the given Graph, and
+// which is directed if the Graph is. The Graph is left alone. Returns NULL
+// on memory error.
+DeltaGraph FreezeGraph(Graph g, size_t threshold);
+
+// Frees a DeltaGraph, waiting for any merge in progress to finish first.
+void FreeDeltaGraph(DeltaGraph d);
+
+// Returns true if the DeltaGraph was allocated directed.
+bool IsDirectedDeltaGraph(DeltaGraph d);
+
+// The counterparts of the Graph functions of the same names (see Graph.h),
+// with the same arguments and return values. DeltaRemoveEdge returns -1 on
+// memory error (removing an edge from the base takes a tombstone), and 0
+// otherwise.
+int DeltaAddVertex(DeltaGraph d, GVertex_t v);
+bool DeltaContainsVertex(DeltaGraph d, GVertex_t v);
+bool DeltaAreAdjacent(DeltaGraph d, GVertex_t v1, GVertex_t v2);
+int DeltaGetNeighbors(DeltaGraph d, GVertex_t v, Neighbor **out);
+int DeltaAddEdge(DeltaGraph d, GVertex_t v1, GVertex_t v2, GWeight_t w);
+int DeltaRemoveEdge(DeltaGraph d, GVertex_t v1, GVertex_t v2);
+
+// Starts walking the neighbors of v, in increasing order. The DeltaGraph
+// cannot be updated until the walk is ended, so keep walks short, and do
+// not update the DeltaGraph from the thread walking it.
+//
+// Every call must be matched by a call to EndDeltaNeighbors, whatever it
+// returns. Returns false if v is not in the DeltaGraph, in which case the
+// walk is empty.
+bool StartDeltaNeighbors(DeltaGraph d, GVertex_t v,
+                         DeltaNeighborIterator *it);
+
+// Places the next neighbor of the walk in n. Returns false once there are
+// no more neighbors.
+bool NextDeltaNeighbor(DeltaNeighborIterator *it, Neighbor *n);
+
+// Ends a walk started by StartDeltaNeighbors.
+void EndDeltaNeighbors(DeltaNeighborIterator *it);
+
+// Folds the overlay into a new base now, in the calling thread, waiting
+// for any background merge in progress first. Returns -1 on memory error,
+// in which case the DeltaGraph is unchanged, and 0 on success.
+int MergeDeltaGraph(DeltaGraph d);
+
+// Summarizes the DeltaGraph.
+void GetDeltaGraphSummary(DeltaGraph d, DeltaGraphSummary *out);
+
+#endif
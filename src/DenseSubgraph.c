@@ -0,0 +1,747 @@
+// Implementation of k-core decomposition and maximal clique enumeration.
+//
+// Both start by copying the adjacency into arrays indexed by vertex id (an
+// IdGraph), since following the Graph's lists would cost a vertex lookup
+// per edge every time an edge is looked at, rather than once.
+//
+// The sequential decomposition is Batagelj and Zaversnik's: vertices are
+// kept in an array sorted by current degree, with the start of each degree's
+// bucket recorded, so that a vertex whose degree drops moves to the front
+// of its bucket, then out of it, in constant time. The order in which the
+// vertices leave is a degeneracy order.
+//
+// The parallel one is a round per core number k: every thread collects the
+// vertices of degree k in its share of the ids, then peels them, lowering
+// the degrees of their neighbors with atomic operations. A neighbor whose
+// degree falls to k is peeled in the same round by the thread that lowered
+// it; one already at k is left alone, undoing the decrement.
+//
+// Clique searches keep their candidates (P) and excluded vertices (X) as
+// arrays of ids, tested for adjacency by binary search in the sorted
+// adjacency arrays, until both together fit a bitset. From there the
+// search copies the adjacency of just those vertices into a bitset matrix,
+// and carries on with P and X as bitsets, one pair per level of recursion.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./DenseSubgraph.h"
+#include "./GraphBuilder_priv.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+// Searches on at most this many vertices use a bitset matrix.
+#define BITSET_LIMIT 256
+#define BITSET_WORDS (BITSET_LIMIT / 64)
+
+// The adjacency of a Graph, by vertex id.
+typedef struct IdGraph {
+  int        n;
+  int        maxDegree;
+  ListItem **items;    // the vertex of each id
+  size_t    *offsets;  // where each id's neighbors start in adj; n + 1
+  int       *adj;      // the ids of each id's neighbors
+} IdGraph;
+
+// The state shared by the threads of a parallel decomposition. The threads
+// wait at the gate until the number that started is known.
+typedef struct PeelShared {
+  const IdGraph     *ig;
+  int               *degrees;
+  int                threads;
+  int                level;
+  long               peeled;
+  bool               ready;
+  pthread_mutex_t    lock;
+  pthread_cond_t     gate;
+  pthread_barrier_t  barrier;
+} PeelShared;
+
+typedef struct PeelTask {
+  PeelShared *shared;
+  int         t;
+  int        *buffer;  // the vertices this thread peels in a round
+} PeelTask;
+
+// The state of a clique enumeration. The clique being grown is R in the
+// literature.
+typedef struct CliqueSearch {
+  const IdGraph  *ig;
+  int             minSize;
+  CliqueCallback  fn;
+  void           *arg;
+  long            found;
+  bool            stopped;
+  bool            failed;
+
+  int            *clique;   // ids of the clique so far
+  int             size;
+  GVertex_t      *report;   // the clique as vertices, to pass to fn
+
+  // the bitset search: its vertices, the bitset index of each id in it
+  // (-1 for the rest), their adjacency matrix, and P and X at each level
+  int            *members;
+  int            *local;
+  uint64_t       *matrix;
+  uint64_t       *levels;
+} CliqueSearch;
+
+// Helper function declarations
+bool BuildIdGraph(Graph g, bool sorted, IdGraph *ig);
+void FreeIdGraph(IdGraph *ig);
+int CompareIds(const void *a, const void *b);
+bool HasNeighbor(const IdGraph *ig, int u, int v);
+bool PeelCores(const IdGraph *ig, int *cores, int *order);
+void PeelShare(const IdGraph *ig, int threads, int t, int *start, int *end);
+void *PeelThread(void *arg);
+void PeelRounds(PeelTask *task);
+void ReportClique(CliqueSearch *s);
+void ArraySearch(CliqueSearch *s, int *p, int np, int *x, int nx);
+int ArrayPivot(CliqueSearch *s, const int *p, int np, const int *x, int nx);
+void BitsetSearch(CliqueSearch *s, const int *p, int np, const int *x,
+                  int nx);
+void BitsetLevel(CliqueSearch *s, int depth, int words);
+
+int GetCoreNumbers(Graph g, VertexCore **out) {
+  IdGraph ig;
+  int *cores, *order;
+  int i, ret;
+
+  if (g->directed) {
+    return -1;
+  }
+  if (g->numVertices == 0) {
+    return 0;
+  }
+  if (!BuildIdGraph(g, false, &ig)) {
+    return -2;
+  }
+  if (ig.n == 0) {
+    // a view showing no vertices
+    FreeIdGraph(&ig);
+    return 0;
+  }
+
+  ret = -2;
+  cores = (int *)malloc(sizeof(int) * ig.n);
+  order = (int *)malloc(sizeof(int) * ig.n);
+  *out = (VertexCore *)malloc(sizeof(VertexCore) * ig.n);
+  if (cores != NULL && order != NULL && *out != NULL &&
+      PeelCores(&ig, cores, order)) {
+    for (i = 0; i < ig.n; i++) {
+      (*out)[i].v = ig.items[order[i]]->data;
+      (*out)[i].core = cores[order[i]];
+    }
+    ret = ig.n;
+  } else {
+    free(*out);
+  }
+
+  free(cores);
+  free(order);
+  FreeIdGraph(&ig);
+  return ret;
+}
+
+int GetCoreNumbersParallel(Graph g, int threads, VertexCore **out) {
+  PeelShared shared;
+  PeelTask *tasks;
+  pthread_t *ids;
+  IdGraph ig;
+  int i, t, started, ret = -2;
+
+  if (g->directed) {
+    return -1;
+  }
+  if (g->numVertices == 0) {
+    return 0;
+  }
+  if (!BuildIdGraph(g, false, &ig)) {
+    return -2;
+  }
+  if (ig.n == 0) {
+    // a view showing no vertices
+    FreeIdGraph(&ig);
+    return 0;
+  }
+
+  threads = GraphThreads(threads);
+  memset(&shared, 0, sizeof(PeelShared));
+  shared.ig = &ig;
+  shared.degrees = (int *)malloc(sizeof(int) * ig.n);
+  tasks = (PeelTask *)calloc(threads, sizeof(PeelTask));
+  ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+  *out = (VertexCore *)malloc(sizeof(VertexCore) * ig.n);
+  if (shared.degrees == NULL || tasks == NULL || ids == NULL ||
+      *out == NULL) {
+    goto done;
+  }
+  for (t = 0; t < threads; t++) {
+    tasks[t].shared = &shared;
+    tasks[t].t = t;
+    tasks[t].buffer = (int *)malloc(sizeof(int) * ig.n);
+    if (tasks[t].buffer == NULL) {
+      goto done;
+    }
+  }
+  for (i = 0; i < ig.n; i++) {
+    shared.degrees[i] = (int)(ig.offsets[i + 1] - ig.offsets[i]);
+  }
+
+  // start the threads, then open the gate for however many started
+  pthread_mutex_init(&shared.lock, NULL);
+  pthread_cond_init(&shared.gate, NULL);
+  for (started = 1; started < threads; started++) {
+    if (pthread_create(&ids[started], NULL, PeelThread,
+                       &tasks[started]) != 0) {
+      break;
+    }
+  }
+  shared.threads = started;
+  pthread_barrier_init(&shared.barrier, NULL, started);
+  pthread_mutex_lock(&shared.lock);
+  shared.ready = true;
+  pthread_cond_broadcast(&shared.gate);
+  pthread_mutex_unlock(&shared.lock);
+
+  PeelRounds(&tasks[0]);
+  for (t = 1; t < started; t++) {
+    pthread_join(ids[t], NULL);
+  }
+  pthread_barrier_destroy(&shared.barrier);
+  pthread_cond_destroy(&shared.gate);
+  pthread_mutex_destroy(&shared.lock);
+
+  for (i = 0; i < ig.n; i++) {
+    (*out)[i].v = ig.items[i]->data;
+    (*out)[i].core = shared.degrees[i];
+  }
+  ret = ig.n;
+
+done:
+  if (ret < 0) {
+    free(*out);
+  }
+  for (t = 0; tasks != NULL && t < threads; t++) {
+    free(tasks[t].buffer);
+  }
+  free(tasks);
+  free(ids);
+  free(shared.degrees);
+  FreeIdGraph(&ig);
+  return ret;
+}
+
+long ForEachMaximalClique(Graph g, int minSize, CliqueCallback fn,
+                          void *arg) {
+  CliqueSearch s;
+  IdGraph ig;
+  int *cores = NULL, *order = NULL, *rank = NULL, *p = NULL, *x = NULL;
+  int i, v, u, np, nx;
+  size_t e;
+
+  if (g->directed) {
+    return -1;
+  }
+  if (g->numVertices == 0) {
+    return 0;
+  }
+  if (!BuildIdGraph(g, true, &ig)) {
+    return -2;
+  }
+  if (ig.n == 0) {
+    // a view showing no vertices
+    FreeIdGraph(&ig);
+    return 0;
+  }
+
+  memset(&s, 0, sizeof(CliqueSearch));
+  s.ig = &ig;
+  s.minSize = minSize;
+  s.fn = fn;
+  s.arg = arg;
+  cores = (int *)malloc(sizeof(int) * ig.n);
+  order = (int *)malloc(sizeof(int) * ig.n);
+  rank = (int *)malloc(sizeof(int) * ig.n);
+  p = (int *)malloc(sizeof(int) * (ig.maxDegree + 1));
+  x = (int *)malloc(sizeof(int) * (ig.maxDegree + 1));
+  s.clique = (int *)malloc(sizeof(int) * (ig.n + 1));
+  s.report = (GVertex_t *)malloc(sizeof(GVertex_t) * (ig.n + 1));
+  s.members = (int *)malloc(sizeof(int) * BITSET_LIMIT);
+  s.local = (int *)malloc(sizeof(int) * ig.n);
+  s.matrix = (uint64_t *)malloc(sizeof(uint64_t) * BITSET_LIMIT *
+                                BITSET_WORDS);
+  s.levels = (uint64_t *)malloc(sizeof(uint64_t) * (BITSET_LIMIT + 2) * 2 *
+                                BITSET_WORDS);
+  if (cores == NULL || order == NULL || rank == NULL || p == NULL ||
+      x == NULL || s.clique == NULL || s.report == NULL ||
+      s.members == NULL || s.local == NULL || s.matrix == NULL ||
+      s.levels == NULL || !PeelCores(&ig, cores, order)) {
+    s.failed = true;
+    goto done;
+  }
+  for (i = 0; i < ig.n; i++) {
+    rank[order[i]] = i;
+    s.local[i] = -1;
+  }
+
+  // start from each vertex in degeneracy order, with its later neighbors
+  // as candidates and its earlier ones excluded, as their searches have
+  // found every clique holding them
+  for (i = 0; i < ig.n && !s.stopped; i++) {
+    v = order[i];
+    np = nx = 0;
+    for (e = ig.offsets[v]; e < ig.offsets[v + 1]; e++) {
+      u = ig.adj[e];
+      if (rank[u] > i) {
+        p[np++] = u;
+      } else {
+        x[nx++] = u;
+      }
+    }
+    s.clique[0] = v;
+    s.size = 1;
+    ArraySearch(&s, p, np, x, nx);
+  }
+
+done:
+  free(cores);
+  free(order);
+  free(rank);
+  free(p);
+  free(x);
+  free(s.clique);
+  free(s.report);
+  free(s.members);
+  free(s.local);
+  free(s.matrix);
+  free(s.levels);
+  FreeIdGraph(&ig);
+  return s.failed ? -2 : s.found;
+}
+
+// Copies the adjacency of a Graph into an IdGraph, with each vertex's
+// neighbors sorted by id if asked for. The ids are the Graph's, unless it
+// is a view, whose vertices are numbered afresh so that hidden ones take
+// no room. Returns false on memory error.
+bool BuildIdGraph(Graph g, bool sorted, IdGraph *ig) {
+  ListItem *l;
+  EdgeItem *edge;
+  int *number;
+  size_t e;
+  int v, degree;
+
+  number = (int *)malloc(sizeof(int) * (g->numVertices + 1));
+  ig->items = (ListItem **)malloc(sizeof(ListItem *) *
+                                  (g->numVertices + 1));
+  ig->offsets = (size_t *)malloc(sizeof(size_t) * (g->numVertices + 1));
+  ig->adj = (int *)malloc(sizeof(int) * (2 * g->numEdges + 1));
+  if (number == NULL || ig->items == NULL || ig->offsets == NULL ||
+      ig->adj == NULL) {
+    free(number);
+    FreeIdGraph(ig);
+    return false;
+  }
+
+  ig->n = 0;
+  for (l = g->front; l != NULL; l = l->next) {
+    if (VertexVisible(g, l)) {
+      number[l->id] = ig->n;
+      ig->items[ig->n++] = l;
+    }
+  }
+  ig->maxDegree = 0;
+  ig->offsets[0] = 0;
+  for (v = 0; v < ig->n; v++) {
+    e = ig->offsets[v];
+    for (edge = ig->items[v]->neighbors; edge != NULL; edge = edge->next) {
+      if (EdgeVisible(g, ig->items[v], edge, false)) {
+        ig->adj[e++] = number[FindVertex(g, edge->data)->id];
+      }
+    }
+    ig->offsets[v + 1] = e;
+    degree = (int)(e - ig->offsets[v]);
+    if (degree > ig->maxDegree) {
+      ig->maxDegree = degree;
+    }
+    if (sorted) {
+      qsort(ig->adj + ig->offsets[v], degree, sizeof(int), CompareIds);
+    }
+  }
+  free(number);
+  return true;
+}
+
+void FreeIdGraph(IdGraph *ig) {
+  free(ig->items);
+  free(ig->offsets);
+  free(ig->adj);
+}
+
+int CompareIds(const void *a, const void *b) {
+  int x = *(const int *)a, y = *(const int *)b;
+
+  return (x > y) - (x < y);
+}
+
+// Returns true if u and v are adjacent, by binary search in u's sorted
+// neighbors.
+bool HasNeighbor(const IdGraph *ig, int u, int v) {
+  size_t lo = ig->offsets[u], hi = ig->offsets[u + 1], mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (ig->adj[mid] < v) {
+      lo = mid + 1;
+    } else if (ig->adj[mid] > v) {
+      hi = mid;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Computes the core number of every id, and a degeneracy order of the ids,
+// in which their core numbers never decrease. Returns false on memory
+// error.
+bool PeelCores(const IdGraph *ig, int *cores, int *order) {
+  int *bins, *pos;
+  int i, d, v, u, w, du, pu, pw, start, count;
+  size_t e;
+
+  bins = (int *)calloc(ig->maxDegree + 1, sizeof(int));
+  pos = (int *)malloc(sizeof(int) * ig->n);
+  if (bins == NULL || pos == NULL) {
+    free(bins);
+    free(pos);
+    return false;
+  }
+
+  // sort the ids by degree, with bins[d] the start of degree d's bucket
+  for (v = 0; v < ig->n; v++) {
+    cores[v] = (int)(ig->offsets[v + 1] - ig->offsets[v]);
+    bins[cores[v]]++;
+  }
+  for (start = 0, d = 0; d <= ig->maxDegree; d++) {
+    count = bins[d];
+    bins[d] = start;
+    start += count;
+  }
+  for (v = 0; v < ig->n; v++) {
+    pos[v] = bins[cores[v]]++;
+    order[pos[v]] = v;
+  }
+  for (d = ig->maxDegree; d > 0; d--) {
+    bins[d] = bins[d - 1];
+  }
+  bins[0] = 0;
+
+  // peel in order, moving each neighbor whose degree drops to the front of
+  // its bucket and then into the bucket below
+  for (i = 0; i < ig->n; i++) {
+    v = order[i];
+    for (e = ig->offsets[v]; e < ig->offsets[v + 1]; e++) {
+      u = ig->adj[e];
+      if (cores[u] <= cores[v]) {
+        continue;
+      }
+      du = cores[u];
+      pu = pos[u];
+      pw = bins[du];
+      w = order[pw];
+      if (u != w) {
+        pos[u] = pw;
+        order[pu] = w;
+        pos[w] = pu;
+        order[pw] = u;
+      }
+      bins[du]++;
+      cores[u]--;
+    }
+  }
+
+  free(bins);
+  free(pos);
+  return true;
+}
+
+// Places the range of ids that thread t of threads scans in [start, end).
+void PeelShare(const IdGraph *ig, int threads, int t, int *start, int *end) {
+  *start = (int)((long)ig->n * t / threads);
+  *end = (int)((long)ig->n * (t + 1) / threads);
+}
+
+void *PeelThread(void *arg) {
+  PeelTask *task = (PeelTask *)arg;
+  PeelShared *s = task->shared;
+
+  pthread_mutex_lock(&s->lock);
+  while (!s->ready) {
+    pthread_cond_wait(&s->gate, &s->lock);
+  }
+  pthread_mutex_unlock(&s->lock);
+
+  // a thread started after the one that failed has no share
+  if (task->t < s->threads) {
+    PeelRounds(task);
+  }
+  return NULL;
+}
+
+// Runs one thread's part of every round of a parallel decomposition.
+void PeelRounds(PeelTask *task) {
+  PeelShared *s = task->shared;
+  const IdGraph *ig = s->ig;
+  int *degrees = s->degrees;
+  int start, end, level, v, u, i, count, before;
+  size_t e;
+
+  PeelShare(ig, s->threads, task->t, &start, &end);
+  for (;;) {
+    level = s->level;
+    count = 0;
+    for (v = start; v < end; v++) {
+      if (degrees[v] == level) {
+        task->buffer[count++] = v;
+      }
+    }
+
+    // every thread must have collected its round before any degree drops
+    pthread_barrier_wait(&s->barrier);
+    for (i = 0; i < count; i++) {
+      v = task->buffer[i];
+      for (e = ig->offsets[v]; e < ig->offsets[v + 1]; e++) {
+        u = ig->adj[e];
+        if (__atomic_load_n(&degrees[u], __ATOMIC_RELAXED) <= level) {
+          continue;
+        }
+        before = __atomic_fetch_sub(&degrees[u], 1, __ATOMIC_RELAXED);
+        if (before == level + 1) {
+          task->buffer[count++] = u;
+        } else if (before <= level) {
+          __atomic_fetch_add(&degrees[u], 1, __ATOMIC_RELAXED);
+        }
+      }
+    }
+    __atomic_fetch_add(&s->peeled, count, __ATOMIC_RELAXED);
+
+    if (pthread_barrier_wait(&s->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+      s->level++;
+    }
+    pthread_barrier_wait(&s->barrier);
+    if (__atomic_load_n(&s->peeled, __ATOMIC_RELAXED) == ig->n) {
+      return;
+    }
+  }
+}
+
+// Reports the clique so far, if it is large enough.
+void ReportClique(CliqueSearch *s) {
+  int i;
+
+  if (s->size < s->minSize) {
+    return;
+  }
+  for (i = 0; i < s->size; i++) {
+    s->report[i] = s->ig->items[s->clique[i]]->data;
+  }
+  s->found++;
+  if (!s->fn(s->report, s->size, s->arg)) {
+    s->stopped = true;
+  }
+}
+
+// Extends the clique so far by candidates p, excluding x, with both as
+// arrays of ids. The x array has room for np more ids.
+void ArraySearch(CliqueSearch *s, int *p, int np, int *x, int nx) {
+  int *block, *candidates, *np2, *nx2;
+  int pivot, ncandidates, c, i, v, nnp, nnx;
+
+  if (np == 0) {
+    if (nx == 0) {
+      ReportClique(s);
+    }
+    return;
+  }
+  if (s->size + np < s->minSize) {
+    return;
+  }
+  if (np + nx <= BITSET_LIMIT) {
+    BitsetSearch(s, p, np, x, nx);
+    return;
+  }
+
+  block = (int *)malloc(sizeof(int) * (3 * np + nx));
+  if (block == NULL) {
+    s->failed = s->stopped = true;
+    return;
+  }
+  candidates = block;
+  np2 = block + np;
+  nx2 = block + 2 * np;
+
+  // only candidates not adjacent to the pivot need branching on: any
+  // clique holding none of them could take the pivot too
+  pivot = ArrayPivot(s, p, np, x, nx);
+  ncandidates = 0;
+  for (i = 0; i < np; i++) {
+    if (!HasNeighbor(s->ig, pivot, p[i])) {
+      candidates[ncandidates++] = p[i];
+    }
+  }
+
+  for (c = 0; c < ncandidates && !s->stopped; c++) {
+    v = candidates[c];
+    nnp = nnx = 0;
+    for (i = 0; i < np; i++) {
+      if (HasNeighbor(s->ig, v, p[i])) {
+        np2[nnp++] = p[i];
+      }
+    }
+    for (i = 0; i < nx; i++) {
+      if (HasNeighbor(s->ig, v, x[i])) {
+        nx2[nnx++] = x[i];
+      }
+    }
+    s->clique[s->size++] = v;
+    ArraySearch(s, np2, nnp, nx2, nnx);
+    s->size--;
+
+    // v's cliques are all found, so move it from p to x
+    for (i = 0; p[i] != v; i++) {
+    }
+    p[i] = p[--np];
+    x[nx++] = v;
+  }
+
+  free(block);
+}
+
+// Returns the vertex of p or x adjacent to the most of p.
+int ArrayPivot(CliqueSearch *s, const int *p, int np, const int *x, int nx) {
+  int best = p[0], bestCount = -1, count, u, i, j;
+
+  for (i = 0; i < np + nx; i++) {
+    u = (i < np) ? p[i] : x[i - np];
+    count = 0;
+    for (j = 0; j < np; j++) {
+      count += HasNeighbor(s->ig, u, p[j]);
+    }
+    if (count > bestCount) {
+      best = u;
+      bestCount = count;
+    }
+  }
+  return best;
+}
+
+// Extends the clique so far by candidates p, excluding x, which together
+// fit a bitset, by copying their adjacency into the matrix and searching
+// that.
+void BitsetSearch(CliqueSearch *s, const int *p, int np, const int *x,
+                  int nx) {
+  const IdGraph *ig = s->ig;
+  uint64_t *row, *level;
+  int m = np + nx, words = (np + nx + 63) / 64;
+  int a, b, u;
+  size_t e;
+
+  for (a = 0; a < m; a++) {
+    s->members[a] = (a < np) ? p[a] : x[a - np];
+    s->local[s->members[a]] = a;
+  }
+
+  // scan each member's neighbors for the others, or look the others up in
+  // them if there are fewer of those
+  for (a = 0; a < m; a++) {
+    row = &s->matrix[a * BITSET_WORDS];
+    memset(row, 0, sizeof(uint64_t) * words);
+    u = s->members[a];
+    if (ig->offsets[u + 1] - ig->offsets[u] <= (size_t)m) {
+      for (e = ig->offsets[u]; e < ig->offsets[u + 1]; e++) {
+        if ((b = s->local[ig->adj[e]]) >= 0) {
+          row[b / 64] |= 1ULL << (b % 64);
+        }
+      }
+    } else {
+      for (b = 0; b < m; b++) {
+        if (HasNeighbor(ig, u, s->members[b])) {
+          row[b / 64] |= 1ULL << (b % 64);
+        }
+      }
+    }
+  }
+  for (a = 0; a < m; a++) {
+    s->local[s->members[a]] = -1;
+  }
+
+  level = s->levels;
+  memset(level, 0, sizeof(uint64_t) * 2 * BITSET_WORDS);
+  for (a = 0; a < m; a++) {
+    level[(a < np ? 0 : BITSET_WORDS) + a / 64] |= 1ULL << (a % 64);
+  }
+  BitsetLevel(s, 0, words);
+}
+
+// Extends the clique so far by the candidates of the given level of the
+// bitset search, excluding its excluded set.
+void BitsetLevel(CliqueSearch *s, int depth, int words) {
+  uint64_t *p = &s->levels[depth * 2 * BITSET_WORDS];
+  uint64_t *x = p + BITSET_WORDS;
+  uint64_t *np = p + 2 * BITSET_WORDS, *nx = np + BITSET_WORDS;
+  uint64_t candidates[BITSET_WORDS], bits, *row;
+  int w, i, u, v, pivot = 0, count, best = -1, inP = 0, inX = 0;
+
+  for (w = 0; w < words; w++) {
+    inP += __builtin_popcountll(p[w]);
+    inX += __builtin_popcountll(x[w]);
+  }
+  if (inP == 0) {
+    if (inX == 0) {
+      ReportClique(s);
+    }
+    return;
+  }
+  if (s->size + inP < s->minSize) {
+    return;
+  }
+
+  for (w = 0; w < words; w++) {
+    for (bits = p[w] | x[w]; bits != 0; bits &= bits - 1) {
+      u = w * 64 + __builtin_ctzll(bits);
+      row = &s->matrix[u * BITSET_WORDS];
+      count = 0;
+      for (i = 0; i < words; i++) {
+        count += __builtin_popcountll(p[i] & row[i]);
+      }
+      if (count > best) {
+        best = count;
+        pivot = u;
+      }
+    }
+  }
+
+  row = &s->matrix[pivot * BITSET_WORDS];
+  for (w = 0; w < words; w++) {
+    candidates[w] = p[w] & ~row[w];
+  }
+  for (w = 0; w < words && !s->stopped; w++) {
+    for (bits = candidates[w]; bits != 0 && !s->stopped; bits &= bits - 1) {
+      v = w * 64 + __builtin_ctzll(bits);
+      row = &s->matrix[v * BITSET_WORDS];
+      for (i = 0; i < words; i++) {
+        np[i] = p[i] & row[i];
+        nx[i] = x[i] & row[i];
+      }
+      s->clique[s->size++] = s->members[v];
+      BitsetLevel(s, depth + 1, words);
+      s->size--;
+
+      p[w] &= ~(1ULL << (v % 64));
+      x[w] |= 1ULL << (v % 64);
+    }
+  }
+}
@@ -0,0 +1,87 @@
+// Dense subgraph detection on undirected Graphs: k-core decomposition and
+// maximal clique enumeration.
+//
+// The k-core of a Graph is the largest subgraph in which every vertex has
+// at least k neighbors, and a vertex's core number is the largest k whose
+// k-core holds it. The largest core number is the Graph's degeneracy.
+// Cores are computed by repeatedly peeling off the vertex of least degree,
+// with vertices kept in buckets by degree, in time linear in the size of
+// the Graph. The parallel variant instead peels every vertex of the
+// current least degree at once, one round per core number, with threads
+// sharing the vertices of each round.
+//
+// A clique is a set of vertices every two of which are adjacent, and is
+// maximal if no other vertex is adjacent to all of them. Cliques are
+// enumerated by Bron-Kerbosch with pivoting, started once from each vertex
+// in degeneracy order with the neighbors that come after it as candidates,
+// so that no search starts with more candidates than the degeneracy. A
+// search small enough works on a bitset adjacency matrix of just the
+// vertices it can reach, where each step is a few word operations; larger
+// ones work on sorted adjacency arrays.
+//
+// Both work on a copy of the adjacency numbered by dense vertex id, so the
+// Graph is only looked at while the copy is made. They must not run
+// concurrently with mutations of the Graph, like any other query.
+
+#ifndef _DENSE_SUBGRAPH_H_
+#define _DENSE_SUBGRAPH_H_
+
+#include <stdbool.h>
+
+#include "./Graph.h"
+
+// A vertex and its core number.
+typedef struct VertexCore {
+  GVertex_t v;
+  int       core;
+} VertexCore;
+
+// Computes the core number of every vertex of an undirected Graph.
+//
+// Arguments:
+//
+//    -- g    the Graph.
+//    -- out  location to store the core numbers in.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if the Graph is directed,
+//    otherwise the number of vertices.
+//
+// In the latter case, places an array of that many VertexCore in out, one
+// per vertex, in order of increasing core number. The array must be
+// free()'d, unless the Graph is empty, in which case out is untouched.
+int GetCoreNumbers(Graph g, VertexCore **out);
+
+// Computes the core numbers with the given number of threads (or one per
+// CPU, if 0). Takes and returns the same as GetCoreNumbers, but the
+// vertices come in no particular order.
+int GetCoreNumbersParallel(Graph g, int threads, VertexCore **out);
+
+// Called with each maximal clique found, which holds size vertices in no
+// particular order. The array is only valid during the call. Return false
+// to stop the enumeration.
+typedef bool (*CliqueCallback)(const GVertex_t *clique, int size, void *arg);
+
+// Enumerates the maximal cliques of an undirected Graph.
+//
+// Arguments:
+//
+//    -- g        the Graph.
+//    -- minSize  the fewest vertices a clique must have to be reported.
+//                Searches that cannot reach this size are cut short, so a
+//                larger minimum makes enumeration faster.
+//    -- fn       called with each clique.
+//    -- arg      passed along to fn.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if the Graph is directed,
+//    otherwise the number of cliques reported.
+//
+// A vertex with no edges is a maximal clique of one.
+long ForEachMaximalClique(Graph g, int minSize, CliqueCallback fn, void *arg);
+
+#endif
@@ -2,177 +2,480 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "./Graph.h"
+#include "./GraphAllocator.h"
 #include "./Graph_priv.h"
+#include "./GraphAlloc_priv.h"
+#include "./GraphStats_priv.h"
+#include "./GraphView_priv.h"
+#include "./WeightIndex.h"
+#include "./WeightIndex_priv.h"
 
 // Helper function declarations
-void FreeEdges(ListItem *vertex);
-ListItem *FindVertex(ListItem *vertex, GVertex_t v);
-ListItem *FindFirstVertex(ListItem *vertex, GVertex_t v1, GVertex_t v2);
-int AddVertexSaveBack(Graph g, GVertex_t v, ListItem **back);
-bool AddEdge(ListItem *vertex, GVertex_t v, int w);
-void RemoveEdge(ListItem *vertex, GVertex_t v);
-int AddGraphEdgeEmptyGraph(Graph g, GVertex_t v1, GVertex_t v2, int w);
+Graph NewGraph(bool directed, const GraphAllocator *a, size_t limit);
+void FreeEdgeList(Graph g, EdgeItem *list);
+void FreeEdges(Graph g, ListItem *vertex);
+bool AddEdge(Graph g, ListItem *vertex, GVertex_t v, GWeight_t w);
+bool AddInEdge(Graph g, ListItem *vertex, GVertex_t v, GWeight_t w);
+EdgeItem *SearchEdges(EdgeItem *list, GVertex_t v);
+EdgeItem *FindEdge(ListItem *vertex, GVertex_t v);
+EdgeItem *ReverseEdge(Graph g, ListItem *vertex, GVertex_t v);
+EdgeItem *UnlinkEdge(EdgeItem **list, GVertex_t v);
+bool RemoveEdge(Graph g, ListItem *vertex, GVertex_t v);
+int CopyNeighbors(Graph g, ListItem *vertex, bool in, Neighbor **out);
 
 Graph AllocateGraph() {
+  return NewGraph(false, SystemGraphAllocator(), 0);
+}
+
+Graph AllocateDirectedGraph() {
+  return NewGraph(true, SystemGraphAllocator(), 0);
+}
+
+Graph AllocateGraphWithAllocator(bool directed, const GraphAllocator *a,
+                                 size_t limit) {
+  return NewGraph(directed, a, limit);
+}
+
+// Allocates an empty Graph, directed or not, whose memory comes from the
+// given allocator. Returns NULL on memory error.
+Graph NewGraph(bool directed, const GraphAllocator *a, size_t limit) {
+  GraphMemory memory = { a, 0, limit };
   Graph g;
   
-  g = (Graph) malloc(sizeof(GraphImplementation));
+  g = (Graph) MemoryAlloc(&memory, sizeof(GraphImplementation));
   if (g == NULL) {
     return NULL;
   }
+  g->memory = memory;
   g->front = g->back = NULL;
+  g->vertexSlab = NULL;
+  g->vertexSlabCount = 0;
+  g->edgeSlab = NULL;
+  g->edgeSlabCount = 0;
+  g->directed = directed;
+  g->hasInEdges = false;
+  g->inEdgeSlab = NULL;
+  g->inEdgeSlabCount = 0;
+  g->weightIndex = NULL;
+  g->view = NULL;
+  g->serial = NewGraphSerial();
+  g->mutations = 0;
+  if (!InitVertexIndex(&g->index, &g->memory)) {
+    MemoryFree(&memory, g, sizeof(GraphImplementation));
+    return NULL;
+  }
+  g->numVertices = 0;
+  g->numEdges = 0;
+  g->minDegree = g->maxDegree = 0;
+  memset(g->degreeHistogram, 0, sizeof(g->degreeHistogram));
+
+  // make sure vertices with no edges can always be counted
+  g->degreeCounts = NULL;
+  g->degreeCapacity = 0;
+  if (!EnsureDegreeCapacity(g, 0)) {
+    FreeVertexIndex(&g->index);
+    memory = g->memory;
+    MemoryFree(&memory, g, sizeof(GraphImplementation));
+    return NULL;
+  }
 
   return g;
 }
 
-// Releases memory associated with the edge list of a given vertex.
-void FreeEdges(ListItem *vertex) {
+uint64_t NewGraphSerial() {
+  static uint64_t last = 0;
+
+  return __atomic_add_fetch(&last, 1, __ATOMIC_RELAXED);
+}
+
+// Releases memory associated with an edge list.
+void FreeEdgeList(Graph g, EdgeItem *list) {
   EdgeItem *cur, *temp;
   
-  for (cur = vertex->neighbors; cur != NULL;) {
+  for (cur = list; cur != NULL;) {
     temp = cur->next;
-    free(cur);
+    ReleaseEdge(g, cur);
     cur = temp;  
   }
 }
 
+// Releases memory associated with the edge lists of a given vertex.
+void FreeEdges(Graph g, ListItem *vertex) {
+  FreeEdgeList(g, vertex->neighbors);
+  FreeEdgeList(g, vertex->inNeighbors);
+}
+
 void FreeGraph(Graph g) {
+  GraphMemory memory;
   ListItem *cur, *temp;
 
+  if (g->view != NULL) {
+    // a view holds none of the vertices and edges it shows
+    FreeView(g);
+    return;
+  }
+
   for (cur = g->front; cur != NULL;) {
-    FreeEdges(cur);
+    FreeEdges(g, cur);
     temp = cur->next;
-    free(cur);
+    if (!InVertexSlab(g, cur)) {
+      MemoryFree(&g->memory, cur, sizeof(ListItem));
+    }
     cur = temp;
   }
 
-  free(g);
+  MemoryFree(&g->memory, g->vertexSlab,
+             sizeof(ListItem) * g->vertexSlabCount);
+  MemoryFree(&g->memory, g->edgeSlab,
+             sizeof(EdgeItem) * (g->edgeSlabCount + 1));
+  MemoryFree(&g->memory, g->inEdgeSlab,
+             sizeof(EdgeItem) * (g->inEdgeSlabCount + 1));
+  FreeVertexIndex(&g->index);
+  DisableWeightIndex(g);
+  MemoryFree(&g->memory, g->degreeCounts, sizeof(int) * g->degreeCapacity);
+
+  // the accounts live in the Graph, so take them out before freeing it
+  memory = g->memory;
+  MemoryFree(&memory, g, sizeof(GraphImplementation));
 }
 
-// Loops through the Graph looking for the given vertex. Returns a reference
-// to that vertex if it exists. Otherwise, returns NULL.
-ListItem *FindVertex(ListItem *vertex, GVertex_t v) {
- for (; vertex != NULL; vertex = vertex->next) {
-    if (vertex->data == v) {
-      return vertex;
-    }
-  }
-  return NULL;
+size_t GraphBytesAllocated(Graph g) {
+  return g->memory.bytes;
 }
 
-// Loops through the Graph starting at vertex looking for one of the two 
-// vertices. Returns a reference to the first of the two vertices it finds, 
-// if one of them exists. Otherwise, returns NULL.
-ListItem *FindFirstVertex(ListItem *vertex, GVertex_t v1, GVertex_t v2) {
-  for (; vertex != NULL; vertex = vertex->next) {
-    if (vertex->data == v1 || vertex-> data == v2) {
-      return vertex;
-    }
-  }
-  return NULL;
+size_t GraphMemoryLimit(Graph g) {
+  return g->memory.limit;
 }
 
-// Adds a new vertex to the back of the list. Places a pointer to the old back
-// of the list in old if a Vertex is added, else is NULL. Otherwise, follows the 
-// conventions of AddVertex defined in Graph.h.
-int AddVertexSaveBack(Graph g, GVertex_t v, ListItem **old) {
-  ListItem *l;
+void SetGraphMemoryLimit(Graph g, size_t limit) {
+  g->memory.limit = limit;
+}
 
-  if ((l = FindVertex(g->front, v)) != NULL) {
-    // already exists!
-    *old = NULL;
-    return 0;
+// Looks the given vertex up in the Graph's index. Returns a reference to
+// that vertex if it exists. Otherwise, returns NULL.
+ListItem *FindVertex(Graph g, GVertex_t v) {
+  ListItem *vertex;
+  int probes;
+
+  vertex = VertexIndexFind(&g->index, v, &probes);
+  if (vertex != NULL && !VertexVisible(g, vertex)) {
+    // hidden by a view
+    vertex = NULL;
   }
 
-  l = (ListItem *)malloc(sizeof(ListItem));
+  STATS_ADD(vertexLookups, 1);
+  STATS_ADD(verticesScanned, probes);
+  return vertex;
+}
+
+// Appends a new vertex with no edges to the back of the list. This function
+// does not check to see if the vertex is already in the Graph.
+//
+// Returns the new vertex, or NULL if an out of memory error occurs.
+ListItem *AppendVertex(Graph g, GVertex_t v) {
+  ListItem *l;
+
+  l = (ListItem *)MemoryAlloc(&g->memory, sizeof(ListItem));
+  STATS_ADD(vertexAllocs, 1);
   if (l == NULL) {
-    return -1;
+    return NULL;
   }
 
   l->data = v;
   l->neighbors = NULL;
   l->count = 0;
   l->next = NULL;
+  l->inNeighbors = NULL;
+  l->id = g->numVertices;
+#if GRAPH_VERTEX_PAYLOAD > 0
+  memset(l->payload, 0, sizeof(l->payload));
+#endif
+
+  if (!VertexIndexInsert(&g->index, v, l)) {
+    MemoryFree(&g->memory, l, sizeof(ListItem));
+    return NULL;
+  }
 
-  *old = g->back;
-
-  // case 1: graph empty, set as front and back 
+  // case 1: graph empty, set as front and back
   if (g->front == NULL) {
     g->front = g->back = l;
-    return 0;
+  } else {
+    // case 2: append to end
+    g->back->next = l;
+    g->back = l;
   }
 
-  // case 2: append to end
-  g->back->next = l;
-  g->back = l;
-  return 0;
+  g->numVertices++;
+  g->mutations++;
+  NoteDegreeChange(g, -1, 0);
+  return l;
+}
+
+// Removes every vertex after back from the list, making back the new back of
+// the list (or emptying the list if back is NULL). This is used to roll back
+// vertices appended by an operation that later failed, so the vertices
+// removed must not have any edges.
+void TruncateVertices(Graph g, ListItem *back) {
+  ListItem *cur, *temp;
+
+  cur = (back == NULL) ? g->front : back->next;
+  while (cur != NULL) {
+    temp = cur->next;
+    VertexIndexRemove(&g->index, cur->data);
+    g->numVertices--;
+    g->mutations++;
+    NoteDegreeChange(g, 0, -1);
+    MemoryFree(&g->memory, cur, sizeof(ListItem));
+    cur = temp;
+  }
+
+  g->back = back;
+  if (back == NULL) {
+    g->front = NULL;
+  } else {
+    back->next = NULL;
+  }
 }
 
-// adds new vertex to the back of the list
 int AddVertex(Graph g, GVertex_t v) {
-  ListItem *l;
-  return AddVertexSaveBack(g, v, &l);
+  STATS_TIME_OP(GRAPH_OP_ADD_VERTEX);
+
+  if (g->view != NULL) {
+    // views are read only
+    return -1;
+  }
+  if (FindVertex(g, v) != NULL) {
+    // already exists!
+    return 0;
+  }
+  return AppendVertex(g, v) != NULL ? 0 : -1;
 }
 
 bool ContainsVertex(Graph g, GVertex_t v) {
-  return FindVertex(g->front, v) != NULL ? true : false;
+  STATS_TIME_OP(GRAPH_OP_CONTAINS_VERTEX);
+
+  return FindVertex(g, v) != NULL ? true : false;
 }
 
 bool AreAdjacent(Graph g, GVertex_t v1, GVertex_t v2) {
-  ListItem *vertex; 
-  EdgeItem *neighb;
-  GVertex_t v3;
+  ListItem *first, *second;
+  EdgeItem *edge;
+  STATS_TIME_OP(GRAPH_OP_ARE_ADJACENT);
 
-  vertex = FindFirstVertex(g->front, v1, v2);
-  if (vertex == NULL) {
+  first = FindVertex(g, v1);
+  second = FindVertex(g, v2);
+  if (first == NULL || second == NULL) {
     return false;
   } 
 
-  // determine which of the two vertices we found, so we can
-  // look for the other.
-  v3 = (vertex->data == v1) ? v2 : v1;
+  // an undirected edge is stored with both vertices, so search the shorter
+  // list
+  if (!g->directed && second->count < first->count) {
+    edge = FindEdge(second, v1);
+    return edge != NULL && EdgeVisible(g, second, edge, false);
+  }
+  edge = FindEdge(first, v2);
+  return edge != NULL && EdgeVisible(g, first, edge, false);
+}
 
-  // now loop through the edges
-  for (neighb = vertex->neighbors; neighb != NULL; neighb = neighb->next) {
-    if (neighb->data == v3) {
-      return true;
+// Copies the edges of the given vertex (or its incoming edges, if in is
+// true) that the Graph shows out as an array of Neighbors, with the same
+// return values as GetNeighbors.
+int CopyNeighbors(Graph g, ListItem *vertex, bool in, Neighbor **out) {
+  EdgeItem *list, *edge;
+  int count = 0, i;
+
+  list = in ? vertex->inNeighbors : vertex->neighbors;
+  if (!in) {
+    count = VisibleDegree(g, vertex);
+  } else {
+    for (edge = list; edge != NULL; edge = edge->next) {
+      count += EdgeVisible(g, vertex, edge, true);
     }
   }
+  if (count == 0) {
+    // vertex has no edges
+    return 0;
+  }
+
+  *out = (Neighbor *)malloc(sizeof(Neighbor) * count);
+  STATS_ADD(neighborAllocs, 1);
+  if (*out == NULL) {
+    // memory error
+    return -2;
+  }
 
-  return false;
+  i = 0;
+  for (edge = list; edge != NULL; edge = edge->next) {
+    if (!EdgeVisible(g, vertex, edge, in)) {
+      continue;
+    }
+    (*out)[i].v = edge->data;
+    (*out)[i].weight = EdgeWeight(edge);
+#if GRAPH_EDGE_PAYLOAD > 0
+    memcpy((*out)[i].payload, edge->payload, sizeof(edge->payload));
+#endif
+    i++;
+  }
+  return count;
 }
 
 int GetNeighbors(Graph g, GVertex_t v, Neighbor **out) {
   ListItem *vertex;
-  EdgeItem *edge;
-  int i;
-  
-  vertex = FindVertex(g->front, v);
+  STATS_TIME_OP(GRAPH_OP_GET_NEIGHBORS);
+
+  vertex = FindVertex(g, v);
   if (vertex == NULL) {
     // vertex not found
     return -1;  
   }
+  return CopyNeighbors(g, vertex, false, out);
+}
 
-  if (vertex->count == 0) {
-    // vertex has no edges
-    return 0;
+int GetInNeighbors(Graph g, GVertex_t v, Neighbor **out) {
+  ListItem *vertex;
+  STATS_TIME_OP(GRAPH_OP_GET_IN_NEIGHBORS);
+
+  vertex = FindVertex(g, v);
+  if (vertex == NULL) {
+    return -1;
+  }
+  if (!g->directed) {
+    return CopyNeighbors(g, vertex, false, out);
   }
 
-  *out = (Neighbor *)malloc(sizeof(Neighbor) * vertex->count);
-  if (*out == NULL) {
-    // memory error
+  if (!EnsureInAdjacency(g)) {
     return -2;
   }
+  return CopyNeighbors(g, vertex, true, out);
+}
 
-  i = 0;
-  for (edge = vertex->neighbors; edge != NULL; edge = edge->next) {
-    (*out)[i].v = edge->data;
-    (*out)[i].weight = edge->weight;
-    i++;
+bool IsDirectedGraph(Graph g) {
+  return g->directed;
+}
+
+// Builds every vertex's list of incoming edges in one pass over the Graph.
+// The items all come from one allocation, so building cannot fail halfway.
+bool EnsureInAdjacency(Graph g) {
+  EdgeItem *slab, *in;
+  ListItem *l, *target;
+  EdgeItem *edge;
+  size_t i = 0;
+
+  if (!g->directed || g->hasInEdges) {
+    return true;
+  }
+  if (g->view != NULL) {
+    // a view shares the lists of the Graph it views, so build them there
+    if (!EnsureInAdjacency(g->view->parent)) {
+      return false;
+    }
+    g->hasInEdges = true;
+    return true;
+  }
+
+  slab = (EdgeItem *)MemoryAlloc(&g->memory,
+                                 sizeof(EdgeItem) * (g->numEdges + 1));
+  STATS_ADD(edgeAllocs, 1);
+  if (slab == NULL) {
+    return false;
+  }
+
+  for (l = g->front; l != NULL; l = l->next) {
+    for (edge = l->neighbors; edge != NULL; edge = edge->next) {
+      target = FindVertex(g, edge->data);
+      in = &slab[i++];
+      *in = *edge;
+      in->data = l->data;
+      in->next = target->inNeighbors;
+      target->inNeighbors = in;
+    }
+  }
+
+  g->inEdgeSlab = slab;
+  g->inEdgeSlabCount = i;
+  g->hasInEdges = true;
+  return true;
+}
+
+// Makes sure the degree table can count vertices of the given degree,
+// growing it if necessary. Returns false if an out of memory error occurs.
+bool EnsureDegreeCapacity(Graph g, int degree) {
+  int *counts;
+  int capacity;
+
+  if (degree < g->degreeCapacity) {
+    return true;
+  }
+
+  capacity = (g->degreeCapacity == 0) ? 16 : g->degreeCapacity;
+  while (capacity <= degree) {
+    capacity *= 2;
+  }
+
+  counts = (int *)MemoryRealloc(&g->memory, g->degreeCounts,
+                                sizeof(int) * g->degreeCapacity,
+                                sizeof(int) * capacity);
+  if (counts == NULL) {
+    return false;
+  }
+  memset(counts + g->degreeCapacity, 0,
+         sizeof(int) * (capacity - g->degreeCapacity));
+
+  g->degreeCounts = counts;
+  g->degreeCapacity = capacity;
+  return true;
+}
+
+// Returns the degree histogram bucket for the given degree: bucket 0 holds
+// degree 0, and bucket i holds degrees in [2^(i-1), 2^i).
+int DegreeBucket(int degree) {
+  return (degree == 0) ? 0 : 32 - __builtin_clz((unsigned int)degree);
+}
+
+// Updates the degree counters for a vertex whose degree changed from one
+// value to another. A from value of -1 means the vertex is new, and a to
+// value of -1 means the vertex is going away. The degree table must already
+// be large enough to hold the new degree (see EnsureDegreeCapacity).
+//
+// Since degrees only ever change by one, the minimum and maximum degree can
+// be kept exact in constant time: the vertex that moved is always at a
+// neighboring degree.
+void NoteDegreeChange(Graph g, int from, int to) {
+  if (from != -1) {
+    g->degreeCounts[from]--;
+    g->degreeHistogram[DegreeBucket(from)]--;
+  }
+  if (to != -1) {
+    g->degreeCounts[to]++;
+    g->degreeHistogram[DegreeBucket(to)]++;
+  }
+
+  if (g->numVertices == 0) {
+    g->minDegree = g->maxDegree = 0;
+    return;
+  }
+
+  if (to != -1 && (to > g->maxDegree || g->numVertices == 1)) {
+    g->maxDegree = to;
+  } else if (from == g->maxDegree && g->degreeCounts[from] == 0) {
+    // the vertex at the maximum moved down by one, or went away with
+    // degree 0, in which case every remaining vertex has degree 0 too.
+    g->maxDegree = (to == -1) ? 0 : to;
+  }
+
+  if (to != -1 && (to < g->minDegree || g->numVertices == 1)) {
+    g->minDegree = to;
+  } else if (from == g->minDegree && g->degreeCounts[from] == 0) {
+    // the vertex at the minimum moved up by one. A degree 0 vertex going
+    // away leaves the minimum to be found by looking upward.
+    while (g->degreeCounts[g->minDegree] == 0) {
+      g->minDegree++;
+    }
   }
-  return vertex->count;
 }
 
 // Adds an edge to vertex v with weight w to the vertex stored in li. This
@@ -180,190 +483,430 @@ int GetNeighbors(Graph g, GVertex_t v, Neighbor **out) {
 // merely inserts the new edge at the front of the list of neighbors.
 //
 // Returns true if successful, false if an out of memory error occurs.
-bool AddEdge(ListItem *li, GVertex_t v, int w) {
+bool AddEdge(Graph g, ListItem *li, GVertex_t v, GWeight_t w) {
   EdgeItem *ei;
 
-  ei = (EdgeItem *)malloc(sizeof(EdgeItem));
+  if (!EnsureDegreeCapacity(g, li->count + 1)) {
+    return false;
+  }
+
+  ei = (EdgeItem *)MemoryAlloc(&g->memory, sizeof(EdgeItem));
+  STATS_ADD(edgeAllocs, 1);
   if (ei == NULL) {
     return false;  
   }
 
   ei->data = v;
-  ei->weight = w;
+  SetEdgeWeight(ei, w);
+#if GRAPH_EDGE_PAYLOAD > 0
+  memset(ei->payload, 0, sizeof(ei->payload));
+#endif
   
   // add to front of list
   ei->next = li->neighbors;
   li->neighbors = ei;
 
   li->count++;
+  NoteDegreeChange(g, li->count - 1, li->count);
   return true;
 }
 
-// Removes the edge pointing to v from the given vertex. This releases
-// the memory associated with the edge. If the edge is not found
-void RemoveEdge(ListItem *vertex, GVertex_t v) {
-  EdgeItem *cur, *temp;
+// Adds an edge from vertex v with weight w to the incoming edges of the
+// vertex stored in li, once the Graph's in-adjacency has been built. Like
+// AddEdge, this does not check for an existing edge.
+//
+// Returns true if successful, false if an out of memory error occurs.
+bool AddInEdge(Graph g, ListItem *li, GVertex_t v, GWeight_t w) {
+  EdgeItem *ei;
 
-  if (vertex->neighbors == NULL) {
-    return;
+  if (!g->hasInEdges) {
+    return true;
   }
 
-  // if the edge is at the head of the list, simply update
-  // the pointer
-  if (vertex->neighbors->data == v) {
-    temp = vertex->neighbors;
-    vertex->neighbors = vertex->neighbors->next;
-    free(temp);
-    vertex->count--;
-    return;
+  ei = (EdgeItem *)MemoryAlloc(&g->memory, sizeof(EdgeItem));
+  STATS_ADD(edgeAllocs, 1);
+  if (ei == NULL) {
+    return false;
   }
 
-  cur = vertex->neighbors;
-  while (cur->next != NULL) {
-    if (cur->next->data == v) {
-      // the next thing in the list is the edge we want to remove
-      temp = cur->next;
-      cur->next = cur->next->next;
-      free(temp);
-      vertex->count--;
-      return;
+  ei->data = v;
+  SetEdgeWeight(ei, w);
+#if GRAPH_EDGE_PAYLOAD > 0
+  memset(ei->payload, 0, sizeof(ei->payload));
+#endif
+  ei->next = li->inNeighbors;
+  li->inNeighbors = ei;
+  return true;
+}
+
+// Returns the edge in the given list pointing to v, or NULL if there is
+// none.
+EdgeItem *SearchEdges(EdgeItem *list, GVertex_t v) {
+  EdgeItem *edge;
+  int walked = 0;
+
+  for (edge = list; edge != NULL; edge = edge->next) {
+    walked++;
+    if (edge->data == v) {
+      break;
     }
-    cur = cur->next;
   }
+
+  STATS_ADD(edgesWalked, walked);
+  return edge;
 }
 
-int AddGraphEdge(Graph g, GVertex_t v1, GVertex_t v2, int w) {
-  ListItem *first, *second, *oldBackFirst, *oldBackSecond;
-  bool addedFirst, addedSecond;
-  int ret;
+// Returns the edge from the given vertex to v, or NULL if there is none.
+EdgeItem *FindEdge(ListItem *vertex, GVertex_t v) {
+  return SearchEdges(vertex->neighbors, v);
+}
 
-  // handle empty graph
-  if (g->front == NULL) {
-    return AddGraphEdgeEmptyGraph(g, v1, v2, w);
+// Returns the other copy of the edge from v to the given vertex: the
+// vertex's own edge to v in an undirected Graph, or its incoming edge from
+// v in a directed one. Returns NULL if a directed Graph's in-adjacency has
+// not been built, since then there is no other copy.
+EdgeItem *ReverseEdge(Graph g, ListItem *vertex, GVertex_t v) {
+  if (!g->directed) {
+    return FindEdge(vertex, v);
   }
- 
-  // try to find the first vertex in the list
-  first = FindFirstVertex(g->front, v1, v2);
+  return SearchEdges(vertex->inNeighbors, v);
+}
 
-  if (first == NULL) {
-    // neither vertex is in the graph. Add one 
-    ret = AddVertexSaveBack(g, v1, &oldBackFirst);
-    if (ret == -1) {
-      return -1;  
+// Unlinks the edge pointing to v from the given list, and returns it.
+// Returns NULL if the list has no edge to v.
+EdgeItem *UnlinkEdge(EdgeItem **list, GVertex_t v) {
+  EdgeItem **cur, *temp = NULL;
+  int walked = 0;
+
+  // walk the links rather than the items, so that removing the head of
+  // the list is no different from removing any other edge
+  for (cur = list; *cur != NULL; cur = &(*cur)->next) {
+    walked++;
+    if ((*cur)->data == v) {
+      temp = *cur;
+      *cur = temp->next;
+      break;
     }
-    first = g->back;
-    addedFirst = true;
   }
 
-  // okay now we are guarantted to have the first vertex lets add the edge
-  if (!AddEdge(first, (first->data == v1) ? v2 : v1, w)) {
-    // on memory error, if first vertex was previously not in the graph, remove it
-    if (addedFirst) {
-      g->back = oldBackFirst; 
-      g->back->next = NULL;
-      free(first);
-    }
+  STATS_ADD(edgesWalked, walked);
+  return temp;
+}
+
+// Releases the memory associated with an edge, unless it lives in a slab.
+void ReleaseEdge(Graph g, EdgeItem *edge) {
+  if (edge != NULL && !InEdgeSlab(g, edge)) {
+    MemoryFree(&g->memory, edge, sizeof(EdgeItem));
+  }
+}
+
+// Removes the edge pointing to v from the given vertex. This releases
+// the memory associated with the edge. Returns true if the edge was
+// found and removed, false if the vertex has no edge to v.
+bool RemoveEdge(Graph g, ListItem *vertex, GVertex_t v) {
+  EdgeItem *edge;
+
+  edge = UnlinkEdge(&vertex->neighbors, v);
+  if (edge == NULL) {
+    return false;
+  }
+
+  ReleaseEdge(g, edge);
+  vertex->count--;
+  NoteDegreeChange(g, vertex->count + 1, vertex->count);
+  return true;
+}
+
+int AddGraphEdge(Graph g, GVertex_t v1, GVertex_t v2, GWeight_t w) {
+  ListItem *first, *second, *oldBack;
+  EdgeItem *edge;
+  STATS_TIME_OP(GRAPH_OP_ADD_EDGE);
+
+  if (v1 == v2 || g->view != NULL) {
+    // self-loops are not permitted, and views are read only
     return -1;
   }
 
-  // now find the second vertex
-  second = FindFirstVertex(first->next, v1, v2);
-  if (second == NULL) {
-    // the second vertex is missing; we need to add it
-    ret = AddVertexSaveBack(g, v2, &oldBackSecond);
-    if (ret == -1) {
-      // we need to remove the edge we added to the first
-      // vertex
-      RemoveEdge(first, (first->data == v1) ? v2 : v1);     
-      if (addedFirst) {
-        g->back = oldBackFirst;
-        g->back->next = NULL;
-        free(first);
+  first = FindVertex(g, v1);
+  second = FindVertex(g, v2);
+
+  // if the edge already exists, only its weight changes
+  if (first != NULL && second != NULL &&
+      (edge = FindEdge(first, v2)) != NULL) {
+    SetEdgeWeight(edge, w);
+    WeightIndexUpdate(g, first, edge);
+    if ((edge = ReverseEdge(g, second, v1)) != NULL) {
+      SetEdgeWeight(edge, w);
+      if (!g->directed) {
+        WeightIndexUpdate(g, second, edge);
       }
+    }
+    g->mutations++;
+    return 0;
+  }
+
+  // add whichever vertices are missing, remembering where the list ended so
+  // that we can roll them back on a memory error
+  oldBack = g->back;
+  if (first == NULL) {
+    first = AppendVertex(g, v1);
+    if (first == NULL) {
       return -1;
     }
-    second = g->back;
-    addedSecond = true;
   }
-  
-  // okay we have the second vertex lets add the edge
-  if (!AddEdge(second, (second->data == v1) ? v2 : v1, w)) {
-    RemoveEdge(first, (first->data == v1 ? v2 : v1));
-    // handle each of two cases -> we added both vertices, or we added
-    // only the second. 
-    if (addedFirst && addedSecond) {
-        g->back = oldBackFirst;
-        g->back->next = NULL;
-        free(first);
-        free(second);
-    } else if (addedSecond) {
-      g->back = oldBackSecond;
-      g->back->next = NULL;
-      free(second);
+  if (second == NULL) {
+    second = AppendVertex(g, v2);
+    if (second == NULL) {
+      TruncateVertices(g, oldBack);
+      return -1;
     }
-    return -1;
   }
-  
-  // we made it!
-  return 0;
-}
 
-// helper function to add an edge to a previously empty Graph.
-int AddGraphEdgeEmptyGraph(Graph g, GVertex_t v1, GVertex_t v2, int w) {
-  ListItem *first, *second;
-  int ret;
-
-  // create first vertex and edge
-  ret = AddVertex(g, v1);
-  if (ret == -1) {
+  // make room in the weight index first, as inserting there cannot fail
+  if (!WeightIndexReserve(g, first, 1) ||
+      (!g->directed && !WeightIndexReserve(g, second, 1))) {
+    TruncateVertices(g, oldBack);
     return -1;
   }
-  first = g->back;
 
-  // add edge to v2
-  if (!AddEdge(first, v2, w)) {
-    free(first);
+  // now add the edge in both directions, or for a directed Graph, the
+  // forward edge and (if it has been built) the reverse one
+  if (!AddEdge(g, first, second->data, w)) {
+    TruncateVertices(g, oldBack);
     return -1;
   }
-  
-  // now add second vertex
-  ret = AddVertex(g, v2);
-  if (ret == -1) {
-    FreeEdges(first); 
-    free(first);
-    g->front = NULL;
+  if (g->directed ? !AddInEdge(g, second, first->data, w) :
+      !AddEdge(g, second, first->data, w)) {
+    RemoveEdge(g, first, second->data);
+    TruncateVertices(g, oldBack);
     return -1;
   }
-  second = g->back;
 
-  // add edge to v1
-  if (!AddEdge(second, v1, w)) {
-    free(second);
-    FreeEdges(first);
-    free(first);
-    g->front = g->back = NULL;
-    return -1;
+  // we made it! The new edges are at the fronts of their lists.
+  WeightIndexInsert(g, first, first->neighbors);
+  if (!g->directed) {
+    WeightIndexInsert(g, second, second->neighbors);
   }
-
+  g->numEdges++;
+  g->mutations++;
   return 0;
 }
 
 void RemoveGraphEdge(Graph g, GVertex_t v1, GVertex_t v2) {
   ListItem *first, *second;
+  STATS_TIME_OP(GRAPH_OP_REMOVE_EDGE);
 
-  // if graph is empty, or single element, return immediately
-  if (g->front == NULL || g->front == g->back) {
+  if (g->view != NULL) {
     return;
   }
-
-  first = FindFirstVertex(g->front, v1, v2);
-  second = FindFirstVertex(first->next, v1, v2);
+  first = FindVertex(g, v1);
+  second = FindVertex(g, v2);
   // if one or vertices is missing, return 
   if (first == NULL || second == NULL) {
     return;
   }
 
   // okay, remove the edges
-  RemoveEdge(first, (first->data == v1) ? v2 : v1);
-  RemoveEdge(second, (second->data == v1) ? v2 : v1);
+  if (RemoveEdge(g, first, v2)) {
+    WeightIndexRemove(g, first, v2);
+    if (g->directed) {
+      ReleaseEdge(g, UnlinkEdge(&second->inNeighbors, v1));
+    } else {
+      RemoveEdge(g, second, v1);
+      WeightIndexRemove(g, second, v1);
+    }
+    g->numEdges--;
+    g->mutations++;
+  }
+}
+
+void *GetVertexPayload(Graph g, GVertex_t v) {
+#if GRAPH_VERTEX_PAYLOAD > 0
+  ListItem *vertex;
+
+  vertex = FindVertex(g, v);
+  return vertex != NULL ? vertex->payload : NULL;
+#else
+  (void)g;
+  (void)v;
+  return NULL;
+#endif
+}
+
+const void *GetEdgePayload(Graph g, GVertex_t v1, GVertex_t v2) {
+#if GRAPH_EDGE_PAYLOAD > 0
+  ListItem *first;
+  EdgeItem *edge;
+
+  first = FindVertex(g, v1);
+  if (first == NULL || (edge = FindEdge(first, v2)) == NULL ||
+      !EdgeVisible(g, first, edge, false)) {
+    return NULL;
+  }
+  return edge->payload;
+#else
+  (void)g;
+  (void)v1;
+  (void)v2;
+  return NULL;
+#endif
+}
+
+int SetEdgePayload(Graph g, GVertex_t v1, GVertex_t v2, const void *data) {
+#if GRAPH_EDGE_PAYLOAD > 0
+  ListItem *first, *second;
+  EdgeItem *edge;
+
+  if (g->view != NULL) {
+    return -1;
+  }
+  first = FindVertex(g, v1);
+  second = FindVertex(g, v2);
+  if (first == NULL || second == NULL ||
+      (edge = FindEdge(first, v2)) == NULL) {
+    return -1;
+  }
+
+  // keep both copies of the edge in step, and the index with them
+  memcpy(edge->payload, data, GRAPH_EDGE_PAYLOAD);
+  WeightIndexUpdate(g, first, edge);
+  if ((edge = ReverseEdge(g, second, v1)) != NULL) {
+    memcpy(edge->payload, data, GRAPH_EDGE_PAYLOAD);
+    if (!g->directed) {
+      WeightIndexUpdate(g, second, edge);
+    }
+  }
+  return 0;
+#else
+  (void)g;
+  (void)v1;
+  (void)v2;
+  (void)data;
+  return -1;
+#endif
+}
+
+// Estimates the number of bytes the system allocator really uses to satisfy
+// a request of the given size. This models glibc's malloc on 64-bit
+// platforms: each chunk carries an 8 byte header, is rounded up to a multiple
+// of 16 bytes, and is at least 32 bytes long.
+size_t AllocatedSize(size_t size) {
+  size_t chunk;
+
+  chunk = (size + sizeof(size_t) + 15) & ~(size_t)15;
+  return chunk < 32 ? 32 : chunk;
+}
+
+void GetGraphSummary(Graph g, GraphSummary *out) {
+  if (g->view != NULL) {
+    SummarizeView(g, out);
+    return;
+  }
+  memset(out, 0, sizeof(GraphSummary));
+
+  out->vertices = g->numVertices;
+  out->edges = g->numEdges;
+  out->minDegree = g->minDegree;
+  out->maxDegree = g->maxDegree;
+  if (g->numVertices > 0) {
+    out->meanDegree = (g->directed ? 1.0 : 2.0) * g->numEdges /
+      g->numVertices;
+  }
+  memcpy(out->degreeHistogram, g->degreeHistogram,
+         sizeof(out->degreeHistogram));
+
+  // every undirected edge is stored once for each endpoint, and a directed
+  // edge once, plus once more if the in-adjacency has been built
+  out->vertexBytes = g->numVertices * AllocatedSize(sizeof(ListItem));
+  out->edgeBytes = (g->directed && !g->hasInEdges ? 1 : 2) * g->numEdges *
+    AllocatedSize(sizeof(EdgeItem));
+  out->overheadBytes = AllocatedSize(sizeof(GraphImplementation)) +
+    AllocatedSize(sizeof(IndexSlot) * (g->index.mask + 1));
+  if (g->degreeCounts != NULL) {
+    out->overheadBytes += AllocatedSize(sizeof(int) * g->degreeCapacity);
+  }
+}
+
+// How many queries ahead of the one being answered each stage of the
+// batched lookups runs. Far enough ahead that a prefetch issued for a query
+// has landed by the time that query reaches the next stage, but not so far
+// that the prefetched lines are evicted again first.
+#define BATCH_DISTANCE 16
+
+// Ring buffer size for in-flight batch queries: one window per stage.
+#define BATCH_RING (4 * BATCH_DISTANCE)
+
+void ContainsVertexBatch(Graph g, const GVertex_t *vs, int n, bool *results) {
+  int i, j;
+  STATS_TIME_OP(GRAPH_OP_CONTAINS_VERTEX_BATCH);
+
+  // Two stages: prefetch the home slot of query i, then BATCH_DISTANCE
+  // queries later, probe the (hopefully cached) table for it.
+  for (i = 0; i < n + BATCH_DISTANCE; i++) {
+    if (i < n) {
+      __builtin_prefetch(VertexIndexHome(&g->index, vs[i]));
+    }
+    j = i - BATCH_DISTANCE;
+    if (j >= 0) {
+      results[j] = FindVertex(g, vs[j]) != NULL;
+    }
+  }
+}
+
+void AreAdjacentBatch(Graph g, const VertexPair *queries, int n,
+                      bool *results) {
+  ListItem *first[BATCH_RING], *second[BATCH_RING], *shorter;
+  GVertex_t other[BATCH_RING];
+  EdgeItem *edge;
+  int i, j, k;
+  STATS_TIME_OP(GRAPH_OP_ARE_ADJACENT_BATCH);
+
+  // Four stages, each running BATCH_DISTANCE queries behind the last:
+  //
+  // 1. prefetch the index slots of both vertices.
+  // 2. look both vertices up, and prefetch their ListItems.
+  // 3. pick the shorter edge list of the two, and prefetch its head.
+  // 4. walk the edge list.
+  for (i = 0; i < n + 3 * BATCH_DISTANCE; i++) {
+    if (i < n) {
+      __builtin_prefetch(VertexIndexHome(&g->index, queries[i].v1));
+      __builtin_prefetch(VertexIndexHome(&g->index, queries[i].v2));
+    }
+
+    j = i - BATCH_DISTANCE;
+    if (j >= 0 && j < n) {
+      k = j % BATCH_RING;
+      first[k] = FindVertex(g, queries[j].v1);
+      second[k] = FindVertex(g, queries[j].v2);
+      if (first[k] != NULL && second[k] != NULL) {
+        __builtin_prefetch(first[k]);
+        __builtin_prefetch(second[k]);
+      }
+    }
+
+    j = i - 2 * BATCH_DISTANCE;
+    if (j >= 0 && j < n) {
+      k = j % BATCH_RING;
+      if (first[k] != NULL && second[k] != NULL) {
+        if (!g->directed && second[k]->count < first[k]->count) {
+          shorter = second[k];
+          other[k] = queries[j].v1;
+        } else {
+          shorter = first[k];
+          other[k] = queries[j].v2;
+        }
+        first[k] = shorter;
+        __builtin_prefetch(shorter->neighbors);
+      } else {
+        first[k] = NULL;
+      }
+    }
+
+    j = i - 3 * BATCH_DISTANCE;
+    if (j >= 0) {
+      k = j % BATCH_RING;
+      edge = (first[k] != NULL) ? FindEdge(first[k], other[k]) : NULL;
+      results[j] = edge != NULL && EdgeVisible(g, first[k], edge, false);
+    }
+  }
 }
@@ -5,11 +5,17 @@
 // A Graph G(V,E) is a set of vertices V and pairs of connected vertices
 // {V1,V2} known as edges. Each edge {V1,V2} has an associated weight W that
 // is non-negative.
+//
+// A Graph may instead be directed (see AllocateDirectedGraph), in which case
+// each edge (V1,V2) runs from V1 to V2 only, and is stored only once.
 
 #ifndef _GRAPH_H_
 #define _GRAPH_H_
 
+#include <inttypes.h> // for PRId64
 #include <stdbool.h>  // for bool type
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for int64_t
 
 // We define the implementation struct here, and define a Graph as a pointer
 // to the implementation. This way we can obscure the implementation details
@@ -17,23 +23,99 @@
 struct graphimpl;
 typedef struct graphimpl *Graph;
 
+// The Graph's storage is specialized at compile time, so that a build only
+// pays for what it uses. The following macros select the specialization, and
+// every file linked together must be compiled with the same values (the
+// Makefile passes them along for you):
+//
+//    -- GRAPH_VERTEX_BITS     the width of a vertex: 32 (the default) or 64.
+//    -- GRAPH_WEIGHT          the type of an edge weight: GRAPH_WEIGHT_INT
+//                             (the default), GRAPH_WEIGHT_FLOAT or
+//                             GRAPH_WEIGHT_NONE. An unweighted Graph stores
+//                             no weights at all; every edge reports a weight
+//                             of 1, and weights passed in are ignored.
+//    -- GRAPH_VERTEX_PAYLOAD  the number of bytes of client data stored
+//                             inline with each vertex (default 0).
+//    -- GRAPH_EDGE_PAYLOAD    the number of bytes of client data stored
+//                             inline with each edge (default 0).
+#define GRAPH_WEIGHT_NONE  0
+#define GRAPH_WEIGHT_INT   1
+#define GRAPH_WEIGHT_FLOAT 2
+
+#ifndef GRAPH_VERTEX_BITS
+#define GRAPH_VERTEX_BITS 32
+#endif
+
+#ifndef GRAPH_WEIGHT
+#define GRAPH_WEIGHT GRAPH_WEIGHT_INT
+#endif
+
+#ifndef GRAPH_VERTEX_PAYLOAD
+#define GRAPH_VERTEX_PAYLOAD 0
+#endif
+
+#ifndef GRAPH_EDGE_PAYLOAD
+#define GRAPH_EDGE_PAYLOAD 0
+#endif
+
 // We define the Vertex data type as a integer. We could add support for
 // generic data types via a (void *) but the added complexity in terms of
 // memory management and vertex comparisons isn't worth it for the scope
-// of this project.
+// of this project. Clients with data to attach to their vertices can store
+// it inline instead (see GRAPH_VERTEX_PAYLOAD).
+//
+// GVERTEX_FMT is the printf conversion for a vertex, as in
+// printf("%" GVERTEX_FMT, v).
+#if GRAPH_VERTEX_BITS == 32
 typedef int GVertex_t;
+#define GVERTEX_FMT "d"
+#elif GRAPH_VERTEX_BITS == 64
+typedef int64_t GVertex_t;
+#define GVERTEX_FMT PRId64
+#else
+#error "GRAPH_VERTEX_BITS must be 32 or 64"
+#endif
+
+// The type of an edge weight, as passed to and returned from the Graph. An
+// unweighted Graph still takes and returns weights (always 1), so that the
+// interface is the same for every specialization. GWEIGHT_FMT is the printf
+// conversion for a weight.
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_FLOAT
+typedef float GWeight_t;
+#define GWEIGHT_FMT "g"
+#elif GRAPH_WEIGHT == GRAPH_WEIGHT_INT || GRAPH_WEIGHT == GRAPH_WEIGHT_NONE
+typedef int GWeight_t;
+#define GWEIGHT_FMT "d"
+#else
+#error "GRAPH_WEIGHT must be GRAPH_WEIGHT_INT, GRAPH_WEIGHT_FLOAT or GRAPH_WEIGHT_NONE"
+#endif
 
 // A neighbor is a composed of a vertex and a weight. Thus for any given
 // vertex, the outgoing edges from that vertex can represented as a set of
-// neighbors.
+// neighbors. When edges carry a payload, the neighbor holds a copy of it.
 typedef struct Neighbor {
-  GVertex_t v;
-  int       weight;
+  GVertex_t     v;
+  GWeight_t     weight;
+#if GRAPH_EDGE_PAYLOAD > 0
+  unsigned char payload[GRAPH_EDGE_PAYLOAD];
+#endif
 } Neighbor;
 
 // Allocates a new Graph. Returns NULL on memory error.
 Graph AllocateGraph();
 
+// Allocates a new directed Graph. Returns NULL on memory error.
+//
+// The functions below work on directed Graphs too; where their behavior
+// differs, they say so. Only the edges leaving each vertex are stored up
+// front. The first call to GetInNeighbors builds lists of the edges
+// entering each vertex as well, and the Graph keeps both up to date from
+// then on, which costs as much again in memory and insertion work.
+Graph AllocateDirectedGraph();
+
+// Returns true if the Graph was allocated with AllocateDirectedGraph.
+bool IsDirectedGraph(Graph g);
+
 // Frees an existing Graph.
 //
 // Arguments:
@@ -66,9 +148,51 @@ bool ContainsVertex(Graph g, GVertex_t v);
 //    -- v1   the source vertex.
 //    -- v2   the destination vertex.
 //
-// Returns true if there exists an edge {V1,V2}, otherwise false.
+// Returns true if there exists an edge {V1,V2}, otherwise false. In a
+// directed Graph, the edge must run from v1 to v2.
 bool AreAdjacent(Graph g, GVertex_t v1, GVertex_t v2);
 
+// A pair of vertices, as used to describe an edge in a batch of queries.
+typedef struct VertexPair {
+  GVertex_t v1;
+  GVertex_t v2;
+} VertexPair;
+
+// An edge {v1,v2} with its weight, as used to describe many edges at once.
+typedef struct GraphEdge {
+  GVertex_t v1;
+  GVertex_t v2;
+  GWeight_t weight;
+} GraphEdge;
+
+// Tests a batch of vertices for membership in the Graph. This gives the
+// same answers as calling ContainsVertex for each vertex in turn, but
+// overlaps the memory accesses of neighboring queries, so large batches
+// against large Graphs run considerably faster.
+//
+// Arguments:
+//
+//    -- g        the Graph to examine.
+//    -- vs       the vertices to look for.
+//    -- n        the number of vertices in vs.
+//    -- results  location to store the n answers in; results[i] is true if
+//                vs[i] exists in the graph, otherwise false.
+void ContainsVertexBatch(Graph g, const GVertex_t *vs, int n, bool *results);
+
+// Tests a batch of vertex pairs for adjacency. This gives the same answers
+// as calling AreAdjacent for each pair in turn, but overlaps the memory
+// accesses of neighboring queries.
+//
+// Arguments:
+//
+//    -- g        the Graph to examine.
+//    -- queries  the pairs of vertices to test.
+//    -- n        the number of pairs in queries.
+//    -- results  location to store the n answers in; results[i] is true if
+//                there exists an edge {queries[i].v1, queries[i].v2}.
+void AreAdjacentBatch(Graph g, const VertexPair *queries, int n,
+                      bool *results);
+
 // Gets a list of neighbors for a given vertex.
 //
 // Arguments:
@@ -86,11 +210,24 @@ bool AreAdjacent(Graph g, GVertex_t v1, GVertex_t v2);
 //    
 // In the latter case returns array of Neighbors in the location specified
 // by out. The client is responsible for free()'ing this array.
+//
+// In a directed Graph, the neighbors are the vertices v has edges to.
 int GetNeighbors(Graph g, GVertex_t v, Neighbor **out);
 
+// Gets a list of the vertices with edges to a given vertex, in the same
+// way as GetNeighbors. In an undirected Graph these are just its neighbors.
+// In a directed Graph, the first call builds the in-adjacency of the whole
+// Graph, which takes time linear in its size; later calls take time linear
+// in the number of neighbors returned.
+//
+// Returns the same values as GetNeighbors.
+int GetInNeighbors(Graph g, GVertex_t v, Neighbor **out);
+
 // Adds an edge between two vertices. If either of the vertices is not
 // present in the Graph, they are automatically added. The vertices
-// must be distinct (no self-loops are permitted).
+// must be distinct (no self-loops are permitted). If the edge is already
+// present, its weight is updated to w. In a directed Graph, the edge runs
+// from v1 to v2, and the edge from v2 to v1 is a different edge.
 //
 // Arguments:
 //
@@ -99,8 +236,9 @@ int GetNeighbors(Graph g, GVertex_t v, Neighbor **out);
 //    -- v2   the destination vertex.
 //    -- w    the weight of the edge. Must be non-negative.
 //
-// Returns -1 on memory error, 0 on success.
-int AddGraphEdge(Graph g, GVertex_t v1, GVertex_t v2, int w);
+// Returns -1 on memory error or if v1 and v2 are the same vertex, 0 on
+// success.
+int AddGraphEdge(Graph g, GVertex_t v1, GVertex_t v2, GWeight_t w);
 
 // Removes an edge between vertices.
 //
@@ -111,7 +249,81 @@ int AddGraphEdge(Graph g, GVertex_t v1, GVertex_t v2, int w);
 //    -- v2   the destination vertex.
 //
 // If the either vertex is not in the graph, or if the edge is not
-// in the graph, does nothing.
+// in the graph, does nothing. In a directed Graph, only the edge from v1 to
+// v2 is removed.
 void RemoveGraphEdge(Graph g, GVertex_t v1, GVertex_t v2);
 
+// Gets the payload stored inline with a vertex. A new vertex's payload is
+// zeroed. The payload stays where it is for as long as the vertex remains in
+// the Graph, so clients may hold on to the pointer.
+//
+// Arguments:
+//
+//    -- g    the Graph to query.
+//    -- v    the vertex whose payload to get.
+//
+// Returns the GRAPH_VERTEX_PAYLOAD bytes of payload, which the client may
+// read and write, or NULL if v is not in the Graph or vertices carry no
+// payload.
+void *GetVertexPayload(Graph g, GVertex_t v);
+
+// Gets the payload stored inline with an edge. A new edge's payload is
+// zeroed, and updating an edge's weight leaves its payload alone.
+//
+// Arguments:
+//
+//    -- g    the Graph to query.
+//    -- v1   one vertex of the edge.
+//    -- v2   the other vertex of the edge.
+//
+// Returns the GRAPH_EDGE_PAYLOAD bytes of payload, or NULL if there is no
+// edge {v1,v2} or edges carry no payload. Since an undirected edge is
+// stored with both of its vertices, the payload is read-only; change it
+// with SetEdgePayload.
+const void *GetEdgePayload(Graph g, GVertex_t v1, GVertex_t v2);
+
+// Sets the payload stored inline with an edge.
+//
+// Arguments:
+//
+//    -- g     the Graph containing the edge.
+//    -- v1    one vertex of the edge.
+//    -- v2    the other vertex of the edge.
+//    -- data  the GRAPH_EDGE_PAYLOAD bytes to store.
+//
+// Returns -1 if there is no edge {v1,v2} or edges carry no payload, 0 on
+// success.
+int SetEdgePayload(Graph g, GVertex_t v1, GVertex_t v2, const void *data);
+
+// The degree histogram reported by GetGraphSummary is bucketed by powers of
+// two: bucket 0 counts vertices with no edges, and bucket i counts vertices
+// whose degree is in [2^(i-1), 2^i).
+#define GRAPH_DEGREE_BUCKETS 32
+
+// A summary of the shape and size of a Graph. The byte counts include an
+// estimate of the allocator's per-allocation overhead. In a directed Graph,
+// the degrees are out-degrees.
+typedef struct GraphSummary {
+  int    vertices;
+  long   edges;
+  int    minDegree;
+  int    maxDegree;
+  double meanDegree;
+  long   degreeHistogram[GRAPH_DEGREE_BUCKETS];
+  size_t vertexBytes;    // storage for the vertices themselves
+  size_t edgeBytes;      // storage for the edges (in both directions)
+  size_t overheadBytes;  // bookkeeping shared by the whole Graph
+} GraphSummary;
+
+// Summarizes the Graph. The counters are maintained as the Graph is
+// modified, so this takes constant time regardless of the Graph's size,
+// except for a view (see GraphView.h), which is walked to count what it
+// shows.
+//
+// Arguments:
+//
+//    -- g    the Graph to summarize.
+//    -- out  location to store the summary in.
+void GetGraphSummary(Graph g, GraphSummary *out);
+
 #endif
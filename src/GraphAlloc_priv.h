@@ -0,0 +1,36 @@
+// The allocation calls used by the Graph implementation and its vertex
+// index, which charge every block to the Graph's accounts (see
+// GraphAllocator.h).
+//
+// Code working on a Graph's internals must allocate and free the Graph's
+// memory through these, passing each block's size back when freeing it.
+
+#ifndef _GRAPH_ALLOC_PRIV_H_
+#define _GRAPH_ALLOC_PRIV_H_
+
+#include <stddef.h>
+
+#include "./GraphAllocator.h"
+
+// A Graph's allocator and accounts.
+typedef struct GraphMemory {
+  const GraphAllocator *allocator;
+  size_t                bytes;  // held from the allocator
+  size_t                limit;  // the most bytes to hold, or 0 for no limit
+} GraphMemory;
+
+// Allocates size bytes, unless that would take the accounts past their
+// limit. Returns NULL on memory error. A NULL m uses malloc, uncounted.
+void *MemoryAlloc(GraphMemory *m, size_t size);
+
+// The same, but zeroed.
+void *MemoryCalloc(GraphMemory *m, size_t size);
+
+// Resizes a block from oldSize to size bytes, with the same limit. Returns
+// NULL on memory error, leaving the block as it was.
+void *MemoryRealloc(GraphMemory *m, void *p, size_t oldSize, size_t size);
+
+// Frees a block of size bytes. Does nothing if p is NULL.
+void MemoryFree(GraphMemory *m, void *p, size_t size);
+
+#endif
@@ -0,0 +1,332 @@
+// Implementation of the built-in Graph allocators and the accounting every
+// Graph allocation goes through.
+//
+// An arena hands out blocks from the current chunk by bumping a pointer,
+// and starts a new chunk when that one runs out; the rest of the old chunk
+// is wasted, which is why blocks large enough to waste much get chunks of
+// their own. Freed blocks of the small sizes a Graph makes by the thousand
+// (vertices and edges) go on a free list for their size, rounded up to
+// the alignment, and are handed out again before the chunk is touched. A
+// block with a chunk of its own goes back as soon as it is freed.
+//
+// Every chunk starts with a header linking it into its arena's list.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "./GraphAllocator.h"
+#include "./GraphAlloc_priv.h"
+
+// Every block is aligned to this, as malloc's are.
+#define ALIGNMENT 16
+
+// Blocks up to this size are recycled through free lists.
+#define SMALL_BLOCK 512
+#define SIZE_CLASSES (SMALL_BLOCK / ALIGNMENT)
+
+// Blocks larger than this fraction of a chunk get chunks of their own.
+#define SHARED_FRACTION 8
+
+#define DEFAULT_CHUNK (1 << 20)
+#define MIN_CHUNK 4096
+
+// System allocations at least this large are aligned to, and ask for, huge
+// pages, as GraphBuilder.c does with its work arrays.
+#define HUGE_PAGE (2 << 20)
+
+// The header at the start of each chunk, padded to keep blocks aligned.
+typedef struct Chunk {
+  struct Chunk  *prev;
+  struct Chunk  *next;
+  size_t         size;     // of the whole chunk, header included
+  bool           mapped;   // from mmap rather than malloc
+} __attribute__((aligned(ALIGNMENT))) Chunk;
+
+// A freed small block, linked into the free list for its size.
+typedef struct FreeBlock {
+  struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct Arena {
+  GraphAllocator  allocator;  // first, so that it converts to the arena
+  size_t          chunkSize;
+  bool            hugePages;
+  Chunk          *chunks;
+  char           *next;       // the free part of the current chunk
+  char           *end;
+  FreeBlock      *freeLists[SIZE_CLASSES];
+} Arena;
+
+// Helper function declarations
+void *SystemAlloc(void *ctx, size_t size);
+void *SystemRealloc(void *ctx, void *p, size_t oldSize, size_t size);
+void SystemFree(void *ctx, void *p, size_t size);
+GraphAllocator *NewArena(size_t chunkBytes, bool hugePages);
+Chunk *NewChunk(Arena *a, size_t size);
+void ReleaseChunk(Arena *a, Chunk *c);
+void *ArenaAlloc(void *ctx, size_t size);
+void *ArenaRealloc(void *ctx, void *p, size_t oldSize, size_t size);
+void ArenaFree(void *ctx, void *p, size_t size);
+
+static const GraphAllocator systemAllocator = {
+  SystemAlloc, SystemRealloc, SystemFree, NULL
+};
+
+const GraphAllocator *SystemGraphAllocator() {
+  return &systemAllocator;
+}
+
+void *SystemAlloc(void *ctx, size_t size) {
+  void *p;
+
+  (void)ctx;
+  if (size < HUGE_PAGE) {
+    return malloc(size);
+  }
+  if (posix_memalign(&p, HUGE_PAGE, size) != 0) {
+    return NULL;
+  }
+  madvise(p, size, MADV_HUGEPAGE);
+  return p;
+}
+
+void *SystemRealloc(void *ctx, void *p, size_t oldSize, size_t size) {
+  (void)ctx;
+  (void)oldSize;
+  return realloc(p, size);
+}
+
+void SystemFree(void *ctx, void *p, size_t size) {
+  (void)ctx;
+  (void)size;
+  free(p);
+}
+
+GraphAllocator *AllocateArenaAllocator(size_t chunkBytes) {
+  return NewArena(chunkBytes, false);
+}
+
+GraphAllocator *AllocateHugePageAllocator(size_t chunkBytes) {
+  if (chunkBytes == 0) {
+    chunkBytes = HUGE_PAGE;
+  }
+  return NewArena((chunkBytes + HUGE_PAGE - 1) & ~(size_t)(HUGE_PAGE - 1),
+                  true);
+}
+
+void FreeArenaAllocator(GraphAllocator *allocator) {
+  Arena *a = (Arena *)allocator;
+
+  while (a->chunks != NULL) {
+    ReleaseChunk(a, a->chunks);
+  }
+  free(a);
+}
+
+// Allocates an empty arena. Returns NULL on memory error.
+GraphAllocator *NewArena(size_t chunkBytes, bool hugePages) {
+  Arena *a;
+
+  a = (Arena *)calloc(1, sizeof(Arena));
+  if (a == NULL) {
+    return NULL;
+  }
+  a->allocator.alloc = ArenaAlloc;
+  a->allocator.realloc = ArenaRealloc;
+  a->allocator.free = ArenaFree;
+  a->allocator.ctx = a;
+  if (chunkBytes == 0) {
+    chunkBytes = DEFAULT_CHUNK;
+  }
+  a->chunkSize = (chunkBytes < MIN_CHUNK) ? MIN_CHUNK : chunkBytes;
+  a->hugePages = hugePages;
+  return &a->allocator;
+}
+
+// Allocates a chunk with room for size bytes after its header, and links
+// it into the arena. Returns NULL on memory error.
+Chunk *NewChunk(Arena *a, size_t size) {
+  void *p = MAP_FAILED;
+  Chunk *c;
+
+  size += sizeof(Chunk);
+  if (size < sizeof(Chunk)) {
+    return NULL;
+  }
+  if (a->hugePages) {
+    size = (size + HUGE_PAGE - 1) & ~(size_t)(HUGE_PAGE - 1);
+#ifdef MAP_HUGETLB
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+      // no huge pages reserved, so settle for transparent ones
+      p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+        return NULL;
+      }
+      madvise(p, size, MADV_HUGEPAGE);
+    }
+  } else {
+    p = malloc(size);
+    if (p == NULL) {
+      return NULL;
+    }
+  }
+
+  c = (Chunk *)p;
+  c->size = size;
+  c->mapped = a->hugePages;
+  c->prev = NULL;
+  c->next = a->chunks;
+  if (a->chunks != NULL) {
+    a->chunks->prev = c;
+  }
+  a->chunks = c;
+  return c;
+}
+
+// Unlinks a chunk from the arena and gives its memory back.
+void ReleaseChunk(Arena *a, Chunk *c) {
+  if (c->prev != NULL) {
+    c->prev->next = c->next;
+  } else {
+    a->chunks = c->next;
+  }
+  if (c->next != NULL) {
+    c->next->prev = c->prev;
+  }
+  if (c->mapped) {
+    munmap(c, c->size);
+  } else {
+    free(c);
+  }
+}
+
+void *ArenaAlloc(void *ctx, size_t size) {
+  Arena *a = (Arena *)ctx;
+  FreeBlock *block;
+  Chunk *c;
+  size_t rounded;
+  void *p;
+
+  rounded = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+  if (rounded == 0) {
+    rounded = ALIGNMENT;
+  }
+  if (rounded <= SMALL_BLOCK &&
+      (block = a->freeLists[rounded / ALIGNMENT - 1]) != NULL) {
+    a->freeLists[rounded / ALIGNMENT - 1] = block->next;
+    return block;
+  }
+
+  if (rounded > a->chunkSize / SHARED_FRACTION) {
+    c = NewChunk(a, rounded);
+    return (c == NULL) ? NULL : (void *)(c + 1);
+  }
+  if ((size_t)(a->end - a->next) < rounded) {
+    c = NewChunk(a, a->chunkSize - sizeof(Chunk));
+    if (c == NULL) {
+      return NULL;
+    }
+    a->next = (char *)(c + 1);
+    a->end = (char *)c + c->size;
+  }
+  p = a->next;
+  a->next += rounded;
+  return p;
+}
+
+void *ArenaRealloc(void *ctx, void *p, size_t oldSize, size_t size) {
+  void *grown;
+
+  grown = ArenaAlloc(ctx, size);
+  if (grown == NULL) {
+    return NULL;
+  }
+  if (p != NULL) {
+    memcpy(grown, p, oldSize < size ? oldSize : size);
+    ArenaFree(ctx, p, oldSize);
+  }
+  return grown;
+}
+
+void ArenaFree(void *ctx, void *p, size_t size) {
+  Arena *a = (Arena *)ctx;
+  FreeBlock *block = (FreeBlock *)p;
+  size_t rounded;
+
+  if (p == NULL) {
+    return;
+  }
+  rounded = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+  if (rounded == 0) {
+    rounded = ALIGNMENT;
+  }
+  if (rounded > a->chunkSize / SHARED_FRACTION) {
+    // the block has its chunk to itself
+    ReleaseChunk(a, (Chunk *)p - 1);
+  } else if (rounded <= SMALL_BLOCK) {
+    block->next = a->freeLists[rounded / ALIGNMENT - 1];
+    a->freeLists[rounded / ALIGNMENT - 1] = block;
+  }
+  // a larger shared block stays where it is until the arena goes
+}
+
+void *MemoryAlloc(GraphMemory *m, size_t size) {
+  void *p;
+
+  if (m == NULL) {
+    return malloc(size);
+  }
+  if (m->limit != 0 && (size > m->limit || m->bytes > m->limit - size)) {
+    return NULL;
+  }
+  p = m->allocator->alloc(m->allocator->ctx, size);
+  if (p != NULL) {
+    m->bytes += size;
+  }
+  return p;
+}
+
+void *MemoryCalloc(GraphMemory *m, size_t size) {
+  void *p;
+
+  p = MemoryAlloc(m, size);
+  if (p != NULL) {
+    memset(p, 0, size);
+  }
+  return p;
+}
+
+void *MemoryRealloc(GraphMemory *m, void *p, size_t oldSize, size_t size) {
+  void *grown;
+
+  if (m == NULL) {
+    return realloc(p, size);
+  }
+  if (m->limit != 0 && size > oldSize &&
+      (size - oldSize > m->limit || m->bytes > m->limit - (size - oldSize))) {
+    return NULL;
+  }
+  grown = m->allocator->realloc(m->allocator->ctx, p, oldSize, size);
+  if (grown != NULL) {
+    m->bytes = m->bytes - oldSize + size;
+  }
+  return grown;
+}
+
+void MemoryFree(GraphMemory *m, void *p, size_t size) {
+  if (p == NULL) {
+    return;
+  }
+  if (m == NULL) {
+    free(p);
+    return;
+  }
+  m->allocator->free(m->allocator->ctx, p, size);
+  m->bytes -= size;
+}
@@ -0,0 +1,96 @@
+// Pluggable memory allocation for Graphs, with per-Graph accounting and
+// limits.
+//
+// Every byte a Graph holds (its vertices, edges, slabs, index and counters)
+// comes from the allocator it was created with, and is counted against
+// it. A Graph with a limit refuses any allocation that would take it past
+// the limit; the operation needing it fails as it would when out of memory,
+// leaving the Graph as it was. The arrays handed out to clients, such as
+// those of GetNeighbors, are not the Graph's: they always come from
+// malloc, so that the client can free() them.
+//
+// An allocator is a table of functions and a context pointer passed to
+// each. Three are built in:
+//
+//    -- the system allocator, malloc and free. Blocks of 2 MB or more are
+//       aligned to, and ask for, transparent huge pages. Graphs made with
+//       AllocateGraph use this one.
+//    -- arenas, which carve blocks out of large chunks with a bump pointer,
+//       and recycle freed small blocks by size. Allocation is a few
+//       instructions, vertices and edges allocated together sit together,
+//       and freeing the arena releases every Graph in it at once.
+//    -- huge page arenas, whose chunks are huge page mappings
+//       (MAP_HUGETLB), or if none are available, regions the kernel is
+//       asked to back with transparent huge pages.
+//
+// A Graph only calls its allocator while it is being changed (and the first
+// time GetInNeighbors builds a directed Graph's in-adjacency), so an
+// allocator only needs to be thread safe if Graphs sharing it are changed
+// from several threads at once. The arenas are not.
+
+#ifndef _GRAPH_ALLOCATOR_H_
+#define _GRAPH_ALLOCATOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./Graph.h"
+
+// An allocator. Blocks must be aligned for any type, as with malloc. The
+// Graph always passes a block's current size back with it, so allocators
+// need not record sizes themselves.
+//
+//    -- alloc    returns a new block of size bytes, or NULL.
+//    -- realloc  resizes the block p of oldSize bytes to size bytes,
+//                keeping its contents, and returns it (perhaps moved), or
+//                NULL, leaving p as it was.
+//    -- free     releases the block p of size bytes.
+//    -- ctx      passed to each of the above.
+typedef struct GraphAllocator {
+  void *(*alloc)(void *ctx, size_t size);
+  void *(*realloc)(void *ctx, void *p, size_t oldSize, size_t size);
+  void  (*free)(void *ctx, void *p, size_t size);
+  void   *ctx;
+} GraphAllocator;
+
+// Returns the system allocator.
+const GraphAllocator *SystemGraphAllocator();
+
+// Allocates an arena allocator, taking memory from malloc in chunks of the
+// given size (or a default size, if 0). Blocks too large to share a chunk
+// get chunks of their own. Returns NULL on memory error.
+GraphAllocator *AllocateArenaAllocator(size_t chunkBytes);
+
+// Allocates an arena allocator whose chunks are huge page mappings, of the
+// given size rounded up to a whole number of huge pages (or a default size,
+// if 0). Returns NULL on memory error.
+GraphAllocator *AllocateHugePageAllocator(size_t chunkBytes);
+
+// Frees an arena or huge page allocator, and with it all the memory it
+// handed out. Any Graph using it must be freed first.
+void FreeArenaAllocator(GraphAllocator *a);
+
+// Allocates a new Graph whose memory comes from the given allocator.
+//
+// Arguments:
+//
+//    -- directed   whether the Graph is directed (see AllocateDirectedGraph).
+//    -- a          the allocator. It must outlive the Graph.
+//    -- limit      the most bytes the Graph may hold, or 0 for no limit.
+//
+// Returns NULL on memory error, including if the limit is too small to
+// hold an empty Graph.
+Graph AllocateGraphWithAllocator(bool directed, const GraphAllocator *a,
+                                 size_t limit);
+
+// Returns the number of bytes the Graph holds from its allocator.
+size_t GraphBytesAllocated(Graph g);
+
+// Returns the Graph's memory limit in bytes, or 0 if it has none.
+size_t GraphMemoryLimit(Graph g);
+
+// Sets the Graph's memory limit in bytes, or removes it if limit is 0. A
+// limit below what the Graph already holds only stops it growing.
+void SetGraphMemoryLimit(Graph g, size_t limit);
+
+#endif
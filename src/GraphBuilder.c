@@ -0,0 +1,658 @@
+// Implementation of the parallel Graph builder.
+//
+// The build runs in phases. Each phase splits its work across the threads,
+// and the next phase starts only once every thread has finished the last:
+//
+// 1. Discover vertices: insert both endpoints of every edge into a
+//    concurrent open addressing table, claiming empty slots with an atomic
+//    compare-and-swap.
+// 2. Number vertices: count the occupied slots in each thread's share of
+//    the table, and give every vertex a dense id via a prefix sum of those
+//    counts.
+// 3. Count degrees: resolve every edge's endpoints to ids, and atomically
+//    increment both endpoints' degrees (only the source's, when building a
+//    directed Graph).
+// 4. Lay out edge lists: a prefix sum over the degrees gives each vertex a
+//    contiguous run of the edge slab.
+// 5. Scatter: write every edge into the next free place in both endpoints'
+//    runs (or the source's), again claimed atomically.
+// 6. Finish vertices: sort each run so duplicate edges sit together, keep
+//    the last occurrence of each, link the run into an edge list, and fill
+//    in the vertex's ListItem.
+// 7. Index: insert every vertex into the Graph's vertex index concurrently,
+//    and tally the degree counters GetGraphSummary reports.
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "./GraphBuilder.h"
+#include "./GraphBuilder_priv.h"
+#include "./Graph_priv.h"
+
+// States of a slot in the discovery table during phase 1.
+#define SLOT_EMPTY 0
+#define SLOT_BUSY  1
+#define SLOT_READY 2
+
+// Runs at most this long are sorted by insertion sort rather than qsort.
+#define SHORT_RUN 32
+
+// Arrays at least this large are aligned to, and ask for, huge pages. The
+// phases access them at random, so fewer TLB misses matter.
+#define HUGE_PAGE (2 << 20)
+
+// Vertices are finished in blocks of this many, handed out dynamically, so
+// that a few very high degree vertices do not leave threads idle.
+#define VERTEX_BLOCK 1024
+
+// Counters each thread accumulates while finishing vertices.
+typedef struct ThreadTally {
+  long edges;  // edge list entries, so twice the number of undirected edges
+  int  minDegree;
+  int  maxDegree;
+  long degreeHistogram[GRAPH_DEGREE_BUCKETS];
+  bool failed;
+} ThreadTally;
+
+// The state shared by all threads during a build.
+typedef struct Build {
+  const GraphEdge *edges;
+  size_t           n;
+  int              threads;
+  bool             directed;
+
+  // the discovery table; after phase 2, ids holds each occupied slot's
+  // vertex id, and -1 for empty slots
+  GVertex_t       *keys;
+  int             *ids;
+  size_t           tableMask;
+  int              tableShift;
+
+  size_t          *partials;     // per-thread counts for prefix sums
+  int              numVertices;
+  GVertex_t       *vertices;     // vertex value by id
+
+  int             *ends;         // endpoint ids, two per edge; -1 if skipped
+  int             *degrees;      // degree by id, before removing duplicates
+  size_t          *offsets;      // start of each id's run; numVertices + 1
+  size_t          *cursors;      // next free place in each id's run
+
+  Graph            g;
+  int              nextBlock;
+  ThreadTally     *tallies;
+} Build;
+
+// A phase of the build, run by each thread with its thread number.
+typedef void (*Phase)(Build *b, int t);
+
+// A phase to run, as the argument of PhaseShare.
+typedef struct PhaseRun {
+  Build *b;
+  Phase  phase;
+} PhaseRun;
+
+// Arguments for a thread running a share of some work.
+typedef struct ShareTask {
+  ThreadShare  share;
+  void        *arg;
+  int          t;
+} ShareTask;
+
+// Helper function declarations
+Graph BuildGraph(const GraphEdge *edges, size_t n, int threads,
+                 bool directed);
+bool RunPhase(Build *b, Phase phase);
+void PhaseShare(void *arg, int t);
+void *ShareThread(void *arg);
+void Share(size_t total, int threads, int t, size_t *start, size_t *end);
+size_t TableSlot(const Build *b, GVertex_t v);
+int LookupId(const Build *b, GVertex_t v);
+void DiscoverPhase(Build *b, int t);
+void CountSlotsPhase(Build *b, int t);
+void NumberPhase(Build *b, int t);
+void DegreePhase(Build *b, int t);
+void SumDegreesPhase(Build *b, int t);
+void OffsetPhase(Build *b, int t);
+void ScatterPhase(Build *b, int t);
+void FinishPhase(Build *b, int t);
+void IndexPhase(Build *b, int t);
+int CompareRunEdges(const void *a, const void *b);
+void SortRun(EdgeItem *run, int len);
+void *AllocateLarge(size_t bytes);
+void FreeBuild(Build *b);
+
+int GraphThreads(int threads) {
+  long cpus;
+
+  if (threads <= 0) {
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus < 1) ? 1 : (int)cpus;
+  }
+  return threads;
+}
+
+bool RunOnThreads(int threads, ThreadShare share, void *arg) {
+  ShareTask *tasks;
+  pthread_t *ids;
+  int t, started;
+
+  tasks = (ShareTask *)malloc(sizeof(ShareTask) * threads);
+  ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+  if (tasks == NULL || ids == NULL) {
+    free(tasks);
+    free(ids);
+    return false;
+  }
+  for (t = 0; t < threads; t++) {
+    tasks[t].share = share;
+    tasks[t].arg = arg;
+    tasks[t].t = t;
+  }
+
+  for (started = 1; started < threads; started++) {
+    if (pthread_create(&ids[started], NULL, ShareThread,
+                       &tasks[started]) != 0) {
+      break;
+    }
+  }
+  // if a thread failed to start, run its share (and the rest) ourselves
+  for (t = started; t < threads; t++) {
+    share(arg, t);
+  }
+  share(arg, 0);
+
+  for (t = 1; t < started; t++) {
+    pthread_join(ids[t], NULL);
+  }
+  free(tasks);
+  free(ids);
+  return true;
+}
+
+void *ShareThread(void *arg) {
+  ShareTask *task = (ShareTask *)arg;
+
+  task->share(task->arg, task->t);
+  return NULL;
+}
+
+// Runs one phase on every thread, the calling thread included, and waits
+// for all of them. Returns false on memory error, in which case the phase
+// has not run.
+bool RunPhase(Build *b, Phase phase) {
+  PhaseRun run = { b, phase };
+
+  return RunOnThreads(b->threads, PhaseShare, &run);
+}
+
+void PhaseShare(void *arg, int t) {
+  PhaseRun *run = (PhaseRun *)arg;
+
+  run->phase(run->b, t);
+}
+
+// Places the range of [0, total) that thread t of threads is responsible
+// for in [start, end).
+void Share(size_t total, int threads, int t, size_t *start, size_t *end) {
+  *start = total / threads * t + (total % threads < (size_t)t ?
+                                  total % threads : (size_t)t);
+  *end = *start + total / threads + ((size_t)t < total % threads ? 1 : 0);
+}
+
+size_t TableSlot(const Build *b, GVertex_t v) {
+  return (size_t)(((uint64_t)v * 0x9E3779B97F4A7C15ULL) >> b->tableShift);
+}
+
+// Returns the id of a vertex known to be in the table.
+int LookupId(const Build *b, GVertex_t v) {
+  size_t i;
+
+  for (i = TableSlot(b, v); b->keys[i] != v || b->ids[i] == -1;
+       i = (i + 1) & b->tableMask) {
+  }
+  return b->ids[i];
+}
+
+void DiscoverPhase(Build *b, int t) {
+  GVertex_t v;
+  size_t start, end, e, i;
+  int k, state;
+
+  Share(b->n, b->threads, t, &start, &end);
+  for (e = start; e < end; e++) {
+    if (b->edges[e].v1 == b->edges[e].v2) {
+      continue;
+    }
+    for (k = 0; k < 2; k++) {
+      v = (k == 0) ? b->edges[e].v1 : b->edges[e].v2;
+      for (i = TableSlot(b, v);; i = (i + 1) & b->tableMask) {
+        state = __atomic_load_n(&b->ids[i], __ATOMIC_ACQUIRE);
+        if (state == SLOT_EMPTY) {
+          if (__atomic_compare_exchange_n(&b->ids[i], &state, SLOT_BUSY,
+                                          false, __ATOMIC_ACQUIRE,
+                                          __ATOMIC_ACQUIRE)) {
+            b->keys[i] = v;
+            __atomic_store_n(&b->ids[i], SLOT_READY, __ATOMIC_RELEASE);
+            break;
+          }
+        }
+        // another thread is mid-way through filling the slot in
+        while (state == SLOT_BUSY) {
+          state = __atomic_load_n(&b->ids[i], __ATOMIC_ACQUIRE);
+        }
+        if (b->keys[i] == v) {
+          break;
+        }
+      }
+    }
+  }
+}
+
+void CountSlotsPhase(Build *b, int t) {
+  size_t start, end, i, count = 0;
+
+  Share(b->tableMask + 1, b->threads, t, &start, &end);
+  for (i = start; i < end; i++) {
+    if (b->ids[i] == SLOT_READY) {
+      count++;
+    }
+  }
+  b->partials[t] = count;
+}
+
+// Expects partials to hold the exclusive prefix sum of the slot counts.
+void NumberPhase(Build *b, int t) {
+  size_t start, end, i, id;
+
+  id = b->partials[t];
+  Share(b->tableMask + 1, b->threads, t, &start, &end);
+  for (i = start; i < end; i++) {
+    if (b->ids[i] == SLOT_READY) {
+      b->vertices[id] = b->keys[i];
+      b->ids[i] = (int)id++;
+    } else {
+      b->ids[i] = -1;
+    }
+  }
+}
+
+void DegreePhase(Build *b, int t) {
+  size_t start, end, e;
+  int a, c;
+
+  Share(b->n, b->threads, t, &start, &end);
+  for (e = start; e < end; e++) {
+    if (b->edges[e].v1 == b->edges[e].v2) {
+      b->ends[2 * e] = b->ends[2 * e + 1] = -1;
+      continue;
+    }
+    a = LookupId(b, b->edges[e].v1);
+    c = LookupId(b, b->edges[e].v2);
+    b->ends[2 * e] = a;
+    b->ends[2 * e + 1] = c;
+    // An atomic increment is several times slower than a plain one, since
+    // it cannot overlap its cache miss with the next edge's. Avoid it when
+    // there is nothing to race with.
+    if (b->threads == 1) {
+      b->degrees[a]++;
+      if (!b->directed) {
+        b->degrees[c]++;
+      }
+    } else {
+      __atomic_fetch_add(&b->degrees[a], 1, __ATOMIC_RELAXED);
+      if (!b->directed) {
+        __atomic_fetch_add(&b->degrees[c], 1, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+void SumDegreesPhase(Build *b, int t) {
+  size_t start, end, v, sum = 0;
+
+  Share(b->numVertices, b->threads, t, &start, &end);
+  for (v = start; v < end; v++) {
+    sum += b->degrees[v];
+  }
+  b->partials[t] = sum;
+}
+
+// Expects partials to hold the exclusive prefix sum of the degree sums.
+void OffsetPhase(Build *b, int t) {
+  size_t start, end, v, offset;
+
+  offset = b->partials[t];
+  Share(b->numVertices, b->threads, t, &start, &end);
+  for (v = start; v < end; v++) {
+    b->offsets[v] = b->cursors[v] = offset;
+    offset += b->degrees[v];
+  }
+}
+
+void ScatterPhase(Build *b, int t) {
+  EdgeItem *slab = b->g->edgeSlab;
+  size_t start, end, e, pos;
+  int k, from, to, copies;
+
+  copies = b->directed ? 1 : 2;
+  Share(b->n, b->threads, t, &start, &end);
+  for (e = start; e < end; e++) {
+    if (b->ends[2 * e] == -1) {
+      continue;
+    }
+    for (k = 0; k < copies; k++) {
+      from = b->ends[2 * e + k];
+      to = b->ends[2 * e + 1 - k];
+      if (b->threads == 1) {
+        pos = b->cursors[from]++;
+      } else {
+        pos = __atomic_fetch_add(&b->cursors[from], 1, __ATOMIC_RELAXED);
+      }
+      slab[pos].data = b->vertices[to];
+      SetEdgeWeight(&slab[pos], b->edges[e].weight);
+#if GRAPH_EDGE_PAYLOAD > 0
+      memset(slab[pos].payload, 0, sizeof(slab[pos].payload));
+#endif
+      // until the run is linked up, next holds the edge's position in the
+      // input, so that duplicates can be resolved in input order
+      slab[pos].next = (EdgeItem *)(uintptr_t)e;
+    }
+  }
+}
+
+// Orders edges in a run by neighbor, then by position in the input.
+int CompareRunEdges(const void *a, const void *b) {
+  const EdgeItem *x = (const EdgeItem *)a, *y = (const EdgeItem *)b;
+
+  if (x->data != y->data) {
+    return x->data < y->data ? -1 : 1;
+  }
+  return (uintptr_t)x->next < (uintptr_t)y->next ? -1 :
+    (uintptr_t)x->next > (uintptr_t)y->next;
+}
+
+// Sorts a run with CompareRunEdges. Most runs are short, and insertion sort
+// beats qsort's per-comparison function call on those.
+void SortRun(EdgeItem *run, int len) {
+  EdgeItem tmp;
+  int i, j;
+
+  if (len > SHORT_RUN) {
+    qsort(run, len, sizeof(EdgeItem), CompareRunEdges);
+    return;
+  }
+
+  for (i = 1; i < len; i++) {
+    tmp = run[i];
+    for (j = i; j > 0 && CompareRunEdges(&run[j - 1], &tmp) > 0; j--) {
+      run[j] = run[j - 1];
+    }
+    run[j] = tmp;
+  }
+}
+
+void FinishPhase(Build *b, int t) {
+  ThreadTally *tally = &b->tallies[t];
+  EdgeItem *run;
+  ListItem *l;
+  int block, v, end, i, count, len;
+
+  tally->minDegree = INT_MAX;
+  for (;;) {
+    block = __atomic_fetch_add(&b->nextBlock, 1, __ATOMIC_RELAXED);
+    v = block * VERTEX_BLOCK;
+    if (v >= b->numVertices) {
+      break;
+    }
+    end = v + VERTEX_BLOCK < b->numVertices ? v + VERTEX_BLOCK :
+      b->numVertices;
+
+    for (; v < end; v++) {
+      run = b->g->edgeSlab + b->offsets[v];
+      len = (int)(b->offsets[v + 1] - b->offsets[v]);
+
+      // keep only the last occurrence of each neighbor, packing the
+      // survivors at the front of the run
+      SortRun(run, len);
+      count = 0;
+      for (i = 0; i < len; i++) {
+        if (i + 1 < len && run[i + 1].data == run[i].data) {
+          continue;
+        }
+        run[count++] = run[i];
+      }
+      for (i = 0; i < count; i++) {
+        run[i].next = (i + 1 < count) ? &run[i + 1] : NULL;
+      }
+
+      l = &b->g->vertexSlab[v];
+      l->data = b->vertices[v];
+      l->neighbors = (count > 0) ? run : NULL;
+      l->count = count;
+      l->next = (v + 1 < b->numVertices) ? l + 1 : NULL;
+      l->inNeighbors = NULL;
+      l->id = v;
+#if GRAPH_VERTEX_PAYLOAD > 0
+      memset(l->payload, 0, sizeof(l->payload));
+#endif
+
+      tally->edges += count;
+      if (count < tally->minDegree) {
+        tally->minDegree = count;
+      }
+      if (count > tally->maxDegree) {
+        tally->maxDegree = count;
+      }
+      tally->degreeHistogram[DegreeBucket(count)]++;
+    }
+  }
+}
+
+void IndexPhase(Build *b, int t) {
+  ListItem *l;
+  size_t start, end, v;
+
+  Share(b->numVertices, b->threads, t, &start, &end);
+  for (v = start; v < end; v++) {
+    l = &b->g->vertexSlab[v];
+    VertexIndexInsertConcurrent(&b->g->index, l->data, l);
+    __atomic_fetch_add(&b->g->degreeCounts[l->count], 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Allocates memory that can be released with free(), backed by transparent
+// huge pages where the system allows. Returns NULL on memory error.
+void *AllocateLarge(size_t bytes) {
+  void *p;
+
+  if (bytes < HUGE_PAGE) {
+    return malloc(bytes);
+  }
+  if (posix_memalign(&p, HUGE_PAGE, bytes) != 0) {
+    return NULL;
+  }
+  madvise(p, bytes, MADV_HUGEPAGE);
+  return p;
+}
+
+void FreeBuild(Build *b) {
+  free(b->keys);
+  free(b->ids);
+  free(b->partials);
+  free(b->vertices);
+  free(b->ends);
+  free(b->degrees);
+  free(b->offsets);
+  free(b->cursors);
+  free(b->tallies);
+}
+
+Graph BuildGraphParallel(const GraphEdge *edges, size_t n, int threads) {
+  return BuildGraph(edges, n, threads, false);
+}
+
+Graph BuildDirectedGraphParallel(const GraphEdge *edges, size_t n,
+                                 int threads) {
+  return BuildGraph(edges, n, threads, true);
+}
+
+// Builds a Graph, directed or not, from the given edges.
+Graph BuildGraph(const GraphEdge *edges, size_t n, int threads,
+                 bool directed) {
+  Build b;
+  Graph g;
+  size_t slots, sum, part;
+  int t, i;
+
+  threads = GraphThreads(threads);
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  if (g == NULL || n == 0) {
+    return g;
+  }
+
+  memset(&b, 0, sizeof(Build));
+  b.edges = edges;
+  b.n = n;
+  b.threads = threads;
+  b.directed = directed;
+  b.g = g;
+
+  // phase 1: there are at most 2n vertices, keep the table half empty
+  for (slots = 16; slots < 4 * n; slots *= 2) {
+  }
+  b.tableMask = slots - 1;
+  b.tableShift = 64 - __builtin_ctzll(slots);
+  b.keys = (GVertex_t *)AllocateLarge(sizeof(GVertex_t) * slots);
+  b.ids = (int *)AllocateLarge(sizeof(int) * slots);
+  b.partials = (size_t *)malloc(sizeof(size_t) * threads);
+  b.tallies = (ThreadTally *)calloc(threads, sizeof(ThreadTally));
+  if (b.keys == NULL || b.ids == NULL || b.partials == NULL ||
+      b.tallies == NULL) {
+    goto fail;
+  }
+  memset(b.ids, 0, sizeof(int) * slots);
+  if (!RunPhase(&b, DiscoverPhase)) {
+    goto fail;
+  }
+
+  // phase 2
+  if (!RunPhase(&b, CountSlotsPhase)) {
+    goto fail;
+  }
+  for (sum = 0, t = 0; t < threads; t++) {
+    part = b.partials[t];
+    b.partials[t] = sum;
+    sum += part;
+  }
+  if (sum > INT_MAX) {
+    goto fail;
+  }
+  if (sum == 0) {
+    // every edge was a self-loop
+    FreeBuild(&b);
+    return g;
+  }
+  b.numVertices = (int)sum;
+  b.vertices = (GVertex_t *)malloc(sizeof(GVertex_t) * b.numVertices);
+  if (b.vertices == NULL) {
+    goto fail;
+  }
+  if (!RunPhase(&b, NumberPhase)) {
+    goto fail;
+  }
+
+  // phase 3
+  b.ends = (int *)malloc(sizeof(int) * 2 * n);
+  b.degrees = (int *)calloc(b.numVertices, sizeof(int));
+  if (b.ends == NULL || b.degrees == NULL) {
+    goto fail;
+  }
+  if (!RunPhase(&b, DegreePhase)) {
+    goto fail;
+  }
+
+  // phase 4
+  b.offsets = (size_t *)malloc(sizeof(size_t) * (b.numVertices + 1));
+  b.cursors = (size_t *)malloc(sizeof(size_t) * b.numVertices);
+  if (b.offsets == NULL || b.cursors == NULL) {
+    goto fail;
+  }
+  if (!RunPhase(&b, SumDegreesPhase)) {
+    goto fail;
+  }
+  for (sum = 0, t = 0; t < threads; t++) {
+    part = b.partials[t];
+    b.partials[t] = sum;
+    sum += part;
+  }
+  b.offsets[b.numVertices] = sum;
+  if (!RunPhase(&b, OffsetPhase)) {
+    goto fail;
+  }
+
+  // phase 5
+  g->vertexSlab = (ListItem *)MemoryAlloc(&g->memory,
+                                          sizeof(ListItem) * b.numVertices);
+  g->edgeSlab = (EdgeItem *)MemoryAlloc(&g->memory,
+                                        sizeof(EdgeItem) * (sum + 1));
+  g->vertexSlabCount = b.numVertices;
+  g->edgeSlabCount = sum;
+  if (g->vertexSlab == NULL || g->edgeSlab == NULL) {
+    goto fail;
+  }
+  if (!RunPhase(&b, ScatterPhase)) {
+    goto fail;
+  }
+
+  // phase 6
+  if (!RunPhase(&b, FinishPhase)) {
+    goto fail;
+  }
+  g->minDegree = INT_MAX;
+  for (t = 0; t < threads; t++) {
+    g->numEdges += b.tallies[t].edges;
+    if (b.tallies[t].minDegree < g->minDegree) {
+      g->minDegree = b.tallies[t].minDegree;
+    }
+    if (b.tallies[t].maxDegree > g->maxDegree) {
+      g->maxDegree = b.tallies[t].maxDegree;
+    }
+    for (i = 0; i < GRAPH_DEGREE_BUCKETS; i++) {
+      g->degreeHistogram[i] += b.tallies[t].degreeHistogram[i];
+    }
+  }
+  if (!directed) {
+    g->numEdges /= 2;
+  }
+  g->numVertices = b.numVertices;
+  g->front = &g->vertexSlab[0];
+  g->back = &g->vertexSlab[b.numVertices - 1];
+
+  // phase 7
+  FreeVertexIndex(&g->index);
+  if (!InitVertexIndexSized(&g->index, b.numVertices, &g->memory) ||
+      !EnsureDegreeCapacity(g, g->maxDegree)) {
+    // leave the Graph empty so that FreeGraph has nothing to walk
+    g->front = g->back = NULL;
+    goto fail;
+  }
+  if (!RunPhase(&b, IndexPhase)) {
+    goto fail;
+  }
+  g->index.count = b.numVertices;
+
+  FreeBuild(&b);
+  return g;
+
+fail:
+  g->front = g->back = NULL;
+  FreeGraph(g);
+  FreeBuild(&b);
+  return NULL;
+}
@@ -0,0 +1,41 @@
+// Bulk construction of a Graph from an array of edges, using many threads.
+//
+// Building a Graph one AddGraphEdge at a time is inherently serial. The
+// builder instead works in parallel phases with no locks: it discovers the
+// distinct vertices in a concurrent hash table, counts every vertex's
+// degree, lays the edge lists out contiguously using a prefix sum over the
+// degrees, and scatters the edges into place.
+
+#ifndef _GRAPH_BUILDER_H_
+#define _GRAPH_BUILDER_H_
+
+#include <stddef.h>  // for size_t
+
+#include "./Graph.h"
+
+// Builds the Graph containing exactly the given edges and their endpoints.
+// The result is the same as adding each edge in turn with AddGraphEdge:
+// self-loops are skipped, and if an edge appears more than once the weight
+// of its last occurrence wins. The order in which the vertices are stored
+// is unspecified.
+//
+// The returned Graph is an ordinary Graph, and can be queried, modified
+// and freed like any other.
+//
+// Arguments:
+//
+//    -- edges    the edges to build the Graph from.
+//    -- n        the number of edges.
+//    -- threads  the number of threads to use, or 0 to use one per CPU.
+//
+// Returns the Graph, or NULL on memory error or if there are more vertices
+// than a Graph can hold.
+Graph BuildGraphParallel(const GraphEdge *edges, size_t n, int threads);
+
+// Builds a directed Graph in the same way, as if each edge were added in
+// turn to a Graph from AllocateDirectedGraph. Each edge runs from v1 to v2,
+// and the in-adjacency is left to be built on first use.
+Graph BuildDirectedGraphParallel(const GraphEdge *edges, size_t n,
+                                 int threads);
+
+#endif
@@ -0,0 +1,24 @@
+// The thread helpers the bulk builder runs its phases on (see
+// GraphBuilder.c), shared with the other modules that split work into
+// shares, one per thread.
+
+#ifndef _GRAPH_BUILDER_PRIV_H_
+#define _GRAPH_BUILDER_PRIV_H_
+
+#include <stdbool.h>
+
+// Does share t of some work, given the argument passed to RunOnThreads.
+typedef void (*ThreadShare)(void *arg, int t);
+
+// Returns the number of threads to use for a requested number, where 0
+// (or less) means one per CPU.
+int GraphThreads(int threads);
+
+// Runs share(arg, t) for every t in [0, threads), each on a thread of its
+// own, the calling thread taking share 0, and waits for all of them. If a
+// thread fails to start, the calling thread runs its share (and the rest)
+// itself, so every share is done either way. Returns false on memory error,
+// in which case no share has run.
+bool RunOnThreads(int threads, ThreadShare share, void *arg);
+
+#endif
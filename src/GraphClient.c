@@ -0,0 +1,266 @@
+// Implementation of the Graph client.
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "./GraphClient.h"
+#include "./GraphProtocol.h"
+
+// Bytes read from the server at a time.
+#define READ_CHUNK 65536
+
+struct graphclient {
+  int       fd;
+  char     *out;        // queued requests
+  size_t    outLen;
+  size_t    outCap;
+  char     *in;         // received bytes not yet decoded, from inStart
+  size_t    inStart;
+  size_t    inLen;
+  size_t    inCap;
+  Neighbor *neighbors;  // the last response's neighbors
+  int       neighborCap;
+};
+
+// Helper function declarations
+int QueueRequest(GraphClient c, uint32_t id, int op, GVertex_t v1,
+                 GVertex_t v2, GWeight_t w);
+int FillInput(GraphClient c, size_t want);
+int DecodeResponse(GraphClient c, const char *p, uint32_t size,
+                   GraphResponse *r);
+
+GraphClient ConnectGraphClient(const char *path) {
+  struct sockaddr_un addr;
+  GraphClient c;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return NULL;
+  }
+  c = (GraphClient)calloc(1, sizeof(struct graphclient));
+  if (c == NULL) {
+    return NULL;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  c->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (c->fd == -1 ||
+      connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    CloseGraphClient(c);
+    return NULL;
+  }
+  return c;
+}
+
+void CloseGraphClient(GraphClient c) {
+  if (c->fd != -1) {
+    close(c->fd);
+  }
+  free(c->out);
+  free(c->in);
+  free(c->neighbors);
+  free(c);
+}
+
+// Appends a request frame to the queue. Arguments the op does not take are
+// ignored.
+int QueueRequest(GraphClient c, uint32_t id, int op, GVertex_t v1,
+                 GVertex_t v2, GWeight_t w) {
+  uint32_t size;
+  size_t cap;
+  char *out, *p;
+
+  size = GRAPH_REQUEST_HEADER + GraphRequestArgBytes(op);
+  if (c->outLen + GRAPH_MAX_REQUEST > c->outCap) {
+    cap = (c->outCap == 0) ? READ_CHUNK : 2 * c->outCap;
+    out = (char *)realloc(c->out, cap);
+    if (out == NULL) {
+      return -1;
+    }
+    c->out = out;
+    c->outCap = cap;
+  }
+
+  p = c->out + c->outLen;
+  p = PutBytes(p, &size, GRAPH_FRAME_SIZE_BYTES);
+  p = PutBytes(p, &id, 4);
+  *p++ = (char)op;
+  p = PutBytes(p, &v1, sizeof(GVertex_t));
+  if (op == GRAPH_REQ_ADJACENT || op == GRAPH_REQ_ADD_EDGE) {
+    p = PutBytes(p, &v2, sizeof(GVertex_t));
+  }
+  if (op == GRAPH_REQ_ADD_EDGE) {
+    p = PutBytes(p, &w, sizeof(GWeight_t));
+  }
+  c->outLen = p - c->out;
+  return 0;
+}
+
+int QueueContains(GraphClient c, uint32_t id, GVertex_t v) {
+  return QueueRequest(c, id, GRAPH_REQ_CONTAINS, v, 0, 0);
+}
+
+int QueueAdjacent(GraphClient c, uint32_t id, GVertex_t v1, GVertex_t v2) {
+  return QueueRequest(c, id, GRAPH_REQ_ADJACENT, v1, v2, 0);
+}
+
+int QueueNeighbors(GraphClient c, uint32_t id, GVertex_t v) {
+  return QueueRequest(c, id, GRAPH_REQ_NEIGHBORS, v, 0, 0);
+}
+
+int QueueAddEdge(GraphClient c, uint32_t id, GVertex_t v1, GVertex_t v2,
+                 GWeight_t w) {
+  return QueueRequest(c, id, GRAPH_REQ_ADD_EDGE, v1, v2, w);
+}
+
+int QueueAddVertex(GraphClient c, uint32_t id, GVertex_t v) {
+  return QueueRequest(c, id, GRAPH_REQ_ADD_VERTEX, v, 0, 0);
+}
+
+int FlushGraphClient(GraphClient c) {
+  size_t sent = 0;
+  ssize_t n;
+
+  while (sent < c->outLen) {
+    n = send(c->fd, c->out + sent, c->outLen - sent, MSG_NOSIGNAL);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    sent += n;
+  }
+  c->outLen = 0;
+  return 0;
+}
+
+// Reads from the server until at least want undecoded bytes are buffered.
+// Returns -1 if the connection fails or closes first, 0 on success.
+int FillInput(GraphClient c, size_t want) {
+  size_t cap;
+  ssize_t n;
+  char *in;
+
+  if (c->inLen - c->inStart >= want) {
+    return 0;
+  }
+
+  // drop what has been decoded, then make room for the rest
+  if (c->inStart > 0) {
+    memmove(c->in, c->in + c->inStart, c->inLen - c->inStart);
+    c->inLen -= c->inStart;
+    c->inStart = 0;
+  }
+  if (want > c->inCap || c->inCap - c->inLen < READ_CHUNK / 4) {
+    cap = (c->inCap == 0) ? READ_CHUNK : 2 * c->inCap;
+    while (cap < want) {
+      cap *= 2;
+    }
+    in = (char *)realloc(c->in, cap);
+    if (in == NULL) {
+      return -1;
+    }
+    c->in = in;
+    c->inCap = cap;
+  }
+
+  while (c->inLen < want) {
+    n = recv(c->fd, c->in + c->inLen, c->inCap - c->inLen, 0);
+    if (n == 0) {
+      return -1;
+    }
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    c->inLen += n;
+  }
+  return 0;
+}
+
+int ReadGraphResponse(GraphClient c, GraphResponse *r) {
+  uint32_t size;
+
+  if (FillInput(c, GRAPH_FRAME_SIZE_BYTES) == -1) {
+    return -1;
+  }
+  memcpy(&size, c->in + c->inStart, GRAPH_FRAME_SIZE_BYTES);
+  if (size < GRAPH_RESPONSE_HEADER ||
+      FillInput(c, GRAPH_FRAME_SIZE_BYTES + size) == -1) {
+    return -1;
+  }
+
+  c->inStart += GRAPH_FRAME_SIZE_BYTES;
+  if (DecodeResponse(c, c->in + c->inStart, size, r) == -1) {
+    return -1;
+  }
+  c->inStart += size;
+  return 0;
+}
+
+// Decodes a response frame (without its size field) into r.
+int DecodeResponse(GraphClient c, const char *p, uint32_t size,
+                   GraphResponse *r) {
+  Neighbor *neighbors;
+  uint32_t count, i;
+
+  memset(r, 0, sizeof(GraphResponse));
+  p = GetBytes(p, &r->id, 4);
+  r->op = (unsigned char)*p++;
+  r->status = (unsigned char)*p++;
+  size -= GRAPH_RESPONSE_HEADER;
+  if (r->status != GRAPH_STATUS_OK) {
+    return 0;
+  }
+
+  switch (r->op) {
+    case GRAPH_REQ_CONTAINS:
+    case GRAPH_REQ_ADJACENT:
+      if (size != 1) {
+        return -1;
+      }
+      r->answer = (*p != 0);
+      return 0;
+
+    case GRAPH_REQ_NEIGHBORS:
+      if (size < 4) {
+        return -1;
+      }
+      p = GetBytes(p, &count, 4);
+      if (size != 4 + count * GRAPH_NEIGHBOR_BYTES) {
+        return -1;
+      }
+      if ((int)count > c->neighborCap) {
+        neighbors = (Neighbor *)realloc(c->neighbors,
+                                        sizeof(Neighbor) * count);
+        if (neighbors == NULL) {
+          return -1;
+        }
+        c->neighbors = neighbors;
+        c->neighborCap = (int)count;
+      }
+      for (i = 0; i < count; i++) {
+        memset(&c->neighbors[i], 0, sizeof(Neighbor));
+        p = GetBytes(p, &c->neighbors[i].v, sizeof(GVertex_t));
+        p = GetBytes(p, &c->neighbors[i].weight, sizeof(GWeight_t));
+      }
+      r->count = (int)count;
+      r->neighbors = c->neighbors;
+      return 0;
+
+    case GRAPH_REQ_ADD_EDGE:
+    case GRAPH_REQ_ADD_VERTEX:
+      return size == 0 ? 0 : -1;
+
+    default:
+      return -1;
+  }
+}
@@ -0,0 +1,66 @@
+// A client for the Graph server (see GraphServer.h and GraphProtocol.h).
+//
+// Requests are queued locally and sent together by FlushGraphClient, so a
+// client can pipeline as many requests as it likes before reading the
+// responses with ReadGraphResponse. Responses come back in the order the
+// requests were sent.
+//
+// A GraphClient is not safe to use from several threads at once; give each
+// thread its own.
+
+#ifndef _GRAPH_CLIENT_H_
+#define _GRAPH_CLIENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./Graph.h"
+
+struct graphclient;
+typedef struct graphclient *GraphClient;
+
+// A decoded response.
+//
+//    -- id         the id of the request this answers.
+//    -- op         the request's op (GRAPH_REQ_*).
+//    -- status     GRAPH_STATUS_OK, or why the request did not succeed.
+//    -- answer     for GRAPH_REQ_CONTAINS and GRAPH_REQ_ADJACENT, the answer.
+//    -- count      for GRAPH_REQ_NEIGHBORS, the number of neighbors.
+//    -- neighbors  for GRAPH_REQ_NEIGHBORS, the neighbors. The array belongs
+//                  to the client, and is valid until its next read.
+typedef struct GraphResponse {
+  uint32_t  id;
+  int       op;
+  int       status;
+  bool      answer;
+  int       count;
+  Neighbor *neighbors;
+} GraphResponse;
+
+// Connects to the server listening at the given path. Returns NULL if the
+// connection fails or on memory error.
+GraphClient ConnectGraphClient(const char *path);
+
+// Closes the connection and frees the client. Responses not yet read are
+// discarded.
+void CloseGraphClient(GraphClient c);
+
+// Queue a request with the given id. Each returns -1 on memory error, 0 on
+// success.
+int QueueContains(GraphClient c, uint32_t id, GVertex_t v);
+int QueueAdjacent(GraphClient c, uint32_t id, GVertex_t v1, GVertex_t v2);
+int QueueNeighbors(GraphClient c, uint32_t id, GVertex_t v);
+int QueueAddEdge(GraphClient c, uint32_t id, GVertex_t v1, GVertex_t v2,
+                 GWeight_t w);
+int QueueAddVertex(GraphClient c, uint32_t id, GVertex_t v);
+
+// Sends every queued request. Returns -1 if the connection has failed, 0
+// on success.
+int FlushGraphClient(GraphClient c);
+
+// Waits for the next response, and decodes it into r. Returns -1 if the
+// connection has failed or closed, or the response is malformed, and 0 on
+// success.
+int ReadGraphResponse(GraphClient c, GraphResponse *r);
+
+#endif
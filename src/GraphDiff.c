@@ -0,0 +1,746 @@
+// Implementation of Graph diffs.
+//
+// Every way of computing a diff comes down to comparing, vertex by vertex,
+// the sorted edges of the old version with those of the new: a merge of
+// two sorted runs, in which an edge only in the new run is added, one only
+// in the old run is removed, and one in both with different weights is
+// reweighted. In an undirected Graph, each vertex's runs hold only its
+// edges to larger vertices, so that every edge is compared once. Vertices
+// of the old version that the new one gives no run are compared against an
+// empty run.
+//
+// Applying a diff turns each change into an entry for every edge list it
+// touches: the list of v1, and that of v2 in an undirected Graph, or v2's
+// incoming edges in a directed Graph whose in-adjacency is built. The
+// entries are sorted by list and then by the vertex at the other end, and
+// each list is walked once, looking its edges up among its entries by
+// binary search. Every allocation the changes need is made before the
+// first is applied, so that a memory error leaves the Graph as it was.
+
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./GraphDiff.h"
+#include "./GraphStats_priv.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+#include "./WeightIndex_priv.h"
+
+// The largest weight an edge file may give.
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_FLOAT
+#define WEIGHT_MAX FLT_MAX
+#else
+#define WEIGHT_MAX INT_MAX
+#endif
+
+// The runs being compared.
+#define OLD 0
+#define NEW 1
+
+// An edge in a run: the vertex at its other end, and its weight.
+typedef struct WeightedVertex {
+  GVertex_t  v;
+  GWeight_t  weight;
+} WeightedVertex;
+
+// An edge of the new version, with its place in the array it came from,
+// so that the last weight given for an edge can be told apart.
+typedef struct IndexedEdge {
+  GVertex_t  v1;
+  GVertex_t  v2;
+  GWeight_t  weight;
+  size_t     index;
+} IndexedEdge;
+
+// A diff being computed, with the room in its arrays and the runs being
+// compared.
+typedef struct DiffBuild {
+  GraphDiff       *diff;
+  size_t           changeCapacity;
+  size_t           vertexCapacity;
+  WeightedVertex  *runs[2];
+  size_t           runCapacity[2];
+  bool            *visited;  // old vertices given a run, by id
+} DiffBuild;
+
+// One edge list a change touches.
+typedef struct ChangeEntry {
+  ListItem          *owner;
+  GVertex_t          other;    // the vertex at the other end of the edge
+  const EdgeChange  *change;
+  bool               in;       // the list is owner's incoming edges
+  bool               forward;  // the change's own direction
+  bool               matched;  // an edge of the list was found for it
+} ChangeEntry;
+
+// Helper function declarations
+bool StartDiff(DiffBuild *b, Graph from, bool directed, GraphDiff *out);
+int FinishDiff(DiffBuild *b, bool ok);
+bool PushChange(DiffBuild *b, EdgeChangeKind kind, GVertex_t v1,
+                GVertex_t v2, GWeight_t w);
+bool PushVertex(DiffBuild *b, GVertex_t v);
+bool ReserveRun(DiffBuild *b, int run, size_t n);
+int CollectRun(DiffBuild *b, int run, Graph g, ListItem *l);
+bool MergeRuns(DiffBuild *b, GVertex_t v, int nold, int nnew);
+bool DiffVertex(DiffBuild *b, Graph from, GVertex_t v, int nnew);
+bool DiffUnvisited(DiffBuild *b, Graph from);
+void CanonicalEdge(bool directed, GVertex_t *v1, GVertex_t *v2);
+int CompareWeightedVertices(const void *a, const void *b);
+int CompareIndexedEdges(const void *a, const void *b);
+int CompareChanges(const void *a, const void *b);
+int CompareDiffVertices(const void *a, const void *b);
+int ParseEdgeLine(const char *line, GVertex_t *v1, GVertex_t *v2,
+                  GWeight_t *w);
+int CompareEntries(const void *a, const void *b);
+int FindEntry(const ChangeEntry *entries, int n, GVertex_t v);
+void ApplyEntries(Graph g, ChangeEntry *entries, int n, EdgeItem **pool,
+                  size_t *used);
+
+int DiffGraphs(Graph from, Graph to, GraphDiff *out) {
+  DiffBuild b;
+  ListItem *l;
+  int nold, nnew;
+  bool ok;
+
+  if (from->directed != to->directed) {
+    return -1;
+  }
+  ok = StartDiff(&b, NULL, from->directed, out);
+
+  for (l = to->front; l != NULL && ok; l = l->next) {
+    if (VertexVisible(to, l)) {
+      nnew = CollectRun(&b, NEW, to, l);
+      ok = nnew >= 0 && DiffVertex(&b, from, l->data, nnew);
+    }
+  }
+  for (l = from->front; l != NULL && ok; l = l->next) {
+    if (VertexVisible(from, l) && FindVertex(to, l->data) == NULL) {
+      nold = CollectRun(&b, OLD, from, l);
+      ok = nold >= 0 && MergeRuns(&b, l->data, nold, 0);
+    }
+  }
+  return FinishDiff(&b, ok);
+}
+
+int DiffGraphEdges(Graph from, const GraphEdge *edges, size_t n,
+                   GraphDiff *out) {
+  IndexedEdge *sorted;
+  DiffBuild b;
+  size_t i, j, count = 0, run;
+  bool ok;
+
+  sorted = (IndexedEdge *)malloc(sizeof(IndexedEdge) * (n + 1));
+  if (sorted == NULL) {
+    return -2;
+  }
+  for (i = 0; i < n; i++) {
+    if (edges[i].v1 == edges[i].v2) {
+      continue;
+    }
+    sorted[count].v1 = edges[i].v1;
+    sorted[count].v2 = edges[i].v2;
+    CanonicalEdge(from->directed, &sorted[count].v1, &sorted[count].v2);
+    sorted[count].weight = edges[i].weight;
+    sorted[count++].index = i;
+  }
+  qsort(sorted, count, sizeof(IndexedEdge), CompareIndexedEdges);
+
+  // each run of edges from one vertex is that vertex's new run, with the
+  // last weight of each edge written over the ones before it
+  ok = StartDiff(&b, from, from->directed, out);
+  for (i = 0; i < count && ok; i = j) {
+    for (j = i; j < count && sorted[j].v1 == sorted[i].v1; j++) {
+    }
+    ok = ReserveRun(&b, NEW, j - i);
+    run = 0;
+    for (j = i; ok && j < count && sorted[j].v1 == sorted[i].v1; j++) {
+      if (run > 0 && b.runs[NEW][run - 1].v == sorted[j].v2) {
+        run--;
+      }
+      b.runs[NEW][run].v = sorted[j].v2;
+      b.runs[NEW][run++].weight = sorted[j].weight;
+    }
+    ok = ok && DiffVertex(&b, from, sorted[i].v1, (int)run);
+  }
+  ok = ok && DiffUnvisited(&b, from);
+
+  free(sorted);
+  return FinishDiff(&b, ok);
+}
+
+int DiffGraphEdgeFile(Graph from, const char *path, GraphDiff *out) {
+  GVertex_t v1, v2, current = 0;
+  bool ok, valid = true, started = false;
+  char *line = NULL;
+  size_t capacity = 0;
+  DiffBuild b;
+  GWeight_t w;
+  size_t n = 0;
+  FILE *f;
+  int ret;
+
+  f = fopen(path, "r");
+  if (f == NULL) {
+    return -1;
+  }
+  ok = StartDiff(&b, from, from->directed, out);
+
+  while (ok && valid && getline(&line, &capacity, f) != -1) {
+    ret = ParseEdgeLine(line, &v1, &v2, &w);
+    if (ret == -1) {
+      valid = false;
+      break;
+    }
+    if (ret == 0) {
+      continue;
+    }
+
+    if (started && v1 != current) {
+      ok = DiffVertex(&b, from, current, (int)n);
+      valid = v1 > current;
+      n = 0;
+    }
+    if ((!from->directed && v1 > v2) ||
+        (n > 0 && v2 < b.runs[NEW][n - 1].v)) {
+      valid = false;
+    }
+    if (!ok || !valid) {
+      break;
+    }
+    if (n > 0 && v2 == b.runs[NEW][n - 1].v) {
+      n--;
+    } else if (!ReserveRun(&b, NEW, n + 1)) {
+      ok = false;
+      break;
+    }
+    b.runs[NEW][n].v = v2;
+    b.runs[NEW][n++].weight = w;
+    current = v1;
+    started = true;
+  }
+  if (ferror(f)) {
+    valid = false;
+  }
+  free(line);
+  fclose(f);
+
+  if (ok && valid && started) {
+    ok = DiffVertex(&b, from, current, (int)n);
+  }
+  ok = ok && valid && DiffUnvisited(&b, from);
+  ret = FinishDiff(&b, ok);
+  return (ret == -2 && !valid) ? -1 : ret;
+}
+
+int ApplyGraphDiff(Graph g, const GraphDiff *diff) {
+  ChangeEntry *entries;
+  EdgeItem **pool = NULL;
+  ListItem *oldBack, *first, *second;
+  const EdgeChange *c;
+  size_t i, j, n = 0, adds = 0, used = 0, allocated = 0, more;
+  bool ok = true;
+
+  if (diff->directed != g->directed || g->view != NULL) {
+    return -1;
+  }
+  for (i = 0; i < diff->numChanges; i++) {
+    if (diff->changes[i].v1 == diff->changes[i].v2) {
+      return -1;
+    }
+  }
+  entries = (ChangeEntry *)malloc(sizeof(ChangeEntry) *
+                                  (2 * diff->numChanges + 1));
+  if (entries == NULL) {
+    return -1;
+  }
+
+  // add the missing vertices, remembering where the list ended so that
+  // they can be rolled back
+  oldBack = g->back;
+  for (i = 0; i < diff->numVertices && ok; i++) {
+    if (FindVertex(g, diff->vertices[i]) == NULL) {
+      ok = AppendVertex(g, diff->vertices[i]) != NULL;
+    }
+  }
+  for (i = 0; i < diff->numChanges && ok; i++) {
+    c = &diff->changes[i];
+    first = FindVertex(g, c->v1);
+    second = FindVertex(g, c->v2);
+    if (c->kind == EDGE_REMOVED) {
+      if (first == NULL || second == NULL) {
+        continue;
+      }
+    } else {
+      if (first == NULL && (first = AppendVertex(g, c->v1)) == NULL) {
+        ok = false;
+        break;
+      }
+      if (second == NULL && (second = AppendVertex(g, c->v2)) == NULL) {
+        ok = false;
+        break;
+      }
+    }
+    entries[n] = (ChangeEntry){first, c->v2, c, false, true, false};
+    n++;
+    if (!g->directed || g->hasInEdges) {
+      entries[n] = (ChangeEntry){second, c->v1, c, g->directed, false,
+                                 false};
+      n++;
+    }
+  }
+  qsort(entries, n, sizeof(ChangeEntry), CompareEntries);
+
+  // refuse an edge changed twice, then make every allocation the changes
+  // could need: room in the degree table and the weight index, and the
+  // edges themselves
+  for (i = 0; i < n && ok; i = j) {
+    more = 0;
+    for (j = i; j < n && entries[j].owner == entries[i].owner &&
+           entries[j].in == entries[i].in; j++) {
+      if (j > i && entries[j].other == entries[j - 1].other) {
+        ok = false;
+      }
+      more += entries[j].change->kind != EDGE_REMOVED;
+    }
+    if (!entries[i].in && more > 0) {
+      ok = ok &&
+        EnsureDegreeCapacity(g, entries[i].owner->count + (int)more) &&
+        WeightIndexReserve(g, entries[i].owner, (int)more);
+    }
+    adds += more;
+  }
+  if (ok) {
+    pool = (EdgeItem **)malloc(sizeof(EdgeItem *) * (adds + 1));
+    ok = pool != NULL;
+  }
+  for (; ok && allocated < adds; allocated++) {
+    pool[allocated] = (EdgeItem *)MemoryAlloc(&g->memory, sizeof(EdgeItem));
+    STATS_ADD(edgeAllocs, 1);
+    ok = pool[allocated] != NULL;
+  }
+
+  if (ok) {
+    for (i = 0; i < n; i = j) {
+      for (j = i; j < n && entries[j].owner == entries[i].owner &&
+             entries[j].in == entries[i].in; j++) {
+      }
+      ApplyEntries(g, entries + i, (int)(j - i), pool, &used);
+    }
+  } else {
+    TruncateVertices(g, oldBack);
+  }
+
+  // changes that found their edge already in place left edges unused
+  for (i = used; pool != NULL && i < allocated; i++) {
+    MemoryFree(&g->memory, pool[i], sizeof(EdgeItem));
+  }
+  free(pool);
+  free(entries);
+  return ok ? 0 : -1;
+}
+
+void FreeGraphDiff(GraphDiff *diff) {
+  free(diff->vertices);
+  free(diff->changes);
+  diff->vertices = NULL;
+  diff->changes = NULL;
+  diff->numVertices = diff->numChanges = 0;
+}
+
+// Starts an empty diff in out. The visited marks are only kept if from is
+// given. Returns false on memory error.
+bool StartDiff(DiffBuild *b, Graph from, bool directed, GraphDiff *out) {
+  memset(b, 0, sizeof(DiffBuild));
+  memset(out, 0, sizeof(GraphDiff));
+  b->diff = out;
+  out->directed = directed;
+  if (from != NULL) {
+    b->visited = (bool *)calloc(from->numVertices + 1, sizeof(bool));
+    return b->visited != NULL;
+  }
+  return true;
+}
+
+// Sorts the diff and frees the working state, or frees the diff too if ok
+// is false. Returns 0 if ok, otherwise -2.
+int FinishDiff(DiffBuild *b, bool ok) {
+  GraphDiff *d = b->diff;
+  size_t i, n = 0;
+
+  free(b->runs[OLD]);
+  free(b->runs[NEW]);
+  free(b->visited);
+  if (!ok) {
+    FreeGraphDiff(d);
+    return -2;
+  }
+
+  if (d->numChanges > 0) {
+    qsort(d->changes, d->numChanges, sizeof(EdgeChange), CompareChanges);
+  }
+  if (d->numVertices > 0) {
+    qsort(d->vertices, d->numVertices, sizeof(GVertex_t),
+          CompareDiffVertices);
+  }
+  for (i = 0; i < d->numVertices; i++) {
+    if (n == 0 || d->vertices[i] != d->vertices[n - 1]) {
+      d->vertices[n++] = d->vertices[i];
+    }
+  }
+  d->numVertices = n;
+  return 0;
+}
+
+// Appends a change to the diff. Returns false on memory error.
+bool PushChange(DiffBuild *b, EdgeChangeKind kind, GVertex_t v1,
+                GVertex_t v2, GWeight_t w) {
+  GraphDiff *d = b->diff;
+  EdgeChange *grown;
+  size_t capacity;
+
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_NONE
+  w = 1;
+#endif
+
+  if (d->numChanges == b->changeCapacity) {
+    capacity = (b->changeCapacity == 0) ? 64 : 2 * b->changeCapacity;
+    grown = (EdgeChange *)realloc(d->changes, sizeof(EdgeChange) * capacity);
+    if (grown == NULL) {
+      return false;
+    }
+    d->changes = grown;
+    b->changeCapacity = capacity;
+  }
+
+  d->changes[d->numChanges++] = (EdgeChange){kind, v1, v2, w};
+  if (kind == EDGE_ADDED) {
+    d->added++;
+  } else if (kind == EDGE_REMOVED) {
+    d->removed++;
+  } else {
+    d->reweighted++;
+  }
+  return true;
+}
+
+// Appends a vertex to the diff's added vertices. Returns false on memory
+// error.
+bool PushVertex(DiffBuild *b, GVertex_t v) {
+  GraphDiff *d = b->diff;
+  GVertex_t *grown;
+  size_t capacity;
+
+  if (d->numVertices == b->vertexCapacity) {
+    capacity = (b->vertexCapacity == 0) ? 64 : 2 * b->vertexCapacity;
+    grown = (GVertex_t *)realloc(d->vertices, sizeof(GVertex_t) * capacity);
+    if (grown == NULL) {
+      return false;
+    }
+    d->vertices = grown;
+    b->vertexCapacity = capacity;
+  }
+  d->vertices[d->numVertices++] = v;
+  return true;
+}
+
+// Makes room for n edges in a run. Returns false on memory error.
+bool ReserveRun(DiffBuild *b, int run, size_t n) {
+  WeightedVertex *grown;
+  size_t capacity;
+
+  if (n <= b->runCapacity[run]) {
+    return true;
+  }
+  capacity = (b->runCapacity[run] == 0) ? 64 : 2 * b->runCapacity[run];
+  if (capacity < n) {
+    capacity = n;
+  }
+  grown = (WeightedVertex *)realloc(b->runs[run],
+                                    sizeof(WeightedVertex) * capacity);
+  if (grown == NULL) {
+    return false;
+  }
+  b->runs[run] = grown;
+  b->runCapacity[run] = capacity;
+  return true;
+}
+
+// Fills a run with the sorted edges of a vertex of g that g shows (only
+// those to larger vertices, if undirected). Returns the number of edges,
+// or -1 on memory error.
+int CollectRun(DiffBuild *b, int run, Graph g, ListItem *l) {
+  EdgeItem *e;
+  int n = 0;
+
+  if (!ReserveRun(b, run, l->count)) {
+    return -1;
+  }
+  for (e = l->neighbors; e != NULL; e = e->next) {
+    if ((b->diff->directed || e->data > l->data) &&
+        EdgeVisible(g, l, e, false)) {
+      b->runs[run][n].v = e->data;
+      b->runs[run][n++].weight = EdgeWeight(e);
+    }
+  }
+  qsort(b->runs[run], n, sizeof(WeightedVertex), CompareWeightedVertices);
+  return n;
+}
+
+// Compares the old and new runs of v, appending the differences to the
+// diff. Returns false on memory error.
+bool MergeRuns(DiffBuild *b, GVertex_t v, int nold, int nnew) {
+  const WeightedVertex *before = b->runs[OLD], *after = b->runs[NEW];
+  int i = 0, j = 0;
+  bool ok = true;
+
+  while (ok && (i < nold || j < nnew)) {
+    if (j == nnew || (i < nold && before[i].v < after[j].v)) {
+      ok = PushChange(b, EDGE_REMOVED, v, before[i].v, before[i].weight);
+      i++;
+    } else if (i == nold || after[j].v < before[i].v) {
+      ok = PushChange(b, EDGE_ADDED, v, after[j].v, after[j].weight);
+      j++;
+    } else {
+      if (GRAPH_WEIGHT != GRAPH_WEIGHT_NONE &&
+          before[i].weight != after[j].weight) {
+        ok = PushChange(b, EDGE_REWEIGHTED, v, after[j].v, after[j].weight);
+      }
+      i++;
+      j++;
+    }
+  }
+  return ok;
+}
+
+// Compares the new run of v, already filled in, with its edges in from,
+// noting v and the vertices of the run if from lacks them. Returns false
+// on memory error.
+bool DiffVertex(DiffBuild *b, Graph from, GVertex_t v, int nnew) {
+  ListItem *l;
+  int i, nold = 0;
+
+  l = FindVertex(from, v);
+  if (l == NULL) {
+    if (!PushVertex(b, v)) {
+      return false;
+    }
+  } else {
+    if (b->visited != NULL) {
+      b->visited[l->id] = true;
+    }
+    nold = CollectRun(b, OLD, from, l);
+    if (nold == -1) {
+      return false;
+    }
+  }
+
+  // the Graph holding the run has its vertices to itself, but one built
+  // from edges must look for them here
+  if (b->visited != NULL) {
+    for (i = 0; i < nnew; i++) {
+      if (FindVertex(from, b->runs[NEW][i].v) == NULL &&
+          !PushVertex(b, b->runs[NEW][i].v)) {
+        return false;
+      }
+    }
+  }
+  return MergeRuns(b, v, nold, nnew);
+}
+
+// Removes the edges of every vertex of from that was given no new run.
+// Returns false on memory error.
+bool DiffUnvisited(DiffBuild *b, Graph from) {
+  ListItem *l;
+  int nold;
+
+  for (l = from->front; l != NULL; l = l->next) {
+    if (!b->visited[l->id] && VertexVisible(from, l)) {
+      nold = CollectRun(b, OLD, from, l);
+      if (nold == -1 || !MergeRuns(b, l->data, nold, 0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Orders the vertices of an undirected edge smaller first.
+void CanonicalEdge(bool directed, GVertex_t *v1, GVertex_t *v2) {
+  GVertex_t temp;
+
+  if (!directed && *v1 > *v2) {
+    temp = *v1;
+    *v1 = *v2;
+    *v2 = temp;
+  }
+}
+
+int CompareWeightedVertices(const void *a, const void *b) {
+  GVertex_t x = ((const WeightedVertex *)a)->v;
+  GVertex_t y = ((const WeightedVertex *)b)->v;
+
+  return (x > y) - (x < y);
+}
+
+int CompareIndexedEdges(const void *a, const void *b) {
+  const IndexedEdge *x = (const IndexedEdge *)a, *y = (const IndexedEdge *)b;
+
+  if (x->v1 != y->v1) {
+    return (x->v1 > y->v1) - (x->v1 < y->v1);
+  }
+  if (x->v2 != y->v2) {
+    return (x->v2 > y->v2) - (x->v2 < y->v2);
+  }
+  return (x->index > y->index) - (x->index < y->index);
+}
+
+int CompareChanges(const void *a, const void *b) {
+  const EdgeChange *x = (const EdgeChange *)a, *y = (const EdgeChange *)b;
+
+  if (x->v1 != y->v1) {
+    return (x->v1 > y->v1) - (x->v1 < y->v1);
+  }
+  return (x->v2 > y->v2) - (x->v2 < y->v2);
+}
+
+int CompareDiffVertices(const void *a, const void *b) {
+  GVertex_t x = *(const GVertex_t *)a, y = *(const GVertex_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+// Orders entries by the list they touch, then by the other vertex.
+int CompareEntries(const void *a, const void *b) {
+  const ChangeEntry *x = (const ChangeEntry *)a, *y = (const ChangeEntry *)b;
+
+  if (x->owner != y->owner) {
+    return (x->owner->id > y->owner->id) - (x->owner->id < y->owner->id);
+  }
+  if (x->in != y->in) {
+    return x->in ? 1 : -1;
+  }
+  return (x->other > y->other) - (x->other < y->other);
+}
+
+// Returns the index of the entry for v among n sorted entries, or -1.
+int FindEntry(const ChangeEntry *entries, int n, GVertex_t v) {
+  int lo = 0, hi = n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (entries[mid].other < v) {
+      lo = mid + 1;
+    } else if (entries[mid].other > v) {
+      hi = mid;
+    } else {
+      return mid;
+    }
+  }
+  return -1;
+}
+
+// Applies the n entries for one edge list in a single walk of the list,
+// then adds the edges it lacked from the pool, starting at *used.
+void ApplyEntries(Graph g, ChangeEntry *entries, int n, EdgeItem **pool,
+                  size_t *used) {
+  ListItem *owner = entries[0].owner;
+  bool in = entries[0].in;
+  EdgeItem **link, *e;
+  GVertex_t v;
+  int k, left = n, walked = 0;
+
+  g->mutations++;
+  link = in ? &owner->inNeighbors : &owner->neighbors;
+  while (*link != NULL && left > 0) {
+    e = *link;
+    walked++;
+    k = FindEntry(entries, n, e->data);
+    if (k == -1) {
+      link = &e->next;
+      continue;
+    }
+    entries[k].matched = true;
+    left--;
+
+    if (entries[k].change->kind == EDGE_REMOVED) {
+      v = e->data;
+      *link = e->next;
+      ReleaseEdge(g, e);
+      if (!in) {
+        owner->count--;
+        NoteDegreeChange(g, owner->count + 1, owner->count);
+        WeightIndexRemove(g, owner, v);
+      }
+      g->numEdges -= entries[k].forward;
+    } else {
+      SetEdgeWeight(e, entries[k].change->weight);
+      if (!in) {
+        WeightIndexUpdate(g, owner, e);
+      }
+      link = &e->next;
+    }
+  }
+  STATS_ADD(edgesWalked, walked);
+
+  for (k = 0; k < n; k++) {
+    if (entries[k].matched || entries[k].change->kind == EDGE_REMOVED) {
+      continue;
+    }
+    e = pool[(*used)++];
+    e->data = entries[k].other;
+    SetEdgeWeight(e, entries[k].change->weight);
+#if GRAPH_EDGE_PAYLOAD > 0
+    memset(e->payload, 0, sizeof(e->payload));
+#endif
+    link = in ? &owner->inNeighbors : &owner->neighbors;
+    e->next = *link;
+    *link = e;
+    if (!in) {
+      owner->count++;
+      NoteDegreeChange(g, owner->count - 1, owner->count);
+      WeightIndexInsert(g, owner, e);
+    }
+    g->numEdges += entries[k].forward;
+  }
+}
+
+// Parses a line of an edge file. Returns 1 if it holds an edge, placed in
+// v1, v2 and w, 0 if it holds none (a blank line, a comment or a
+// self-loop), and -1 if it is malformed: a vertex missing or out of range,
+// a weight that is negative or out of range, or anything after the weight.
+int ParseEdgeLine(const char *line, GVertex_t *v1, GVertex_t *v2,
+                  GWeight_t *w) {
+  long long x, y;
+  char *p, *end;
+  double d;
+
+  errno = 0;
+  x = strtoll(line, &p, 10);
+  if (p == line) {
+    return 0;
+  }
+  y = strtoll(p, &end, 10);
+  if (end == p || errno == ERANGE || (long long)(GVertex_t)x != x ||
+      (long long)(GVertex_t)y != y) {
+    return -1;
+  }
+  d = strtod(end, &p);
+  if (p == end) {
+    d = 1;
+  } else if (!isfinite(d) || d < 0 || d > WEIGHT_MAX) {
+    return -1;
+  }
+  if (p[strspn(p, " \t\r\n")] != '\0') {
+    return -1;
+  }
+
+  *v1 = (GVertex_t)x;
+  *v2 = (GVertex_t)y;
+  *w = (GWeight_t)d;
+  return (x == y) ? 0 : 1;
+}
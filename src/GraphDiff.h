@@ -0,0 +1,109 @@
+// Edge-level differences between Graphs, for bringing a Graph up to date
+// with a new version of itself without rebuilding it.
+//
+// A diff lists the edges added, removed and reweighted between an old and
+// a new version of a Graph, and the vertices the new version adds. It can
+// be computed from two Graphs, or from a Graph and the new version's edges,
+// as an array or as a sorted edge file that is read one vertex at a time.
+// Computing a diff reads every edge of both versions once.
+//
+// Applying a diff to the old version brings it to the new one. The changes
+// are sorted by the vertex they touch, and each vertex's edges are walked
+// once, matching them against all of that vertex's changes together, so the
+// time taken grows with the size of the change and the degrees of the
+// vertices it touches, not with the size of the Graph.
+//
+// A Graph cannot lose vertices, so vertices missing from the new version
+// are left in place without their edges.
+
+#ifndef _GRAPH_DIFF_H_
+#define _GRAPH_DIFF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./Graph.h"
+
+typedef enum EdgeChangeKind {
+  EDGE_ADDED,
+  EDGE_REMOVED,
+  EDGE_REWEIGHTED
+} EdgeChangeKind;
+
+// One changed edge, from v1 to v2, with its weight in the new version (or
+// in the old one, if removed). An undirected edge appears once, with v1
+// the smaller of its vertices.
+typedef struct EdgeChange {
+  EdgeChangeKind kind;
+  GVertex_t      v1;
+  GVertex_t      v2;
+  GWeight_t      weight;
+} EdgeChange;
+
+// A diff.
+//
+//    -- directed     whether its edges run one way only.
+//    -- vertices     the vertices the new version adds, in increasing
+//                    order.
+//    -- changes      the changed edges, ordered by v1 and then v2.
+//    -- added, removed, reweighted
+//                    the number of changes of each kind.
+typedef struct GraphDiff {
+  bool         directed;
+  GVertex_t   *vertices;
+  size_t       numVertices;
+  EdgeChange  *changes;
+  size_t       numChanges;
+  size_t       added;
+  size_t       removed;
+  size_t       reweighted;
+} GraphDiff;
+
+// Computes the diff from one Graph to another.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if one Graph is directed and the other is not,
+//     0 on success, in which case the diff is placed in out, and must be
+//       freed with FreeGraphDiff.
+int DiffGraphs(Graph from, Graph to, GraphDiff *out);
+
+// Computes the diff from a Graph to the Graph of the given edges, which is
+// directed if the Graph is. The edges may come in any order, and are
+// taken as BuildGraphParallel takes them (see GraphBuilder.h): self-loops
+// are skipped, and the last weight given for an edge wins. Returns the same
+// as DiffGraphs, without the -1 case.
+int DiffGraphEdges(Graph from, const GraphEdge *edges, size_t n,
+                   GraphDiff *out);
+
+// Computes the diff from a Graph to the Graph of the edges in a file,
+// holding one edge per line as "x y w" (the weight is optional, and
+// defaults to 1). Lines that do not start with a number are skipped, as
+// comments. The file is read one vertex at a time, so the edges must be
+// sorted by x and then y. In an undirected Graph, x must be the smaller
+// vertex of each edge, and each edge is listed once.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if the file cannot be read, is not sorted, or has a malformed line
+//       (a vertex or weight out of range, or more than three fields),
+//     0 on success, as for DiffGraphs.
+int DiffGraphEdgeFile(Graph from, const char *path, GraphDiff *out);
+
+// Applies a diff to a Graph, adding its vertices (if missing), then adding
+// or reweighting its added and reweighted edges, and removing its removed
+// ones (if present). Each edge must appear in the diff at most once, and
+// the diff must be directed if the Graph is.
+//
+// Returns -1 on memory error, if the diff does not match the Graph in
+// direction, if it has a self-loop or an edge more than once, or if the
+// Graph is a view (see GraphView.h), in which case the Graph is unchanged,
+// and 0 on success.
+int ApplyGraphDiff(Graph g, const GraphDiff *diff);
+
+// Frees the arrays of a diff.
+void FreeGraphDiff(GraphDiff *diff);
+
+#endif
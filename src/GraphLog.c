@@ -0,0 +1,998 @@
+// Implementation of the Graph write-ahead log.
+//
+// The log directory holds:
+//
+// 1. checkpoint: a header (magic, the vertex size, the weight type tag,
+//    the LSN the checkpoint runs up to, and the vertex and edge counts),
+//    followed by every vertex, then every edge once as a (v1, v2, w) triple,
+//    then a CRC-32 of everything before it.
+// 2. log: a header (magic, vertex size, weight tag, and the LSN of the first
+//    record),
+//    followed by fixed size records. Each record is a CRC-32 of the rest of
+//    the record, a type byte, two vertices and a weight.
+//
+// Every logged mutation is numbered with a log sequence number (LSN). A
+// checkpoint taken at LSN n contains the effect of every mutation numbered
+// below n, and recovery skips any such records still left in the log.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./GraphLog.h"
+#include "./GraphBuilder.h"
+#include "./Graph_priv.h"
+
+#define LOG_MAGIC "GBLOG001"
+#define CHECKPOINT_MAGIC "GBSNAP01"
+
+#define LOG_FILE "log"
+#define CHECKPOINT_FILE "checkpoint"
+#define CHECKPOINT_TMP_FILE "checkpoint.tmp"
+
+// The bytes a weight takes in either file. An unweighted Graph stores none.
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_NONE
+#define WEIGHT_SIZE 0
+#else
+#define WEIGHT_SIZE sizeof(GWeight_t)
+#endif
+
+// Identifies the weight type in the file headers: int and float weights
+// have the same size, so the size alone would not tell them apart.
+#define WEIGHT_TAG ((uint32_t)(GRAPH_WEIGHT << 8 | WEIGHT_SIZE))
+
+// magic, vertex size, weight tag, first LSN
+#define LOG_HEADER_SIZE (8 + 4 + 4 + 8)
+
+// magic, vertex size, weight tag, LSN, vertex count, edge count
+#define CHECKPOINT_HEADER_SIZE (8 + 4 + 4 + 8 + 8 + 8)
+
+// crc, type, v1, v2, w
+#define RECORD_SIZE (4 + 1 + 2 * sizeof(GVertex_t) + WEIGHT_SIZE)
+
+// The types of log records.
+enum {
+  RECORD_ADD_VERTEX = 1,
+  RECORD_ADD_EDGE = 2,
+  RECORD_REMOVE_EDGE = 3
+};
+
+// A decoded log record.
+typedef struct LogRecord {
+  int       type;
+  GVertex_t v1;
+  GVertex_t v2;
+  GWeight_t w;
+} LogRecord;
+
+struct graphlog {
+  Graph            g;
+  GraphLogOptions  opts;
+  char            *dir;
+  int              fd;
+
+  // Everything below is protected by lock. Records are appended to the
+  // active buffer; the background thread swaps it with the flushing buffer
+  // and writes the latter out without holding the lock.
+  pthread_mutex_t  lock;
+  pthread_cond_t   wake;     // signalled to wake the background thread
+  pthread_cond_t   flushed;  // broadcast whenever durableLsn advances
+  pthread_t        flusher;
+
+  char            *active;
+  size_t           activeLen;
+  size_t           activeCap;
+  char            *flushing;
+  size_t           flushingCap;
+
+  uint64_t         nextLsn;     // the LSN the next record will get
+  uint64_t         durableLsn;  // every record below this is durable
+  size_t           logBytes;    // size of the log, including the buffer
+  bool             syncRequested;
+  bool             stopping;
+  bool             failed;
+};
+
+// Helper function declarations
+void InitCrc32();
+uint32_t Crc32(uint32_t crc, const void *buf, size_t len);
+char *LogPath(GraphLog log, const char *file);
+int ReadWholeFile(const char *path, char **buf, size_t *len);
+int WriteAll(int fd, const void *buf, size_t len);
+void EncodeHeader(char *buf, const char *magic, uint64_t lsn);
+void EncodeRecord(char *buf, int type, GVertex_t v1, GVertex_t v2,
+                  GWeight_t w);
+bool DecodeRecord(const char *buf, LogRecord *r);
+int ResetLogFile(GraphLog log, uint64_t lsn);
+int LoadCheckpoint(GraphLog log, uint64_t *lsn);
+int ReplayLog(GraphLog log, uint64_t checkpointLsn);
+int ReduceAndApply(Graph g, LogRecord *records, size_t n, int threads);
+void *ReduceWorker(void *arg);
+void *FlushLoop(void *arg);
+int ReserveRecord(GraphLog log);
+void CommitRecord(GraphLog log, int type, GVertex_t v1, GVertex_t v2,
+                  GWeight_t w);
+void MaybeCheckpoint(GraphLog log);
+
+void DefaultGraphLogOptions(GraphLogOptions *opts) {
+  long cpus;
+
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  opts->commitIntervalUs = 2000;
+  opts->bufferBytes = 1 << 20;
+  opts->checkpointBytes = 0;
+  opts->replayThreads = (cpus < 1) ? 1 : (cpus > 16 ? 16 : (int)cpus);
+}
+
+// CRC-32 (the IEEE polynomial, as used by zlib), computed a byte at a time
+// from a table that is built once.
+
+static uint32_t crcTable[256];
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+void InitCrc32() {
+  uint32_t c;
+  int i, j;
+
+  for (i = 0; i < 256; i++) {
+    c = (uint32_t)i;
+    for (j = 0; j < 8; j++) {
+      c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+    }
+    crcTable[i] = c;
+  }
+}
+
+uint32_t Crc32(uint32_t crc, const void *buf, size_t len) {
+  const unsigned char *p = (const unsigned char *)buf;
+
+  crc = ~crc;
+  while (len-- > 0) {
+    crc = crcTable[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Returns the malloc'ed path of the given file in the log directory.
+char *LogPath(GraphLog log, const char *file) {
+  char *path;
+
+  path = (char *)malloc(strlen(log->dir) + strlen(file) + 2);
+  if (path != NULL) {
+    sprintf(path, "%s/%s", log->dir, file);
+  }
+  return path;
+}
+
+// Reads the given file into a malloc'ed buffer. Returns 1 if the file does
+// not exist, -1 on any other error, 0 on success.
+int ReadWholeFile(const char *path, char **buf, size_t *len) {
+  struct stat st;
+  ssize_t n;
+  size_t got;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return errno == ENOENT ? 1 : -1;
+  }
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return -1;
+  }
+
+  *len = (size_t)st.st_size;
+  *buf = (char *)malloc(*len + 1);
+  if (*buf == NULL) {
+    close(fd);
+    return -1;
+  }
+
+  for (got = 0; got < *len; got += (size_t)n) {
+    n = read(fd, *buf + got, *len - got);
+    if (n <= 0) {
+      free(*buf);
+      close(fd);
+      return -1;
+    }
+  }
+
+  close(fd);
+  return 0;
+}
+
+// Writes the whole buffer, retrying short writes. Returns -1 on error.
+int WriteAll(int fd, const void *buf, size_t len) {
+  const char *p = (const char *)buf;
+  ssize_t n;
+
+  while (len > 0) {
+    n = write(fd, p, len);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// Writes the start shared by both file headers: the given magic, the type
+// vertex size, the weight tag, and the given LSN.
+void EncodeHeader(char *buf, const char *magic, uint64_t lsn) {
+  uint32_t size;
+
+  memcpy(buf, magic, 8);
+  size = sizeof(GVertex_t);
+  memcpy(buf + 8, &size, 4);
+  size = WEIGHT_TAG;
+  memcpy(buf + 12, &size, 4);
+  memcpy(buf + 16, &lsn, 8);
+}
+
+void EncodeRecord(char *buf, int type, GVertex_t v1, GVertex_t v2,
+                  GWeight_t w) {
+  uint32_t crc;
+  char *p;
+
+  p = buf + 4;
+  *p++ = (char)type;
+  memcpy(p, &v1, sizeof(GVertex_t));
+  p += sizeof(GVertex_t);
+  memcpy(p, &v2, sizeof(GVertex_t));
+  p += sizeof(GVertex_t);
+  memcpy(p, &w, WEIGHT_SIZE);
+
+  crc = Crc32(0, buf + 4, RECORD_SIZE - 4);
+  memcpy(buf, &crc, 4);
+}
+
+// Decodes a record, returning false if it is torn or corrupt.
+bool DecodeRecord(const char *buf, LogRecord *r) {
+  uint32_t crc;
+  const char *p;
+
+  memcpy(&crc, buf, 4);
+  if (crc != Crc32(0, buf + 4, RECORD_SIZE - 4)) {
+    return false;
+  }
+
+  p = buf + 4;
+  r->type = *p++;
+  memcpy(&r->v1, p, sizeof(GVertex_t));
+  p += sizeof(GVertex_t);
+  memcpy(&r->v2, p, sizeof(GVertex_t));
+  p += sizeof(GVertex_t);
+  r->w = 1;
+  memcpy(&r->w, p, WEIGHT_SIZE);
+
+  return r->type >= RECORD_ADD_VERTEX && r->type <= RECORD_REMOVE_EDGE;
+}
+
+// Empties the log file, leaving only a header saying the next record will
+// have the given LSN. Returns -1 on error.
+int ResetLogFile(GraphLog log, uint64_t lsn) {
+  char header[LOG_HEADER_SIZE];
+
+  EncodeHeader(header, LOG_MAGIC, lsn);
+  if (ftruncate(log->fd, 0) == -1 ||
+      WriteAll(log->fd, header, LOG_HEADER_SIZE) == -1 ||
+      fdatasync(log->fd) == -1) {
+    return -1;
+  }
+
+  log->logBytes = LOG_HEADER_SIZE;
+  return 0;
+}
+
+// Loads the checkpoint, if there is one, replacing the (empty) Graph, and
+// places the LSN it was taken at in lsn. The edges are loaded with the
+// parallel builder. Returns -1 if the checkpoint is unreadable or corrupt,
+// or on memory error.
+int LoadCheckpoint(GraphLog log, uint64_t *lsn) {
+  uint64_t numVertices, numEdges, i;
+  uint32_t vsize, wsize, crc;
+  GraphEdge *edges;
+  GVertex_t v;
+  Graph g;
+  char *path, *buf, *p;
+  size_t len, expected;
+  int ret;
+
+  *lsn = 0;
+  path = LogPath(log, CHECKPOINT_FILE);
+  if (path == NULL) {
+    return -1;
+  }
+  ret = ReadWholeFile(path, &buf, &len);
+  free(path);
+  if (ret != 0) {
+    // no checkpoint is fine, we start from an empty Graph
+    return ret == 1 ? 0 : -1;
+  }
+
+  if (len < CHECKPOINT_HEADER_SIZE + 4 ||
+      memcmp(buf, CHECKPOINT_MAGIC, 8) != 0) {
+    free(buf);
+    return -1;
+  }
+  memcpy(&vsize, buf + 8, 4);
+  memcpy(&wsize, buf + 12, 4);
+  memcpy(lsn, buf + 16, 8);
+  memcpy(&numVertices, buf + 24, 8);
+  memcpy(&numEdges, buf + 32, 8);
+  memcpy(&crc, buf + len - 4, 4);
+
+  expected = CHECKPOINT_HEADER_SIZE + numVertices * sizeof(GVertex_t) +
+    numEdges * (2 * sizeof(GVertex_t) + WEIGHT_SIZE) + 4;
+  if (vsize != sizeof(GVertex_t) || wsize != WEIGHT_TAG ||
+      len != expected || crc != Crc32(0, buf, len - 4)) {
+    free(buf);
+    return -1;
+  }
+
+  edges = (GraphEdge *)malloc(sizeof(GraphEdge) * (numEdges + 1));
+  if (edges == NULL) {
+    free(buf);
+    return -1;
+  }
+  p = buf + CHECKPOINT_HEADER_SIZE + numVertices * sizeof(GVertex_t);
+  for (i = 0; i < numEdges; i++) {
+    memcpy(&edges[i].v1, p, sizeof(GVertex_t));
+    p += sizeof(GVertex_t);
+    memcpy(&edges[i].v2, p, sizeof(GVertex_t));
+    p += sizeof(GVertex_t);
+    edges[i].weight = 1;
+    memcpy(&edges[i].weight, p, WEIGHT_SIZE);
+    p += WEIGHT_SIZE;
+  }
+
+  g = BuildGraphParallel(edges, numEdges, log->opts.replayThreads);
+  free(edges);
+  if (g == NULL) {
+    free(buf);
+    return -1;
+  }
+  FreeGraph(log->g);
+  log->g = g;
+
+  // the builder only knows about vertices with edges
+  p = buf + CHECKPOINT_HEADER_SIZE;
+  for (i = 0; i < numVertices; i++) {
+    memcpy(&v, p, sizeof(GVertex_t));
+    p += sizeof(GVertex_t);
+    if (AddVertex(log->g, v) == -1) {
+      free(buf);
+      return -1;
+    }
+  }
+
+  free(buf);
+  return 0;
+}
+
+// A record that survives reducing the log. If verticesOnly is set, only the
+// record's vertices are to be added: the pair's last record removes the edge
+// an earlier record added, but the vertices that add created remain.
+typedef struct Survivor {
+  size_t index;
+  bool   verticesOnly;
+} Survivor;
+
+// Arguments and results for one thread reducing the log. Thread t of n is
+// responsible for every vertex pair that hashes to t mod n.
+typedef struct ReduceTask {
+  const LogRecord *records;
+  size_t           n;
+  int              thread;
+  int              threads;
+
+  Survivor        *survivors;
+  size_t           count;
+  bool             started;
+  bool             failed;
+} ReduceTask;
+
+// A slot in a reduce thread's table of vertex pairs. used is 0 for an empty
+// slot; added is set if any record for the pair added an edge.
+typedef struct PairSlot {
+  GVertex_t a;
+  GVertex_t b;
+  size_t    last;
+  bool      used;
+  bool      added;
+} PairSlot;
+
+// Hashes the vertex pair a record is about, in canonical order so that
+// {v1,v2} and {v2,v1} collide. Vertex records use the pair {v,v}, which no
+// edge record can have.
+static inline uint64_t PairHash(GVertex_t a, GVertex_t b) {
+  uint64_t h;
+
+  h = (uint64_t)a * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)b + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+  return h * 0xD6E8FEB86659FD93ULL;
+}
+
+void *ReduceWorker(void *arg) {
+  ReduceTask *t = (ReduceTask *)arg;
+  PairSlot *table, *s;
+  GVertex_t a, b;
+  size_t cap, mask, i, j, mine;
+  uint64_t h;
+
+  // count our records to size the table
+  mine = 0;
+  for (i = 0; i < t->n; i++) {
+    a = t->records[i].v1 < t->records[i].v2 ?
+      t->records[i].v1 : t->records[i].v2;
+    b = t->records[i].v1 < t->records[i].v2 ?
+      t->records[i].v2 : t->records[i].v1;
+    if ((PairHash(a, b) >> 32) % t->threads == (uint64_t)t->thread) {
+      mine++;
+    }
+  }
+  for (cap = 16; cap < 2 * mine; cap *= 2) {
+  }
+  mask = cap - 1;
+
+  table = (PairSlot *)calloc(cap, sizeof(PairSlot));
+  // each pair can produce up to two survivors
+  t->survivors = (Survivor *)malloc(sizeof(Survivor) * (2 * mine + 1));
+  if (table == NULL || t->survivors == NULL) {
+    free(table);
+    t->failed = true;
+    return NULL;
+  }
+
+  // remember the last record of each pair
+  for (i = 0; i < t->n; i++) {
+    a = t->records[i].v1 < t->records[i].v2 ?
+      t->records[i].v1 : t->records[i].v2;
+    b = t->records[i].v1 < t->records[i].v2 ?
+      t->records[i].v2 : t->records[i].v1;
+    h = PairHash(a, b);
+    if ((h >> 32) % t->threads != (uint64_t)t->thread) {
+      continue;
+    }
+    for (j = h & mask; table[j].used && (table[j].a != a || table[j].b != b);
+         j = (j + 1) & mask) {
+    }
+    s = &table[j];
+    s->used = true;
+    s->a = a;
+    s->b = b;
+    s->last = i;
+    if (t->records[i].type == RECORD_ADD_EDGE) {
+      s->added = true;
+    }
+  }
+
+  t->count = 0;
+  for (j = 0; j < cap; j++) {
+    s = &table[j];
+    if (!s->used) {
+      continue;
+    }
+    if (t->records[s->last].type == RECORD_REMOVE_EDGE && s->added) {
+      t->survivors[t->count].index = s->last;
+      t->survivors[t->count++].verticesOnly = true;
+    }
+    t->survivors[t->count].index = s->last;
+    t->survivors[t->count++].verticesOnly = false;
+  }
+
+  free(table);
+  return NULL;
+}
+
+// Reduces the log to the last record for each vertex pair using the given
+// number of threads, then applies what is left to the Graph. Returns -1 on
+// memory error.
+int ReduceAndApply(Graph g, LogRecord *records, size_t n, int threads) {
+  ReduceTask *tasks;
+  pthread_t *ids;
+  LogRecord *r;
+  size_t k;
+  int t, ret = 0;
+
+  if (threads < 1) {
+    threads = 1;
+  }
+  tasks = (ReduceTask *)calloc(threads, sizeof(ReduceTask));
+  ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+  if (tasks == NULL || ids == NULL) {
+    free(tasks);
+    free(ids);
+    return -1;
+  }
+
+  for (t = 0; t < threads; t++) {
+    tasks[t].records = records;
+    tasks[t].n = n;
+    tasks[t].thread = t;
+    tasks[t].threads = threads;
+  }
+  // the calling thread takes the first share itself
+  for (t = 1; t < threads; t++) {
+    tasks[t].started =
+      pthread_create(&ids[t], NULL, ReduceWorker, &tasks[t]) == 0;
+    tasks[t].failed = !tasks[t].started;
+  }
+  ReduceWorker(&tasks[0]);
+  for (t = 1; t < threads; t++) {
+    if (tasks[t].started) {
+      pthread_join(ids[t], NULL);
+    }
+  }
+
+  // The Graph is not safe to modify concurrently, so the application
+  // itself is serial. Pairs are independent, so order does not matter.
+  for (t = 0; t < threads && ret == 0; t++) {
+    if (tasks[t].failed) {
+      ret = -1;
+      break;
+    }
+    for (k = 0; k < tasks[t].count && ret == 0; k++) {
+      r = &records[tasks[t].survivors[k].index];
+      if (tasks[t].survivors[k].verticesOnly) {
+        if (AddVertex(g, r->v1) == -1 || AddVertex(g, r->v2) == -1) {
+          ret = -1;
+        }
+      } else if (r->type == RECORD_ADD_VERTEX) {
+        ret = AddVertex(g, r->v1);
+      } else if (r->type == RECORD_ADD_EDGE) {
+        ret = AddGraphEdge(g, r->v1, r->v2, r->w);
+      } else {
+        RemoveGraphEdge(g, r->v1, r->v2);
+      }
+    }
+  }
+
+  for (t = 0; t < threads; t++) {
+    free(tasks[t].survivors);
+  }
+  free(tasks);
+  free(ids);
+  return ret;
+}
+
+// Replays the log on top of the checkpoint, and leaves the log file open
+// for appending. A torn or corrupt tail (from a crash mid-write) ends the
+// log; it is cut off so that new records follow the last good one. Returns
+// -1 on error.
+int ReplayLog(GraphLog log, uint64_t checkpointLsn) {
+  LogRecord *records;
+  uint64_t startLsn, lsn;
+  uint32_t vsize, wsize;
+  size_t len, i, n, valid;
+  char *path, *buf;
+  int ret;
+
+  path = LogPath(log, LOG_FILE);
+  if (path == NULL) {
+    return -1;
+  }
+  ret = ReadWholeFile(path, &buf, &len);
+  log->fd = (ret == -1) ? -1 : open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  free(path);
+  if (log->fd == -1) {
+    if (ret == 0) {
+      free(buf);
+    }
+    return -1;
+  }
+
+  if (ret == 1 || len < LOG_HEADER_SIZE) {
+    // no log (or not even a whole header): start one after the checkpoint
+    if (ret == 0) {
+      free(buf);
+    }
+    log->nextLsn = checkpointLsn;
+    return ResetLogFile(log, checkpointLsn);
+  }
+
+  memcpy(&vsize, buf + 8, 4);
+  memcpy(&wsize, buf + 12, 4);
+  memcpy(&startLsn, buf + 16, 8);
+  if (memcmp(buf, LOG_MAGIC, 8) != 0 || vsize != sizeof(GVertex_t) ||
+      wsize != WEIGHT_TAG) {
+    free(buf);
+    return -1;
+  }
+
+  n = (len - LOG_HEADER_SIZE) / RECORD_SIZE;
+  records = (LogRecord *)malloc(sizeof(LogRecord) * (n + 1));
+  if (records == NULL) {
+    free(buf);
+    return -1;
+  }
+
+  // decode the good prefix, skipping anything the checkpoint already has
+  valid = 0;
+  for (i = 0; i < n; i++) {
+    lsn = startLsn + i;
+    if (!DecodeRecord(buf + LOG_HEADER_SIZE + i * RECORD_SIZE,
+                      &records[valid])) {
+      break;
+    }
+    if (lsn >= checkpointLsn) {
+      valid++;
+    }
+  }
+  free(buf);
+  n = i;
+
+  ret = ReduceAndApply(log->g, records, valid, log->opts.replayThreads);
+  free(records);
+  if (ret == -1) {
+    return -1;
+  }
+
+  if (startLsn + n < checkpointLsn) {
+    // A crash between writing a checkpoint and emptying the log leaves a
+    // log the checkpoint already covers. Empty it now.
+    log->nextLsn = checkpointLsn;
+    return ResetLogFile(log, checkpointLsn);
+  }
+
+  log->nextLsn = startLsn + n;
+  log->logBytes = LOG_HEADER_SIZE + n * RECORD_SIZE;
+  if (log->logBytes != len && ftruncate(log->fd, log->logBytes) == -1) {
+    return -1;
+  }
+  return 0;
+}
+
+// The background thread. Waits for records to arrive, gives later records
+// up to commitIntervalUs to join them, then writes them all and fsyncs once.
+void *FlushLoop(void *arg) {
+  GraphLog log = (GraphLog)arg;
+  struct timespec deadline;
+  uint64_t lsn;
+  size_t len, cap;
+  char *buf;
+  int err;
+
+  pthread_mutex_lock(&log->lock);
+  for (;;) {
+    while (log->activeLen == 0 && !log->stopping) {
+      log->syncRequested = false;
+      pthread_cond_wait(&log->wake, &log->lock);
+    }
+    if (log->activeLen == 0 && log->stopping) {
+      break;
+    }
+
+    // let the group fill up, unless someone is waiting on it
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)log->opts.commitIntervalUs * 1000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    while (!log->syncRequested && !log->stopping &&
+           log->activeLen < log->opts.bufferBytes) {
+      if (pthread_cond_timedwait(&log->wake, &log->lock, &deadline) ==
+          ETIMEDOUT) {
+        break;
+      }
+    }
+
+    // swap buffers, and write the full one out without holding the lock
+    buf = log->active;
+    len = log->activeLen;
+    cap = log->activeCap;
+    log->active = log->flushing;
+    log->activeCap = log->flushingCap;
+    log->activeLen = 0;
+    log->flushing = buf;
+    log->flushingCap = cap;
+    log->syncRequested = false;
+    lsn = log->nextLsn;
+    pthread_mutex_unlock(&log->lock);
+
+    err = WriteAll(log->fd, buf, len) == -1 || fdatasync(log->fd) == -1;
+
+    pthread_mutex_lock(&log->lock);
+    if (err) {
+      log->failed = true;
+    } else {
+      log->durableLsn = lsn;
+    }
+    pthread_cond_broadcast(&log->flushed);
+  }
+  pthread_mutex_unlock(&log->lock);
+
+  return NULL;
+}
+
+GraphLog OpenGraphLog(const char *dir, const GraphLogOptions *opts,
+                      Graph *out) {
+  GraphLog log;
+  uint64_t checkpointLsn;
+
+  pthread_once(&crcOnce, InitCrc32);
+
+  if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+    return NULL;
+  }
+
+  log = (GraphLog)calloc(1, sizeof(struct graphlog));
+  if (log == NULL) {
+    return NULL;
+  }
+  if (opts != NULL) {
+    log->opts = *opts;
+  } else {
+    DefaultGraphLogOptions(&log->opts);
+  }
+  log->fd = -1;
+  log->dir = strdup(dir);
+  log->g = AllocateGraph();
+  log->activeCap = log->flushingCap = RECORD_SIZE * 1024;
+  log->active = (char *)malloc(log->activeCap);
+  log->flushing = (char *)malloc(log->flushingCap);
+  if (log->dir == NULL || log->g == NULL || log->active == NULL ||
+      log->flushing == NULL) {
+    goto fail;
+  }
+
+  if (LoadCheckpoint(log, &checkpointLsn) == -1 ||
+      ReplayLog(log, checkpointLsn) == -1) {
+    goto fail;
+  }
+  log->durableLsn = log->nextLsn;
+
+  pthread_mutex_init(&log->lock, NULL);
+  pthread_cond_init(&log->wake, NULL);
+  pthread_cond_init(&log->flushed, NULL);
+  if (pthread_create(&log->flusher, NULL, FlushLoop, log) != 0) {
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->wake);
+    pthread_cond_destroy(&log->flushed);
+    goto fail;
+  }
+
+  *out = log->g;
+  return log;
+
+fail:
+  if (log->fd != -1) {
+    close(log->fd);
+  }
+  if (log->g != NULL) {
+    FreeGraph(log->g);
+  }
+  free(log->active);
+  free(log->flushing);
+  free(log->dir);
+  free(log);
+  return NULL;
+}
+
+int CloseGraphLog(GraphLog log) {
+  int ret;
+
+  ret = SyncGraphLog(log);
+
+  pthread_mutex_lock(&log->lock);
+  log->stopping = true;
+  pthread_cond_signal(&log->wake);
+  pthread_mutex_unlock(&log->lock);
+  pthread_join(log->flusher, NULL);
+
+  if (close(log->fd) == -1) {
+    ret = -1;
+  }
+  pthread_mutex_destroy(&log->lock);
+  pthread_cond_destroy(&log->wake);
+  pthread_cond_destroy(&log->flushed);
+  free(log->active);
+  free(log->flushing);
+  free(log->dir);
+  free(log);
+  return ret;
+}
+
+// Takes the lock and makes sure the active buffer has room for one more
+// record. On success, returns 0 with the lock held; the caller must follow
+// up with CommitRecord, or unlock. Returns -1 (without the lock) if the log
+// has failed or on memory error.
+int ReserveRecord(GraphLog log) {
+  size_t cap;
+  char *buf;
+
+  pthread_mutex_lock(&log->lock);
+  if (log->failed) {
+    pthread_mutex_unlock(&log->lock);
+    return -1;
+  }
+
+  if (log->activeLen + RECORD_SIZE > log->activeCap) {
+    cap = 2 * log->activeCap;
+    buf = (char *)realloc(log->active, cap);
+    if (buf == NULL) {
+      pthread_mutex_unlock(&log->lock);
+      return -1;
+    }
+    log->active = buf;
+    log->activeCap = cap;
+  }
+  return 0;
+}
+
+// Appends a record to the space ReserveRecord made, and releases the lock.
+void CommitRecord(GraphLog log, int type, GVertex_t v1, GVertex_t v2,
+                  GWeight_t w) {
+  EncodeRecord(log->active + log->activeLen, type, v1, v2, w);
+
+  // wake the background thread when a new group starts, or when the buffer
+  // fills up; otherwise it is already waiting for the group to fill
+  log->activeLen += RECORD_SIZE;
+  if (log->activeLen == RECORD_SIZE ||
+      log->activeLen >= log->opts.bufferBytes) {
+    pthread_cond_signal(&log->wake);
+  }
+  log->nextLsn++;
+  log->logBytes += RECORD_SIZE;
+  pthread_mutex_unlock(&log->lock);
+}
+
+// Checkpoints if the log has grown past the configured size.
+void MaybeCheckpoint(GraphLog log) {
+  if (log->opts.checkpointBytes != 0 &&
+      log->logBytes >= log->opts.checkpointBytes) {
+    // a failed checkpoint leaves the log as it was, so there is nothing
+    // to do about it but try again next time
+    CheckpointGraphLog(log);
+  }
+}
+
+int LogAddVertex(GraphLog log, GVertex_t v) {
+  if (ReserveRecord(log) == -1) {
+    return -1;
+  }
+  if (AddVertex(log->g, v) == -1) {
+    pthread_mutex_unlock(&log->lock);
+    return -1;
+  }
+  CommitRecord(log, RECORD_ADD_VERTEX, v, v, 0);
+  MaybeCheckpoint(log);
+  return 0;
+}
+
+int LogAddGraphEdge(GraphLog log, GVertex_t v1, GVertex_t v2, GWeight_t w) {
+  if (ReserveRecord(log) == -1) {
+    return -1;
+  }
+  if (AddGraphEdge(log->g, v1, v2, w) == -1) {
+    pthread_mutex_unlock(&log->lock);
+    return -1;
+  }
+  CommitRecord(log, RECORD_ADD_EDGE, v1, v2, w);
+  MaybeCheckpoint(log);
+  return 0;
+}
+
+int LogRemoveGraphEdge(GraphLog log, GVertex_t v1, GVertex_t v2) {
+  if (ReserveRecord(log) == -1) {
+    return -1;
+  }
+  RemoveGraphEdge(log->g, v1, v2);
+  CommitRecord(log, RECORD_REMOVE_EDGE, v1, v2, 0);
+  MaybeCheckpoint(log);
+  return 0;
+}
+
+int SyncGraphLog(GraphLog log) {
+  uint64_t target;
+  int ret;
+
+  pthread_mutex_lock(&log->lock);
+  target = log->nextLsn;
+  while (log->durableLsn < target && !log->failed) {
+    log->syncRequested = true;
+    pthread_cond_signal(&log->wake);
+    pthread_cond_wait(&log->flushed, &log->lock);
+  }
+  ret = log->failed ? -1 : 0;
+  pthread_mutex_unlock(&log->lock);
+
+  return ret;
+}
+
+int CheckpointGraphLog(GraphLog log) {
+  char header[CHECKPOINT_HEADER_SIZE];
+  uint64_t numVertices, numEdges;
+  uint32_t crc;
+  char *tmpPath, *path;
+  ListItem *l;
+  EdgeItem *e;
+  GWeight_t w;
+  FILE *f;
+  int fd, ret = -1;
+
+  // Make the log durable first. With the lock held afterwards the buffer
+  // stays empty and the background thread stays idle.
+  if (SyncGraphLog(log) == -1) {
+    return -1;
+  }
+  pthread_mutex_lock(&log->lock);
+
+  tmpPath = LogPath(log, CHECKPOINT_TMP_FILE);
+  path = LogPath(log, CHECKPOINT_FILE);
+  f = (tmpPath == NULL) ? NULL : fopen(tmpPath, "wb");
+  if (f == NULL) {
+    goto done;
+  }
+
+  numVertices = (uint64_t)log->g->numVertices;
+  numEdges = (uint64_t)log->g->numEdges;
+  EncodeHeader(header, CHECKPOINT_MAGIC, log->nextLsn);
+  memcpy(header + 24, &numVertices, 8);
+  memcpy(header + 32, &numEdges, 8);
+  crc = Crc32(0, header, CHECKPOINT_HEADER_SIZE);
+  fwrite(header, CHECKPOINT_HEADER_SIZE, 1, f);
+
+  for (l = log->g->front; l != NULL; l = l->next) {
+    crc = Crc32(crc, &l->data, sizeof(GVertex_t));
+    fwrite(&l->data, sizeof(GVertex_t), 1, f);
+  }
+  // each edge once, from its smaller endpoint
+  for (l = log->g->front; l != NULL; l = l->next) {
+    for (e = l->neighbors; e != NULL; e = e->next) {
+      if (l->data < e->data) {
+        crc = Crc32(crc, &l->data, sizeof(GVertex_t));
+        crc = Crc32(crc, &e->data, sizeof(GVertex_t));
+        w = EdgeWeight(e);
+        crc = Crc32(crc, &w, WEIGHT_SIZE);
+        fwrite(&l->data, sizeof(GVertex_t), 1, f);
+        fwrite(&e->data, sizeof(GVertex_t), 1, f);
+        fwrite(&w, WEIGHT_SIZE, 1, f);
+      }
+    }
+  }
+  fwrite(&crc, 4, 1, f);
+
+  if (fflush(f) != 0 || ferror(f) || fsync(fileno(f)) == -1) {
+    fclose(f);
+    goto done;
+  }
+  if (fclose(f) != 0 || rename(tmpPath, path) == -1) {
+    goto done;
+  }
+
+  // make the rename itself durable before dropping the log it replaces
+  fd = open(log->dir, O_RDONLY);
+  if (fd == -1) {
+    goto done;
+  }
+  if (fsync(fd) == -1) {
+    close(fd);
+    goto done;
+  }
+  close(fd);
+
+  if (ResetLogFile(log, log->nextLsn) == -1) {
+    // the checkpoint is safely in place, so recovery is unaffected, but we
+    // can no longer trust the log file's contents
+    log->failed = true;
+    goto done;
+  }
+  ret = 0;
+
+done:
+  pthread_mutex_unlock(&log->lock);
+  free(tmpPath);
+  free(path);
+  return ret;
+}
@@ -0,0 +1,97 @@
+// A write-ahead log that makes a Graph survive crashes.
+//
+// A GraphLog owns a directory holding two files: a checkpoint, which is a
+// binary snapshot of the Graph, and a log of every mutation made since
+// that checkpoint. Mutations are made through the Log* functions below,
+// which apply them to the Graph and append them to an in-memory buffer. A
+// background thread writes the buffer out and fsyncs it, so that many
+// mutations share the cost of each fsync (group commit).
+//
+// Opening a GraphLog recovers the Graph from the checkpoint and the log.
+// Every mutation is either adding a vertex or setting the state of one
+// vertex pair (present with some weight, or absent), so only the last
+// logged mutation of each pair matters. Recovery uses that to reduce the
+// log in parallel before applying it.
+//
+// Like the Graph itself, a GraphLog is not safe to mutate from several
+// threads at once; callers must serialize the Log* calls.
+//
+// Vertex and edge payloads (see GRAPH_VERTEX_PAYLOAD in Graph.h) are not
+// logged; a recovered Graph has zeroed payloads. The files record the
+// Graph's vertex and weight types, and a log written by one specialization
+// cannot be opened by another. The Graph a GraphLog manages is always
+// undirected.
+
+#ifndef _GRAPH_LOG_H_
+#define _GRAPH_LOG_H_
+
+#include <stddef.h>  // for size_t
+
+#include "./Graph.h"
+
+struct graphlog;
+typedef struct graphlog *GraphLog;
+
+// Tuning knobs for a GraphLog.
+//
+//    -- commitIntervalUs  the longest a logged mutation waits in memory
+//                         before the background thread writes it out.
+//    -- bufferBytes       buffered bytes that trigger an immediate write.
+//    -- checkpointBytes   log size that triggers an automatic checkpoint
+//                         on the next mutation, or 0 for none.
+//    -- replayThreads     threads used to reduce the log during recovery.
+typedef struct GraphLogOptions {
+  int    commitIntervalUs;
+  size_t bufferBytes;
+  size_t checkpointBytes;
+  int    replayThreads;
+} GraphLogOptions;
+
+// Fills in the default options.
+void DefaultGraphLogOptions(GraphLogOptions *opts);
+
+// Opens the log in the given directory, creating the directory if it does
+// not exist, and recovers the Graph it describes.
+//
+// Arguments:
+//
+//    -- dir    the directory holding the checkpoint and log.
+//    -- opts   the options to use, or NULL for the defaults.
+//    -- out    location to store the recovered Graph in. The Graph belongs
+//              to the caller, and must outlive the GraphLog.
+//
+// Returns the GraphLog, or NULL if the directory could not be read or
+// written, if its contents are corrupt, or on memory error.
+GraphLog OpenGraphLog(const char *dir, const GraphLogOptions *opts,
+                      Graph *out);
+
+// Waits until every mutation logged so far is durable, stops the background
+// thread and releases the GraphLog. The Graph is left untouched.
+//
+// Returns -1 if any logged mutation could not be made durable, 0 otherwise.
+int CloseGraphLog(GraphLog log);
+
+// Logged versions of AddVertex, AddGraphEdge and RemoveGraphEdge. Each
+// applies the mutation to the Graph and logs it. A mutation is durable once
+// the background thread has written it out, or once SyncGraphLog returns.
+//
+// The Add functions return -1 on memory error, if the mutation is not
+// valid, or if the log has failed, 0 on success. LogRemoveGraphEdge
+// returns -1 if the log has failed, 0 otherwise.
+int LogAddVertex(GraphLog log, GVertex_t v);
+int LogAddGraphEdge(GraphLog log, GVertex_t v1, GVertex_t v2, GWeight_t w);
+int LogRemoveGraphEdge(GraphLog log, GVertex_t v1, GVertex_t v2);
+
+// Waits until every mutation logged so far is durable.
+//
+// Returns -1 if writing the log failed, 0 otherwise.
+int SyncGraphLog(GraphLog log);
+
+// Writes a new checkpoint of the Graph and empties the log. The checkpoint
+// replaces the previous one atomically, so a crash during a checkpoint
+// leaves the previous checkpoint and log intact.
+//
+// Returns -1 if the checkpoint could not be written, 0 otherwise.
+int CheckpointGraphLog(GraphLog log);
+
+#endif
@@ -0,0 +1,102 @@
+// The binary protocol spoken between the Graph server and its clients.
+//
+// A client sends a stream of request frames over a Unix domain socket, and
+// may send as many as it likes before reading any responses (pipelining).
+// The server answers every request with exactly one response frame, which
+// carries the request's id. Responses to one connection's requests are
+// sent in the order the requests arrived.
+//
+// All integers are in the host's byte order, and vertices and weights are
+// sent as GVertex_t and GWeight_t, so client and server must be built with
+// the same Graph specialization (see Graph.h). A request frame is:
+//
+//    u32 size | u32 id | u8 op | arguments
+//
+// where size counts the bytes after the size field itself, and the
+// arguments depend on the op:
+//
+//    -- GRAPH_REQ_CONTAINS   v
+//    -- GRAPH_REQ_ADJACENT   v1 v2
+//    -- GRAPH_REQ_NEIGHBORS  v
+//    -- GRAPH_REQ_ADD_EDGE   v1 v2 w
+//    -- GRAPH_REQ_ADD_VERTEX v
+//
+// A response frame is:
+//
+//    u32 size | u32 id | u8 op | u8 status | result
+//
+// where the result is present only if the status is GRAPH_STATUS_OK:
+//
+//    -- GRAPH_REQ_CONTAINS   u8 answer
+//    -- GRAPH_REQ_ADJACENT   u8 answer
+//    -- GRAPH_REQ_NEIGHBORS  u32 count, then count (v, w) pairs
+//    -- GRAPH_REQ_ADD_EDGE   nothing
+//    -- GRAPH_REQ_ADD_VERTEX nothing
+//
+// A frame that cannot be parsed makes the server close the connection,
+// since the stream can no longer be trusted.
+
+#ifndef _GRAPH_PROTOCOL_H_
+#define _GRAPH_PROTOCOL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "./Graph.h"
+
+// Request ops.
+#define GRAPH_REQ_CONTAINS   1
+#define GRAPH_REQ_ADJACENT   2
+#define GRAPH_REQ_NEIGHBORS  3
+#define GRAPH_REQ_ADD_EDGE   4
+#define GRAPH_REQ_ADD_VERTEX 5
+
+// Response statuses.
+#define GRAPH_STATUS_OK        0
+#define GRAPH_STATUS_NOT_FOUND 1  // GRAPH_REQ_NEIGHBORS of a missing vertex
+#define GRAPH_STATUS_FAILED    2  // the Graph refused the request
+
+// The size fields of the two frame headers, and the fixed parts after them.
+#define GRAPH_FRAME_SIZE_BYTES  4
+#define GRAPH_REQUEST_HEADER    (4 + 1)
+#define GRAPH_RESPONSE_HEADER   (4 + 1 + 1)
+
+// The largest request frame, size field included. Anything bigger is
+// malformed.
+#define GRAPH_MAX_REQUEST (GRAPH_FRAME_SIZE_BYTES + GRAPH_REQUEST_HEADER + \
+                           2 * sizeof(GVertex_t) + sizeof(GWeight_t))
+
+// The bytes taken by each neighbor in a GRAPH_REQ_NEIGHBORS result.
+#define GRAPH_NEIGHBOR_BYTES (sizeof(GVertex_t) + sizeof(GWeight_t))
+
+// Returns the size of the arguments to the given request op, or -1 if the
+// op is unknown.
+static inline int GraphRequestArgBytes(int op) {
+  switch (op) {
+    case GRAPH_REQ_CONTAINS:
+    case GRAPH_REQ_NEIGHBORS:
+    case GRAPH_REQ_ADD_VERTEX:
+      return sizeof(GVertex_t);
+    case GRAPH_REQ_ADJACENT:
+      return 2 * sizeof(GVertex_t);
+    case GRAPH_REQ_ADD_EDGE:
+      return 2 * sizeof(GVertex_t) + sizeof(GWeight_t);
+    default:
+      return -1;
+  }
+}
+
+// Appends the given bytes at p, returning the position after them. Frames
+// are unaligned, so every field goes through memcpy.
+static inline char *PutBytes(char *p, const void *src, size_t n) {
+  memcpy(p, src, n);
+  return p + n;
+}
+
+// Reads n bytes from p into dst, returning the position after them.
+static inline const char *GetBytes(const char *p, void *dst, size_t n) {
+  memcpy(dst, p, n);
+  return p + n;
+}
+
+#endif
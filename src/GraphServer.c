@@ -0,0 +1,593 @@
+// Implementation of the Graph server.
+//
+// Each connection has an input buffer, holding at most one partial request
+// between reads, and an output buffer of responses not yet sent. A worker
+// serving a connection alternates between reading a chunk and answering
+// every complete request in it, then sends what it can. If a client stops
+// reading its responses, the worker stops reading its requests once enough
+// output is queued, and waits for the socket to drain instead.
+//
+// The epoll data of every registration points either at the listening
+// socket, at the stop event, or at a Connection.
+
+#define _GNU_SOURCE  // for accept4 and the rwlock kind
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./GraphServer.h"
+#include "./GraphProtocol.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+// Events a worker takes from epoll at a time.
+#define EVENTS_PER_WAIT 16
+
+// Bytes read from a connection at a time.
+#define READ_CHUNK 65536
+
+// Queued output past which a connection's requests are left unread until
+// the client catches up.
+#define OUTPUT_LIMIT (4 << 20)
+
+// The most requests answered under one acquisition of the Graph lock, so
+// that a long batch of queries does not hold off mutations for too long.
+#define REQUESTS_PER_HOLD 256
+
+// How long to wait before accepting again after running out of
+// descriptors, when there is no connection of ours whose closing would
+// free one.
+#define ACCEPT_BACKOFF_NS 10000000
+
+// How a worker holds the Graph lock while answering a batch.
+enum {
+  HELD_NONE,
+  HELD_READ,
+  HELD_WRITE
+};
+
+typedef struct Connection {
+  int                 fd;
+  bool                eof;       // the client has finished sending
+  char               *in;        // READ_CHUNK bytes
+  size_t              inLen;
+  char               *out;
+  size_t              outLen;
+  size_t              outSent;
+  size_t              outCap;
+  struct Connection  *prev;
+  struct Connection  *next;
+} Connection;
+
+struct graphserver {
+  Graph             g;
+  char             *path;
+  int               listenFd;
+  int               epollFd;
+  int               stopFd;
+  pthread_rwlock_t  lock;
+  pthread_mutex_t   connLock;
+  Connection       *conns;
+  bool              acceptPaused;  // listenFd is left disarmed
+  int               workers;
+  pthread_t        *threads;
+};
+
+// Helper function declarations
+void *WorkerThread(void *arg);
+void AcceptConnections(GraphServer s);
+void ArmListener(GraphServer s);
+void ServeConnection(GraphServer s, Connection *c);
+bool AnswerRequests(GraphServer s, Connection *c);
+bool Answer(GraphServer s, Connection *c, const char *frame, uint32_t size,
+            int *held);
+void Hold(GraphServer s, int *held, int want);
+char *AppendResponse(Connection *c, uint32_t id, int op, int status,
+                     size_t resultBytes);
+bool SendResponses(Connection *c);
+void CloseConnection(GraphServer s, Connection *c);
+void FreeConnection(Connection *c);
+
+void DefaultGraphServerOptions(GraphServerOptions *opts) {
+  long cpus;
+
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  opts->workers = (cpus < 1) ? 1 : (int)cpus;
+  opts->backlog = 128;
+}
+
+GraphServer StartGraphServer(Graph g, const char *path,
+                             const GraphServerOptions *opts) {
+  GraphServerOptions defaults;
+  pthread_rwlockattr_t attr;
+  struct sockaddr_un addr;
+  struct epoll_event ev;
+  GraphServer s;
+  int workers;
+
+  DefaultGraphServerOptions(&defaults);
+  if (opts == NULL) {
+    opts = &defaults;
+  }
+  workers = (opts->workers > 0) ? opts->workers : defaults.workers;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return NULL;
+  }
+
+  s = (GraphServer)calloc(1, sizeof(struct graphserver));
+  if (s == NULL) {
+    return NULL;
+  }
+  s->g = g;
+  s->listenFd = s->epollFd = s->stopFd = -1;
+
+  // prefer writers, so that a steady stream of queries cannot starve
+  // mutations forever
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr,
+                                PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&s->lock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+  pthread_mutex_init(&s->connLock, NULL);
+
+  s->path = strdup(path);
+  s->threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+  if (s->path == NULL || s->threads == NULL) {
+    goto fail;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  s->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       0);
+  if (s->listenFd == -1 ||
+      bind(s->listenFd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+      listen(s->listenFd, opts->backlog) == -1) {
+    goto fail;
+  }
+
+  s->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  s->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (s->epollFd == -1 || s->stopFd == -1) {
+    goto fail;
+  }
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ev.data.ptr = &s->listenFd;
+  if (epoll_ctl(s->epollFd, EPOLL_CTL_ADD, s->listenFd, &ev) == -1) {
+    goto fail;
+  }
+  // level triggered, so that every worker sees it
+  ev.events = EPOLLIN;
+  ev.data.ptr = &s->stopFd;
+  if (epoll_ctl(s->epollFd, EPOLL_CTL_ADD, s->stopFd, &ev) == -1) {
+    goto fail;
+  }
+
+  for (s->workers = 0; s->workers < workers; s->workers++) {
+    if (pthread_create(&s->threads[s->workers], NULL, WorkerThread,
+                       s) != 0) {
+      break;
+    }
+  }
+  if (s->workers == 0) {
+    goto fail;
+  }
+  return s;
+
+fail:
+  StopGraphServer(s);
+  return NULL;
+}
+
+void StopGraphServer(GraphServer s) {
+  uint64_t one = 1;
+  Connection *c, *next;
+  int t;
+
+  if (s->workers > 0 && write(s->stopFd, &one, sizeof(one)) == -1) {
+    // an eventfd write can only fail on overflow, which one write
+    // cannot cause
+  }
+  for (t = 0; t < s->workers; t++) {
+    pthread_join(s->threads[t], NULL);
+  }
+
+  for (c = s->conns; c != NULL; c = next) {
+    next = c->next;
+    FreeConnection(c);
+  }
+  if (s->listenFd != -1) {
+    close(s->listenFd);
+    unlink(s->path);
+  }
+  if (s->epollFd != -1) {
+    close(s->epollFd);
+  }
+  if (s->stopFd != -1) {
+    close(s->stopFd);
+  }
+  pthread_rwlock_destroy(&s->lock);
+  pthread_mutex_destroy(&s->connLock);
+  free(s->threads);
+  free(s->path);
+  free(s);
+}
+
+void *WorkerThread(void *arg) {
+  GraphServer s = (GraphServer)arg;
+  struct epoll_event events[EVENTS_PER_WAIT];
+  int n, i;
+
+  for (;;) {
+    n = epoll_wait(s->epollFd, events, EVENTS_PER_WAIT, -1);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return NULL;
+    }
+    for (i = 0; i < n; i++) {
+      if (events[i].data.ptr == &s->stopFd) {
+        return NULL;
+      } else if (events[i].data.ptr == &s->listenFd) {
+        AcceptConnections(s);
+      } else {
+        ServeConnection(s, (Connection *)events[i].data.ptr);
+      }
+    }
+  }
+}
+
+// Accepts every pending connection, then re-arms the listening socket.
+// Out of descriptors, the socket stays readable, so re-arming it at once
+// would only wake a worker straight back up: it is left disarmed until one
+// of the connections closes instead, or re-armed after a short wait if
+// there are none.
+void AcceptConnections(GraphServer s) {
+  struct timespec backoff = { 0, ACCEPT_BACKOFF_NS };
+  struct epoll_event ev;
+  Connection *c;
+  bool paused;
+  int fd;
+
+  for (;;) {
+    fd = accept4(s->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+          errno == ENOMEM) {
+        pthread_mutex_lock(&s->connLock);
+        paused = s->acceptPaused = (s->conns != NULL);
+        pthread_mutex_unlock(&s->connLock);
+        if (paused) {
+          return;
+        }
+        nanosleep(&backoff, NULL);
+      }
+      // EAGAIN once the queue is empty; on anything else the rest stay
+      // queued until the next wakeup
+      break;
+    }
+
+    c = (Connection *)calloc(1, sizeof(Connection));
+    if (c != NULL) {
+      c->in = (char *)malloc(READ_CHUNK);
+    }
+    if (c == NULL || c->in == NULL) {
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->fd = fd;
+
+    pthread_mutex_lock(&s->connLock);
+    c->next = s->conns;
+    if (s->conns != NULL) {
+      s->conns->prev = c;
+    }
+    s->conns = c;
+    pthread_mutex_unlock(&s->connLock);
+
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = c;
+    if (epoll_ctl(s->epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      CloseConnection(s, c);
+    }
+  }
+
+  ArmListener(s);
+}
+
+// Re-arms the listening socket, for one worker to take the next wakeup.
+void ArmListener(GraphServer s) {
+  struct epoll_event ev;
+
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ev.data.ptr = &s->listenFd;
+  epoll_ctl(s->epollFd, EPOLL_CTL_MOD, s->listenFd, &ev);
+}
+
+// Reads and answers whatever the client has sent, sends back what it can,
+// and re-arms the connection (or closes it).
+void ServeConnection(GraphServer s, Connection *c) {
+  struct epoll_event ev;
+  ssize_t n;
+
+  while (!c->eof && c->outLen - c->outSent < OUTPUT_LIMIT) {
+    n = read(c->fd, c->in + c->inLen, READ_CHUNK - c->inLen);
+    if (n > 0) {
+      c->inLen += n;
+      if (!AnswerRequests(s, c)) {
+        CloseConnection(s, c);
+        return;
+      }
+    } else if (n == 0) {
+      c->eof = true;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      CloseConnection(s, c);
+      return;
+    }
+  }
+
+  if (!SendResponses(c) || (c->eof && c->outSent == c->outLen)) {
+    CloseConnection(s, c);
+    return;
+  }
+
+  ev.events = EPOLLONESHOT;
+  if (!c->eof && c->outLen - c->outSent < OUTPUT_LIMIT) {
+    ev.events |= EPOLLIN;
+  }
+  if (c->outSent < c->outLen) {
+    ev.events |= EPOLLOUT;
+  }
+  ev.data.ptr = c;
+  if (epoll_ctl(s->epollFd, EPOLL_CTL_MOD, c->fd, &ev) == -1) {
+    CloseConnection(s, c);
+  }
+}
+
+// Answers every complete request in the input buffer, and moves any
+// partial request left over to the front. Returns false if a request is
+// malformed.
+bool AnswerRequests(GraphServer s, Connection *c) {
+  uint32_t size;
+  size_t pos = 0;
+  int held = HELD_NONE, answered = 0;
+  bool ok = true;
+
+  while (c->inLen - pos >= GRAPH_FRAME_SIZE_BYTES) {
+    memcpy(&size, c->in + pos, GRAPH_FRAME_SIZE_BYTES);
+    if (size > GRAPH_MAX_REQUEST - GRAPH_FRAME_SIZE_BYTES) {
+      ok = false;
+      break;
+    }
+    if (c->inLen - pos < GRAPH_FRAME_SIZE_BYTES + size) {
+      break;
+    }
+
+    if (++answered % REQUESTS_PER_HOLD == 0) {
+      Hold(s, &held, HELD_NONE);
+    }
+    if (!Answer(s, c, c->in + pos + GRAPH_FRAME_SIZE_BYTES, size, &held)) {
+      ok = false;
+      break;
+    }
+    pos += GRAPH_FRAME_SIZE_BYTES + size;
+  }
+  Hold(s, &held, HELD_NONE);
+
+  memmove(c->in, c->in + pos, c->inLen - pos);
+  c->inLen -= pos;
+  return ok;
+}
+
+// Changes how the Graph lock is held, releasing it for HELD_NONE.
+void Hold(GraphServer s, int *held, int want) {
+  if (*held == want) {
+    return;
+  }
+  if (*held != HELD_NONE) {
+    pthread_rwlock_unlock(&s->lock);
+  }
+  if (want == HELD_READ) {
+    pthread_rwlock_rdlock(&s->lock);
+  } else if (want == HELD_WRITE) {
+    pthread_rwlock_wrlock(&s->lock);
+  }
+  *held = want;
+}
+
+// Answers one request frame (without its size field), appending the
+// response to the output buffer. Returns false if the request is malformed
+// or on memory error.
+bool Answer(GraphServer s, Connection *c, const char *frame, uint32_t size,
+            int *held) {
+  ListItem *vertex;
+  EdgeItem *edge;
+  GVertex_t v1, v2 = 0;
+  GWeight_t w = 0;
+  uint32_t id, count;
+  const char *p;
+  char *result;
+  int op, args, status;
+  bool answer;
+
+  if (size < GRAPH_REQUEST_HEADER) {
+    return false;
+  }
+  p = GetBytes(frame, &id, 4);
+  op = (unsigned char)*p++;
+  args = GraphRequestArgBytes(op);
+  if (args == -1 || size != GRAPH_REQUEST_HEADER + (uint32_t)args) {
+    return false;
+  }
+  p = GetBytes(p, &v1, sizeof(GVertex_t));
+  if (op == GRAPH_REQ_ADJACENT || op == GRAPH_REQ_ADD_EDGE) {
+    p = GetBytes(p, &v2, sizeof(GVertex_t));
+  }
+  if (op == GRAPH_REQ_ADD_EDGE) {
+    GetBytes(p, &w, sizeof(GWeight_t));
+  }
+
+  switch (op) {
+    case GRAPH_REQ_CONTAINS:
+    case GRAPH_REQ_ADJACENT:
+      Hold(s, held, HELD_READ);
+      answer = (op == GRAPH_REQ_CONTAINS) ? ContainsVertex(s->g, v1) :
+        AreAdjacent(s->g, v1, v2);
+      result = AppendResponse(c, id, op, GRAPH_STATUS_OK, 1);
+      if (result == NULL) {
+        return false;
+      }
+      *result = answer ? 1 : 0;
+      return true;
+
+    case GRAPH_REQ_NEIGHBORS:
+      // copy the edge list straight into the response, rather than
+      // through GetNeighbors and a temporary array
+      Hold(s, held, HELD_READ);
+      vertex = FindVertex(s->g, v1);
+      if (vertex == NULL) {
+        return AppendResponse(c, id, op, GRAPH_STATUS_NOT_FOUND, 0) != NULL;
+      }
+      count = VisibleDegree(s->g, vertex);
+      result = AppendResponse(c, id, op, GRAPH_STATUS_OK,
+                              4 + count * GRAPH_NEIGHBOR_BYTES);
+      if (result == NULL) {
+        return false;
+      }
+      result = PutBytes(result, &count, 4);
+      for (edge = vertex->neighbors; edge != NULL; edge = edge->next) {
+        if (!EdgeVisible(s->g, vertex, edge, false)) {
+          continue;
+        }
+        w = EdgeWeight(edge);
+        result = PutBytes(result, &edge->data, sizeof(GVertex_t));
+        result = PutBytes(result, &w, sizeof(GWeight_t));
+      }
+      return true;
+
+    case GRAPH_REQ_ADD_VERTEX:
+      Hold(s, held, HELD_WRITE);
+      status = (AddVertex(s->g, v1) == 0) ? GRAPH_STATUS_OK :
+        GRAPH_STATUS_FAILED;
+      return AppendResponse(c, id, op, status, 0) != NULL;
+
+    default:  // GRAPH_REQ_ADD_EDGE
+      Hold(s, held, HELD_WRITE);
+      status = (AddGraphEdge(s->g, v1, v2, w) == 0) ? GRAPH_STATUS_OK :
+        GRAPH_STATUS_FAILED;
+      return AppendResponse(c, id, op, status, 0) != NULL;
+  }
+}
+
+// Appends a response header to the output buffer, with room for a result
+// of the given size after it. Returns where the result goes, or NULL on
+// memory error.
+char *AppendResponse(Connection *c, uint32_t id, int op, int status,
+                     size_t resultBytes) {
+  size_t bytes, cap;
+  uint32_t size;
+  char *out, *p;
+
+  // drop what has already been sent before growing the buffer
+  if (c->outSent > 0) {
+    memmove(c->out, c->out + c->outSent, c->outLen - c->outSent);
+    c->outLen -= c->outSent;
+    c->outSent = 0;
+  }
+
+  size = GRAPH_RESPONSE_HEADER + resultBytes;
+  bytes = GRAPH_FRAME_SIZE_BYTES + size;
+  if (c->outLen + bytes > c->outCap) {
+    cap = (c->outCap == 0) ? READ_CHUNK : c->outCap;
+    while (cap < c->outLen + bytes) {
+      cap *= 2;
+    }
+    out = (char *)realloc(c->out, cap);
+    if (out == NULL) {
+      return NULL;
+    }
+    c->out = out;
+    c->outCap = cap;
+  }
+
+  p = c->out + c->outLen;
+  p = PutBytes(p, &size, GRAPH_FRAME_SIZE_BYTES);
+  p = PutBytes(p, &id, 4);
+  *p++ = (char)op;
+  *p++ = (char)status;
+  c->outLen += bytes;
+  return p;
+}
+
+// Sends as much queued output as the socket will take. Returns false if
+// the connection has failed.
+bool SendResponses(Connection *c) {
+  ssize_t n;
+
+  while (c->outSent < c->outLen) {
+    n = send(c->fd, c->out + c->outSent, c->outLen - c->outSent,
+             MSG_NOSIGNAL);
+    if (n >= 0) {
+      c->outSent += n;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      break;
+    } else if (errno != EINTR) {
+      return false;
+    }
+  }
+  if (c->outSent == c->outLen) {
+    c->outSent = c->outLen = 0;
+  }
+  return true;
+}
+
+// Unlinks a connection from the server and frees it. Closing the socket
+// also removes it from epoll.
+void CloseConnection(GraphServer s, Connection *c) {
+  bool paused;
+
+  pthread_mutex_lock(&s->connLock);
+  if (c->prev != NULL) {
+    c->prev->next = c->next;
+  } else {
+    s->conns = c->next;
+  }
+  if (c->next != NULL) {
+    c->next->prev = c->prev;
+  }
+  paused = s->acceptPaused;
+  s->acceptPaused = false;
+  pthread_mutex_unlock(&s->connLock);
+  FreeConnection(c);
+
+  // the descriptor just freed lets the listening socket accept again
+  if (paused) {
+    ArmListener(s);
+  }
+}
+
+void FreeConnection(Connection *c) {
+  close(c->fd);
+  free(c->in);
+  free(c->out);
+  free(c);
+}
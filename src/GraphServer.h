@@ -0,0 +1,56 @@
+// A server answering Graph queries from many clients over a Unix domain
+// socket, using the protocol in GraphProtocol.h.
+//
+// A pool of worker threads shares one epoll instance. Every connection is
+// registered one-shot, so whichever worker wakes for it has it to itself
+// until it re-arms it: the worker reads everything the client has sent,
+// answers every complete request in it, and sends all the responses back
+// with as few writes as possible. Clients that pipeline their requests
+// therefore get their answers in batches.
+//
+// Queries from different connections run concurrently. Mutations take the
+// Graph exclusively, since the Graph itself is not safe to mutate from
+// several threads at once. While the server runs, the Graph must not be
+// touched by anything else.
+
+#ifndef _GRAPH_SERVER_H_
+#define _GRAPH_SERVER_H_
+
+#include "./Graph.h"
+
+struct graphserver;
+typedef struct graphserver *GraphServer;
+
+// Tuning knobs for a GraphServer.
+//
+//    -- workers  the number of worker threads, or 0 for one per CPU.
+//    -- backlog  the listen backlog for pending connections.
+typedef struct GraphServerOptions {
+  int workers;
+  int backlog;
+} GraphServerOptions;
+
+// Fills in the default options.
+void DefaultGraphServerOptions(GraphServerOptions *opts);
+
+// Starts serving the given Graph on a Unix domain socket at the given path.
+// An existing socket at the path is replaced. Returns once the workers are
+// running.
+//
+// Arguments:
+//
+//    -- g     the Graph to serve.
+//    -- path  where to create the socket.
+//    -- opts  the options to use, or NULL for the defaults.
+//
+// Returns the server, or NULL if the socket could not be created or on
+// memory error.
+GraphServer StartGraphServer(Graph g, const char *path,
+                             const GraphServerOptions *opts);
+
+// Stops the server: waits for the workers to finish what they are doing,
+// closes every connection, and removes the socket. The Graph is left to
+// the caller.
+void StopGraphServer(GraphServer s);
+
+#endif
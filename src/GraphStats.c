@@ -0,0 +1,181 @@
+// Implementation of the per-thread Graph counters.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./GraphStats.h"
+#include "./GraphStats_priv.h"
+
+static const char *opNames[GRAPH_NUM_OPS] = {
+  "add",
+  "contains",
+  "adj",
+  "neighbors",
+  "edge",
+  "remove",
+  "contains_batch",
+  "adj_batch",
+  "in_neighbors",
+  "khop",
+};
+
+const char *GraphOpName(GraphOp op) {
+  if (op < 0 || op >= GRAPH_NUM_OPS) {
+    return "unknown";
+  }
+  return opNames[op];
+}
+
+unsigned long long GraphOpPercentile(const GraphOpStats *op, double p) {
+  unsigned long long target, seen, scaled;
+  int i;
+
+  if (op->calls == 0) {
+    return 0;
+  }
+
+  // the rank of the call we are looking for, rounded up; p is taken to a
+  // thousandth of a percent, so that the rounding is done on integers and
+  // a product like 7% of 100 calls can't come out a hair over 7
+  scaled = (p <= 0) ? 0 : (p >= 100) ? 100000 :
+    (unsigned long long)(p * 1000 + 0.5);
+  target = (scaled * op->calls + 99999) / 100000;
+  if (target == 0) {
+    target = 1;
+  }
+
+  seen = 0;
+  for (i = 0; i < GRAPH_STATS_BUCKETS; i++) {
+    seen += op->histogram[i];
+    if (seen >= target) {
+      return 1ULL << i;
+    }
+  }
+  return 1ULL << (GRAPH_STATS_BUCKETS - 1);
+}
+
+void RecordGraphOpLatency(GraphOpStats *op, unsigned long long ns) {
+  int bucket;
+
+  // bucket i holds latencies in [2^(i-1), 2^i)
+  bucket = (ns == 0) ? 0 : 64 - __builtin_clzll(ns);
+  if (bucket >= GRAPH_STATS_BUCKETS) {
+    bucket = GRAPH_STATS_BUCKETS - 1;
+  }
+
+  op->calls++;
+  op->totalNs += ns;
+  op->histogram[bucket]++;
+}
+
+#ifdef GRAPH_STATS
+
+#include <pthread.h>
+
+// Each thread's counters live in a block that is linked into a global list
+// the first time the thread records anything. Blocks are never freed, so
+// that the work done by threads which have since exited is still reported.
+typedef struct StatsBlock {
+  GraphStats         stats;
+  struct StatsBlock *next;
+} StatsBlock;
+
+static pthread_mutex_t blocksLock = PTHREAD_MUTEX_INITIALIZER;
+static StatsBlock *blocks = NULL;
+static __thread StatsBlock *local = NULL;
+
+GraphStats *LocalGraphStats() {
+  StatsBlock *b;
+
+  if (local != NULL) {
+    return &local->stats;
+  }
+
+  b = (StatsBlock *)calloc(1, sizeof(StatsBlock));
+  if (b == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&blocksLock);
+  b->next = blocks;
+  blocks = b;
+  pthread_mutex_unlock(&blocksLock);
+
+  local = b;
+  return &local->stats;
+}
+
+GraphStatsTimer StartGraphStatsTimer(GraphOp op) {
+  GraphStatsTimer t;
+
+  t.op = op;
+  clock_gettime(CLOCK_MONOTONIC, &t.start);
+  return t;
+}
+
+void StopGraphStatsTimer(GraphStatsTimer *t) {
+  struct timespec end;
+  unsigned long long ns;
+  GraphStats *stats;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  stats = LocalGraphStats();
+  if (stats == NULL) {
+    return;
+  }
+
+  ns = (unsigned long long)(end.tv_sec - t->start.tv_sec) * 1000000000ULL +
+       (unsigned long long)(end.tv_nsec - t->start.tv_nsec);
+  RecordGraphOpLatency(&stats->ops[t->op], ns);
+}
+
+int GetGraphStats(GraphStats *out) {
+  StatsBlock *b;
+  GraphStats *s;
+  int i, j;
+
+  memset(out, 0, sizeof(GraphStats));
+
+  pthread_mutex_lock(&blocksLock);
+  for (b = blocks; b != NULL; b = b->next) {
+    s = &b->stats;
+    out->verticesScanned += s->verticesScanned;
+    out->vertexLookups += s->vertexLookups;
+    out->edgesWalked += s->edgesWalked;
+    out->vertexAllocs += s->vertexAllocs;
+    out->edgeAllocs += s->edgeAllocs;
+    out->neighborAllocs += s->neighborAllocs;
+    for (i = 0; i < GRAPH_NUM_OPS; i++) {
+      out->ops[i].calls += s->ops[i].calls;
+      out->ops[i].totalNs += s->ops[i].totalNs;
+      for (j = 0; j < GRAPH_STATS_BUCKETS; j++) {
+        out->ops[i].histogram[j] += s->ops[i].histogram[j];
+      }
+    }
+  }
+  pthread_mutex_unlock(&blocksLock);
+
+  return 0;
+}
+
+void ResetGraphStats() {
+  StatsBlock *b;
+
+  pthread_mutex_lock(&blocksLock);
+  for (b = blocks; b != NULL; b = b->next) {
+    memset(&b->stats, 0, sizeof(GraphStats));
+  }
+  pthread_mutex_unlock(&blocksLock);
+}
+
+#else
+
+int GetGraphStats(GraphStats *out) {
+  memset(out, 0, sizeof(GraphStats));
+  return -1;
+}
+
+void ResetGraphStats() {
+}
+
+#endif
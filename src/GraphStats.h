@@ -0,0 +1,83 @@
+// Instrumentation for the Graph ADT.
+//
+// When the library is compiled with GRAPH_STATS defined, every public Graph
+// operation records its call count and latency, and the internal helpers
+// record how much work they do (vertices scanned, edges walked, allocations
+// made). Counters are kept per-thread so that recording them never contends
+// on a lock; GetGraphStats() sums the counters of every thread that has
+// touched a Graph.
+//
+// Without GRAPH_STATS the instrumentation compiles away entirely and
+// GetGraphStats() reports that statistics are unavailable.
+
+#ifndef _GRAPH_STATS_H_
+#define _GRAPH_STATS_H_
+
+// The public operations we keep latency histograms for.
+typedef enum GraphOp {
+  GRAPH_OP_ADD_VERTEX,
+  GRAPH_OP_CONTAINS_VERTEX,
+  GRAPH_OP_ARE_ADJACENT,
+  GRAPH_OP_GET_NEIGHBORS,
+  GRAPH_OP_ADD_EDGE,
+  GRAPH_OP_REMOVE_EDGE,
+  GRAPH_OP_CONTAINS_VERTEX_BATCH,
+  GRAPH_OP_ARE_ADJACENT_BATCH,
+  GRAPH_OP_GET_IN_NEIGHBORS,
+  GRAPH_OP_K_HOP,
+  GRAPH_NUM_OPS
+} GraphOp;
+
+// The batch operations record one call (and one latency) per batch.
+//
+// Latencies are bucketed by powers of two: bucket i counts calls that took
+// fewer than 2^i nanoseconds (and at least 2^(i-1)). The last bucket also
+// absorbs anything slower.
+#define GRAPH_STATS_BUCKETS 32
+
+typedef struct GraphOpStats {
+  unsigned long long calls;
+  unsigned long long totalNs;
+  unsigned long long histogram[GRAPH_STATS_BUCKETS];
+} GraphOpStats;
+
+// A snapshot of the counters. The work counters are:
+//
+//    -- verticesScanned  index slots probed while looking up a vertex.
+//    -- vertexLookups    number of vertex lookups performed.
+//    -- edgesWalked      edge list entries examined while searching for
+//                        or removing an edge.
+//    -- vertexAllocs     allocations made for new vertices.
+//    -- edgeAllocs       allocations made for new edges.
+//    -- neighborAllocs   allocations made by GetNeighbors and
+//                        GetInNeighbors.
+typedef struct GraphStats {
+  unsigned long long verticesScanned;
+  unsigned long long vertexLookups;
+  unsigned long long edgesWalked;
+  unsigned long long vertexAllocs;
+  unsigned long long edgeAllocs;
+  unsigned long long neighborAllocs;
+  GraphOpStats       ops[GRAPH_NUM_OPS];
+} GraphStats;
+
+// Sums the counters of all threads into out. Counters of other threads are
+// read without synchronization, so a snapshot taken while other threads are
+// working is approximate.
+//
+// Returns 0 on success, -1 if the library was built without GRAPH_STATS (in
+// which case out is zeroed).
+int GetGraphStats(GraphStats *out);
+
+// Zeroes the counters of all threads.
+void ResetGraphStats();
+
+// Returns a short human readable name for the given operation.
+const char *GraphOpName(GraphOp op);
+
+// Estimates the given percentile (0 < p <= 100) of an operation's latency
+// from its histogram. The estimate is the upper bound of the bucket the
+// percentile falls in, in nanoseconds. Returns 0 if there are no calls.
+unsigned long long GraphOpPercentile(const GraphOpStats *op, double p);
+
+#endif
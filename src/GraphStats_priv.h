@@ -0,0 +1,56 @@
+// Recording macros used by the Graph implementation to update the counters
+// described in GraphStats.h. All of them expand to nothing unless the
+// library is compiled with GRAPH_STATS.
+
+#ifndef _GRAPH_STATS_PRIV_H_
+#define _GRAPH_STATS_PRIV_H_
+
+#include "./GraphStats.h"
+
+// Adds a call taking ns nanoseconds to an operation's counters and latency
+// histogram. Available in every build, for callers keeping counters of
+// their own.
+void RecordGraphOpLatency(GraphOpStats *op, unsigned long long ns);
+
+#ifdef GRAPH_STATS
+
+#include <time.h>  // for struct timespec
+
+// Returns the calling thread's counters, creating them on first use.
+// Returns NULL if they could not be allocated, in which case nothing
+// is recorded for this thread.
+GraphStats *LocalGraphStats();
+
+// A timer started when a public operation is entered and stopped (via the
+// cleanup attribute) whenever the function returns.
+typedef struct GraphStatsTimer {
+  GraphOp         op;
+  struct timespec start;
+} GraphStatsTimer;
+
+GraphStatsTimer StartGraphStatsTimer(GraphOp op);
+void StopGraphStatsTimer(GraphStatsTimer *t);
+
+// Adds n to the named counter of the calling thread.
+#define STATS_ADD(field, n)                          \
+  do {                                               \
+    GraphStats *_stats = LocalGraphStats();          \
+    if (_stats != NULL) {                            \
+      _stats->field += (n);                          \
+    }                                                \
+  } while (0)
+
+// Times the remainder of the enclosing function as the given operation.
+#define STATS_TIME_OP(op)                                              \
+  GraphStatsTimer _stats_timer                                         \
+    __attribute__((cleanup(StopGraphStatsTimer))) =                    \
+    StartGraphStatsTimer(op)
+
+#else
+
+#define STATS_ADD(field, n) do { } while (0)
+#define STATS_TIME_OP(op) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+// Implementation of Graph views (see GraphView.h).
+//
+// Materializing a view runs in two parallel passes over shares of the
+// vertex ids: the first counts the edges each share shows, and the second,
+// after a prefix sum over the counts, writes them into place in one array,
+// which is handed to the bulk builder.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./GraphView.h"
+#include "./GraphView_priv.h"
+#include "./GraphBuilder.h"
+#include "./GraphBuilder_priv.h"
+#include "./WeightIndex.h"
+
+// The state shared by the threads materializing a view.
+typedef struct Gather {
+  Graph       g;
+  ListItem  **items;    // the ListItem of each id
+  int         threads;
+  size_t     *counts;   // the edges each thread's share shows, then where
+                        // its edges start
+  GraphEdge  *edges;    // NULL while counting
+} Gather;
+
+// Helper function declarations
+void GatherShare(void *arg, int t);
+
+Graph CreateGraphView(Graph g, const GVertex_t *vertices, int n,
+                      GraphEdgeFilter filter, void *arg) {
+  GraphMemory memory = { g->memory.allocator, 0, 0 };
+  GraphView *view;
+  ListItem *l;
+  Graph v;
+  int i;
+
+  v = (Graph)MemoryAlloc(&memory, sizeof(GraphImplementation));
+  view = (GraphView *)MemoryCalloc(&memory, sizeof(GraphView));
+  if (v == NULL || view == NULL) {
+    MemoryFree(&memory, view, sizeof(GraphView));
+    MemoryFree(&memory, v, sizeof(GraphImplementation));
+    return NULL;
+  }
+
+  view->parent = g;
+  view->filter = filter;
+  view->arg = arg;
+  view->filtered = filter != NULL || (g->view != NULL && g->view->filtered);
+  if (vertices != NULL || (g->view != NULL && g->view->mask != NULL)) {
+    view->maskWords = g->numVertices / 64 + 1;
+    view->mask = (uint64_t *)MemoryCalloc(&memory, sizeof(uint64_t) *
+                                          view->maskWords);
+    if (view->mask == NULL) {
+      MemoryFree(&memory, view, sizeof(GraphView));
+      MemoryFree(&memory, v, sizeof(GraphImplementation));
+      return NULL;
+    }
+    if (vertices == NULL) {
+      memcpy(view->mask, g->view->mask, sizeof(uint64_t) * view->maskWords);
+    }
+    // looking the vertices up in g leaves out those g hides
+    for (i = 0; vertices != NULL && i < n; i++) {
+      l = FindVertex(g, vertices[i]);
+      if (l != NULL) {
+        view->mask[l->id / 64] |= (uint64_t)1 << (l->id % 64);
+      }
+    }
+  }
+
+  *v = *g;
+  v->weightIndex = NULL;
+  v->view = view;
+  // a view shows something other than g, so state derived from one must
+  // not pass for the other's
+  v->serial = NewGraphSerial();
+  v->memory = memory;
+  return v;
+}
+
+bool IsGraphView(Graph g) {
+  return g->view != NULL;
+}
+
+// Frees a view, leaving the Graph it views alone.
+void FreeView(Graph g) {
+  GraphMemory memory;
+
+  DisableWeightIndex(g);
+  MemoryFree(&g->memory, g->view->mask,
+             sizeof(uint64_t) * g->view->maskWords);
+  MemoryFree(&g->memory, g->view, sizeof(GraphView));
+
+  // the accounts live in the view, so take them out before freeing it
+  memory = g->memory;
+  MemoryFree(&memory, g, sizeof(GraphImplementation));
+}
+
+// Returns true if the view shows the given edge of l. The far end of the
+// edge is looked up only if the view hides some vertices, and the filters
+// are called only if some view below this one has one.
+bool ViewShowsEdge(Graph g, const ListItem *l, const EdgeItem *e, bool in) {
+  GVertex_t v1 = l->data, v2 = e->data, tmp;
+  GWeight_t w = EdgeWeight(e);
+  Graph v;
+
+  if (!VertexVisible(g, l) ||
+      (g->view->mask != NULL && FindVertex(g, e->data) == NULL)) {
+    return false;
+  }
+  if (!g->view->filtered) {
+    return true;
+  }
+
+  if (in) {
+    v1 = e->data;
+    v2 = l->data;
+  }
+  if (!g->directed && v2 < v1) {
+    tmp = v1;
+    v1 = v2;
+    v2 = tmp;
+  }
+  for (v = g; v->view != NULL; v = v->view->parent) {
+    if (v->view->filter != NULL && !v->view->filter(v1, v2, w, v->view->arg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the number of edges of l the view shows.
+int ViewDegree(Graph g, const ListItem *l) {
+  EdgeItem *e;
+  int count = 0;
+
+  if (!VertexVisible(g, l)) {
+    return 0;
+  }
+  if (g->view->mask == NULL && !g->view->filtered) {
+    return l->count;
+  }
+  for (e = l->neighbors; e != NULL; e = e->next) {
+    if (ViewShowsEdge(g, l, e, false)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Summarizes what the view shows. A view holds no vertices or edges, only
+// its header and mask.
+void SummarizeView(Graph g, GraphSummary *out) {
+  ListItem *l;
+  int degree;
+
+  memset(out, 0, sizeof(GraphSummary));
+  for (l = g->front; l != NULL; l = l->next) {
+    if (!VertexVisible(g, l)) {
+      continue;
+    }
+    degree = ViewDegree(g, l);
+    if (out->vertices == 0 || degree < out->minDegree) {
+      out->minDegree = degree;
+    }
+    if (degree > out->maxDegree) {
+      out->maxDegree = degree;
+    }
+    out->degreeHistogram[DegreeBucket(degree)]++;
+    out->vertices++;
+    out->edges += degree;
+  }
+  if (out->vertices > 0) {
+    out->meanDegree = (double)out->edges / out->vertices;
+  }
+  if (!g->directed) {
+    // each undirected edge was counted from both ends
+    out->edges /= 2;
+  }
+
+  out->overheadBytes = AllocatedSize(sizeof(GraphImplementation)) +
+    AllocatedSize(sizeof(GraphView));
+  if (g->view->mask != NULL) {
+    out->overheadBytes +=
+      AllocatedSize(sizeof(uint64_t) * g->view->maskWords);
+  }
+}
+
+Graph MaterializeGraphView(Graph g, int threads) {
+  Gather gather;
+  ListItem *l;
+  Graph copy = NULL;
+  size_t total = 0, count;
+  int t;
+
+  memset(&gather, 0, sizeof(Gather));
+  gather.g = g;
+  gather.threads = GraphThreads(threads);
+  gather.items = (ListItem **)malloc(sizeof(ListItem *) *
+                                     (g->numVertices + 1));
+  gather.counts = (size_t *)calloc(gather.threads, sizeof(size_t));
+  if (gather.items == NULL || gather.counts == NULL) {
+    goto done;
+  }
+  for (l = g->front; l != NULL; l = l->next) {
+    gather.items[l->id] = l;
+  }
+
+  // count each share's edges, then gather them where the counts put them
+  if (!RunOnThreads(gather.threads, GatherShare, &gather)) {
+    goto done;
+  }
+  for (t = 0; t < gather.threads; t++) {
+    count = gather.counts[t];
+    gather.counts[t] = total;
+    total += count;
+  }
+  gather.edges = (GraphEdge *)malloc(sizeof(GraphEdge) * (total + 1));
+  if (gather.edges == NULL ||
+      !RunOnThreads(gather.threads, GatherShare, &gather)) {
+    goto done;
+  }
+
+  copy = g->directed ?
+    BuildDirectedGraphParallel(gather.edges, total, gather.threads) :
+    BuildGraphParallel(gather.edges, total, gather.threads);
+  // the builder only knows about vertices with edges
+  for (l = g->front; copy != NULL && l != NULL; l = l->next) {
+    if (VertexVisible(g, l) && AddVertex(copy, l->data) == -1) {
+      FreeGraph(copy);
+      copy = NULL;
+    }
+  }
+
+done:
+  free(gather.items);
+  free(gather.counts);
+  free(gather.edges);
+  return copy;
+}
+
+// Counts the edges shown by thread t's share of the ids, or if the edges
+// array is there, writes them out from where the share's edges start. An
+// undirected edge is taken from its smaller end only.
+void GatherShare(void *arg, int t) {
+  Gather *gather = (Gather *)arg;
+  Graph g = gather->g;
+  GraphEdge *edge;
+  ListItem *l;
+  EdgeItem *e;
+  size_t count = 0;
+  int start, end, id;
+
+  start = (int)((long)g->numVertices * t / gather->threads);
+  end = (int)((long)g->numVertices * (t + 1) / gather->threads);
+  for (id = start; id < end; id++) {
+    l = gather->items[id];
+    for (e = l->neighbors; e != NULL; e = e->next) {
+      if ((!g->directed && e->data < l->data) ||
+          !EdgeVisible(g, l, e, false)) {
+        continue;
+      }
+      if (gather->edges != NULL) {
+        edge = &gather->edges[gather->counts[t] + count];
+        edge->v1 = l->data;
+        edge->v2 = e->data;
+        edge->weight = EdgeWeight(e);
+      }
+      count++;
+    }
+  }
+  if (gather->edges == NULL) {
+    gather->counts[t] = count;
+  }
+}
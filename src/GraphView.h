@@ -0,0 +1,70 @@
+// Views of a Graph: the subgraph of some of its vertices, and of those of
+// the edges between them that pass a filter, without copying any of it.
+//
+// A view is itself a Graph, sharing the vertex and edge lists of the Graph
+// it views, so every query and traversal takes one: lookups and neighbor
+// lists, summaries, k-hop neighborhoods, shortest paths and landmarks, core
+// numbers and cliques, random walks, partitions, diffs and weight indexes
+// all see only what the view shows. Hidden vertices are not found, and
+// hidden edges are skipped as the lists are walked, so a query on a view
+// costs what it would on the whole Graph, plus a test of each edge it
+// walks. The vertices shown are kept as a bitmap over vertex ids.
+//
+// A view is read only: AddVertex, AddGraphEdge and SetEdgePayload fail on
+// one, and RemoveGraphEdge does nothing. It holds none of the vertices and
+// edges it shows, so it is only valid until the Graph it views is next
+// changed, and must be freed (with FreeGraph) before that Graph is. The
+// first query on a view of a directed Graph that follows edges backward
+// (GetInNeighbors, BidirectionalPath or ComputeLandmarks) builds the
+// in-adjacency of the Graph viewed, just as the same query on that Graph
+// would, and all its views then share it. As there, make that query before
+// querying from several threads at once. A view has no weight index until
+// one is enabled on it (see WeightIndex.h), which is the view's own, and
+// holds only the edges the view shows.
+//
+// A subgraph walked often enough that testing its edges costs more than
+// copying them once can be copied into a compact Graph of its own with
+// MaterializeGraphView.
+
+#ifndef _GRAPH_VIEW_H_
+#define _GRAPH_VIEW_H_
+
+#include <stdbool.h>
+
+#include "./Graph.h"
+
+// Decides whether a view shows the edge from v1 to v2 of weight w. In an
+// undirected Graph, v1 is the smaller vertex, so that the edge is judged
+// the same from both ends. Queries may run concurrently, so a filter must
+// be safe to call from several threads at once.
+typedef bool (*GraphEdgeFilter)(GVertex_t v1, GVertex_t v2, GWeight_t w,
+                                void *arg);
+
+// Makes a view of a Graph.
+//
+// Arguments:
+//
+//    -- g         the Graph to view. If g is itself a view, the new view
+//                 shows only what both show, and must be freed first.
+//    -- vertices  the vertices to show, or NULL to show every vertex.
+//                 Vertices g does not have (or does not show) are ignored.
+//    -- n         the number of vertices.
+//    -- filter    decides which edges between shown vertices to show, or
+//                 NULL to show them all.
+//    -- arg       passed to filter.
+//
+// Returns the view, or NULL on memory error.
+Graph CreateGraphView(Graph g, const GVertex_t *vertices, int n,
+                      GraphEdgeFilter filter, void *arg);
+
+// Returns true if the Graph is a view.
+bool IsGraphView(Graph g);
+
+// Copies the vertices and edges a Graph shows into a new, ordinary Graph,
+// directed if it is, laid out as BuildGraphParallel lays a Graph out (see
+// GraphBuilder.h). The edges are gathered by threads threads (or one per
+// CPU, if 0), each filtering a share of the vertices. Payloads are not
+// copied. Returns the new Graph, or NULL on memory error.
+Graph MaterializeGraphView(Graph g, int threads);
+
+#endif
@@ -0,0 +1,66 @@
+// A view's representation, and the calls through which the Graph's queries
+// and traversals see only what a view shows (see GraphView.h).
+//
+// A view is a copy of the GraphImplementation of the Graph it views, so it
+// shares that Graph's vertex list, edge lists and vertex index, plus the
+// filters below. Code walking a Graph's lists must skip what it hides:
+// FindVertex does not find hidden vertices, and VertexVisible, EdgeVisible
+// and VisibleDegree answer the rest. Each is a single test on an ordinary
+// Graph.
+//
+// Ids are shared with the Graph viewed, so per-vertex arrays indexed by id
+// still need room for every vertex of that Graph, shown or not.
+
+#ifndef _GRAPH_VIEW_PRIV_H_
+#define _GRAPH_VIEW_PRIV_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./Graph.h"
+#include "./Graph_priv.h"
+#include "./GraphView.h"
+
+// A view's filters. The mask already accounts for every view below this
+// one, but their edge filters are called in turn.
+typedef struct graphview {
+  Graph            parent;    // the Graph viewed, which may be a view
+  uint64_t        *mask;      // a bit per id shown, or NULL for all
+  int              maskWords;
+  GraphEdgeFilter  filter;    // or NULL
+  void            *arg;
+  bool             filtered;  // whether this view or one below filters edges
+} GraphView;
+
+// Returns true if the view shows the given edge of l, one of its edges or
+// (if in is true) one of its incoming edges.
+bool ViewShowsEdge(Graph g, const ListItem *l, const EdgeItem *e, bool in);
+
+// Returns the number of edges of l the view shows.
+int ViewDegree(Graph g, const ListItem *l);
+
+// Summarizes what the view shows, walking it, for GetGraphSummary.
+void SummarizeView(Graph g, GraphSummary *out);
+
+// Frees a view, for FreeGraph.
+void FreeView(Graph g);
+
+// Returns true if the Graph shows the given vertex.
+static inline bool VertexVisible(Graph g, const ListItem *l) {
+  return g->view == NULL || g->view->mask == NULL ||
+    ((g->view->mask[l->id / 64] >> (l->id % 64)) & 1) != 0;
+}
+
+// Returns true if the Graph shows the given edge of l, one of its edges or
+// (if in is true) one of its incoming edges.
+static inline bool EdgeVisible(Graph g, const ListItem *l, const EdgeItem *e,
+                               bool in) {
+  return g->view == NULL || ViewShowsEdge(g, l, e, in);
+}
+
+// Returns the number of edges of l the Graph shows.
+static inline int VisibleDegree(Graph g, const ListItem *l) {
+  return g->view == NULL ? l->count : ViewDegree(g, l);
+}
+
+#endif
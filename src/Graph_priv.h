@@ -6,7 +6,12 @@
 #ifndef _GRAPH_PRIV_H_
 #define _GRAPH_PRIV_H_
 
+#include <limits.h>
+#include <stdint.h>
+
 #include "./Graph.h"
+#include "./GraphAlloc_priv.h"
+#include "./VertexIndex.h"
 
 // For any given vertex, we want to represent the vertices to which it
 // has edges to, and the weights of those connections. We encapsulate
@@ -14,23 +19,50 @@
 // vertex/weight pairs, along with references to the next item in the list.
 // Thus we can easily encapsulate the outgoing edges for any vertex by
 // constructing a chain of EdgeItems.
+//
+// The fields present depend on the Graph's specialization (see Graph.h): an
+// unweighted Graph has no weight field, and payloads are only present when
+// they have a size. Code outside this file should go through EdgeWeight and
+// SetEdgeWeight rather than touch the weight directly. The small fields come
+// first, so that they share the padding ahead of the pointer.
 typedef struct EdgeItem {
   GVertex_t         data;
-  int               weight;
+#if GRAPH_WEIGHT != GRAPH_WEIGHT_NONE
+  GWeight_t         weight;
+#endif
+#if GRAPH_EDGE_PAYLOAD > 0
+  unsigned char     payload[GRAPH_EDGE_PAYLOAD];
+#endif
   struct EdgeItem  *next;
 } EdgeItem;
 
 // A listitem is composed of:
 //
 // 1. A Vertex (as represented by its data value).
-// 2. The list of vertices that vertex has edges to.
-// 3. The count of vertices that vertex has edges to. 
+// 2. The count of vertices that vertex has edges to. 
+// 3. The list of vertices that vertex has edges to.
 // 4. A pointer to the next item in the list.
+// 5. In a directed Graph, the list of vertices with edges to this vertex,
+//    once the Graph's in-adjacency has been built (see EnsureInAdjacency).
+//    Otherwise NULL.
+// 6. A dense id: the vertex's position in the list. Since vertices are
+//    only ever removed from the back of the list (see TruncateVertices),
+//    the ids of a Graph with n vertices are exactly 0 to n - 1, so code
+//    keeping per-vertex state can use plain arrays.
+// 7. The vertex's payload, if vertices carry one.
+//
+// With 32 bit vertices the vertex and count share one word. In a directed
+// Graph, neighbors and count describe the edges leaving the vertex.
 typedef struct ListItem {
   GVertex_t         data;
-  EdgeItem         *neighbors;
   int               count;   
+  EdgeItem         *neighbors;
   struct ListItem  *next;
+  EdgeItem         *inNeighbors;
+  int               id;
+#if GRAPH_VERTEX_PAYLOAD > 0
+  unsigned char     payload[GRAPH_VERTEX_PAYLOAD];
+#endif
 } ListItem;
 
 // A Graph represented as an adjacency list is a list of vertices and the 
@@ -38,13 +70,162 @@ typedef struct ListItem {
 // List of Linked Lists. We store a reference to the front and the back
 // of the list of vertices.
 //
-// In practice, we would probably prefer to have a Hash
-// Table of vertices for better perf. However, since this project is mostly
-// for learning and will not be operating on large data sets, the overhead
-// involved to implement a Hash Table is not worth it.
+// Finding a vertex by walking the list takes time linear in the size of the
+// Graph, so we also keep a hash index from each vertex to its ListItem (see
+// VertexIndex.h). The list remains the canonical set of vertices; the index
+// only speeds up finding them.
+//
+// Vertices and edges are normally allocated one at a time. A Graph built in
+// bulk (see GraphBuilder.h) instead carves them out of two large slabs, one
+// for ListItems and one for EdgeItems. Items inside a slab are never freed
+// individually; the slabs are released along with the Graph.
+//
+// An undirected edge {V1,V2} is stored twice, once in each vertex's edge
+// list. A directed edge from V1 to V2 is stored once, in V1's list. Most
+// directed workloads never ask which vertices have edges to a vertex, so the
+// reverse lists (the in-adjacency) are only built on first use, all at once
+// into a slab of their own. After that they are kept up to date along with
+// the forward lists.
+//
+// A Graph may also keep a weight index (see WeightIndex_priv.h): a copy of
+// each vertex's edges ordered by weight, which the mutations keep in step
+// with the lists.
+//
+// A Graph may also be a view of another (see GraphView_priv.h): a copy of
+// that Graph's header sharing its lists, with filters that hide some of
+// its vertices and edges.
+//
+// Everything the Graph holds is allocated through its memory accounts (see
+// GraphAlloc_priv.h), and must be freed with its size. The edge slabs hold
+// one item more than their counts, so that they are never empty.
+//
+// Alongside the list we keep the counters reported by GetGraphSummary, which
+// every mutation updates as it goes:
+//
+// 1. The number of vertices and edges (each undirected edge counted once).
+// 2. The minimum and maximum vertex degree (out-degree, if directed).
+// 3. A table of how many vertices have each degree, which is what lets us
+//    keep the minimum and maximum exact, and a log-bucketed histogram of
+//    the same, which is what GetGraphSummary reports.
+//
+// Each Graph (and each view) also gets a serial number no other Graph in the
+// process shares, and counts the mutations made to it, so that state
+// derived from a Graph, such as landmark tables, can tell whether it still
+// describes the Graph it is used with.
 typedef struct graphimpl {
-  ListItem *front;
-  ListItem *back;
+  ListItem    *front;
+  ListItem    *back;
+  VertexIndex  index;
+  GraphMemory  memory;
+
+  ListItem    *vertexSlab;
+  size_t       vertexSlabCount;
+  EdgeItem    *edgeSlab;
+  size_t       edgeSlabCount;
+
+  bool         directed;
+  bool         hasInEdges;
+  EdgeItem    *inEdgeSlab;
+  size_t       inEdgeSlabCount;
+
+  struct weightindex *weightIndex;  // see WeightIndex.h, or NULL
+  struct graphview   *view;         // see GraphView.h, or NULL
+
+  uint64_t     serial;     // unique to this Graph
+  uint64_t     mutations;  // bumped by every change to its vertices or edges
+
+  int          numVertices;
+  long         numEdges;
+  int          minDegree;
+  int          maxDegree;
+  int         *degreeCounts;
+  int          degreeCapacity;
+  long         degreeHistogram[GRAPH_DEGREE_BUCKETS];
 } GraphImplementation;
 
+// Returns the weight of the given edge.
+static inline GWeight_t EdgeWeight(const EdgeItem *e) {
+#if GRAPH_WEIGHT != GRAPH_WEIGHT_NONE
+  return e->weight;
+#else
+  (void)e;
+  return 1;
+#endif
+}
+
+// Returns the sum of two non-negative weights, such as a distance and the
+// weight of the next edge. Integer sums saturate at INT_MAX rather than
+// overflow.
+static inline GWeight_t AddWeights(GWeight_t a, GWeight_t b) {
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_FLOAT
+  return a + b;
+#else
+  GWeight_t sum;
+
+  return __builtin_add_overflow(a, b, &sum) ? INT_MAX : sum;
+#endif
+}
+
+// Sets the weight of the given edge. Does nothing in an unweighted Graph.
+static inline void SetEdgeWeight(EdgeItem *e, GWeight_t w) {
+#if GRAPH_WEIGHT != GRAPH_WEIGHT_NONE
+  e->weight = w;
+#else
+  (void)e;
+  (void)w;
+#endif
+}
+
+// Looks the given vertex up in the Graph's index. Returns a reference to
+// that vertex if it exists. Otherwise, returns NULL.
+ListItem *FindVertex(Graph g, GVertex_t v);
+
+// Returns a serial number no Graph has had before.
+uint64_t NewGraphSerial();
+
+// Appends a new vertex with no edges, without checking whether it is
+// already in the Graph. Returns NULL if an out of memory error occurs.
+ListItem *AppendVertex(Graph g, GVertex_t v);
+
+// Removes every vertex after back, which must have no edges, rolling back
+// the vertices appended by an operation that later failed.
+void TruncateVertices(Graph g, ListItem *back);
+
+// Updates the degree counters for a vertex whose degree changed by one
+// (see Graph.c).
+void NoteDegreeChange(Graph g, int from, int to);
+
+// Releases the memory associated with an unlinked edge, unless it lives in
+// a slab.
+void ReleaseEdge(Graph g, EdgeItem *edge);
+
+// Makes sure the degree table can count vertices of the given degree,
+// growing it if necessary. Returns false if an out of memory error occurs.
+bool EnsureDegreeCapacity(Graph g, int degree);
+
+// Returns the degree histogram bucket for the given degree.
+int DegreeBucket(int degree);
+
+// Estimates the number of bytes the system allocator really uses to satisfy
+// a request of the given size (see Graph.c).
+size_t AllocatedSize(size_t size);
+
+// Builds the in-adjacency of a directed Graph, if it is not built already.
+// Does nothing for an undirected Graph, where every edge list already holds
+// both directions. For a view, builds the in-adjacency of the Graph it
+// views, which it shares. Returns false if an out of memory error occurs,
+// in which case the Graph is unchanged.
+bool EnsureInAdjacency(Graph g);
+
+// Returns true if the given edge lives in one of the Graph's edge slabs.
+static inline bool InEdgeSlab(Graph g, EdgeItem *e) {
+  return (e >= g->edgeSlab && e < g->edgeSlab + g->edgeSlabCount) ||
+    (e >= g->inEdgeSlab && e < g->inEdgeSlab + g->inEdgeSlabCount);
+}
+
+// Returns true if the given vertex lives in the Graph's vertex slab.
+static inline bool InVertexSlab(Graph g, ListItem *l) {
+  return l >= g->vertexSlab && l < g->vertexSlab + g->vertexSlabCount;
+}
+
 #endif
@@ -0,0 +1,309 @@
+// Implementation of k-hop neighborhood queries.
+//
+// A query is a breadth-first search that runs one round per hop. Round r
+// expands the frontier left by round r - 1, and so finds the shortest
+// distances over paths of at most r edges (this is Bellman-Ford, cut off
+// after k rounds). A vertex whose distance improves is queued for the next
+// round even if it was reached earlier, since the better distance may
+// improve its own neighbors in turn.
+//
+// Each frontier entry carries the distance its vertex had when it was
+// queued, and is updated in place if the distance improves again in the
+// same round. Expanding a round therefore only ever sees distances from the
+// rounds before it, and never extends a path beyond k edges.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./Neighborhood.h"
+#include "./GraphBuilder.h"
+#include "./Graph_priv.h"
+#include "./GraphStats_priv.h"
+#include "./GraphView_priv.h"
+
+// A vertex waiting to be expanded, and its distance when it was queued.
+typedef struct FrontierEntry {
+  ListItem  *item;
+  GWeight_t  distance;
+} FrontierEntry;
+
+// A thread's working state. The per-vertex arrays are indexed by vertex
+// id, and an entry is only meaningful if seen holds the current epoch.
+typedef struct Scratch {
+  int            capacity;  // number of vertices the arrays hold
+  unsigned int   epoch;
+  unsigned int  *seen;      // epoch in which each vertex was last reached
+  int           *slot;      // each vertex's place in results
+  int           *queuedIn;  // the round each vertex was last queued in
+  int           *queuedAt;  // and its place in that round's frontier
+  HopVertex     *results;
+  ListItem     **items;     // the ListItem of each result
+  FrontierEntry *frontier;
+  FrontierEntry *nextFrontier;
+} Scratch;
+
+static pthread_once_t scratchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchKey;
+static __thread Scratch *local = NULL;
+
+// Helper function declarations
+void FreeScratch(void *arg);
+void CreateScratchKey();
+Scratch *ReserveScratch(int vertices);
+void Reach(Scratch *s, ListItem *x, int hops, GWeight_t distance,
+           int *count);
+void Queue(Scratch *s, ListItem *x, int round, GWeight_t distance,
+           int *queued);
+int Explore(Graph g, ListItem *source, int k);
+
+void FreeScratch(void *arg) {
+  Scratch *s = (Scratch *)arg;
+
+  free(s->seen);
+  free(s->slot);
+  free(s->queuedIn);
+  free(s->queuedAt);
+  free(s->results);
+  free(s->items);
+  free(s->frontier);
+  free(s->nextFrontier);
+  free(s);
+}
+
+void CreateScratchKey() {
+  pthread_key_create(&scratchKey, FreeScratch);
+}
+
+// Returns the calling thread's scratch space, grown to hold the given
+// number of vertices if necessary. Returns NULL on memory error, in which
+// case the thread's existing scratch space is left as it was.
+Scratch *ReserveScratch(int vertices) {
+  Scratch *s, grown;
+  int capacity;
+
+  pthread_once(&scratchOnce, CreateScratchKey);
+  if (local == NULL) {
+    s = (Scratch *)calloc(1, sizeof(Scratch));
+    if (s == NULL || pthread_setspecific(scratchKey, s) != 0) {
+      free(s);
+      return NULL;
+    }
+    local = s;
+  }
+  s = local;
+  if (vertices <= s->capacity) {
+    return s;
+  }
+
+  capacity = (s->capacity == 0) ? 64 : s->capacity;
+  while (capacity < vertices) {
+    capacity *= 2;
+  }
+
+  // nothing carries over from one query to the next, so there is no need
+  // to realloc, and a fresh seen array restarts the epochs
+  memset(&grown, 0, sizeof(Scratch));
+  grown.capacity = capacity;
+  grown.seen = (unsigned int *)calloc(capacity, sizeof(unsigned int));
+  grown.slot = (int *)malloc(sizeof(int) * capacity);
+  grown.queuedIn = (int *)malloc(sizeof(int) * capacity);
+  grown.queuedAt = (int *)malloc(sizeof(int) * capacity);
+  grown.results = (HopVertex *)malloc(sizeof(HopVertex) * capacity);
+  grown.items = (ListItem **)malloc(sizeof(ListItem *) * capacity);
+  grown.frontier = (FrontierEntry *)malloc(sizeof(FrontierEntry) * capacity);
+  grown.nextFrontier =
+    (FrontierEntry *)malloc(sizeof(FrontierEntry) * capacity);
+  if (grown.seen == NULL || grown.slot == NULL || grown.queuedIn == NULL ||
+      grown.queuedAt == NULL || grown.results == NULL ||
+      grown.items == NULL || grown.frontier == NULL ||
+      grown.nextFrontier == NULL) {
+    free(grown.seen);
+    free(grown.slot);
+    free(grown.queuedIn);
+    free(grown.queuedAt);
+    free(grown.results);
+    free(grown.items);
+    free(grown.frontier);
+    free(grown.nextFrontier);
+    return NULL;
+  }
+
+  free(s->seen);
+  free(s->slot);
+  free(s->queuedIn);
+  free(s->queuedAt);
+  free(s->results);
+  free(s->items);
+  free(s->frontier);
+  free(s->nextFrontier);
+  *s = grown;
+  return s;
+}
+
+// Marks x as reached for the first time, and adds it to the results.
+void Reach(Scratch *s, ListItem *x, int hops, GWeight_t distance,
+           int *count) {
+  s->seen[x->id] = s->epoch;
+  s->slot[x->id] = *count;
+  s->queuedIn[x->id] = -1;
+  s->results[*count].v = x->data;
+  s->results[*count].hops = hops;
+  s->results[*count].distance = distance;
+  s->items[*count] = x;
+  (*count)++;
+}
+
+// Queues x for expansion in the next round, or if it is already queued
+// for it, updates the distance it will be expanded with.
+void Queue(Scratch *s, ListItem *x, int round, GWeight_t distance,
+           int *queued) {
+  if (s->queuedIn[x->id] == round) {
+    s->nextFrontier[s->queuedAt[x->id]].distance = distance;
+    return;
+  }
+  s->queuedIn[x->id] = round;
+  s->queuedAt[x->id] = *queued;
+  s->nextFrontier[*queued].item = x;
+  s->nextFrontier[*queued].distance = distance;
+  (*queued)++;
+}
+
+// Runs a query from the given vertex in the calling thread's scratch space,
+// which must already hold the whole Graph. Returns the number of vertices
+// reached.
+int Explore(Graph g, ListItem *source, int k) {
+  Scratch *s = local;
+  FrontierEntry *swap;
+  ListItem *x;
+  EdgeItem *edge;
+  GWeight_t d;
+  int count = 0, current = 1, queued, round, i, slot;
+
+  s->epoch++;
+  if (s->epoch == 0) {
+    // the epochs wrapped around, so old marks could look current
+    memset(s->seen, 0, sizeof(unsigned int) * s->capacity);
+    s->epoch = 1;
+  }
+
+  Reach(s, source, 0, 0, &count);
+  s->frontier[0].item = source;
+  s->frontier[0].distance = 0;
+
+  for (round = 1; round <= k && current > 0; round++) {
+    queued = 0;
+    for (i = 0; i < current; i++) {
+      for (edge = s->frontier[i].item->neighbors; edge != NULL;
+           edge = edge->next) {
+        if (!EdgeVisible(g, s->frontier[i].item, edge, false)) {
+          continue;
+        }
+        x = FindVertex(g, edge->data);
+        d = AddWeights(s->frontier[i].distance, EdgeWeight(edge));
+
+        if (s->seen[x->id] != s->epoch) {
+          Reach(s, x, round, d, &count);
+        } else {
+          slot = s->slot[x->id];
+          if (d >= s->results[slot].distance) {
+            continue;
+          }
+          s->results[slot].distance = d;
+        }
+        // nothing expands the last round's frontier
+        if (round < k) {
+          Queue(s, x, round, d, &queued);
+        }
+      }
+    }
+
+    swap = s->frontier;
+    s->frontier = s->nextFrontier;
+    s->nextFrontier = swap;
+    current = queued;
+  }
+
+  return count;
+}
+
+int GetKHopNeighborhood(Graph g, GVertex_t v, int k, const HopVertex **out) {
+  ListItem *source;
+  int count;
+  STATS_TIME_OP(GRAPH_OP_K_HOP);
+
+  source = FindVertex(g, v);
+  if (source == NULL) {
+    return -1;
+  }
+  if (ReserveScratch(g->numVertices) == NULL) {
+    return -2;
+  }
+
+  count = Explore(g, source, k);
+  *out = local->results;
+  return count;
+}
+
+Graph ExtractKHopSubgraph(Graph g, GVertex_t v, int k) {
+  GraphEdge *edges, *grown;
+  const HopVertex *hood;
+  ListItem *x;
+  EdgeItem *edge;
+  Graph sub;
+  size_t n = 0, capacity = 16;
+  int count, i;
+
+  count = GetKHopNeighborhood(g, v, k, &hood);
+  if (count < 0) {
+    return NULL;
+  }
+
+  // gather the edges between vertices in the neighborhood, taking each
+  // undirected edge from its smaller endpoint only
+  edges = (GraphEdge *)malloc(sizeof(GraphEdge) * capacity);
+  if (edges == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < count; i++) {
+    for (edge = local->items[i]->neighbors; edge != NULL; edge = edge->next) {
+      if ((!g->directed && edge->data < hood[i].v) ||
+          !EdgeVisible(g, local->items[i], edge, false)) {
+        continue;
+      }
+      x = FindVertex(g, edge->data);
+      if (local->seen[x->id] != local->epoch) {
+        continue;
+      }
+      if (n == capacity) {
+        capacity *= 2;
+        grown = (GraphEdge *)realloc(edges, sizeof(GraphEdge) * capacity);
+        if (grown == NULL) {
+          free(edges);
+          return NULL;
+        }
+        edges = grown;
+      }
+      edges[n].v1 = hood[i].v;
+      edges[n].v2 = edge->data;
+      edges[n].weight = EdgeWeight(edge);
+      n++;
+    }
+  }
+
+  sub = g->directed ? BuildDirectedGraphParallel(edges, n, 1) :
+    BuildGraphParallel(edges, n, 1);
+  free(edges);
+  if (sub == NULL) {
+    return NULL;
+  }
+
+  // the builder only knows about vertices with edges
+  for (i = 0; i < count; i++) {
+    if (AddVertex(sub, hood[i].v) == -1) {
+      FreeGraph(sub);
+      return NULL;
+    }
+  }
+  return sub;
+}
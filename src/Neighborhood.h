@@ -0,0 +1,73 @@
+// k-hop neighborhood queries.
+//
+// The k-hop neighborhood of a vertex v is every vertex reachable from v by
+// a path of at most k edges. Exploring it with GetNeighbors costs an
+// allocation per vertex expanded. These queries instead keep their working
+// state (visited marks, distances and frontiers) in arrays owned by the
+// calling thread, indexed by each vertex's dense id. The arrays are reused
+// from one query to the next: marks are stamped with a per-query epoch, so
+// nothing needs clearing between queries. Once a thread's arrays have
+// grown to the size of the largest Graph it queries, its queries allocate
+// nothing at all.
+//
+// The arrays take a few dozen bytes per vertex of the largest Graph queried,
+// for each thread that queries. They are released when the thread exits.
+//
+// Like the rest of the Graph API, a query must not run concurrently with
+// mutations of the same Graph, but any number of threads may query at once.
+
+#ifndef _NEIGHBORHOOD_H_
+#define _NEIGHBORHOOD_H_
+
+#include "./Graph.h"
+
+// A vertex in a k-hop neighborhood.
+//
+//    -- v         the vertex.
+//    -- hops      the fewest edges on any path to v from the source.
+//    -- distance  the least total weight of any path to v from the source
+//                 with at most k edges. This path may have more edges than
+//                 hops does.
+typedef struct HopVertex {
+  GVertex_t v;
+  int       hops;
+  GWeight_t distance;
+} HopVertex;
+
+// Finds every vertex within k hops of the given vertex. In a directed Graph,
+// paths follow the direction of the edges.
+//
+// Arguments:
+//
+//    -- g    the Graph to query.
+//    -- v    the vertex to start from.
+//    -- k    the most edges a path may have. Must be non-negative.
+//    -- out  location to store the neighborhood in.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if the passed vertex isn't in the Graph,
+//    otherwise the number of vertices in the neighborhood.
+//
+// In the latter case, places an array of that many HopVertex in out, in
+// order of increasing hops. The first is v itself, at 0 hops and distance 0.
+// The array belongs to the calling thread, and is only valid until its next
+// neighborhood query.
+int GetKHopNeighborhood(Graph g, GVertex_t v, int k, const HopVertex **out);
+
+// Extracts the subgraph induced by the k-hop neighborhood of a vertex: the
+// vertices within k hops of v, and every edge of g between two of them.
+// The subgraph is a new Graph, directed if g is, and is stored compactly
+// (see GraphBuilder.h). It belongs to the caller.
+//
+// Arguments:
+//
+//    -- g    the Graph to query.
+//    -- v    the vertex to start from.
+//    -- k    the most edges a path may have. Must be non-negative.
+//
+// Returns the subgraph, or NULL if v isn't in the Graph or on memory error.
+Graph ExtractKHopSubgraph(Graph g, GVertex_t v, int k);
+
+#endif
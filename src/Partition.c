@@ -0,0 +1,380 @@
+// Implementation of Graph partitioning.
+//
+// A partition made by hashing needs no state at all. One made by the
+// greedy method records each vertex's owner in a pair of arrays sorted by
+// vertex, and falls back on the hash for vertices it does not know.
+//
+// The per-vertex work arrays used here are indexed by each vertex's dense
+// id (see Graph_priv.h).
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./Partition.h"
+#include "./GraphBuilder.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+struct graphpartition {
+  int             shards;
+  bool            directed;
+  int             n;
+  GVertex_t      *vertices;  // sorted
+  int            *owners;    // the owner of each of vertices
+};
+
+// A vertex and the shard it was placed on, for sorting.
+typedef struct Placement {
+  GVertex_t v;
+  int       owner;
+} Placement;
+
+// Helper function declarations
+int HashOwner(GraphPartition p, GVertex_t v);
+bool PlaceGreedily(Graph g, GraphPartition p);
+int *OwnersById(Graph g, GraphPartition p);
+int ComparePlacements(const void *a, const void *b);
+
+GraphPartition PartitionGraph(Graph g, int shards, PartitionMethod method) {
+  GraphPartition p;
+
+  p = (GraphPartition)calloc(1, sizeof(struct graphpartition));
+  if (p == NULL) {
+    return NULL;
+  }
+  p->shards = shards;
+  p->directed = g->directed;
+  if (method == PARTITION_LDG && shards > 1 && !PlaceGreedily(g, p)) {
+    FreePartition(p);
+    return NULL;
+  }
+  return p;
+}
+
+void FreePartition(GraphPartition p) {
+  free(p->vertices);
+  free(p->owners);
+  free(p);
+}
+
+int PartitionShards(GraphPartition p) {
+  return p->shards;
+}
+
+bool IsDirectedPartition(GraphPartition p) {
+  return p->directed;
+}
+
+int PartitionOwner(GraphPartition p, GVertex_t v) {
+  int lo = 0, hi = p->n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (p->vertices[mid] < v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < p->n && p->vertices[lo] == v) {
+    return p->owners[lo];
+  }
+  return HashOwner(p, v);
+}
+
+Graph ExtractShard(Graph g, GraphPartition p, int shard, ShardGhost **ghosts,
+                   int *count) {
+  GraphEdge *edges = NULL, *grownEdges;
+  ShardGhost *found = NULL, *grownGhosts;
+  size_t n = 0, edgeCapacity = 0;
+  int numGhosts = 0, ghostCapacity = 0;
+  int *owner, *seen;
+  ListItem *item, *far;
+  EdgeItem *e;
+  Graph sub;
+
+  owner = OwnersById(g, p);
+  seen = (int *)calloc(g->numVertices + 1, sizeof(int));
+  if (owner == NULL || seen == NULL) {
+    goto fail;
+  }
+
+  // gather the owned vertices' edges, taking an undirected edge between two
+  // owned vertices from its smaller endpoint only, and note each ghost
+  for (item = g->front; item != NULL; item = item->next) {
+    if (owner[item->id] != shard || !VertexVisible(g, item)) {
+      continue;
+    }
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, item, e, false)) {
+        continue;
+      }
+      far = FindVertex(g, e->data);
+      if (owner[far->id] == shard && !g->directed && e->data < item->data) {
+        continue;
+      }
+      if (n == edgeCapacity) {
+        edgeCapacity = (edgeCapacity == 0) ? 64 : 2 * edgeCapacity;
+        grownEdges = (GraphEdge *)realloc(edges,
+                                          sizeof(GraphEdge) * edgeCapacity);
+        if (grownEdges == NULL) {
+          goto fail;
+        }
+        edges = grownEdges;
+      }
+      edges[n].v1 = item->data;
+      edges[n].v2 = e->data;
+      edges[n].weight = EdgeWeight(e);
+      n++;
+
+      if (owner[far->id] != shard && !seen[far->id]) {
+        seen[far->id] = 1;
+        if (numGhosts == ghostCapacity) {
+          ghostCapacity = (ghostCapacity == 0) ? 16 : 2 * ghostCapacity;
+          grownGhosts = (ShardGhost *)realloc(found, sizeof(ShardGhost) *
+                                              ghostCapacity);
+          if (grownGhosts == NULL) {
+            goto fail;
+          }
+          found = grownGhosts;
+        }
+        found[numGhosts].v = far->data;
+        found[numGhosts].owner = owner[far->id];
+        numGhosts++;
+      }
+    }
+  }
+
+  sub = g->directed ? BuildDirectedGraphParallel(edges, n, 1) :
+    BuildGraphParallel(edges, n, 1);
+  if (sub == NULL) {
+    goto fail;
+  }
+  // the builder only knows about vertices with edges
+  for (item = g->front; item != NULL; item = item->next) {
+    if (owner[item->id] == shard && VertexVisible(g, item) &&
+        AddVertex(sub, item->data) == -1) {
+      FreeGraph(sub);
+      goto fail;
+    }
+  }
+
+  free(edges);
+  free(owner);
+  free(seen);
+  if (ghosts != NULL) {
+    *ghosts = found;
+  } else {
+    free(found);
+  }
+  if (count != NULL) {
+    *count = numGhosts;
+  }
+  return sub;
+
+fail:
+  free(edges);
+  free(found);
+  free(owner);
+  free(seen);
+  return NULL;
+}
+
+int GetPartitionSummary(Graph g, GraphPartition p, PartitionSummary *out) {
+  int *owner, *sizes, *seen;
+  ListItem *item, *far;
+  EdgeItem *e;
+  int s;
+
+  memset(out, 0, sizeof(PartitionSummary));
+  out->shards = p->shards;
+
+  owner = OwnersById(g, p);
+  sizes = (int *)calloc(p->shards, sizeof(int));
+  seen = (int *)calloc(g->numVertices + 1, sizeof(int));
+  if (owner == NULL || sizes == NULL || seen == NULL) {
+    free(owner);
+    free(sizes);
+    free(seen);
+    return -1;
+  }
+
+  // count the edges as they are walked, as a view shows only some
+  for (item = g->front; item != NULL; item = item->next) {
+    if (!VertexVisible(g, item)) {
+      continue;
+    }
+    sizes[owner[item->id]]++;
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, item, e, false)) {
+        continue;
+      }
+      out->edges++;
+      far = FindVertex(g, e->data);
+      if (owner[far->id] != owner[item->id]) {
+        out->edgeCut++;
+      }
+    }
+  }
+  if (!g->directed) {
+    // each undirected edge was seen from both ends
+    out->edges /= 2;
+    out->edgeCut /= 2;
+  }
+
+  // a vertex is a ghost in each shard, other than its own, that owns one
+  // of the vertices with an edge to it; seen holds the last shard (plus 1)
+  // that counted it
+  for (s = 0; s < p->shards; s++) {
+    for (item = g->front; item != NULL; item = item->next) {
+      if (owner[item->id] != s || !VertexVisible(g, item)) {
+        continue;
+      }
+      for (e = item->neighbors; e != NULL; e = e->next) {
+        if (!EdgeVisible(g, item, e, false)) {
+          continue;
+        }
+        far = FindVertex(g, e->data);
+        if (owner[far->id] != s && seen[far->id] != s + 1) {
+          seen[far->id] = s + 1;
+          out->ghosts++;
+        }
+      }
+    }
+  }
+
+  out->minVertices = out->maxVertices = sizes[0];
+  for (s = 1; s < p->shards; s++) {
+    if (sizes[s] < out->minVertices) {
+      out->minVertices = sizes[s];
+    }
+    if (sizes[s] > out->maxVertices) {
+      out->maxVertices = sizes[s];
+    }
+  }
+
+  free(owner);
+  free(sizes);
+  free(seen);
+  return 0;
+}
+
+// Returns the shard a vertex hashes to.
+int HashOwner(GraphPartition p, GVertex_t v) {
+  // Fibonacci hashing, as in VertexIndex.h, keeping the top 32 bits
+  uint64_t h = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+  return (int)((h >> 32) % (uint64_t)p->shards);
+}
+
+// Places every vertex of the Graph by linear deterministic greedy, and
+// records the placements in the partition. Each vertex goes to the shard
+// maximizing
+//
+//    (neighbors already on the shard) * (1 - shard size / capacity)
+//
+// where the capacity is an even share of the vertices, and full shards are
+// passed over. Ties, including the vertices with no placed neighbors, go
+// to the smaller shard. Returns false on memory error.
+bool PlaceGreedily(Graph g, GraphPartition p) {
+  Placement *placed;
+  ListItem *item;
+  EdgeItem *e;
+  int *owner, *sizes, *votes;
+  int n = g->numVertices, shown = 0, capacity, best, s, i;
+  double score, bestScore;
+
+  owner = (int *)malloc(sizeof(int) * (n + 1));
+  sizes = (int *)calloc(p->shards, sizeof(int));
+  votes = (int *)calloc(p->shards, sizeof(int));
+  placed = (Placement *)malloc(sizeof(Placement) * (n + 1));
+  p->vertices = (GVertex_t *)malloc(sizeof(GVertex_t) * (n + 1));
+  p->owners = (int *)malloc(sizeof(int) * (n + 1));
+  if (owner == NULL || sizes == NULL || votes == NULL || placed == NULL ||
+      p->vertices == NULL || p->owners == NULL) {
+    free(owner);
+    free(sizes);
+    free(votes);
+    free(placed);
+    return false;
+  }
+  for (i = 0; i < n; i++) {
+    owner[i] = -1;
+  }
+  // a view places only the vertices it shows
+  for (item = g->front; item != NULL; item = item->next) {
+    shown += VertexVisible(g, item);
+  }
+  capacity = (shown + p->shards - 1) / p->shards;
+
+  i = 0;
+  for (item = g->front; item != NULL; item = item->next) {
+    if (!VertexVisible(g, item)) {
+      continue;
+    }
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, item, e, false)) {
+        continue;
+      }
+      s = owner[FindVertex(g, e->data)->id];
+      if (s != -1) {
+        votes[s]++;
+      }
+    }
+
+    best = -1;
+    bestScore = 0;
+    for (s = 0; s < p->shards; s++) {
+      if (sizes[s] >= capacity) {
+        continue;
+      }
+      score = votes[s] * (1.0 - (double)sizes[s] / capacity);
+      if (best == -1 || score > bestScore ||
+          (score == bestScore && sizes[s] < sizes[best])) {
+        best = s;
+        bestScore = score;
+      }
+    }
+    memset(votes, 0, sizeof(int) * p->shards);
+
+    owner[item->id] = best;
+    sizes[best]++;
+    placed[i].v = item->data;
+    placed[i].owner = best;
+    i++;
+  }
+
+  qsort(placed, shown, sizeof(Placement), ComparePlacements);
+  for (i = 0; i < shown; i++) {
+    p->vertices[i] = placed[i].v;
+    p->owners[i] = placed[i].owner;
+  }
+  p->n = shown;
+
+  free(owner);
+  free(sizes);
+  free(votes);
+  free(placed);
+  return true;
+}
+
+// Returns an array holding the owner of each of the Graph's vertices,
+// indexed by id, or NULL on memory error.
+int *OwnersById(Graph g, GraphPartition p) {
+  ListItem *item;
+  int *owner;
+
+  owner = (int *)malloc(sizeof(int) * (g->numVertices + 1));
+  if (owner == NULL) {
+    return NULL;
+  }
+  for (item = g->front; item != NULL; item = item->next) {
+    owner[item->id] = PartitionOwner(p, item->data);
+  }
+  return owner;
+}
+
+int ComparePlacements(const void *a, const void *b) {
+  GVertex_t x = ((const Placement *)a)->v, y = ((const Placement *)b)->v;
+  return (x > y) - (x < y);
+}
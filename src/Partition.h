@@ -0,0 +1,109 @@
+// Splitting a Graph into shards, so that a Graph too large for one process
+// can be served by several (see ShardCluster.h).
+//
+// Every vertex is owned by exactly one shard. A shard holds its vertices
+// with all of their edges, so any query about a single vertex can be
+// answered by its owner alone. An edge whose endpoints have different
+// owners is cut: each side keeps a copy, and the far endpoint appears in
+// the shard as a ghost vertex, a placeholder owned by another shard.
+//
+// Two methods assign vertices to shards:
+//
+//    -- PARTITION_HASH  hashes each vertex. Needs no state, and balances
+//                       well, but cuts most edges of any graph with local
+//                       structure.
+//    -- PARTITION_LDG   linear deterministic greedy: streams the vertices
+//                       once, placing each on the shard that already holds
+//                       most of its neighbors, discounted by how full that
+//                       shard is. Cuts far fewer edges for little more work,
+//                       but must remember where every vertex went.
+//
+// Vertices the partition has never seen (those added after partitioning)
+// are placed by hash under either method.
+
+#ifndef _PARTITION_H_
+#define _PARTITION_H_
+
+#include <stdbool.h>
+
+#include "./Graph.h"
+
+struct graphpartition;
+typedef struct graphpartition *GraphPartition;
+
+typedef enum PartitionMethod {
+  PARTITION_HASH,
+  PARTITION_LDG
+} PartitionMethod;
+
+// A vertex that appears in a shard without being owned by it.
+typedef struct ShardGhost {
+  GVertex_t v;
+  int       owner;
+} ShardGhost;
+
+// How well a partition splits a Graph.
+//
+//    -- shards        the number of shards.
+//    -- edgeCut       the number of edges whose endpoints have different
+//                     owners.
+//    -- edges         the number of edges in the Graph.
+//    -- minVertices   the fewest vertices owned by any shard.
+//    -- maxVertices   the most vertices owned by any shard.
+//    -- ghosts        the number of ghost vertices across all shards.
+typedef struct PartitionSummary {
+  int  shards;
+  long edgeCut;
+  long edges;
+  int  minVertices;
+  int  maxVertices;
+  long ghosts;
+} PartitionSummary;
+
+// Partitions a Graph.
+//
+// Arguments:
+//
+//    -- g        the Graph to partition. In a directed Graph, the greedy
+//                method looks at the edges leaving each vertex only.
+//    -- shards   the number of shards. Must be positive.
+//    -- method   how to assign the vertices.
+//
+// Returns the partition, or NULL on memory error. The partition does not
+// refer to the Graph once made.
+GraphPartition PartitionGraph(Graph g, int shards, PartitionMethod method);
+
+// Frees a partition.
+void FreePartition(GraphPartition p);
+
+// Returns the number of shards.
+int PartitionShards(GraphPartition p);
+
+// Returns true if the partitioned Graph was directed.
+bool IsDirectedPartition(GraphPartition p);
+
+// Returns the shard that owns the given vertex.
+int PartitionOwner(GraphPartition p, GVertex_t v);
+
+// Builds one shard: a Graph holding the vertices the shard owns, all of
+// their edges, and the ghost vertices at the far end of the cut ones.
+// Payloads are not copied.
+//
+// Arguments:
+//
+//    -- g       the partitioned Graph.
+//    -- p       the partition.
+//    -- shard   which shard to build.
+//    -- ghosts  location to store the shard's ghost vertices in, or NULL.
+//               The client is responsible for free()'ing the array.
+//    -- count   location to store the number of ghosts in, or NULL.
+//
+// Returns the shard, or NULL on memory error.
+Graph ExtractShard(Graph g, GraphPartition p, int shard, ShardGhost **ghosts,
+                   int *count);
+
+// Summarizes how a partition splits the given Graph. Returns -1 on memory
+// error, 0 on success.
+int GetPartitionSummary(Graph g, GraphPartition p, PartitionSummary *out);
+
+#endif
@@ -0,0 +1,559 @@
+// Implementation of random walks and neighbor sampling.
+//
+// The sampler holds the adjacency as arrays indexed by vertex id: the
+// neighbors of id v are targets[offsets[v]] to targets[offsets[v + 1] - 1],
+// sorted by id so that node2vec's adjacency tests are binary searches. A
+// weighted sampler's alias tables run alongside: slot i of a vertex keeps
+// its own neighbor with probability keep[i], and otherwise gives way to
+// the neighbor in slot alias[i]. The tables are built by Vose's method,
+// pairing each slot below the average weight with one above it.
+//
+// One 64-bit draw serves a first order step: its high half picks the slot,
+// by multiplying rather than dividing, and its low 24 bits the comparison
+// against keep.
+//
+// Bulk generation splits the vertices between threads, each of which walks
+// from its share of the vertices round after round, filling a buffer of
+// records and writing it with pwrite at the records' place in the file.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./RandomWalk.h"
+#include "./GraphBuilder_priv.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+#define WALKS_MAGIC "GBWLK001"
+
+// magic, vertex size, walk length, walk count
+#define WALKS_HEADER_SIZE (8 + 4 + 4 + 8)
+
+// The most bytes of records a thread gathers before writing them.
+#define WALK_BUFFER (1 << 20)
+
+struct walksampler {
+  Graph       g;
+  int         n;
+  int         known;     // the Graph ids the sampler covers
+  int        *ids;       // each Graph id's sampler id, or -1, in a view;
+                         // NULL if they are the same
+  bool        weighted;
+  GVertex_t  *vertices;  // the vertex with each id
+  size_t     *offsets;   // where each id's neighbors start; n + 1
+  int        *targets;   // the ids of each id's neighbors
+  float      *keep;      // alias tables, if weighted
+  int        *alias;
+};
+
+// A neighbor and the weight of the edge to it, while a sampler is built.
+typedef struct WeightedTarget {
+  int        id;
+  GWeight_t  weight;
+} WeightedTarget;
+
+// A walk's node2vec biases, as the acceptance weights of a draw that goes
+// back, goes to a neighbor of the previous vertex, or goes further, and the
+// largest of them. All 1 for first order walks.
+typedef struct WalkBias {
+  bool    secondOrder;
+  double  back;
+  double  near;
+  double  far;
+  double  most;
+} WalkBias;
+
+// One thread's part of WriteRandomWalks.
+typedef struct WalkTask {
+  WalkSampler         s;
+  const WalkOptions  *opts;
+  int                 fd;
+  int                 threads;
+  int                 t;
+  int                 status;  // 0, or -1 or -2 as WriteRandomWalks returns
+} WalkTask;
+
+// Helper function declarations
+int CompareTargets(const void *a, const void *b);
+void BuildAliasTable(WalkSampler s, int v, const WeightedTarget *row,
+                     double *scaled, int *small, int *large);
+uint64_t NextRandom(WalkRng *rng);
+double UniformRandom(WalkRng *rng);
+int SamplerId(WalkSampler s, GVertex_t v);
+int SamplerIdOf(WalkSampler s, const ListItem *l);
+size_t SampleSlot(WalkSampler s, int v, WalkRng *rng);
+bool HasTarget(WalkSampler s, int v, int target);
+void SetWalkBias(const WalkOptions *opts, WalkBias *bias);
+int WalkFrom(WalkSampler s, int id, int length, const WalkBias *bias,
+             WalkRng *rng, GVertex_t *out);
+void WalkShare(void *arg, int t);
+void RunWalks(WalkTask *task);
+bool WriteAt(int fd, const void *buf, size_t size, off_t offset);
+
+WalkSampler AllocateWalkSampler(Graph g, bool weighted) {
+  WeightedTarget *row = NULL;
+  double *scaled = NULL;
+  int *small = NULL, *large = NULL;
+  WalkSampler s;
+  ListItem *l;
+  EdgeItem *e;
+  size_t edges = 0, i;
+  int v, most = 0;
+  bool ok;
+
+  s = (WalkSampler)calloc(1, sizeof(struct walksampler));
+  if (s == NULL) {
+    return NULL;
+  }
+  s->g = g;
+  s->n = s->known = g->numVertices;
+  s->weighted = weighted && GRAPH_WEIGHT != GRAPH_WEIGHT_NONE;
+
+  // a view's sampler covers only the vertices it shows, numbered afresh
+  if (g->view != NULL) {
+    s->ids = (int *)malloc(sizeof(int) * (s->known + 1));
+    if (s->ids == NULL) {
+      free(s);
+      return NULL;
+    }
+    s->n = 0;
+    for (l = g->front; l != NULL; l = l->next) {
+      s->ids[l->id] = VertexVisible(g, l) ? s->n++ : -1;
+    }
+  }
+  for (l = g->front; l != NULL; l = l->next) {
+    v = VisibleDegree(g, l);
+    edges += v;
+    most = (v > most) ? v : most;
+  }
+
+  s->vertices = (GVertex_t *)malloc(sizeof(GVertex_t) * (s->n + 1));
+  s->offsets = (size_t *)malloc(sizeof(size_t) * (s->n + 1));
+  s->targets = (int *)malloc(sizeof(int) * (edges + 1));
+  row = (WeightedTarget *)malloc(sizeof(WeightedTarget) * (most + 1));
+  ok = s->vertices != NULL && s->offsets != NULL && s->targets != NULL &&
+    row != NULL;
+  if (ok && s->weighted) {
+    s->keep = (float *)malloc(sizeof(float) * (edges + 1));
+    s->alias = (int *)malloc(sizeof(int) * (edges + 1));
+    scaled = (double *)malloc(sizeof(double) * (most + 1));
+    small = (int *)malloc(sizeof(int) * (most + 1));
+    large = (int *)malloc(sizeof(int) * (most + 1));
+    ok = s->keep != NULL && s->alias != NULL && scaled != NULL &&
+      small != NULL && large != NULL;
+  }
+
+  if (ok) {
+    // the sampler ids follow the Graph's, so each vertex's run of targets
+    // follows the run of the one before
+    s->offsets[0] = 0;
+    for (l = g->front; l != NULL; l = l->next) {
+      v = SamplerIdOf(s, l);
+      if (v == -1) {
+        continue;
+      }
+      s->vertices[v] = l->data;
+      i = 0;
+      for (e = l->neighbors; e != NULL; e = e->next) {
+        if (EdgeVisible(g, l, e, false)) {
+          row[i].id = SamplerIdOf(s, FindVertex(g, e->data));
+          row[i++].weight = EdgeWeight(e);
+        }
+      }
+      qsort(row, i, sizeof(WeightedTarget), CompareTargets);
+      s->offsets[v + 1] = s->offsets[v] + i;
+      for (i = 0; i < s->offsets[v + 1] - s->offsets[v]; i++) {
+        s->targets[s->offsets[v] + i] = row[i].id;
+      }
+      if (s->weighted) {
+        BuildAliasTable(s, v, row, scaled, small, large);
+      }
+    }
+  }
+
+  free(row);
+  free(scaled);
+  free(small);
+  free(large);
+  if (!ok) {
+    FreeWalkSampler(s);
+    return NULL;
+  }
+  return s;
+}
+
+void FreeWalkSampler(WalkSampler s) {
+  free(s->ids);
+  free(s->vertices);
+  free(s->offsets);
+  free(s->targets);
+  free(s->keep);
+  free(s->alias);
+  free(s);
+}
+
+void DefaultWalkOptions(WalkOptions *opts) {
+  opts->length = 80;
+  opts->walksPerVertex = 10;
+  opts->p = 1;
+  opts->q = 1;
+  opts->seed = 1;
+  opts->threads = 0;
+}
+
+// Seeds the state with splitmix64, as xoshiro's authors recommend.
+void SeedWalkRng(WalkRng *rng, uint64_t seed) {
+  uint64_t z;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    z = (seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    rng->s[i] = z ^ (z >> 31);
+  }
+}
+
+int RandomWalk(WalkSampler s, GVertex_t start, const WalkOptions *opts,
+               WalkRng *rng, GVertex_t *out) {
+  WalkBias bias;
+  int id;
+
+  id = SamplerId(s, start);
+  if (id == -1) {
+    return -1;
+  }
+  SetWalkBias(opts, &bias);
+  return WalkFrom(s, id, opts->length, &bias, rng, out);
+}
+
+int SampleNeighbors(WalkSampler s, GVertex_t v, int k, WalkRng *rng,
+                    GVertex_t *out) {
+  int id, i;
+
+  id = SamplerId(s, v);
+  if (id == -1) {
+    return -1;
+  }
+  if (s->offsets[id] == s->offsets[id + 1]) {
+    return 0;
+  }
+  for (i = 0; i < k; i++) {
+    out[i] = s->vertices[s->targets[SampleSlot(s, id, rng)]];
+  }
+  return k;
+}
+
+long WriteRandomWalks(WalkSampler s, const WalkOptions *opts,
+                      const char *path) {
+  char header[WALKS_HEADER_SIZE];
+  WalkTask *tasks;
+  uint64_t walks;
+  uint32_t u32;
+  int fd, t, threads, status = 0;
+
+  threads = GraphThreads(opts->threads);
+  tasks = (WalkTask *)malloc(sizeof(WalkTask) * threads);
+  if (tasks == NULL) {
+    return -2;
+  }
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    free(tasks);
+    return -1;
+  }
+  walks = (opts->length > 0 && opts->walksPerVertex > 0) ?
+    (uint64_t)s->n * opts->walksPerVertex : 0;
+  memcpy(header, WALKS_MAGIC, 8);
+  u32 = sizeof(GVertex_t);
+  memcpy(header + 8, &u32, 4);
+  u32 = (uint32_t)opts->length;
+  memcpy(header + 12, &u32, 4);
+  memcpy(header + 16, &walks, 8);
+
+  if (!WriteAt(fd, header, sizeof(header), 0)) {
+    status = -1;
+  } else if (walks > 0) {
+    for (t = 0; t < threads; t++) {
+      tasks[t].s = s;
+      tasks[t].opts = opts;
+      tasks[t].fd = fd;
+      tasks[t].threads = threads;
+      tasks[t].t = t;
+      tasks[t].status = 0;
+    }
+    if (!RunOnThreads(threads, WalkShare, tasks)) {
+      status = -2;
+    }
+    for (t = 0; t < threads; t++) {
+      status = (tasks[t].status < status) ? tasks[t].status : status;
+    }
+  }
+
+  if (close(fd) != 0 && status == 0) {
+    status = -1;
+  }
+  free(tasks);
+  return (status != 0) ? status : (long)walks;
+}
+
+int CompareTargets(const void *a, const void *b) {
+  int x = ((const WeightedTarget *)a)->id, y = ((const WeightedTarget *)b)->id;
+
+  return (x > y) - (x < y);
+}
+
+// Builds the alias table of id v from its neighbors and their weights, with
+// the scratch arrays given, each with room for its degree.
+void BuildAliasTable(WalkSampler s, int v, const WeightedTarget *row,
+                     double *scaled, int *small, int *large) {
+  size_t base = s->offsets[v];
+  int degree = (int)(s->offsets[v + 1] - base);
+  int ns = 0, nl = 0, i, a, b;
+  double total = 0;
+
+  for (i = 0; i < degree; i++) {
+    total += (row[i].weight > 0) ? row[i].weight : 0;
+  }
+  for (i = 0; i < degree; i++) {
+    // a vertex with no weight to go by is sampled uniformly
+    scaled[i] = (total > 0) ?
+      ((row[i].weight > 0) ? row[i].weight : 0) * degree / total : 1;
+    if (scaled[i] < 1) {
+      small[ns++] = i;
+    } else {
+      large[nl++] = i;
+    }
+  }
+
+  // each slot below the average is topped up by one above it
+  while (ns > 0 && nl > 0) {
+    a = small[--ns];
+    b = large[nl - 1];
+    s->keep[base + a] = (float)scaled[a];
+    s->alias[base + a] = b;
+    scaled[b] -= 1 - scaled[a];
+    if (scaled[b] < 1) {
+      nl--;
+      small[ns++] = b;
+    }
+  }
+  // what remains is at the average, up to rounding
+  while (nl > 0) {
+    a = large[--nl];
+    s->keep[base + a] = 1;
+    s->alias[base + a] = a;
+  }
+  while (ns > 0) {
+    a = small[--ns];
+    s->keep[base + a] = 1;
+    s->alias[base + a] = a;
+  }
+}
+
+// Returns the next number from a xoshiro256** generator.
+uint64_t NextRandom(WalkRng *rng) {
+  uint64_t *s = rng->s;
+  uint64_t result, t;
+
+  result = s[1] * 5;
+  result = ((result << 7) | (result >> 57)) * 9;
+  t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 45) | (s[3] >> 19);
+  return result;
+}
+
+// Returns a number uniformly distributed in [0, 1).
+double UniformRandom(WalkRng *rng) {
+  return (NextRandom(rng) >> 11) * 0x1.0p-53;
+}
+
+// Returns the id of a vertex the sampler covers, or -1.
+int SamplerId(WalkSampler s, GVertex_t v) {
+  ListItem *l;
+
+  l = FindVertex(s->g, v);
+  return (l == NULL) ? -1 : SamplerIdOf(s, l);
+}
+
+// Returns the sampler id of a vertex of the Graph, or -1 if the sampler
+// does not cover it.
+int SamplerIdOf(WalkSampler s, const ListItem *l) {
+  if (l->id >= s->known) {
+    return -1;
+  }
+  return (s->ids != NULL) ? s->ids[l->id] : l->id;
+}
+
+// Returns the index in targets of a neighbor of id v, which must have
+// some, drawn uniformly or by weight.
+size_t SampleSlot(WalkSampler s, int v, WalkRng *rng) {
+  uint64_t r = NextRandom(rng);
+  size_t base = s->offsets[v];
+  uint64_t degree = s->offsets[v + 1] - base;
+  size_t slot;
+
+  slot = (size_t)(((r >> 32) * degree) >> 32);
+  if (s->weighted &&
+      (float)(r & 0xFFFFFF) * (1.0f / 16777216) >= s->keep[base + slot]) {
+    slot = (size_t)s->alias[base + slot];
+  }
+  return base + slot;
+}
+
+// Returns true if target is among the neighbors of id v.
+bool HasTarget(WalkSampler s, int v, int target) {
+  size_t lo = s->offsets[v], hi = s->offsets[v + 1], mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (s->targets[mid] < target) {
+      lo = mid + 1;
+    } else if (s->targets[mid] > target) {
+      hi = mid;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Places the acceptance weights for walks with the given options in bias.
+void SetWalkBias(const WalkOptions *opts, WalkBias *bias) {
+  bias->secondOrder = opts->p != 1 || opts->q != 1;
+  bias->back = 1 / opts->p;
+  bias->near = 1;
+  bias->far = 1 / opts->q;
+  bias->most = bias->near;
+  if (bias->back > bias->most) {
+    bias->most = bias->back;
+  }
+  if (bias->far > bias->most) {
+    bias->most = bias->far;
+  }
+}
+
+// Walks from id, placing at most length vertices in out, and returns the
+// number placed.
+int WalkFrom(WalkSampler s, int id, int length, const WalkBias *bias,
+             WalkRng *rng, GVertex_t *out) {
+  int count, prev = -1, next;
+  double accept;
+
+  if (length < 1) {
+    return 0;
+  }
+  out[0] = s->vertices[id];
+  for (count = 1; count < length && s->offsets[id] != s->offsets[id + 1];
+       count++) {
+    if (!bias->secondOrder || prev == -1) {
+      next = s->targets[SampleSlot(s, id, rng)];
+    } else {
+      // draw first order, and keep the draw in proportion to its bias
+      do {
+        next = s->targets[SampleSlot(s, id, rng)];
+        if (next == prev) {
+          accept = bias->back;
+        } else if (HasTarget(s, prev, next)) {
+          accept = bias->near;
+        } else {
+          accept = bias->far;
+        }
+      } while (UniformRandom(rng) * bias->most >= accept);
+    }
+    out[count] = s->vertices[next];
+    prev = id;
+    id = next;
+  }
+  return count;
+}
+
+void WalkShare(void *arg, int t) {
+  RunWalks(&((WalkTask *)arg)[t]);
+}
+
+// Walks from the thread's share of the vertices in every round, writing
+// the records as the buffer fills.
+void RunWalks(WalkTask *task) {
+  const WalkOptions *opts = task->opts;
+  WalkSampler s = task->s;
+  size_t recordSize, perBuffer, filled = 0;
+  GVertex_t *path;
+  WalkBias bias;
+  WalkRng rng;
+  char *buffer, *record;
+  int start, end, round, id;
+  uint32_t count;
+  off_t offset;
+
+  recordSize = sizeof(uint32_t) + sizeof(GVertex_t) * opts->length;
+  perBuffer = WALK_BUFFER / recordSize;
+  if (perBuffer == 0) {
+    perBuffer = 1;
+  }
+  buffer = (char *)malloc(recordSize * perBuffer);
+  path = (GVertex_t *)malloc(sizeof(GVertex_t) * (opts->length + 1));
+  if (buffer == NULL || path == NULL) {
+    free(buffer);
+    free(path);
+    task->status = -2;
+    return;
+  }
+  SetWalkBias(opts, &bias);
+  start = (int)((long)s->n * task->t / task->threads);
+  end = (int)((long)s->n * (task->t + 1) / task->threads);
+
+  for (round = 0; round < opts->walksPerVertex && task->status == 0;
+       round++) {
+    offset = WALKS_HEADER_SIZE +
+      (off_t)recordSize * ((off_t)round * s->n + start);
+    for (id = start; id < end; id++) {
+      // each walk gets a generator of its own, so that the walks do not
+      // depend on which thread took them
+      SeedWalkRng(&rng, opts->seed * 0x2545F4914F6CDD1DULL +
+                  (uint64_t)round * s->n + id);
+      count = (uint32_t)WalkFrom(s, id, opts->length, &bias, &rng, path);
+
+      record = buffer + filled * recordSize;
+      memset(record, 0, recordSize);
+      memcpy(record, &count, sizeof(uint32_t));
+      memcpy(record + sizeof(uint32_t), path, sizeof(GVertex_t) * count);
+      if (++filled == perBuffer || id == end - 1) {
+        if (!WriteAt(task->fd, buffer, filled * recordSize, offset)) {
+          task->status = -1;
+          break;
+        }
+        offset += (off_t)(filled * recordSize);
+        filled = 0;
+      }
+    }
+  }
+
+  free(buffer);
+  free(path);
+}
+
+// Writes size bytes at the given offset, however many calls it takes.
+bool WriteAt(int fd, const void *buf, size_t size, off_t offset) {
+  const char *p = (const char *)buf;
+  ssize_t written;
+
+  while (size > 0) {
+    written = pwrite(fd, p, size, offset);
+    if (written <= 0) {
+      return false;
+    }
+    p += written;
+    size -= (size_t)written;
+    offset += written;
+  }
+  return true;
+}
@@ -0,0 +1,128 @@
+// Random walks and neighbor sampling, for generating the training data of
+// graph embeddings (DeepWalk and node2vec walks, GraphSAGE neighborhoods).
+//
+// A WalkSampler is a snapshot of a Graph's adjacency, laid out for
+// sampling: every vertex's neighbors sit together in one array, as dense
+// vertex ids, so a step reads one short run of memory and allocates
+// nothing. For sampling in proportion to edge weight, each vertex also has
+// an alias table (Walker's method), which picks a neighbor with one random
+// slot and one random comparison, whatever the degree.
+//
+// Walks are first order (the next vertex depends only on the current one)
+// unless given node2vec's return and in-out parameters p and q, which bias
+// each step by the vertex before: going back is weighted 1/p, going to a
+// neighbor of the previous vertex 1, and going further away 1/q. Such
+// steps draw from the first order distribution and accept the draw with
+// probability in proportion to its bias, so they cost a few draws and an
+// adjacency test each rather than a table per edge.
+//
+// Random numbers come from xoshiro256**, with a generator per thread. Bulk
+// generation seeds the generator afresh for each walk from the seed, the
+// round and the start vertex, so the walks written depend only on the
+// options, not on how many threads wrote them or in what order.
+//
+// A sampler describes the Graph as it was built: vertices and edges added
+// since are not walked (and start vertices added since are not found).
+// Rebuild it after changing the Graph. Samplers are read only once built,
+// so any number of threads can walk the same one. A sampler of a view (see
+// GraphView.h) covers only the vertices the view shows, and walks only the
+// edges it shows.
+
+#ifndef _RANDOM_WALK_H_
+#define _RANDOM_WALK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./Graph.h"
+
+struct walksampler;
+typedef struct walksampler *WalkSampler;
+
+// A random number generator's state, for one thread at a time.
+typedef struct WalkRng {
+  uint64_t s[4];
+} WalkRng;
+
+// How to walk.
+//
+//    -- length          the most vertices in a walk, its start included. A
+//                       walk ends early at a vertex with no way out.
+//    -- walksPerVertex  the number of walks to start from each vertex.
+//    -- p, q            node2vec's return and in-out parameters, both 1 for
+//                       first order walks. Both must be positive.
+//    -- seed            the seed walks are generated from.
+//    -- threads         the threads to generate walks with, or 0 for one
+//                       per CPU.
+typedef struct WalkOptions {
+  int       length;
+  int       walksPerVertex;
+  double    p;
+  double    q;
+  uint64_t  seed;
+  int       threads;
+} WalkOptions;
+
+// Builds a sampler for the Graph, which must outlive it.
+//
+// Arguments:
+//
+//    -- g         the Graph.
+//    -- weighted  whether to sample neighbors in proportion to the weights
+//                 of their edges, rather than uniformly. Weights must not
+//                 be negative; a vertex whose edges all weigh 0 is sampled
+//                 uniformly.
+//
+// Returns the sampler, or NULL on memory error.
+WalkSampler AllocateWalkSampler(Graph g, bool weighted);
+
+// Frees a sampler.
+void FreeWalkSampler(WalkSampler s);
+
+// Fills in the default options: walks of 80 vertices, 10 per vertex, first
+// order, seed 1, one thread per CPU.
+void DefaultWalkOptions(WalkOptions *opts);
+
+// Seeds a generator. Generators seeded alike produce the same numbers.
+void SeedWalkRng(WalkRng *rng, uint64_t seed);
+
+// Walks from a vertex.
+//
+// Arguments:
+//
+//    -- s      the sampler.
+//    -- start  the vertex to start from.
+//    -- opts   the length and p and q of the walk (the rest are unused).
+//    -- rng    the generator to draw from.
+//    -- out    location to store the walk in, with room for opts->length
+//              vertices.
+//
+// Returns -1 if the vertex wasn't in the Graph when the sampler was built,
+// otherwise the number of vertices walked, start included.
+int RandomWalk(WalkSampler s, GVertex_t start, const WalkOptions *opts,
+               WalkRng *rng, GVertex_t *out);
+
+// Samples k neighbors of a vertex, with replacement, as GraphSAGE does.
+//
+// Returns -1 if the vertex wasn't in the Graph when the sampler was built,
+// 0 if it has no neighbors, otherwise k, with the neighbors placed in out.
+int SampleNeighbors(WalkSampler s, GVertex_t v, int k, WalkRng *rng,
+                    GVertex_t *out);
+
+// Generates walksPerVertex walks from every vertex, on opts->threads
+// threads, and writes them to a file at the given path.
+//
+// The file is a header followed by one fixed size record per walk. The
+// header is the 8 bytes "GBWLK001", then in the machine's byte order the
+// size of a vertex in bytes (32 bits), opts->length (32 bits) and the
+// number of walks (64 bits). Each record is the number of vertices walked
+// (32 bits) followed by opts->length vertices, those past the end of the
+// walk zeroed. Records run round by round, and within a round in the order
+// the vertices were added to the Graph.
+//
+// Returns -2 for out of memory error, -1 if the file cannot be written,
+// otherwise the number of walks written.
+long WriteRandomWalks(WalkSampler s, const WalkOptions *opts,
+                      const char *path);
+
+#endif
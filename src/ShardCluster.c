@@ -0,0 +1,339 @@
+// Implementation of sharded Graph serving.
+//
+// Each shard process is forked from the caller, so it starts with a copy of
+// the Graph and the partition, builds its shard from them, and frees
+// nothing on the way out: it only ever leaves by _exit, once told to stop.
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "./ShardCluster.h"
+#include "./GraphClient.h"
+#include "./GraphProtocol.h"
+#include "./GraphServer.h"
+
+// How long to wait for a shard to start accepting connections, in tries
+// RETRY_MICROS apart.
+#define START_TRIES  1000
+#define RETRY_MICROS 10000
+
+struct shardcluster {
+  int     shards;
+  pid_t  *pids;
+  char   *dir;
+};
+
+struct coordinator {
+  GraphPartition  p;
+  int             shards;
+  GraphClient    *clients;
+  int            *queued;  // requests queued on each shard
+  uint32_t        nextId;
+};
+
+// Helper function declarations
+void RunShard(Graph g, GraphPartition p, const char *path, int shard,
+              int workers);
+bool WaitForShard(pid_t pid, const char *path);
+int RoundTrip(Coordinator c, int shard, GraphResponse *r);
+
+void ShardSocketPath(const char *dir, int shard, char *buf, size_t size) {
+  snprintf(buf, size, "%s/shard-%d.sock", dir, shard);
+}
+
+ShardCluster StartShardCluster(Graph g, GraphPartition p, const char *dir,
+                               int workers) {
+  ShardCluster c;
+  char path[256];
+  int i;
+
+  c = (ShardCluster)calloc(1, sizeof(struct shardcluster));
+  if (c == NULL) {
+    return NULL;
+  }
+  c->pids = (pid_t *)calloc(PartitionShards(p), sizeof(pid_t));
+  c->dir = strdup(dir);
+  if (c->pids == NULL || c->dir == NULL) {
+    StopShardCluster(c);
+    return NULL;
+  }
+
+  // start every shard before waiting for any, so they build in parallel
+  fflush(NULL);
+  for (i = 0; i < PartitionShards(p); i++) {
+    ShardSocketPath(dir, i, path, sizeof(path));
+    c->pids[i] = fork();
+    if (c->pids[i] == -1) {
+      StopShardCluster(c);
+      return NULL;
+    }
+    if (c->pids[i] == 0) {
+      RunShard(g, p, path, i, workers);
+    }
+    c->shards++;
+  }
+  for (i = 0; i < c->shards; i++) {
+    ShardSocketPath(dir, i, path, sizeof(path));
+    if (!WaitForShard(c->pids[i], path)) {
+      StopShardCluster(c);
+      return NULL;
+    }
+  }
+  return c;
+}
+
+void StopShardCluster(ShardCluster c) {
+  char path[256];
+  int i;
+
+  for (i = 0; i < c->shards; i++) {
+    if (c->pids[i] > 0) {
+      kill(c->pids[i], SIGTERM);
+    }
+  }
+  for (i = 0; i < c->shards; i++) {
+    if (c->pids[i] > 0) {
+      while (waitpid(c->pids[i], NULL, 0) == -1 && errno == EINTR) {
+      }
+    }
+    // a shard killed before it could stop cleanly leaves its socket
+    ShardSocketPath(c->dir, i, path, sizeof(path));
+    unlink(path);
+  }
+  free(c->pids);
+  free(c->dir);
+  free(c);
+}
+
+// The body of a shard process: builds the shard, and serves it until told
+// to stop. Never returns.
+void RunShard(Graph g, GraphPartition p, const char *path, int shard,
+              int workers) {
+  GraphServerOptions opts;
+  GraphServer server;
+  sigset_t signals;
+  Graph sub;
+  int sig;
+
+  // block the signals we wait for before the server starts its workers
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  sub = ExtractShard(g, p, shard, NULL, NULL);
+  if (sub == NULL) {
+    _exit(1);
+  }
+  DefaultGraphServerOptions(&opts);
+  if (workers > 0) {
+    opts.workers = workers;
+  }
+  server = StartGraphServer(sub, path, &opts);
+  if (server == NULL) {
+    _exit(1);
+  }
+
+  sigwait(&signals, &sig);
+  StopGraphServer(server);
+  _exit(0);
+}
+
+// Waits until the shard with the given process id accepts connections at
+// the given path. Returns false if it exits or takes too long instead.
+bool WaitForShard(pid_t pid, const char *path) {
+  GraphClient client;
+  int tries;
+
+  for (tries = 0; tries < START_TRIES; tries++) {
+    client = ConnectGraphClient(path);
+    if (client != NULL) {
+      CloseGraphClient(client);
+      return true;
+    }
+    if (waitpid(pid, NULL, WNOHANG) == pid) {
+      return false;
+    }
+    usleep(RETRY_MICROS);
+  }
+  return false;
+}
+
+Coordinator ConnectCoordinator(GraphPartition p, const char *dir) {
+  Coordinator c;
+  char path[256];
+
+  c = (Coordinator)calloc(1, sizeof(struct coordinator));
+  if (c == NULL) {
+    return NULL;
+  }
+  c->p = p;
+  c->clients = (GraphClient *)calloc(PartitionShards(p), sizeof(GraphClient));
+  c->queued = (int *)calloc(PartitionShards(p), sizeof(int));
+  if (c->clients == NULL || c->queued == NULL) {
+    CloseCoordinator(c);
+    return NULL;
+  }
+  for (c->shards = 0; c->shards < PartitionShards(p); c->shards++) {
+    ShardSocketPath(dir, c->shards, path, sizeof(path));
+    c->clients[c->shards] = ConnectGraphClient(path);
+    if (c->clients[c->shards] == NULL) {
+      CloseCoordinator(c);
+      return NULL;
+    }
+  }
+  return c;
+}
+
+void CloseCoordinator(Coordinator c) {
+  int i;
+
+  for (i = 0; i < c->shards; i++) {
+    CloseGraphClient(c->clients[i]);
+  }
+  free(c->clients);
+  free(c->queued);
+  free(c);
+}
+
+// Sends the request queued on the given shard, and reads its response into
+// r. Returns -1 if the shard could not be reached, 0 otherwise.
+int RoundTrip(Coordinator c, int shard, GraphResponse *r) {
+  if (FlushGraphClient(c->clients[shard]) == -1 ||
+      ReadGraphResponse(c->clients[shard], r) == -1) {
+    return -1;
+  }
+  return 0;
+}
+
+int CoordinatorContainsVertex(Coordinator c, GVertex_t v) {
+  GraphResponse r;
+  int shard;
+
+  shard = PartitionOwner(c->p, v);
+  if (QueueContains(c->clients[shard], c->nextId++, v) == -1 ||
+      RoundTrip(c, shard, &r) == -1) {
+    return -1;
+  }
+  return r.answer ? 1 : 0;
+}
+
+int CoordinatorAreAdjacent(Coordinator c, GVertex_t v1, GVertex_t v2) {
+  GraphResponse r;
+  int shard;
+
+  shard = PartitionOwner(c->p, v1);
+  if (QueueAdjacent(c->clients[shard], c->nextId++, v1, v2) == -1 ||
+      RoundTrip(c, shard, &r) == -1) {
+    return -1;
+  }
+  return r.answer ? 1 : 0;
+}
+
+int CoordinatorAreAdjacentBatch(Coordinator c, const VertexPair *queries,
+                                int n, bool *results) {
+  GraphResponse r;
+  int shard, i;
+
+  // the ids are the queries' positions, so answers land in place however
+  // the shards interleave
+  memset(c->queued, 0, sizeof(int) * c->shards);
+  for (i = 0; i < n; i++) {
+    shard = PartitionOwner(c->p, queries[i].v1);
+    if (QueueAdjacent(c->clients[shard], i, queries[i].v1,
+                      queries[i].v2) == -1) {
+      return -1;
+    }
+    c->queued[shard]++;
+  }
+  for (shard = 0; shard < c->shards; shard++) {
+    if (c->queued[shard] > 0 && FlushGraphClient(c->clients[shard]) == -1) {
+      return -1;
+    }
+  }
+  for (shard = 0; shard < c->shards; shard++) {
+    for (i = 0; i < c->queued[shard]; i++) {
+      if (ReadGraphResponse(c->clients[shard], &r) == -1 ||
+          r.id >= (uint32_t)n) {
+        return -1;
+      }
+      results[r.id] = r.answer;
+    }
+  }
+  return 0;
+}
+
+int CoordinatorGetNeighbors(Coordinator c, GVertex_t v, Neighbor **out) {
+  GraphResponse r;
+  Neighbor *copy;
+  int shard;
+
+  shard = PartitionOwner(c->p, v);
+  if (QueueNeighbors(c->clients[shard], c->nextId++, v) == -1 ||
+      RoundTrip(c, shard, &r) == -1) {
+    return -2;
+  }
+  if (r.status == GRAPH_STATUS_NOT_FOUND) {
+    return -1;
+  }
+  if (r.status != GRAPH_STATUS_OK) {
+    return -2;
+  }
+  if (r.count == 0) {
+    return 0;
+  }
+
+  // the response's array belongs to the client
+  copy = (Neighbor *)malloc(sizeof(Neighbor) * r.count);
+  if (copy == NULL) {
+    return -2;
+  }
+  memcpy(copy, r.neighbors, sizeof(Neighbor) * r.count);
+  *out = copy;
+  return r.count;
+}
+
+int CoordinatorAddEdge(Coordinator c, GVertex_t v1, GVertex_t v2,
+                       GWeight_t w) {
+  GraphResponse r1, r2;
+  int s1, s2;
+
+  if (v1 == v2) {
+    return -1;
+  }
+  s1 = PartitionOwner(c->p, v1);
+  s2 = PartitionOwner(c->p, v2);
+  if (QueueAddEdge(c->clients[s1], c->nextId++, v1, v2, w) == -1) {
+    return -1;
+  }
+  if (s2 == s1) {
+    if (RoundTrip(c, s1, &r1) == -1) {
+      return -1;
+    }
+    return (r1.status == GRAPH_STATUS_OK) ? 0 : -1;
+  }
+
+  // send to both owners before waiting on either
+  if (IsDirectedPartition(c->p)) {
+    if (QueueAddVertex(c->clients[s2], c->nextId++, v2) == -1) {
+      return -1;
+    }
+  } else if (QueueAddEdge(c->clients[s2], c->nextId++, v1, v2, w) == -1) {
+    return -1;
+  }
+  if (FlushGraphClient(c->clients[s1]) == -1 ||
+      FlushGraphClient(c->clients[s2]) == -1 ||
+      ReadGraphResponse(c->clients[s1], &r1) == -1 ||
+      ReadGraphResponse(c->clients[s2], &r2) == -1) {
+    return -1;
+  }
+  return (r1.status == GRAPH_STATUS_OK && r2.status == GRAPH_STATUS_OK) ?
+    0 : -1;
+}
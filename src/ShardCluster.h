@@ -0,0 +1,87 @@
+// Serving a partitioned Graph (see Partition.h) from several processes,
+// one per shard, and a coordinator that routes queries to them.
+//
+// Each shard process serves its shard with a GraphServer on a socket of its
+// own, all in one directory. A Coordinator connects to every shard and
+// sends each query to the owner of the vertex it is about: a shard holds
+// every edge of the vertices it owns, so one shard can answer any single
+// vertex query. Batches of queries are split by owner and pipelined to all
+// the shards at once.
+//
+// Everything runs on one machine here, but the coordinator only needs the
+// partition and the sockets, so the shards could as well be spread over
+// several.
+
+#ifndef _SHARD_CLUSTER_H_
+#define _SHARD_CLUSTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./Graph.h"
+#include "./Partition.h"
+
+struct shardcluster;
+typedef struct shardcluster *ShardCluster;
+
+struct coordinator;
+typedef struct coordinator *Coordinator;
+
+// Writes the path of the given shard's socket in the given directory to
+// buf, which holds size bytes.
+void ShardSocketPath(const char *dir, int shard, char *buf, size_t size);
+
+// Starts one process per shard. Each builds its shard from the Graph (see
+// ExtractShard) and serves it until the cluster is stopped. Returns once
+// every shard is accepting connections.
+//
+// Arguments:
+//
+//    -- g        the partitioned Graph. It is only read, by the shard
+//                processes, which get copies of it.
+//    -- p        the partition.
+//    -- dir      the directory to create the sockets in.
+//    -- workers  the number of worker threads for each shard's server, or 0
+//                for the default.
+//
+// Returns the cluster, or NULL if a shard failed to start or on memory
+// error.
+ShardCluster StartShardCluster(Graph g, GraphPartition p, const char *dir,
+                               int workers);
+
+// Stops every shard process, and waits for them to exit.
+void StopShardCluster(ShardCluster c);
+
+// Connects a coordinator to the shards serving the given partition in the
+// given directory. The partition must outlive the coordinator. Returns NULL
+// if a shard cannot be reached or on memory error.
+//
+// A Coordinator is not safe to use from several threads at once; give each
+// thread its own.
+Coordinator ConnectCoordinator(GraphPartition p, const char *dir);
+
+// Closes the coordinator's connections and frees it.
+void CloseCoordinator(Coordinator c);
+
+// The counterparts of ContainsVertex and AreAdjacent (see Graph.h). Each
+// returns 1 for true, 0 for false, and -1 if a shard could not be reached.
+int CoordinatorContainsVertex(Coordinator c, GVertex_t v);
+int CoordinatorAreAdjacent(Coordinator c, GVertex_t v1, GVertex_t v2);
+
+// The counterpart of AreAdjacentBatch (see Graph.h). Returns -1 if a shard
+// could not be reached, 0 on success.
+int CoordinatorAreAdjacentBatch(Coordinator c, const VertexPair *queries,
+                                int n, bool *results);
+
+// The counterpart of GetNeighbors (see Graph.h), with the same return
+// values; -2 also means a shard could not be reached.
+int CoordinatorGetNeighbors(Coordinator c, GVertex_t v, Neighbor **out);
+
+// The counterpart of AddGraphEdge (see Graph.h). The edge is added to the
+// owners of both vertices; in a directed Graph, the owner of v2 only gets
+// the vertex. Returns -1 if either shard fails to add it or cannot be
+// reached, in which case one of them may have it, and 0 on success.
+int CoordinatorAddEdge(Coordinator c, GVertex_t v1, GVertex_t v2,
+                       GWeight_t w);
+
+#endif
@@ -0,0 +1,890 @@
+// Implementation of point-to-point shortest path queries.
+//
+// Every engine is Dijkstra's algorithm at heart, over a binary heap with
+// lazy deletion: improving a vertex's distance pushes a new entry rather
+// than moving the old one, and entries for vertices already settled are
+// skipped as they come off the heap. The working state for the two
+// directions of a search lives side by side in the thread's scratch space,
+// indexed by side (FORWARD or BACKWARD) and then by vertex id.
+//
+// The landmark tables are laid out a vertex at a time, so the bounds for
+// one vertex, from every landmark, share a cache line or two.
+
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./ShortestPath.h"
+#include "./Graph_priv.h"
+#include "./GraphView_priv.h"
+
+#define FORWARD  0
+#define BACKWARD 1
+
+// The distance of a vertex no search has reached.
+#if GRAPH_WEIGHT == GRAPH_WEIGHT_FLOAT
+#define UNREACHED INFINITY
+#else
+#define UNREACHED INT_MAX
+#endif
+
+#define LANDMARKS_MAGIC "GBLMK002"
+
+// Identifies the weight type in the landmarks file, as in GraphLog.c. The
+// tables always hold distances, even in an unweighted build.
+#define WEIGHT_TAG ((uint32_t)(GRAPH_WEIGHT << 8 | sizeof(GWeight_t)))
+
+// magic, vertex size, weight tag, directed, landmark count, vertex count,
+// edge count, checksum of the Graph's vertices and edges
+#define LANDMARKS_HEADER_SIZE (8 + 4 + 4 + 4 + 4 + 8 + 8 + 8)
+
+// A heap entry: a vertex, keyed by its distance when pushed (plus its
+// lower bound, in an A* search).
+typedef struct HeapEntry {
+  GWeight_t  key;
+  ListItem  *item;
+} HeapEntry;
+
+typedef struct Heap {
+  HeapEntry *entries;
+  int        count;
+  int        capacity;
+} Heap;
+
+// A thread's working state. The per-vertex arrays are indexed by vertex
+// id, and an entry is only meaningful if the matching seen array holds the
+// current epoch.
+typedef struct Scratch {
+  int            capacity;  // number of vertices the arrays hold
+  unsigned int   epoch;
+  unsigned int  *seen[2];   // epoch in which each vertex was last reached
+  unsigned int  *done[2];   // epoch in which each vertex was settled
+  GWeight_t     *dist[2];
+  ListItem     **parent[2];
+  GWeight_t     *bound;     // each vertex's A* lower bound, once reached
+  Heap           heap[2];
+  GVertex_t     *path;
+} Scratch;
+
+struct landmarks {
+  int         count;
+  bool        directed;
+  int         n;          // ids covered by the tables
+  int         shown;      // vertices the Graph showed when computed
+  long        edges;      // and edges
+  uint64_t    checksum;   // of the Graph's vertices and edges (see
+                          // LandmarkChecksum)
+  uint64_t    serial;     // the Graph the tables describe, and the number
+  uint64_t    mutations;  // of mutations it had seen then
+  GVertex_t  *vertices;   // the vertices shown, and the id of each, for
+  int        *ids;        // saving
+  GVertex_t  *landmarks;
+  GWeight_t  *from;       // from[id * count + i] = d(landmark i, vertex)
+  GWeight_t  *to;         // to[id * count + i] = d(vertex, landmark i);
+                          // the same as from, if undirected
+};
+
+static pthread_once_t scratchOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchKey;
+static __thread Scratch *local = NULL;
+
+// Helper function declarations
+void FreePathScratch(void *arg);
+void CreatePathScratchKey();
+Scratch *ReservePathScratch(int vertices);
+void StartSearch(Scratch *s);
+bool PushHeap(Heap *h, GWeight_t key, ListItem *item);
+bool PopHeap(Heap *h, HeapEntry *out);
+bool Relax(Scratch *s, int side, ListItem *x, GWeight_t d, ListItem *from,
+           GWeight_t bound);
+EdgeItem *EdgesOf(Graph g, ListItem *x, int side);
+int FinishPath(Scratch *s, ListItem *a, ListItem *b, GWeight_t distance,
+               PathResult *out);
+GWeight_t LowerBound(Landmarks l, int id, int target);
+int SearchAll(Graph g, Scratch *s, int side, ListItem *source,
+              GWeight_t *table, int stride);
+Landmarks NewLandmarks(int count, int n, int shown, bool directed);
+uint64_t LandmarkChecksum(Graph g);
+uint64_t MixChecksum(uint64_t h);
+
+void FreePathScratch(void *arg) {
+  Scratch *s = (Scratch *)arg;
+  int side;
+
+  for (side = 0; side < 2; side++) {
+    free(s->seen[side]);
+    free(s->done[side]);
+    free(s->dist[side]);
+    free(s->parent[side]);
+    free(s->heap[side].entries);
+  }
+  free(s->bound);
+  free(s->path);
+  free(s);
+}
+
+void CreatePathScratchKey() {
+  pthread_key_create(&scratchKey, FreePathScratch);
+}
+
+// Returns the calling thread's scratch space, grown to hold the given
+// number of vertices if necessary. Returns NULL on memory error, in which
+// case the thread's existing scratch space is left as it was.
+Scratch *ReservePathScratch(int vertices) {
+  Scratch *s, grown;
+  int capacity, side;
+  bool ok = true;
+
+  pthread_once(&scratchOnce, CreatePathScratchKey);
+  if (local == NULL) {
+    s = (Scratch *)calloc(1, sizeof(Scratch));
+    if (s == NULL || pthread_setspecific(scratchKey, s) != 0) {
+      free(s);
+      return NULL;
+    }
+    local = s;
+  }
+  s = local;
+  if (vertices <= s->capacity) {
+    return s;
+  }
+
+  capacity = (s->capacity == 0) ? 64 : s->capacity;
+  while (capacity < vertices) {
+    capacity *= 2;
+  }
+
+  // nothing carries over from one query to the next but the heaps, which
+  // grow on their own; fresh seen and done arrays restart the epochs
+  memset(&grown, 0, sizeof(Scratch));
+  grown.capacity = capacity;
+  for (side = 0; side < 2; side++) {
+    grown.seen[side] = (unsigned int *)calloc(capacity, sizeof(unsigned int));
+    grown.done[side] = (unsigned int *)calloc(capacity, sizeof(unsigned int));
+    grown.dist[side] = (GWeight_t *)malloc(sizeof(GWeight_t) * capacity);
+    grown.parent[side] = (ListItem **)malloc(sizeof(ListItem *) * capacity);
+    ok = ok && grown.seen[side] != NULL && grown.done[side] != NULL &&
+      grown.dist[side] != NULL && grown.parent[side] != NULL;
+    grown.heap[side] = s->heap[side];
+  }
+  grown.bound = (GWeight_t *)malloc(sizeof(GWeight_t) * capacity);
+  grown.path = (GVertex_t *)malloc(sizeof(GVertex_t) * capacity);
+  if (!ok || grown.bound == NULL || grown.path == NULL) {
+    for (side = 0; side < 2; side++) {
+      free(grown.seen[side]);
+      free(grown.done[side]);
+      free(grown.dist[side]);
+      free(grown.parent[side]);
+    }
+    free(grown.bound);
+    free(grown.path);
+    return NULL;
+  }
+
+  for (side = 0; side < 2; side++) {
+    free(s->seen[side]);
+    free(s->done[side]);
+    free(s->dist[side]);
+    free(s->parent[side]);
+  }
+  free(s->bound);
+  free(s->path);
+  *s = grown;
+  return s;
+}
+
+// Starts a new search: moves to the next epoch, and empties the heaps.
+void StartSearch(Scratch *s) {
+  int side;
+
+  s->epoch++;
+  if (s->epoch == 0) {
+    // the epochs wrapped around, so old marks could look current
+    for (side = 0; side < 2; side++) {
+      memset(s->seen[side], 0, sizeof(unsigned int) * s->capacity);
+      memset(s->done[side], 0, sizeof(unsigned int) * s->capacity);
+    }
+    s->epoch = 1;
+  }
+  s->heap[FORWARD].count = 0;
+  s->heap[BACKWARD].count = 0;
+}
+
+// Pushes an entry onto the heap. Returns false on memory error.
+bool PushHeap(Heap *h, GWeight_t key, ListItem *item) {
+  HeapEntry *entries;
+  int capacity, i, up;
+
+  if (h->count == h->capacity) {
+    capacity = (h->capacity == 0) ? 64 : 2 * h->capacity;
+    entries = (HeapEntry *)realloc(h->entries, sizeof(HeapEntry) * capacity);
+    if (entries == NULL) {
+      return false;
+    }
+    h->entries = entries;
+    h->capacity = capacity;
+  }
+
+  for (i = h->count++; i > 0; i = up) {
+    up = (i - 1) / 2;
+    if (h->entries[up].key <= key) {
+      break;
+    }
+    h->entries[i] = h->entries[up];
+  }
+  h->entries[i].key = key;
+  h->entries[i].item = item;
+  return true;
+}
+
+// Pops the entry with the least key into out. Returns false if the heap is
+// empty.
+bool PopHeap(Heap *h, HeapEntry *out) {
+  HeapEntry last;
+  int i, child;
+
+  if (h->count == 0) {
+    return false;
+  }
+  *out = h->entries[0];
+  last = h->entries[--h->count];
+  for (i = 0; (child = 2 * i + 1) < h->count; i = child) {
+    if (child + 1 < h->count &&
+        h->entries[child + 1].key < h->entries[child].key) {
+      child++;
+    }
+    if (last.key <= h->entries[child].key) {
+      break;
+    }
+    h->entries[i] = h->entries[child];
+  }
+  h->entries[i] = last;
+  return true;
+}
+
+// Reaches x on the given side at distance d from the given parent, if that
+// improves on its distance so far, and queues it keyed by d plus its
+// bound. Returns false on memory error.
+bool Relax(Scratch *s, int side, ListItem *x, GWeight_t d, ListItem *from,
+           GWeight_t bound) {
+  int id = x->id;
+
+  if (s->seen[side][id] == s->epoch && s->dist[side][id] <= d) {
+    return true;
+  }
+  s->seen[side][id] = s->epoch;
+  s->dist[side][id] = d;
+  s->parent[side][id] = from;
+  return PushHeap(&s->heap[side], AddWeights(d, bound), x);
+}
+
+// Returns the edges a search on the given side follows out of x: its own
+// edges forward, and the edges into it backward. In an undirected Graph
+// these are the same.
+EdgeItem *EdgesOf(Graph g, ListItem *x, int side) {
+  return (side == BACKWARD && g->directed) ? x->inNeighbors : x->neighbors;
+}
+
+// Writes out the path through a, reached forward, and b, reached backward
+// (or a == b), and the given distance. Returns 1.
+int FinishPath(Scratch *s, ListItem *a, ListItem *b, GWeight_t distance,
+               PathResult *out) {
+  GVertex_t tmp;
+  ListItem *x;
+  int n = 0, i;
+
+  // the forward tree leads back from a to s, so write it reversed
+  for (x = a; x != NULL; x = s->parent[FORWARD][x->id]) {
+    s->path[n++] = x->data;
+  }
+  for (i = 0; i < n / 2; i++) {
+    tmp = s->path[i];
+    s->path[i] = s->path[n - 1 - i];
+    s->path[n - 1 - i] = tmp;
+  }
+  // and the backward tree leads on from b to t
+  if (b != a) {
+    for (x = b; x != NULL; x = s->parent[BACKWARD][x->id]) {
+      s->path[n++] = x->data;
+    }
+  }
+
+  out->distance = distance;
+  out->hops = n - 1;
+  out->path = s->path;
+  return 1;
+}
+
+int DijkstraPath(Graph g, GVertex_t s, GVertex_t t, PathResult *out) {
+  ListItem *source, *target, *x;
+  HeapEntry top;
+  EdgeItem *e;
+  Scratch *sc;
+
+  memset(out, 0, sizeof(PathResult));
+  source = FindVertex(g, s);
+  target = FindVertex(g, t);
+  if (source == NULL || target == NULL) {
+    return -1;
+  }
+  sc = ReservePathScratch(g->numVertices);
+  if (sc == NULL) {
+    return -2;
+  }
+
+  StartSearch(sc);
+  if (!Relax(sc, FORWARD, source, 0, NULL, 0)) {
+    return -2;
+  }
+  while (PopHeap(&sc->heap[FORWARD], &top)) {
+    x = top.item;
+    if (sc->done[FORWARD][x->id] == sc->epoch) {
+      continue;
+    }
+    sc->done[FORWARD][x->id] = sc->epoch;
+    out->settled++;
+    if (x == target) {
+      return FinishPath(sc, x, x, sc->dist[FORWARD][x->id], out);
+    }
+    for (e = x->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, x, e, false)) {
+        continue;
+      }
+      if (!Relax(sc, FORWARD, FindVertex(g, e->data),
+                 AddWeights(sc->dist[FORWARD][x->id], EdgeWeight(e)), x, 0)) {
+        return -2;
+      }
+    }
+  }
+  return 0;
+}
+
+int BidirectionalPath(Graph g, GVertex_t s, GVertex_t t, PathResult *out) {
+  ListItem *source, *target, *x, *y, *meetA = NULL, *meetB = NULL;
+  GWeight_t best = UNREACHED, d;
+  HeapEntry top;
+  EdgeItem *e;
+  Scratch *sc;
+  int side, other;
+
+  memset(out, 0, sizeof(PathResult));
+  source = FindVertex(g, s);
+  target = FindVertex(g, t);
+  if (source == NULL || target == NULL) {
+    return -1;
+  }
+  if (g->directed && !EnsureInAdjacency(g)) {
+    return -2;
+  }
+  sc = ReservePathScratch(g->numVertices);
+  if (sc == NULL) {
+    return -2;
+  }
+
+  StartSearch(sc);
+  if (source == target) {
+    sc->parent[FORWARD][source->id] = NULL;
+    out->settled = 1;
+    return FinishPath(sc, source, source, 0, out);
+  }
+  if (!Relax(sc, FORWARD, source, 0, NULL, 0) ||
+      !Relax(sc, BACKWARD, target, 0, NULL, 0)) {
+    return -2;
+  }
+
+  while (sc->heap[FORWARD].count > 0 && sc->heap[BACKWARD].count > 0) {
+    // no path through an unsettled vertex can beat the best one found
+    // once the two nearest unsettled vertices are this far apart
+    if (best != UNREACHED && AddWeights(sc->heap[FORWARD].entries[0].key,
+        sc->heap[BACKWARD].entries[0].key) >= best) {
+      break;
+    }
+
+    // grow whichever search has the smaller frontier
+    side = (sc->heap[FORWARD].count <= sc->heap[BACKWARD].count) ?
+      FORWARD : BACKWARD;
+    other = 1 - side;
+    PopHeap(&sc->heap[side], &top);
+    x = top.item;
+    if (sc->done[side][x->id] == sc->epoch) {
+      continue;
+    }
+    sc->done[side][x->id] = sc->epoch;
+    out->settled++;
+
+    for (e = EdgesOf(g, x, side); e != NULL; e = e->next) {
+      if (!EdgeVisible(g, x, e, side == BACKWARD && g->directed)) {
+        continue;
+      }
+      y = FindVertex(g, e->data);
+      d = AddWeights(sc->dist[side][x->id], EdgeWeight(e));
+      if (!Relax(sc, side, y, d, x, 0)) {
+        return -2;
+      }
+      if (sc->seen[other][y->id] == sc->epoch &&
+          AddWeights(d, sc->dist[other][y->id]) < best) {
+        best = AddWeights(d, sc->dist[other][y->id]);
+        meetA = (side == FORWARD) ? x : y;
+        meetB = (side == FORWARD) ? y : x;
+      }
+    }
+  }
+
+  if (meetA == NULL) {
+    return 0;
+  }
+  return FinishPath(sc, meetA, meetB, best, out);
+}
+
+int ALTPath(Graph g, Landmarks l, GVertex_t s, GVertex_t t,
+            PathResult *out) {
+  ListItem *source, *target, *x, *y;
+  HeapEntry top;
+  EdgeItem *e;
+  Scratch *sc;
+  GWeight_t bound;
+
+  // tables for another Graph, or for this one before it last changed, can
+  // overestimate distances, which would make the answer wrong
+  if (l->serial != g->serial || l->mutations != g->mutations) {
+    return DijkstraPath(g, s, t, out);
+  }
+
+  memset(out, 0, sizeof(PathResult));
+  source = FindVertex(g, s);
+  target = FindVertex(g, t);
+  if (source == NULL || target == NULL) {
+    return -1;
+  }
+  sc = ReservePathScratch(g->numVertices);
+  if (sc == NULL) {
+    return -2;
+  }
+
+  // the tables hold exact distances in this very Graph, so the bounds are
+  // consistent, and a settled vertex never needs to be reopened
+  StartSearch(sc);
+  if (!Relax(sc, FORWARD, source, 0, NULL,
+             LowerBound(l, source->id, target->id))) {
+    return -2;
+  }
+  while (PopHeap(&sc->heap[FORWARD], &top)) {
+    x = top.item;
+    if (sc->done[FORWARD][x->id] == sc->epoch) {
+      continue;
+    }
+    sc->done[FORWARD][x->id] = sc->epoch;
+    out->settled++;
+    if (x == target) {
+      return FinishPath(sc, x, x, sc->dist[FORWARD][x->id], out);
+    }
+    for (e = x->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, x, e, false)) {
+        continue;
+      }
+      y = FindVertex(g, e->data);
+      if (sc->done[FORWARD][y->id] == sc->epoch) {
+        continue;
+      }
+      // the bound only depends on the vertex, so work it out once
+      if (sc->seen[FORWARD][y->id] == sc->epoch) {
+        bound = sc->bound[y->id];
+      } else {
+        bound = LowerBound(l, y->id, target->id);
+        sc->bound[y->id] = bound;
+      }
+      if (!Relax(sc, FORWARD, y,
+                 AddWeights(sc->dist[FORWARD][x->id], EdgeWeight(e)), x,
+                 bound)) {
+        return -2;
+      }
+    }
+  }
+  return 0;
+}
+
+// Returns the best landmark lower bound on the distance from the vertex
+// with the given id to the target. The tables must match the Graph, and so
+// cover every id.
+GWeight_t LowerBound(Landmarks l, int id, int target) {
+  const GWeight_t *fromV, *fromT, *toV, *toT;
+  GWeight_t best = 0;
+  int i;
+
+  fromV = l->from + (size_t)id * l->count;
+  fromT = l->from + (size_t)target * l->count;
+  toV = l->to + (size_t)id * l->count;
+  toT = l->to + (size_t)target * l->count;
+  for (i = 0; i < l->count; i++) {
+    // d(v,t) >= d(L,t) - d(L,v)
+    if (fromV[i] != UNREACHED && fromT[i] != UNREACHED &&
+        fromT[i] - fromV[i] > best) {
+      best = fromT[i] - fromV[i];
+    }
+    // d(v,t) >= d(v,L) - d(t,L)
+    if (toV[i] != UNREACHED && toT[i] != UNREACHED &&
+        toV[i] - toT[i] > best) {
+      best = toV[i] - toT[i];
+    }
+  }
+  return best;
+}
+
+// Runs a full Dijkstra search from the source on the given side, writing
+// each vertex's distance to table[id * stride], or UNREACHED. Returns -2
+// on memory error, 0 on success.
+int SearchAll(Graph g, Scratch *s, int side, ListItem *source,
+              GWeight_t *table, int stride) {
+  ListItem *x;
+  HeapEntry top;
+  EdgeItem *e;
+  int i;
+
+  for (i = 0; i < g->numVertices; i++) {
+    table[(size_t)i * stride] = UNREACHED;
+  }
+  StartSearch(s);
+  if (!Relax(s, side, source, 0, NULL, 0)) {
+    return -2;
+  }
+  while (PopHeap(&s->heap[side], &top)) {
+    x = top.item;
+    if (s->done[side][x->id] == s->epoch) {
+      continue;
+    }
+    s->done[side][x->id] = s->epoch;
+    table[(size_t)x->id * stride] = s->dist[side][x->id];
+    for (e = EdgesOf(g, x, side); e != NULL; e = e->next) {
+      if (!EdgeVisible(g, x, e, side == BACKWARD && g->directed)) {
+        continue;
+      }
+      if (!Relax(s, side, FindVertex(g, e->data),
+                 AddWeights(s->dist[side][x->id], EdgeWeight(e)), x, 0)) {
+        return -2;
+      }
+    }
+  }
+  return 0;
+}
+
+// Allocates landmarks with room for the given number of landmarks, ids and
+// vertices shown. Returns NULL on memory error.
+Landmarks NewLandmarks(int count, int n, int shown, bool directed) {
+  Landmarks l;
+  size_t cells = (size_t)count * n + 1;
+
+  l = (Landmarks)calloc(1, sizeof(struct landmarks));
+  if (l == NULL) {
+    return NULL;
+  }
+  l->count = count;
+  l->n = n;
+  l->shown = shown;
+  l->directed = directed;
+  l->vertices = (GVertex_t *)malloc(sizeof(GVertex_t) * (shown + 1));
+  l->ids = (int *)malloc(sizeof(int) * (shown + 1));
+  l->landmarks = (GVertex_t *)malloc(sizeof(GVertex_t) * count);
+  l->from = (GWeight_t *)malloc(sizeof(GWeight_t) * cells);
+  l->to = directed ? (GWeight_t *)malloc(sizeof(GWeight_t) * cells) : l->from;
+  if (l->vertices == NULL || l->ids == NULL || l->landmarks == NULL ||
+      l->from == NULL || l->to == NULL) {
+    FreeLandmarks(l);
+    return NULL;
+  }
+  return l;
+}
+
+Landmarks ComputeLandmarks(Graph g, int count) {
+  GWeight_t *nearest, d;
+  ListItem *item, *next, *first;
+  GraphSummary summary;
+  Landmarks l;
+  Scratch *s;
+  int i, j;
+
+  // in a view, the first vertex may be hidden
+  for (first = g->front; first != NULL && !VertexVisible(g, first);
+       first = first->next) {
+  }
+  if (count <= 0 || first == NULL) {
+    return NULL;
+  }
+  GetGraphSummary(g, &summary);
+  if (count > summary.vertices) {
+    count = summary.vertices;
+  }
+  if (g->directed && !EnsureInAdjacency(g)) {
+    return NULL;
+  }
+  s = ReservePathScratch(g->numVertices);
+  l = NewLandmarks(count, g->numVertices, summary.vertices, g->directed);
+  nearest = (GWeight_t *)malloc(sizeof(GWeight_t) * g->numVertices);
+  if (s == NULL || l == NULL || nearest == NULL) {
+    goto fail;
+  }
+  l->edges = summary.edges;
+  l->checksum = LandmarkChecksum(g);
+  l->serial = g->serial;
+  l->mutations = g->mutations;
+  for (i = 0, item = g->front; item != NULL; item = item->next) {
+    if (VertexVisible(g, item)) {
+      l->vertices[i] = item->data;
+      l->ids[i++] = item->id;
+    }
+  }
+
+  // start from the vertex farthest from an arbitrary one, then repeatedly
+  // take the vertex farthest from every landmark so far; unreachable
+  // vertices count as farthest of all, so each component gets one early
+  if (SearchAll(g, s, FORWARD, first, l->from, count) != 0) {
+    goto fail;
+  }
+  next = first;
+  for (item = first; item != NULL; item = item->next) {
+    if (VertexVisible(g, item) &&
+        l->from[(size_t)item->id * count] > l->from[(size_t)next->id * count]) {
+      next = item;
+    }
+  }
+  for (i = 0; i < g->numVertices; i++) {
+    nearest[i] = UNREACHED;
+  }
+
+  for (i = 0; i < count; i++) {
+    l->landmarks[i] = next->data;
+    if (SearchAll(g, s, FORWARD, next, l->from + i, count) != 0 ||
+        (g->directed &&
+         SearchAll(g, s, BACKWARD, next, l->to + i, count) != 0)) {
+      goto fail;
+    }
+
+    next = NULL;
+    for (item = g->front; item != NULL; item = item->next) {
+      if (!VertexVisible(g, item)) {
+        continue;
+      }
+      j = item->id;
+      d = l->from[(size_t)j * count + i];
+      if (d < nearest[j]) {
+        nearest[j] = d;
+      }
+      if (nearest[j] > 0 && (next == NULL || nearest[j] > nearest[next->id])) {
+        next = item;
+      }
+    }
+    if (next == NULL) {
+      // every vertex is as near a landmark as can be, so stop here, and
+      // close the rows up to the landmarks there are
+      for (j = 0; j < g->numVertices; j++) {
+        memmove(l->from + (size_t)j * (i + 1), l->from + (size_t)j * count,
+                sizeof(GWeight_t) * (i + 1));
+        if (g->directed) {
+          memmove(l->to + (size_t)j * (i + 1), l->to + (size_t)j * count,
+                  sizeof(GWeight_t) * (i + 1));
+        }
+      }
+      l->count = i + 1;
+      break;
+    }
+  }
+
+  free(nearest);
+  return l;
+
+fail:
+  free(nearest);
+  if (l != NULL) {
+    FreeLandmarks(l);
+  }
+  return NULL;
+}
+
+void FreeLandmarks(Landmarks l) {
+  if (l->to != l->from) {
+    free(l->to);
+  }
+  free(l->from);
+  free(l->vertices);
+  free(l->ids);
+  free(l->landmarks);
+  free(l);
+}
+
+int LandmarkCount(Landmarks l) {
+  return l->count;
+}
+
+int SaveLandmarks(Landmarks l, const char *path) {
+  char header[LANDMARKS_HEADER_SIZE];
+  GWeight_t *table;
+  uint32_t u32;
+  uint64_t u64;
+  bool ok;
+  FILE *f;
+  int i;
+
+  memcpy(header, LANDMARKS_MAGIC, 8);
+  u32 = sizeof(GVertex_t);
+  memcpy(header + 8, &u32, 4);
+  u32 = WEIGHT_TAG;
+  memcpy(header + 12, &u32, 4);
+  u32 = l->directed ? 1 : 0;
+  memcpy(header + 16, &u32, 4);
+  u32 = (uint32_t)l->count;
+  memcpy(header + 20, &u32, 4);
+  u64 = (uint64_t)l->shown;
+  memcpy(header + 24, &u64, 8);
+  u64 = (uint64_t)l->edges;
+  memcpy(header + 32, &u64, 8);
+  memcpy(header + 40, &l->checksum, 8);
+
+  f = fopen(path, "wb");
+  if (f == NULL) {
+    return -1;
+  }
+  ok = fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+    fwrite(l->vertices, sizeof(GVertex_t), l->shown, f) ==
+    (size_t)l->shown &&
+    fwrite(l->landmarks, sizeof(GVertex_t), l->count, f) ==
+    (size_t)l->count;
+
+  // only the rows of the vertices shown, which are all a view can look up
+  // again, in the order of the vertices above
+  for (table = l->from; ok && table != NULL;
+       table = (l->directed && table == l->from) ? l->to : NULL) {
+    for (i = 0; ok && i < l->shown; i++) {
+      ok = fwrite(table + (size_t)l->ids[i] * l->count, sizeof(GWeight_t),
+                  l->count, f) == (size_t)l->count;
+    }
+  }
+  if (fclose(f) != 0) {
+    ok = false;
+  }
+  return ok ? 0 : -1;
+}
+
+Landmarks LoadLandmarks(Graph g, const char *path) {
+  char header[LANDMARKS_HEADER_SIZE];
+  uint32_t vsize, wtag, directed, count;
+  uint64_t n, edges, checksum, i;
+  GraphSummary summary;
+  Landmarks l = NULL;
+  GWeight_t *table;
+  ListItem *item;
+  size_t cells;
+  FILE *f;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+      memcmp(header, LANDMARKS_MAGIC, 8) != 0) {
+    goto fail;
+  }
+  memcpy(&vsize, header + 8, 4);
+  memcpy(&wtag, header + 12, 4);
+  memcpy(&directed, header + 16, 4);
+  memcpy(&count, header + 20, 4);
+  memcpy(&n, header + 24, 8);
+  memcpy(&edges, header + 32, 8);
+  memcpy(&checksum, header + 40, 8);
+  // the file holds what the Graph it was saved from showed, so a view
+  // loads it if it shows the same
+  GetGraphSummary(g, &summary);
+  if (vsize != sizeof(GVertex_t) || wtag != WEIGHT_TAG ||
+      (directed != 0) != g->directed || count == 0 || count > n ||
+      n != (uint64_t)summary.vertices || edges != (uint64_t)summary.edges ||
+      checksum != LandmarkChecksum(g)) {
+    goto fail;
+  }
+
+  l = NewLandmarks((int)count, g->numVertices, (int)n, g->directed);
+  if (l == NULL) {
+    goto fail;
+  }
+  l->edges = (long)edges;
+  l->checksum = checksum;
+  l->serial = g->serial;
+  l->mutations = g->mutations;
+  if (fread(l->vertices, sizeof(GVertex_t), n, f) != n ||
+      fread(l->landmarks, sizeof(GVertex_t), count, f) != count) {
+    goto fail;
+  }
+
+  // the Graph's ids need not match the ones the tables were written with,
+  // so place each row by looking its vertex up; the rows of ids a view
+  // hides are never read, but are filled in all the same
+  for (i = 0; i < n; i++) {
+    item = FindVertex(g, l->vertices[i]);
+    if (item == NULL) {
+      goto fail;
+    }
+    l->ids[i] = item->id;
+  }
+  cells = (size_t)count * g->numVertices;
+  for (table = l->from; table != NULL;
+       table = (l->directed && table == l->from) ? l->to : NULL) {
+    for (i = 0; i < cells; i++) {
+      table[i] = UNREACHED;
+    }
+    for (i = 0; i < n; i++) {
+      if (fread(table + (size_t)l->ids[i] * count, sizeof(GWeight_t), count,
+                f) != count) {
+        goto fail;
+      }
+    }
+  }
+  if (fgetc(f) != EOF) {
+    goto fail;
+  }
+
+  fclose(f);
+  return l;
+
+fail:
+  if (l != NULL) {
+    FreeLandmarks(l);
+  }
+  fclose(f);
+  return NULL;
+}
+
+// Returns a checksum of the vertices and edges the Graph shows, with their
+// weights. It is a sum over them, so that it does not depend on the order
+// of the Graph's lists or on its ids.
+uint64_t LandmarkChecksum(Graph g) {
+  uint64_t sum = 0, bits;
+  GWeight_t w;
+  ListItem *l;
+  EdgeItem *e;
+
+  for (l = g->front; l != NULL; l = l->next) {
+    if (!VertexVisible(g, l)) {
+      continue;
+    }
+    sum += MixChecksum((uint64_t)l->data);
+    for (e = l->neighbors; e != NULL; e = e->next) {
+      if (!EdgeVisible(g, l, e, false)) {
+        continue;
+      }
+      w = EdgeWeight(e);
+      bits = 0;
+      memcpy(&bits, &w, sizeof(GWeight_t));
+      sum += MixChecksum(MixChecksum((uint64_t)l->data) ^
+                         MixChecksum((uint64_t)e->data + 1) ^ bits);
+    }
+  }
+  return sum;
+}
+
+// Scrambles the bits of h (the finalizer of splitmix64).
+uint64_t MixChecksum(uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+  return h ^ (h >> 31);
+}
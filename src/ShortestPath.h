@@ -0,0 +1,120 @@
+// Point-to-point shortest path queries.
+//
+// Three engines answer the same query, the least total weight of any path
+// from s to t:
+//
+//    -- Dijkstra's algorithm from s, stopping once t is settled. The
+//       baseline the others are measured against.
+//    -- Bidirectional Dijkstra, searching forward from s and backward from
+//       t at once, and stopping once the two searches meet and can no
+//       longer improve on the best path through the meeting points. Each
+//       search covers roughly a ball of half the radius, so this settles
+//       about half as many vertices.
+//    -- ALT: A* search guided by lower bounds from landmarks and the
+//       triangle inequality. A few landmark vertices have their distances
+//       to and from every other vertex computed ahead of time; for any
+//       landmark L, d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L).
+//       With well spread landmarks, the search heads almost straight for
+//       t, and settles a small fraction of what Dijkstra would.
+//
+// As with k-hop queries (see Neighborhood.h), each thread keeps its working
+// state in arrays indexed by vertex id, stamped with a per-query epoch, and
+// reuses them from one query to the next. Once they have grown to the size
+// of the Graph, queries allocate nothing.
+//
+// Weights must be non-negative. In a directed Graph, the backward search
+// and the landmark distances follow edges in reverse, so the first such
+// query builds the Graph's in-adjacency (see GetInNeighbors); do that
+// before querying from several threads at once. Like the rest of the Graph
+// API, queries must not run concurrently with mutations of the same Graph.
+
+#ifndef _SHORTEST_PATH_H_
+#define _SHORTEST_PATH_H_
+
+#include "./Graph.h"
+
+struct landmarks;
+typedef struct landmarks *Landmarks;
+
+// The answer to a query.
+//
+//    -- distance  the total weight of the path.
+//    -- hops      the number of edges on the path.
+//    -- path      the vertices on the path, from s to t. The array belongs
+//                 to the calling thread, and is only valid until its next
+//                 query.
+//    -- settled   the number of vertices the search settled, a measure of
+//                 the work it did.
+typedef struct PathResult {
+  GWeight_t        distance;
+  int              hops;
+  const GVertex_t *path;
+  int              settled;
+} PathResult;
+
+// Finds a shortest path from s to t.
+//
+// Arguments:
+//
+//    -- g    the Graph to query.
+//    -- s    the vertex to start from.
+//    -- t    the vertex to reach.
+//    -- out  location to store the answer in.
+//
+// Returns:
+//
+//    -2 for out of memory error,
+//    -1 if either vertex isn't in the Graph,
+//     0 if there is no path from s to t,
+//     1 if there is, in which case the answer is placed in out.
+//
+// The settled count in out is filled in whatever the outcome.
+int DijkstraPath(Graph g, GVertex_t s, GVertex_t t, PathResult *out);
+
+// Finds a shortest path from s to t by bidirectional Dijkstra. Takes and
+// returns the same as DijkstraPath.
+int BidirectionalPath(Graph g, GVertex_t s, GVertex_t t, PathResult *out);
+
+// Finds a shortest path from s to t by ALT, using the given landmarks.
+// Takes and returns the same as DijkstraPath. If the landmarks were not
+// computed for (or loaded against) this Graph, or it has changed since,
+// their bounds may be wrong, so the query falls back to DijkstraPath.
+int ALTPath(Graph g, Landmarks l, GVertex_t s, GVertex_t t,
+            PathResult *out);
+
+// Picks count landmarks and computes their distance tables, which take
+// 2 * count weights per vertex (count in an undirected Graph). Landmarks
+// are chosen by farthest-point sampling: each one is the vertex farthest
+// from those chosen so far, which spreads them around the edge of the
+// Graph, where they give the tightest bounds.
+//
+// The tables describe the Graph as it is. Any change to its vertices or
+// edges can leave a table distance longer than the new true distance, so
+// ALTPath stops using the landmarks (see above) until they are recomputed
+// or loaded again. A view has landmarks of its own, distinct from those of
+// the Graph it views.
+//
+// Returns the landmarks, or NULL on memory error or if count is not
+// positive.
+Landmarks ComputeLandmarks(Graph g, int count);
+
+// Frees landmarks.
+void FreeLandmarks(Landmarks l);
+
+// Returns the number of landmarks.
+int LandmarkCount(Landmarks l);
+
+// Writes the landmarks and their tables to a file at the given path, so
+// that they can be kept alongside the Graph. Landmarks computed for a view
+// are written for the vertices it shows only, and load into a view that
+// shows the same. Returns -1 if the file cannot be written, 0 on success.
+int SaveLandmarks(Landmarks l, const char *path);
+
+// Reads landmarks written by SaveLandmarks back for the given Graph.
+// Returns NULL if the file cannot be read, is corrupt, was written by a
+// build with a different Graph specialization, or describes a Graph with
+// different vertices, edges or weights (as told by a checksum of them), or
+// on memory error.
+Landmarks LoadLandmarks(Graph g, const char *path);
+
+#endif
@@ -0,0 +1,163 @@
+// Implementation of the open addressing vertex index.
+
+#include <stdlib.h>
+
+#include "./VertexIndex.h"
+
+// The number of slots in a new index.
+#define INITIAL_SLOTS 16
+
+// Helper function declarations
+bool ResizeVertexIndex(VertexIndex *idx, uint32_t slots);
+void PlaceSlot(VertexIndex *idx, GVertex_t v, struct ListItem *item);
+
+// Allocates a table with the given number of slots (a power of 2) and
+// moves every entry of the old table into it.
+bool ResizeVertexIndex(VertexIndex *idx, uint32_t slots) {
+  IndexSlot *old, *s;
+  uint32_t oldSlots, i;
+
+  old = idx->slots;
+  oldSlots = (old == NULL) ? 0 : idx->mask + 1;
+
+  idx->slots = (IndexSlot *)MemoryCalloc(idx->memory,
+                                         sizeof(IndexSlot) * slots);
+  if (idx->slots == NULL) {
+    idx->slots = old;
+    return false;
+  }
+  idx->mask = slots - 1;
+  idx->shift = 64 - __builtin_ctz(slots);
+
+  for (i = 0; i < oldSlots; i++) {
+    s = &old[i];
+    if (s->item != NULL) {
+      PlaceSlot(idx, s->key, s->item);
+    }
+  }
+
+  MemoryFree(idx->memory, old, sizeof(IndexSlot) * oldSlots);
+  return true;
+}
+
+// Stores v in the first free slot at or after its home slot.
+void PlaceSlot(VertexIndex *idx, GVertex_t v, struct ListItem *item) {
+  uint32_t i;
+
+  i = (uint32_t)(VertexIndexHome(idx, v) - idx->slots);
+  while (idx->slots[i].item != NULL) {
+    i = (i + 1) & idx->mask;
+  }
+  idx->slots[i].key = v;
+  idx->slots[i].item = item;
+}
+
+bool InitVertexIndex(VertexIndex *idx, GraphMemory *m) {
+  idx->memory = m;
+  idx->slots = NULL;
+  idx->count = 0;
+  return ResizeVertexIndex(idx, INITIAL_SLOTS);
+}
+
+bool InitVertexIndexSized(VertexIndex *idx, int count, GraphMemory *m) {
+  uint32_t slots;
+
+  // the same at-most-half-full rule VertexIndexInsert follows
+  for (slots = INITIAL_SLOTS; slots < 2 * (uint32_t)count; slots *= 2) {
+  }
+
+  idx->memory = m;
+  idx->slots = NULL;
+  idx->count = 0;
+  return ResizeVertexIndex(idx, slots);
+}
+
+void FreeVertexIndex(VertexIndex *idx) {
+  MemoryFree(idx->memory, idx->slots, sizeof(IndexSlot) * (idx->mask + 1));
+  idx->slots = NULL;
+}
+
+struct ListItem *VertexIndexFind(const VertexIndex *idx, GVertex_t v,
+                                 int *probes) {
+  uint32_t i;
+  int n = 0;
+
+  i = (uint32_t)(VertexIndexHome(idx, v) - idx->slots);
+  for (;;) {
+    n++;
+    if (idx->slots[i].item == NULL || idx->slots[i].key == v) {
+      break;
+    }
+    i = (i + 1) & idx->mask;
+  }
+
+  *probes = n;
+  return idx->slots[i].item;
+}
+
+bool VertexIndexInsert(VertexIndex *idx, GVertex_t v, struct ListItem *item) {
+  // keep the table at most half full so that probe sequences stay short
+  if (2 * (uint32_t)(idx->count + 1) > idx->mask + 1) {
+    if (!ResizeVertexIndex(idx, 2 * (idx->mask + 1))) {
+      return false;
+    }
+  }
+
+  PlaceSlot(idx, v, item);
+  idx->count++;
+  return true;
+}
+
+void VertexIndexInsertConcurrent(VertexIndex *idx, GVertex_t v,
+                                 struct ListItem *item) {
+  struct ListItem *expected;
+  uint32_t i;
+
+  // Claim the first free slot by swapping its item in. Keys are unique, so
+  // other inserting threads never need to read the key we write after.
+  i = (uint32_t)(VertexIndexHome(idx, v) - idx->slots);
+  for (;;) {
+    expected = NULL;
+    if (__atomic_compare_exchange_n(&idx->slots[i].item, &expected, item,
+                                    false, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      break;
+    }
+    i = (i + 1) & idx->mask;
+  }
+  idx->slots[i].key = v;
+}
+
+void VertexIndexRemove(VertexIndex *idx, GVertex_t v) {
+  uint32_t hole, i, home;
+
+  hole = (uint32_t)(VertexIndexHome(idx, v) - idx->slots);
+  while (idx->slots[hole].key != v) {
+    if (idx->slots[hole].item == NULL) {
+      return;  // not present
+    }
+    hole = (hole + 1) & idx->mask;
+  }
+  if (idx->slots[hole].item == NULL) {
+    return;
+  }
+
+  // Rather than leaving a tombstone, shift later members of the probe
+  // sequence back into the hole. An entry can fill the hole only if its
+  // home slot is not cyclically in (hole, i].
+  i = hole;
+  for (;;) {
+    i = (i + 1) & idx->mask;
+    if (idx->slots[i].item == NULL) {
+      break;
+    }
+    home = (uint32_t)(VertexIndexHome(idx, idx->slots[i].key) - idx->slots);
+    if (((i - home) & idx->mask) >= ((i - hole) & idx->mask)) {
+      idx->slots[hole] = idx->slots[i];
+      hole = i;
+    }
+  }
+
+  idx->slots[hole].item = NULL;
+  idx->count--;
+}
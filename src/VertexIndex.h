@@ -0,0 +1,73 @@
+// A hash index from vertex values to the ListItems that hold them, so that
+// the Graph can find a vertex without walking its whole vertex list.
+//
+// The index is an open addressing hash table with linear probing. Each slot
+// stores the vertex value alongside the ListItem pointer, so a lookup only
+// touches the table until it finds a match. The table is kept at most half
+// full, and doubles in size when an insertion would exceed that.
+
+#ifndef _VERTEX_INDEX_H_
+#define _VERTEX_INDEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "./Graph.h"
+#include "./GraphAlloc_priv.h"
+
+struct ListItem;
+
+// A slot is empty if its item is NULL.
+typedef struct IndexSlot {
+  GVertex_t         key;
+  struct ListItem  *item;
+} IndexSlot;
+
+typedef struct VertexIndex {
+  IndexSlot   *slots;
+  uint32_t     mask;    // number of slots - 1; a power of 2, less 1
+  int          shift;   // 64 - log2(number of slots), for the hash function
+  int          count;   // number of occupied slots
+  GraphMemory *memory;  // where the table comes from, or NULL for malloc
+} VertexIndex;
+
+// Initializes an empty index, whose table comes from the given accounts,
+// or from malloc if they are NULL. Returns false on memory error.
+bool InitVertexIndex(VertexIndex *idx, GraphMemory *m);
+
+// Initializes an empty index with room for count vertices without resizing.
+// Returns false on memory error.
+bool InitVertexIndexSized(VertexIndex *idx, int count, GraphMemory *m);
+
+// Releases the memory held by the index (but not the indexed ListItems).
+void FreeVertexIndex(VertexIndex *idx);
+
+// Returns the slot a search for v starts at. Exposed so that batched
+// lookups can prefetch it ahead of time.
+static inline IndexSlot *VertexIndexHome(const VertexIndex *idx, GVertex_t v) {
+  // Fibonacci hashing: multiply by 2^64 / phi and keep the top bits
+  uint64_t h = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+  return &idx->slots[h >> idx->shift];
+}
+
+// Returns the ListItem for v, or NULL if v is not in the index. Places the
+// number of slots examined in probes.
+struct ListItem *VertexIndexFind(const VertexIndex *idx, GVertex_t v,
+                                 int *probes);
+
+// Inserts the ListItem for v, which must not already be in the index.
+// Returns false on memory error, in which case the index is unchanged.
+bool VertexIndexInsert(VertexIndex *idx, GVertex_t v, struct ListItem *item);
+
+// Inserts the ListItem for v, which must not already be in the index, and
+// must fit without resizing (see InitVertexIndexSized). Unlike
+// VertexIndexInsert, this may be called from several threads at once, but
+// not concurrently with any other operation on the index. The index's
+// count is left for the caller to set once all the threads are done.
+void VertexIndexInsertConcurrent(VertexIndex *idx, GVertex_t v,
+                                 struct ListItem *item);
+
+// Removes v from the index, if present.
+void VertexIndexRemove(VertexIndex *idx, GVertex_t v);
+
+#endif
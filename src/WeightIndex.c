@@ -0,0 +1,304 @@
+// Implementation of the weight index (see WeightIndex.h).
+//
+// Keeping the spans sorted makes every query a binary search, at the cost
+// of moving the heavier part of a span along on every insertion and
+// removal. The spans grow by doubling, and only shrink when the index is
+// rebuilt, as vertex degrees tend to move back and forth.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./WeightIndex.h"
+#include "./WeightIndex_priv.h"
+#include "./GraphView_priv.h"
+
+// The smallest span, and the smallest table of spans, worth allocating.
+#define MIN_SPAN 4
+#define MIN_SPANS 16
+
+// Helper function declarations
+bool Lighter(GWeight_t w1, GVertex_t v1, GWeight_t w2, GVertex_t v2);
+int CompareNeighbors(const void *a, const void *b);
+WeightSpan *SpanOf(Graph g, ListItem *vertex);
+int FindPlace(const WeightSpan *span, GWeight_t w, GVertex_t v);
+void FreeSpans(Graph g, WeightSpan *spans, int capacity);
+
+int EnableWeightIndex(Graph g) {
+  WeightIndex *index;
+  WeightSpan *span;
+  ListItem *l;
+  EdgeItem *edge;
+  int capacity, degree, i;
+
+  if (g->weightIndex != NULL) {
+    return 0;
+  }
+
+  index = (WeightIndex *)MemoryAlloc(&g->memory, sizeof(WeightIndex));
+  if (index == NULL) {
+    return -1;
+  }
+  capacity = (g->numVertices < MIN_SPANS) ? MIN_SPANS : g->numVertices;
+  index->spans = (WeightSpan *)MemoryCalloc(&g->memory,
+                                            sizeof(WeightSpan) * capacity);
+  if (index->spans == NULL) {
+    MemoryFree(&g->memory, index, sizeof(WeightIndex));
+    return -1;
+  }
+  index->capacity = capacity;
+
+  // a view's index holds only the edges it shows
+  for (l = g->front; l != NULL; l = l->next) {
+    degree = VisibleDegree(g, l);
+    if (degree == 0) {
+      continue;
+    }
+    span = &index->spans[l->id];
+    span->items = (Neighbor *)MemoryAlloc(&g->memory,
+                                          sizeof(Neighbor) * degree);
+    if (span->items == NULL) {
+      FreeSpans(g, index->spans, index->capacity);
+      MemoryFree(&g->memory, index, sizeof(WeightIndex));
+      return -1;
+    }
+    span->capacity = degree;
+
+    i = 0;
+    for (edge = l->neighbors; edge != NULL; edge = edge->next) {
+      if (!EdgeVisible(g, l, edge, false)) {
+        continue;
+      }
+      memset(&span->items[i], 0, sizeof(Neighbor));
+      span->items[i].v = edge->data;
+      span->items[i].weight = EdgeWeight(edge);
+#if GRAPH_EDGE_PAYLOAD > 0
+      memcpy(span->items[i].payload, edge->payload, sizeof(edge->payload));
+#endif
+      i++;
+    }
+    span->count = i;
+    qsort(span->items, span->count, sizeof(Neighbor), CompareNeighbors);
+  }
+
+  g->weightIndex = index;
+  return 0;
+}
+
+void DisableWeightIndex(Graph g) {
+  WeightIndex *index = g->weightIndex;
+
+  if (index == NULL) {
+    return;
+  }
+  FreeSpans(g, index->spans, index->capacity);
+  MemoryFree(&g->memory, index, sizeof(WeightIndex));
+  g->weightIndex = NULL;
+}
+
+bool HasWeightIndex(Graph g) {
+  return g->weightIndex != NULL;
+}
+
+int GetNeighborsUpToWeight(Graph g, GVertex_t v, GWeight_t max,
+                           const Neighbor **out) {
+  ListItem *vertex;
+  WeightSpan *span;
+  int lo, hi, mid;
+
+  if (g->weightIndex == NULL) {
+    return -2;
+  }
+  vertex = FindVertex(g, v);
+  if (vertex == NULL) {
+    return -1;
+  }
+  span = SpanOf(g, vertex);
+  if (span == NULL) {
+    return 0;
+  }
+
+  // find the first neighbor heavier than max
+  lo = 0;
+  hi = span->count;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (span->items[mid].weight <= max) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *out = span->items;
+  return lo;
+}
+
+int GetLightestNeighbors(Graph g, GVertex_t v, int k, const Neighbor **out) {
+  ListItem *vertex;
+  WeightSpan *span;
+
+  if (g->weightIndex == NULL) {
+    return -2;
+  }
+  vertex = FindVertex(g, v);
+  if (vertex == NULL) {
+    return -1;
+  }
+  span = SpanOf(g, vertex);
+  if (span == NULL || k <= 0) {
+    return 0;
+  }
+  *out = span->items;
+  return (k < span->count) ? k : span->count;
+}
+
+bool WeightIndexReserve(Graph g, ListItem *vertex, int more) {
+  WeightIndex *index = g->weightIndex;
+  WeightSpan *spans, *span;
+  Neighbor *items;
+  int capacity;
+
+  if (index == NULL) {
+    return true;
+  }
+
+  if (vertex->id >= index->capacity) {
+    capacity = index->capacity * 2;
+    if (capacity <= vertex->id) {
+      capacity = vertex->id + 1;
+    }
+    spans = (WeightSpan *)MemoryRealloc(&g->memory, index->spans,
+                                        sizeof(WeightSpan) * index->capacity,
+                                        sizeof(WeightSpan) * capacity);
+    if (spans == NULL) {
+      return false;
+    }
+    memset(spans + index->capacity, 0,
+           sizeof(WeightSpan) * (capacity - index->capacity));
+    index->spans = spans;
+    index->capacity = capacity;
+  }
+
+  span = &index->spans[vertex->id];
+  if (span->count + more <= span->capacity) {
+    return true;
+  }
+  capacity = (span->capacity < MIN_SPAN) ? MIN_SPAN : span->capacity * 2;
+  if (capacity < span->count + more) {
+    capacity = span->count + more;
+  }
+  items = (Neighbor *)MemoryRealloc(&g->memory, span->items,
+                                    sizeof(Neighbor) * span->capacity,
+                                    sizeof(Neighbor) * capacity);
+  if (items == NULL) {
+    return false;
+  }
+  span->items = items;
+  span->capacity = capacity;
+  return true;
+}
+
+void WeightIndexInsert(Graph g, ListItem *vertex, const EdgeItem *edge) {
+  WeightSpan *span;
+  Neighbor *item;
+  int place;
+
+  if (g->weightIndex == NULL) {
+    return;
+  }
+
+  span = &g->weightIndex->spans[vertex->id];
+  place = FindPlace(span, EdgeWeight(edge), edge->data);
+  memmove(&span->items[place + 1], &span->items[place],
+          sizeof(Neighbor) * (span->count - place));
+  span->count++;
+
+  item = &span->items[place];
+  memset(item, 0, sizeof(Neighbor));
+  item->v = edge->data;
+  item->weight = EdgeWeight(edge);
+#if GRAPH_EDGE_PAYLOAD > 0
+  memcpy(item->payload, edge->payload, sizeof(edge->payload));
+#endif
+}
+
+void WeightIndexUpdate(Graph g, ListItem *vertex, const EdgeItem *edge) {
+  if (g->weightIndex == NULL) {
+    return;
+  }
+
+  // the room the edge leaves is the room it needs
+  WeightIndexRemove(g, vertex, edge->data);
+  WeightIndexInsert(g, vertex, edge);
+}
+
+void WeightIndexRemove(Graph g, ListItem *vertex, GVertex_t v) {
+  WeightSpan *span;
+  int i;
+
+  if (g->weightIndex == NULL) {
+    return;
+  }
+
+  span = &g->weightIndex->spans[vertex->id];
+  for (i = 0; i < span->count; i++) {
+    if (span->items[i].v == v) {
+      memmove(&span->items[i], &span->items[i + 1],
+              sizeof(Neighbor) * (span->count - i - 1));
+      span->count--;
+      return;
+    }
+  }
+}
+
+// Returns true if an edge of weight w1 to v1 comes before an edge of weight
+// w2 to v2 in a span.
+bool Lighter(GWeight_t w1, GVertex_t v1, GWeight_t w2, GVertex_t v2) {
+  return w1 < w2 || (w1 == w2 && v1 < v2);
+}
+
+// Orders Neighbors as they are in a span, for qsort.
+int CompareNeighbors(const void *a, const void *b) {
+  const Neighbor *n1 = (const Neighbor *)a, *n2 = (const Neighbor *)b;
+
+  if (Lighter(n1->weight, n1->v, n2->weight, n2->v)) {
+    return -1;
+  }
+  return Lighter(n2->weight, n2->v, n1->weight, n1->v) ? 1 : 0;
+}
+
+// Returns the span of a vertex, or NULL if it has no edges.
+WeightSpan *SpanOf(Graph g, ListItem *vertex) {
+  WeightSpan *span;
+
+  if (vertex->id >= g->weightIndex->capacity) {
+    return NULL;
+  }
+  span = &g->weightIndex->spans[vertex->id];
+  return (span->count > 0) ? span : NULL;
+}
+
+// Returns the place in a span at which an edge of weight w to v belongs.
+int FindPlace(const WeightSpan *span, GWeight_t w, GVertex_t v) {
+  int lo = 0, hi = span->count, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (Lighter(span->items[mid].weight, span->items[mid].v, w, v)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Frees a table of spans, and every span in it.
+void FreeSpans(Graph g, WeightSpan *spans, int capacity) {
+  int i;
+
+  for (i = 0; i < capacity; i++) {
+    MemoryFree(&g->memory, spans[i].items,
+               sizeof(Neighbor) * spans[i].capacity);
+  }
+  MemoryFree(&g->memory, spans, sizeof(WeightSpan) * capacity);
+}
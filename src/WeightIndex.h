@@ -0,0 +1,56 @@
+// Neighbor queries by edge weight: the neighbors of a vertex reached over
+// edges no heavier than a threshold, and the k lightest edges of a vertex.
+//
+// Answering these from GetNeighbors means copying a vertex's whole
+// adjacency and filtering it. Instead, a Graph can keep a weight index: for
+// every vertex, a copy of its edges as an array of Neighbors, ordered by
+// weight (and by vertex, among equal weights). A query finds its answer in
+// that array by binary search and hands out a span of it, without copying.
+//
+// The index is optional, as it costs as much memory again as the edges
+// themselves, and makes adding and removing edges take time linear in the
+// degree of their vertices. Once enabled, it is kept up to date by
+// AddGraphEdge, RemoveGraphEdge and SetEdgePayload. In a directed Graph it
+// holds the edges leaving each vertex.
+//
+// The spans handed out belong to the Graph, and are only valid until the
+// Graph is next changed.
+
+#ifndef _WEIGHT_INDEX_H_
+#define _WEIGHT_INDEX_H_
+
+#include <stdbool.h>
+
+#include "./Graph.h"
+
+// Builds the Graph's weight index, which takes time O(E log E). Returns 0
+// if successful (or if the Graph already has one), or -1 on memory error.
+int EnableWeightIndex(Graph g);
+
+// Frees the Graph's weight index, if it has one.
+void DisableWeightIndex(Graph g);
+
+// Returns true if the Graph has a weight index.
+bool HasWeightIndex(Graph g);
+
+// Gets the neighbors of v reached over edges of weight at most max, lightest
+// first.
+//
+// Arguments:
+//
+//    -- g    the Graph.
+//    -- v    the vertex.
+//    -- max  the heaviest weight to include.
+//    -- out  set to the first of the neighbors, if there are any.
+//
+// Returns the number of neighbors, -1 if v is not in the Graph, or -2 if
+// the Graph has no weight index.
+int GetNeighborsUpToWeight(Graph g, GVertex_t v, GWeight_t max,
+                           const Neighbor **out);
+
+// Gets the neighbors of v reached over its k lightest edges, lightest first,
+// in the same way as GetNeighborsUpToWeight. Fewer are returned if v has
+// fewer than k edges.
+int GetLightestNeighbors(Graph g, GVertex_t v, int k, const Neighbor **out);
+
+#endif
@@ -0,0 +1,44 @@
+// The weight index's representation, and the calls through which the Graph
+// keeps it up to date (see WeightIndex.h).
+//
+// Each call does nothing if the Graph has no weight index. Adding an edge
+// must not fail halfway, so the room for it in the index is reserved before
+// the Graph is changed, and the edge is then inserted into that room.
+
+#ifndef _WEIGHT_INDEX_PRIV_H_
+#define _WEIGHT_INDEX_PRIV_H_
+
+#include <stdbool.h>
+
+#include "./Graph.h"
+#include "./Graph_priv.h"
+
+// The edges of one vertex, ordered by weight and then vertex.
+typedef struct WeightSpan {
+  Neighbor  *items;
+  int        count;
+  int        capacity;
+} WeightSpan;
+
+// The spans of every vertex, by vertex id. Vertices added since the index
+// was built may not have one yet.
+typedef struct weightindex {
+  WeightSpan  *spans;
+  int          capacity;
+} WeightIndex;
+
+// Makes room in the index for more edges of the given vertex. Returns false
+// on memory error.
+bool WeightIndexReserve(Graph g, ListItem *vertex, int more);
+
+// Adds the given edge of a vertex, in room reserved for it.
+void WeightIndexInsert(Graph g, ListItem *vertex, const EdgeItem *edge);
+
+// Moves the given edge of a vertex to the place its weight now calls for,
+// and copies its payload.
+void WeightIndexUpdate(Graph g, ListItem *vertex, const EdgeItem *edge);
+
+// Removes the edge from a vertex to v.
+void WeightIndexRemove(Graph g, ListItem *vertex, GVertex_t v);
+
+#endif
@@ -0,0 +1,129 @@
+// Test Suite for command trace replay.
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./CommandBatch_test.h"
+#include "../src/CommandBatch.h"
+#include "../src/Graph.h"
+
+// Helper function declarations.
+static int Replay(Graph g, const char *trace, CommandFormat format,
+                  char **out, BatchReport *report);
+
+// Tests that a trace runs to its end, or to quit, skipping blank lines and
+// comments, and that every command is counted and timed.
+START_TEST(replay_test)
+{
+  const char *trace =
+    "# a small trace\n"
+    "edge 1 2 3\n"
+    "\n"
+    "edge 2 3 4\n"
+    "contains 2\n"
+    "contains 9\n"
+    "   \n"
+    "adj 1 3\n"
+    "bogus\n"
+    "quit\n"
+    "add 7\n";
+  unsigned long long ns = 0;
+  BatchReport report;
+  char *out;
+  Graph g;
+  int i;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert_int_eq(Replay(g, trace, COMMAND_TERSE, &out, &report), 0);
+  ck_assert_str_eq(out, "1\n0\n0\nerror: invalid command\n");
+  free(out);
+  ck_assert(!ContainsVertex(g, 7));
+
+  ck_assert_uint_eq(report.lines, 7);
+  ck_assert_uint_eq(report.commands[COMMAND_EDGE].calls, 2);
+  ck_assert_uint_eq(report.commands[COMMAND_CONTAINS].calls, 2);
+  ck_assert_uint_eq(report.commands[COMMAND_ADJ].calls, 1);
+  ck_assert_uint_eq(report.commands[COMMAND_INVALID].calls, 1);
+  ck_assert_uint_eq(report.commands[COMMAND_QUIT].calls, 1);
+  ck_assert_uint_eq(report.commands[COMMAND_ADD].calls, 0);
+  for (i = 0; i < NUM_COMMAND_KINDS; i++) {
+    ns += report.commands[i].totalNs;
+  }
+  ck_assert_uint_eq(ns, report.totalNs);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the same trace gives the same results in either format, as
+// far as the Graph is concerned, and that the report prints.
+START_TEST(formats_test)
+{
+  const char *trace = "edge 1 2 3\nneighbors 1\nremove 1 2\nadj 1 2\n";
+  BatchReport report;
+  char *out, *text;
+  size_t size;
+  Graph g;
+  FILE *f;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert_int_eq(Replay(g, trace, COMMAND_TEXT, &out, &report), 0);
+  ck_assert(strstr(out, "1 has edges to: (2") != NULL);
+  ck_assert(strstr(out, "1 and 2 are not neighbors") != NULL);
+  free(out);
+  FreeGraph(g);
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert_int_eq(Replay(g, trace, COMMAND_TERSE, &out, &report), 0);
+  ck_assert_str_eq(out, GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ? "1 2:1\n0\n" :
+                   "1 2:3\n0\n");
+  free(out);
+  FreeGraph(g);
+
+  f = open_memstream(&text, &size);
+  ck_assert(f != NULL);
+  PrintBatchReport(&report, f);
+  fclose(f);
+  ck_assert(strstr(text, "4 commands in") != NULL);
+  ck_assert(strstr(text, "neighbors") != NULL);
+  ck_assert(strstr(text, "khop") == NULL);
+  free(text);
+}
+END_TEST
+
+Suite *CommandBatchSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("CommandBatch");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, replay_test);
+  tcase_add_test(tc_core, formats_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function replaying a trace held in a string. The results are
+// stored in out, and must be free()'d.
+static int Replay(Graph g, const char *trace, CommandFormat format,
+                  char **out, BatchReport *report) {
+  size_t size;
+  FILE *in, *f;
+  int ret;
+
+  in = fmemopen((void *)trace, strlen(trace), "r");
+  f = open_memstream(out, &size);
+  ck_assert(in != NULL && f != NULL);
+  ret = RunCommandBatch(g, in, format, f, report);
+  fclose(in);
+  fclose(f);
+  return ret;
+}
@@ -0,0 +1,11 @@
+// Test Suite for command trace replay.
+
+#include <check.h>
+
+#ifndef _COMMAND_BATCH_TEST_H_
+#define _COMMAND_BATCH_TEST_H_
+
+// Returns the test suite for command trace replay.
+Suite *CommandBatchSuite();
+
+#endif
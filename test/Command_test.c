@@ -0,0 +1,186 @@
+// Test Suite for the CLI's command language.
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./Command_test.h"
+#include "../src/Command.h"
+#include "../src/Graph.h"
+
+// Helper function declarations.
+static bool Run(Graph g, const char *line, char **out);
+static void AssertOutput(Graph g, const char *line, const char *expected);
+static void AssertTerse(Graph g, const char *line, CommandKind kind,
+                        const char *expected);
+
+// Tests that each command does what it says, and reports it.
+START_TEST(commands_test)
+{
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  AssertOutput(g, "add 5\n", "");
+  AssertOutput(g, "contains 5\n", "the graph contains 5\n");
+  AssertOutput(g, "contains -7\n", "the graph does not contain -7\n");
+  AssertOutput(g, "edge 1 2 3\n", "");
+  AssertOutput(g, "adj 2 1", "2 and 1 are neighbors\n");
+  AssertOutput(g, "neighbors 1\n", GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ?
+               "1 has edges to: (2, weight: 1)\n" :
+               "1 has edges to: (2, weight: 3)\n");
+  AssertOutput(g, "neighbors 5\n", "5 has no neighbors\n");
+  AssertOutput(g, "neighbors 9\n", "9 is not in the graph\n");
+  AssertOutput(g, "in 9\n", "9 is not in the graph\n");
+  AssertOutput(g, "edge 2 3 4\n", "");
+  if (GRAPH_WEIGHT == GRAPH_WEIGHT_INT) {
+    AssertOutput(g, "path 1 3\n", "weight 7, 2 hops: 1 2 3\n");
+  }
+  AssertOutput(g, "path 1 5\n", "no path from 1 to 5\n");
+  AssertOutput(g, "remove 1 2\n", "");
+  AssertOutput(g, "adj 1 2\n", "1 and 2 are not neighbors\n");
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that malformed arguments are refused without touching the Graph.
+START_TEST(invalid_arguments_test)
+{
+  GraphSummary s;
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  AssertOutput(g, "add\n", "error: invalid arguments to add\n");
+  AssertOutput(g, "add 12abc\n", "error: invalid arguments to add\n");
+  AssertOutput(g, "edge 1 2\n", "error: invalid arguments to edge\n");
+  AssertOutput(g, "edge 1 2 -1\n", "error: invalid arguments to edge\n");
+  AssertOutput(g, "edge 1 2 nan\n", "error: invalid arguments to edge\n");
+  AssertOutput(g, "edge 1 2 1e300\n", "error: invalid arguments to edge\n");
+  AssertOutput(g, "edge 1 1 2\n", "error: self-loops are not permitted\n");
+  AssertOutput(g, "khop 1 -1\n", "error: invalid arguments to khop\n");
+  AssertOutput(g, "add 99999999999999999999999\n",
+               "error: invalid arguments to add\n");
+  if (sizeof(GVertex_t) == 4) {
+    AssertOutput(g, "add 4294967296\n", "error: invalid arguments to add\n");
+  }
+  AssertOutput(g, "frobnicate\n", "error: invalid command\n");
+  AssertOutput(g, " \t\n", "error: unknown command\n");
+  AssertOutput(g, "", "error: unknown command\n");
+
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0 && s.edges == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests the terse results, and the kinds of command reported.
+START_TEST(terse_test)
+{
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  AssertTerse(g, "edge 1 2 3\n", COMMAND_EDGE, "");
+  AssertTerse(g, "edge 2 3 4\n", COMMAND_EDGE, "");
+  AssertTerse(g, "contains 1\n", COMMAND_CONTAINS, "1\n");
+  AssertTerse(g, "contains 7\n", COMMAND_CONTAINS, "0\n");
+  AssertTerse(g, "adj 2 1\n", COMMAND_ADJ, "1\n");
+  AssertTerse(g, "neighbors 9\n", COMMAND_NEIGHBORS, "-1\n");
+  AssertTerse(g, "in 3\n", COMMAND_IN, GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ?
+              "1 2:1\n" : "1 2:4\n");
+  AssertTerse(g, "khop 3 0\n", COMMAND_KHOP, "1 3:0:0\n");
+  if (GRAPH_WEIGHT == GRAPH_WEIGHT_INT) {
+    AssertTerse(g, "path 1 3\n", COMMAND_PATH, "1 7 1 2 3\n");
+  }
+  AssertTerse(g, "add 5\n", COMMAND_ADD, "");
+  AssertTerse(g, "path 1 5\n", COMMAND_PATH, "0\n");
+  AssertTerse(g, "path 1 6\n", COMMAND_PATH, "-1\n");
+  AssertTerse(g, "adj 1\n", COMMAND_ADJ, "error: invalid arguments to adj\n");
+  AssertTerse(g, "frobnicate\n", COMMAND_INVALID, "error: invalid command\n");
+  AssertTerse(g, "quit\n", COMMAND_QUIT, "");
+  ck_assert_str_eq(CommandName(COMMAND_KHOP), "khop");
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that only quit ends the session.
+START_TEST(quit_test)
+{
+  char *out;
+  Graph g;
+
+  g = AllocateDirectedGraph();
+  ck_assert(g != NULL);
+  ck_assert(!Run(g, "help\n", &out));
+  ck_assert(strstr(out, "quit =>") != NULL);
+  free(out);
+  ck_assert(!Run(g, "quitter\n", &out));
+  free(out);
+  ck_assert(Run(g, "quit\n", &out));
+  ck_assert(strcmp(out, "") == 0);
+  free(out);
+  FreeGraph(g);
+}
+END_TEST
+
+Suite *CommandSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Command");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, commands_test);
+  tcase_add_test(tc_core, invalid_arguments_test);
+  tcase_add_test(tc_core, terse_test);
+  tcase_add_test(tc_core, quit_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function running one line, and returning whether it was quit. The
+// output is stored in out, and must be free()'d.
+static bool Run(Graph g, const char *line, char **out) {
+  char input[256];
+  size_t size;
+  bool quit;
+  FILE *f;
+
+  f = open_memstream(out, &size);
+  ck_assert(f != NULL);
+  strcpy(input, line);
+  quit = RunCommand(g, input, f);
+  fclose(f);
+  return quit;
+}
+
+// Helper function asserting that a line, not quit, writes the given output.
+static void AssertOutput(Graph g, const char *line, const char *expected) {
+  char *out;
+
+  ck_assert(!Run(g, line, &out));
+  ck_assert_msg(strcmp(out, expected) == 0, "%s gave %s", line, out);
+  free(out);
+}
+
+// Helper function asserting that a line, run with terse results, is of the
+// given kind and writes the given output.
+static void AssertTerse(Graph g, const char *line, CommandKind kind,
+                        const char *expected) {
+  char input[256], *out;
+  size_t size;
+  FILE *f;
+
+  f = open_memstream(&out, &size);
+  ck_assert(f != NULL);
+  strcpy(input, line);
+  ck_assert_int_eq(RunCommandFormatted(g, input, COMMAND_TERSE, f), kind);
+  fclose(f);
+  ck_assert_msg(strcmp(out, expected) == 0, "%s gave %s", line, out);
+  free(out);
+}
@@ -0,0 +1,11 @@
+// Test Suite for the CLI's command language.
+
+#include <check.h>
+
+#ifndef _COMMAND_TEST_H_
+#define _COMMAND_TEST_H_
+
+// Returns the test suite for the CLI's command language.
+Suite *CommandSuite();
+
+#endif
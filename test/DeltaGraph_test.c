@@ -0,0 +1,384 @@
+// Test Suite for the DeltaGraph.
+
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "./DeltaGraph_test.h"
+#include "../src/Graph.h"
+#include "../src/DeltaGraph.h"
+#include "../src/GraphAllocator.h"
+
+#define RANDOM_VERTICES 60
+#define RANDOM_OPS 4000
+#define PATH_LENGTH 3000
+#define FAILURE_EDGES 40
+
+// The number of allocations to let through before failing one, or -1 to
+// fail none, and the number failed so far.
+static int failIn = -1;
+static int failed = 0;
+
+// Helper function declarations.
+static void AssertSameGraph(Graph g, DeltaGraph d);
+static void RandomUpdates(bool directed, bool freeze);
+static int CompareNeighbors(const void *a, const void *b);
+static void *ReaderThread(void *arg);
+static void *FailingAlloc(void *ctx, size_t size);
+static void *FailingRealloc(void *ctx, void *p, size_t oldSize, size_t size);
+static void FailingFree(void *ctx, void *p, size_t size);
+
+// The allocator the overlays in failure tests are made with.
+static const GraphAllocator failingAllocator = {
+  FailingAlloc, FailingRealloc, FailingFree, NULL
+};
+
+// Tests updates against an empty base, before and after merging.
+START_TEST(basic_test)
+{
+  DeltaGraphSummary s;
+  Neighbor *neighbors;
+  DeltaGraph d;
+
+  d = AllocateDeltaGraph(false, 0);
+  ck_assert(d != NULL);
+  ck_assert(!IsDirectedDeltaGraph(d));
+  ck_assert(DeltaGetNeighbors(d, 1, &neighbors) == -1);
+  ck_assert(DeltaAddEdge(d, 1, 1, 1) == -1);
+
+  ck_assert(DeltaAddEdge(d, 1, 3, 4) == 0);
+  ck_assert(DeltaAddEdge(d, 1, 2, 5) == 0);
+  ck_assert(DeltaAddVertex(d, 7) == 0);
+  ck_assert(DeltaContainsVertex(d, 7));
+  ck_assert(DeltaAreAdjacent(d, 3, 1));
+  ck_assert(DeltaGetNeighbors(d, 7, &neighbors) == 0);
+  ck_assert(DeltaGetNeighbors(d, 1, &neighbors) == 2);
+  ck_assert(neighbors[0].v == 2 && neighbors[1].v == 3);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || neighbors[0].weight == 5);
+  free(neighbors);
+
+  ck_assert(MergeDeltaGraph(d) == 0);
+  GetDeltaGraphSummary(d, &s);
+  ck_assert(s.vertices == 4 && s.edges == 2);
+  ck_assert(s.baseEdges == 4 && s.deltaEntries == 0 && s.merges == 1);
+  ck_assert(DeltaContainsVertex(d, 7));
+
+  // a tombstone over the base, and an update of a base edge
+  ck_assert(DeltaRemoveEdge(d, 2, 1) == 0);
+  ck_assert(DeltaAddEdge(d, 3, 1, 9) == 0);
+  ck_assert(!DeltaAreAdjacent(d, 1, 2));
+  ck_assert(DeltaGetNeighbors(d, 1, &neighbors) == 1);
+  ck_assert(neighbors[0].v == 3);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || neighbors[0].weight == 9);
+  free(neighbors);
+  ck_assert(DeltaGetNeighbors(d, 2, &neighbors) == 0);
+  GetDeltaGraphSummary(d, &s);
+  ck_assert(s.vertices == 4 && s.edges == 1 && s.deltaEntries == 4);
+
+  // removing an edge that only lives in the overlay leaves no tombstone
+  ck_assert(DeltaAddEdge(d, 5, 6, 1) == 0);
+  ck_assert(DeltaRemoveEdge(d, 6, 5) == 0);
+  GetDeltaGraphSummary(d, &s);
+  ck_assert(s.vertices == 6 && s.edges == 1 && s.deltaEntries == 4);
+
+  ck_assert(MergeDeltaGraph(d) == 0);
+  GetDeltaGraphSummary(d, &s);
+  ck_assert(s.baseEdges == 2 && s.deltaEntries == 0 && s.merges == 2);
+  ck_assert(DeltaAreAdjacent(d, 3, 1) && !DeltaAreAdjacent(d, 1, 2));
+  FreeDeltaGraph(d);
+}
+END_TEST
+
+// Tests that a directed DeltaGraph keeps its edges one way.
+START_TEST(directed_test)
+{
+  DeltaNeighborIterator it;
+  DeltaGraph d;
+  Neighbor n;
+
+  d = AllocateDeltaGraph(true, 0);
+  ck_assert(d != NULL);
+  ck_assert(IsDirectedDeltaGraph(d));
+  ck_assert(DeltaAddEdge(d, 1, 2, 1) == 0);
+  ck_assert(DeltaAreAdjacent(d, 1, 2) && !DeltaAreAdjacent(d, 2, 1));
+  ck_assert(DeltaContainsVertex(d, 2));
+
+  ck_assert(StartDeltaNeighbors(d, 2, &it));
+  ck_assert(!NextDeltaNeighbor(&it, &n));
+  EndDeltaNeighbors(&it);
+  ck_assert(!StartDeltaNeighbors(d, 3, &it));
+  EndDeltaNeighbors(&it);
+
+  ck_assert(MergeDeltaGraph(d) == 0);
+  ck_assert(DeltaAreAdjacent(d, 1, 2) && !DeltaAreAdjacent(d, 2, 1));
+  FreeDeltaGraph(d);
+}
+END_TEST
+
+// Tests random updates against a Graph making the same updates, merging
+// now and then.
+START_TEST(matches_graph_test)
+{
+  RandomUpdates(false, false);
+  RandomUpdates(true, false);
+  RandomUpdates(false, true);
+  RandomUpdates(true, true);
+}
+END_TEST
+
+// Tests background merges while other threads read.
+START_TEST(background_merge_test)
+{
+  pthread_t readers[2];
+  DeltaGraphSummary s;
+  DeltaGraph d;
+  int i;
+
+  d = AllocateDeltaGraph(false, 64);
+  ck_assert(d != NULL);
+  for (i = 0; i < 2; i++) {
+    ck_assert(pthread_create(&readers[i], NULL, ReaderThread, d) == 0);
+  }
+  for (i = 0; i < PATH_LENGTH; i++) {
+    ck_assert(DeltaAddEdge(d, i, i + 1, i) == 0);
+    if (i % 3 == 0 && i > 0) {
+      ck_assert(DeltaRemoveEdge(d, i - 1, i) == 0);
+    }
+  }
+  for (i = 0; i < 2; i++) {
+    pthread_join(readers[i], NULL);
+  }
+
+  // the overlay passed the threshold, so a background merge must follow
+  for (i = 0; i < 1000; i++) {
+    GetDeltaGraphSummary(d, &s);
+    if (s.merges > 0) {
+      break;
+    }
+    usleep(10000);
+  }
+  ck_assert(s.merges > 0);
+  ck_assert(MergeDeltaGraph(d) == 0);
+  GetDeltaGraphSummary(d, &s);
+  ck_assert(s.vertices == PATH_LENGTH + 1);
+  ck_assert(s.edges == PATH_LENGTH - (PATH_LENGTH - 1) / 3);
+  for (i = 0; i < PATH_LENGTH; i++) {
+    ck_assert(DeltaAreAdjacent(d, i, i + 1) == ((i + 1) % 3 != 0 ||
+                                                i + 1 == PATH_LENGTH));
+  }
+  FreeDeltaGraph(d);
+}
+END_TEST
+
+// Tests every allocation DeltaAddEdge can fail on, one at a time, and that
+// a failed update leaves no trace: neither the rows it made room in nor the
+// vertices those rows brought in. Half of the edges join two new vertices,
+// the other half hang off vertex 0, whose row keeps growing.
+START_TEST(add_edge_failure_test)
+{
+  DeltaGraphSummary before, after;
+  GVertex_t v1, v2;
+  int directed, i, k, ret, count;
+  DeltaGraph d;
+
+  for (directed = 0; directed < 2; directed++) {
+    d = AllocateDeltaGraphWithAllocator(directed, 0, &failingAllocator);
+    ck_assert(d != NULL);
+    ck_assert(DeltaAddVertex(d, 0) == 0);
+
+    for (i = 0; i < FAILURE_EDGES; i++) {
+      v1 = (i % 2 == 0) ? 0 : 1000 + i;
+      v2 = 2000 + i;
+      GetDeltaGraphSummary(d, &before);
+      for (k = 0;; k++) {
+        count = failed;
+        failIn = k;
+        ret = DeltaAddEdge(d, v1, v2, 1);
+        failIn = -1;
+        ck_assert((failed > count) == (ret == -1));
+        if (ret == 0) {
+          break;
+        }
+        GetDeltaGraphSummary(d, &after);
+        ck_assert(after.vertices == before.vertices);
+        ck_assert(after.edges == before.edges);
+        ck_assert(after.deltaEntries == before.deltaEntries);
+        ck_assert(DeltaContainsVertex(d, v1) == (v1 == 0));
+        ck_assert(!DeltaContainsVertex(d, v2));
+      }
+      ck_assert(k > 0);
+    }
+
+    // the rows taken back left every other row where lookups find it
+    GetDeltaGraphSummary(d, &after);
+    ck_assert(after.vertices == 1 + FAILURE_EDGES + FAILURE_EDGES / 2);
+    ck_assert(after.edges == FAILURE_EDGES);
+    for (i = 0; i < FAILURE_EDGES; i++) {
+      v1 = (i % 2 == 0) ? 0 : 1000 + i;
+      ck_assert(DeltaAreAdjacent(d, v1, 2000 + i));
+      ck_assert(DeltaAreAdjacent(d, 2000 + i, v1) == !directed);
+    }
+    FreeDeltaGraph(d);
+  }
+}
+END_TEST
+
+Suite *DeltaGraphSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("DeltaGraph");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, basic_test);
+  tcase_add_test(tc_core, directed_test);
+  tcase_add_test(tc_core, matches_graph_test);
+  tcase_add_test(tc_core, background_merge_test);
+  tcase_add_test(tc_core, add_edge_failure_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function asserting that a DeltaGraph holds the same edges as a
+// Graph.
+static void AssertSameGraph(Graph g, DeltaGraph d) {
+  Neighbor *expected, *actual;
+  DeltaGraphSummary ds;
+  GraphSummary gs;
+  GVertex_t v;
+  int n, i;
+
+  GetGraphSummary(g, &gs);
+  GetDeltaGraphSummary(d, &ds);
+  ck_assert(gs.vertices == ds.vertices);
+  ck_assert(gs.edges == ds.edges);
+
+  for (v = 0; v < RANDOM_VERTICES; v++) {
+    ck_assert(ContainsVertex(g, v) == DeltaContainsVertex(d, v));
+    n = GetNeighbors(g, v, &expected);
+    ck_assert(DeltaGetNeighbors(d, v, &actual) == n);
+    if (n <= 0) {
+      continue;
+    }
+    qsort(expected, n, sizeof(Neighbor), CompareNeighbors);
+    for (i = 0; i < n; i++) {
+      ck_assert(expected[i].v == actual[i].v);
+      ck_assert(expected[i].weight == actual[i].weight);
+      ck_assert(DeltaAreAdjacent(d, v, actual[i].v));
+    }
+    free(expected);
+    free(actual);
+  }
+}
+
+// Helper function making the same random updates to a Graph and a
+// DeltaGraph, which starts either empty or frozen from a Graph, and
+// checking that they agree.
+static void RandomUpdates(bool directed, bool freeze) {
+  unsigned int seed = 11;
+  DeltaGraph d;
+  GVertex_t v1, v2;
+  Graph g;
+  int i;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  ck_assert(g != NULL);
+  if (freeze) {
+    for (i = 0; i < RANDOM_OPS / 4; i++) {
+      v1 = rand_r(&seed) % RANDOM_VERTICES;
+      v2 = rand_r(&seed) % RANDOM_VERTICES;
+      if (v1 != v2) {
+        ck_assert(AddGraphEdge(g, v1, v2, 1 + i % 7) == 0);
+      }
+    }
+    d = FreezeGraph(g, 0);
+  } else {
+    d = AllocateDeltaGraph(directed, 0);
+  }
+  ck_assert(d != NULL);
+  ck_assert(IsDirectedDeltaGraph(d) == directed);
+  AssertSameGraph(g, d);
+
+  for (i = 0; i < RANDOM_OPS; i++) {
+    v1 = rand_r(&seed) % RANDOM_VERTICES;
+    v2 = rand_r(&seed) % RANDOM_VERTICES;
+    if (v1 == v2) {
+      ck_assert(AddVertex(g, v1) == 0);
+      ck_assert(DeltaAddVertex(d, v1) == 0);
+    } else if (rand_r(&seed) % 3 == 0) {
+      RemoveGraphEdge(g, v1, v2);
+      ck_assert(DeltaRemoveEdge(d, v1, v2) == 0);
+    } else {
+      ck_assert(AddGraphEdge(g, v1, v2, 1 + i % 5) == 0);
+      ck_assert(DeltaAddEdge(d, v1, v2, 1 + i % 5) == 0);
+    }
+    if (i % 500 == 499) {
+      AssertSameGraph(g, d);
+      ck_assert(MergeDeltaGraph(d) == 0);
+      AssertSameGraph(g, d);
+    }
+  }
+
+  FreeDeltaGraph(d);
+  FreeGraph(g);
+}
+
+// Helper function ordering neighbors by vertex.
+static int CompareNeighbors(const void *a, const void *b) {
+  GVertex_t x = ((const Neighbor *)a)->v, y = ((const Neighbor *)b)->v;
+  return (x > y) - (x < y);
+}
+
+// Helper function walking neighbors while the main thread updates, and
+// checking that every walk comes back in order.
+static void *ReaderThread(void *arg) {
+  DeltaGraph d = (DeltaGraph)arg;
+  DeltaNeighborIterator it;
+  GVertex_t last;
+  Neighbor n;
+  int i;
+
+  for (i = 0; i < 20 * PATH_LENGTH; i++) {
+    StartDeltaNeighbors(d, i % PATH_LENGTH, &it);
+    last = -1;
+    while (NextDeltaNeighbor(&it, &n)) {
+      ck_assert(n.v > last);
+      ck_assert(n.v == i % PATH_LENGTH - 1 || n.v == i % PATH_LENGTH + 1);
+      last = n.v;
+    }
+    EndDeltaNeighbors(&it);
+  }
+  return NULL;
+}
+
+// Helper functions making up the failing allocator: the system allocator,
+// but for the allocation the countdown reaches.
+static void *FailingAlloc(void *ctx, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  if (failIn >= 0 && failIn-- == 0) {
+    failed++;
+    return NULL;
+  }
+  return system->alloc(system->ctx, size);
+}
+
+static void *FailingRealloc(void *ctx, void *p, size_t oldSize, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  if (failIn >= 0 && failIn-- == 0) {
+    failed++;
+    return NULL;
+  }
+  return system->realloc(system->ctx, p, oldSize, size);
+}
+
+static void FailingFree(void *ctx, void *p, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  system->free(system->ctx, p, size);
+}
@@ -0,0 +1,11 @@
+// Test Suite for the DeltaGraph.
+
+#include <check.h>
+
+#ifndef _DELTA_GRAPH_TEST_H_
+#define _DELTA_GRAPH_TEST_H_
+
+// Returns the test suite for the DeltaGraph.
+Suite *DeltaGraphSuite();
+
+#endif
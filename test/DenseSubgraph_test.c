@@ -0,0 +1,285 @@
+// Test Suite for k-core decomposition and maximal clique enumeration.
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "./DenseSubgraph_test.h"
+#include "../src/Graph.h"
+#include "../src/DenseSubgraph.h"
+
+#define RANDOM_VERTICES 300
+#define BRUTE_VERTICES 16
+#define PLANTED 280
+#define EXTRAS 20
+
+// The cliques a test has been told of, as bitmasks of vertices.
+typedef struct CliqueLog {
+  uint32_t cliques[1 << BRUTE_VERTICES];
+  int      count;
+  int      sizes[PLANTED + 2];  // how many were found of each size
+  int      stopAfter;           // or 0 to never stop
+} CliqueLog;
+
+// Helper function declarations.
+static Graph SmallGraph();
+static bool LogClique(const GVertex_t *clique, int size, void *arg);
+static int CoreOf(const VertexCore *cores, int n, GVertex_t v);
+
+// Tests core numbers on a K4 with a tail and an isolated vertex.
+START_TEST(cores_test)
+{
+  VertexCore *cores;
+  int i, n;
+  Graph g;
+
+  g = SmallGraph();
+  n = GetCoreNumbers(g, &cores);
+  ck_assert_int_eq(n, 7);
+  for (i = 1; i < n; i++) {
+    ck_assert(cores[i - 1].core <= cores[i].core);
+  }
+  for (i = 0; i < 4; i++) {
+    ck_assert_int_eq(CoreOf(cores, n, i), 3);
+  }
+  ck_assert_int_eq(CoreOf(cores, n, 4), 1);
+  ck_assert_int_eq(CoreOf(cores, n, 5), 1);
+  ck_assert_int_eq(CoreOf(cores, n, 6), 0);
+  free(cores);
+  FreeGraph(g);
+
+  g = AllocateGraph();
+  ck_assert_int_eq(GetCoreNumbers(g, &cores), 0);
+  ck_assert_int_eq(GetCoreNumbersParallel(g, 2, &cores), 0);
+  FreeGraph(g);
+
+  g = AllocateDirectedGraph();
+  ck_assert_int_eq(AddGraphEdge(g, 0, 1, 1), 0);
+  ck_assert_int_eq(GetCoreNumbers(g, &cores), -1);
+  ck_assert_int_eq(GetCoreNumbersParallel(g, 2, &cores), -1);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the parallel decomposition agrees with the sequential one on
+// a random Graph, whatever the number of threads.
+START_TEST(parallel_test)
+{
+  unsigned int seed = 42;
+  VertexCore *expected, *cores;
+  int i, n, threads;
+  Graph g;
+
+  g = AllocateGraph();
+  for (i = 0; i < RANDOM_VERTICES * 6; i++) {
+    AddGraphEdge(g, rand_r(&seed) % RANDOM_VERTICES,
+                 rand_r(&seed) % (RANDOM_VERTICES / 3), 1);
+  }
+  ck_assert_int_eq(AddVertex(g, RANDOM_VERTICES), 0);
+  n = GetCoreNumbers(g, &expected);
+  ck_assert(n > RANDOM_VERTICES / 3);
+
+  for (threads = 0; threads < 5; threads++) {
+    ck_assert_int_eq(GetCoreNumbersParallel(g, threads, &cores), n);
+    for (i = 0; i < n; i++) {
+      ck_assert_int_eq(CoreOf(expected, n, cores[i].v), cores[i].core);
+    }
+    free(cores);
+  }
+  free(expected);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests clique enumeration on a K4 with a tail and an isolated vertex,
+// with a minimum size, and stopped early.
+START_TEST(cliques_test)
+{
+  CliqueLog *log;
+  Graph g;
+
+  log = (CliqueLog *)calloc(1, sizeof(CliqueLog));
+  g = SmallGraph();
+  ck_assert_int_eq(ForEachMaximalClique(g, 1, LogClique, log), 4);
+  ck_assert_int_eq(log->count, 4);
+  ck_assert_int_eq(log->sizes[4], 1);
+  ck_assert_int_eq(log->sizes[2], 2);
+  ck_assert_int_eq(log->sizes[1], 1);
+
+  log->count = 0;
+  ck_assert_int_eq(ForEachMaximalClique(g, 3, LogClique, log), 1);
+  ck_assert(log->cliques[0] == 0xF);
+
+  log->count = 0;
+  log->stopAfter = 2;
+  ck_assert_int_eq(ForEachMaximalClique(g, 0, LogClique, log), 2);
+  FreeGraph(g);
+
+  g = AllocateDirectedGraph();
+  ck_assert_int_eq(AddGraphEdge(g, 0, 1, 1), 0);
+  ck_assert_int_eq(ForEachMaximalClique(g, 1, LogClique, log), -1);
+  FreeGraph(g);
+  free(log);
+}
+END_TEST
+
+// Tests clique enumeration against every subset of the vertices of small
+// random Graphs.
+START_TEST(brute_force_test)
+{
+  unsigned int seed = 7;
+  uint32_t adj[BRUTE_VERTICES], set, bits;
+  CliqueLog *log;
+  int round, v, u, i, expected;
+  bool clique;
+  Graph g;
+
+  log = (CliqueLog *)calloc(1, sizeof(CliqueLog));
+  for (round = 0; round < 4; round++) {
+    g = AllocateGraph();
+    for (v = 0; v < BRUTE_VERTICES; v++) {
+      adj[v] = 0;
+      ck_assert_int_eq(AddVertex(g, v), 0);
+    }
+    for (v = 0; v < BRUTE_VERTICES; v++) {
+      for (u = v + 1; u < BRUTE_VERTICES; u++) {
+        if (rand_r(&seed) % 4 < round + 1) {
+          ck_assert_int_eq(AddGraphEdge(g, v, u, 1), 0);
+          adj[v] |= 1u << u;
+          adj[u] |= 1u << v;
+        }
+      }
+    }
+
+    log->count = 0;
+    ck_assert_int_eq(ForEachMaximalClique(g, 0, LogClique, log),
+                     log->count);
+    expected = 0;
+    for (set = 1; set < (1u << BRUTE_VERTICES); set++) {
+      clique = true;
+      for (bits = set; bits != 0 && clique; bits &= bits - 1) {
+        v = __builtin_ctz(bits);
+        clique = (set & ~(1u << v) & ~adj[v]) == 0;
+      }
+      for (v = 0; v < BRUTE_VERTICES && clique; v++) {
+        clique = (set & (1u << v)) || (set & ~adj[v]) != 0;
+      }
+      if (clique) {
+        for (i = 0; i < log->count && log->cliques[i] != set; i++) {
+        }
+        ck_assert(i < log->count);
+        expected++;
+      }
+    }
+    ck_assert_int_eq(log->count, expected);
+    FreeGraph(g);
+  }
+  free(log);
+}
+END_TEST
+
+// Tests a clique too large for a bitset search, with vertices each adjacent
+// to half of it.
+START_TEST(large_clique_test)
+{
+  unsigned int seed = 3;
+  CliqueLog *log;
+  int v, u, e;
+  Graph g;
+
+  log = (CliqueLog *)calloc(1, sizeof(CliqueLog));
+  g = AllocateGraph();
+  for (v = 0; v < PLANTED; v++) {
+    for (u = v + 1; u < PLANTED; u++) {
+      ck_assert_int_eq(AddGraphEdge(g, v, u, 1), 0);
+    }
+  }
+  for (e = 0; e < EXTRAS; e++) {
+    for (v = 0, u = 0; u < PLANTED / 2; v = (v + 1) % PLANTED) {
+      if (rand_r(&seed) % 2 && !AreAdjacent(g, PLANTED + e, v)) {
+        ck_assert_int_eq(AddGraphEdge(g, PLANTED + e, v, 1), 0);
+        u++;
+      }
+    }
+  }
+
+  ck_assert_int_eq(ForEachMaximalClique(g, 1, LogClique, log), EXTRAS + 1);
+  ck_assert_int_eq(log->sizes[PLANTED], 1);
+  ck_assert_int_eq(log->sizes[PLANTED / 2 + 1], EXTRAS);
+
+  // only the planted clique is large enough
+  log->count = 0;
+  ck_assert_int_eq(ForEachMaximalClique(g, PLANTED / 2 + 2, LogClique, log),
+                   1);
+  FreeGraph(g);
+  free(log);
+}
+END_TEST
+
+Suite *DenseSubgraphSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("DenseSubgraph");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, cores_test);
+  tcase_add_test(tc_core, parallel_test);
+  tcase_add_test(tc_core, cliques_test);
+  tcase_add_test(tc_core, brute_force_test);
+  tcase_add_test(tc_core, large_clique_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function returning a K4 on 0-3, with a tail 3-4-5, and an
+// isolated vertex 6.
+static Graph SmallGraph() {
+  Graph g;
+  int v, u;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  for (v = 0; v < 4; v++) {
+    for (u = v + 1; u < 4; u++) {
+      ck_assert_int_eq(AddGraphEdge(g, v, u, 1), 0);
+    }
+  }
+  ck_assert_int_eq(AddGraphEdge(g, 3, 4, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 4, 5, 1), 0);
+  ck_assert_int_eq(AddVertex(g, 6), 0);
+  return g;
+}
+
+// Helper function recording a clique in the CliqueLog arg, as a bitmask if
+// its vertices are small enough.
+static bool LogClique(const GVertex_t *clique, int size, void *arg) {
+  CliqueLog *log = (CliqueLog *)arg;
+  uint32_t set = 0;
+  int i;
+
+  for (i = 0; i < size; i++) {
+    if (clique[i] < 32) {
+      set |= 1u << clique[i];
+    }
+  }
+  if (log->count < (1 << BRUTE_VERTICES)) {
+    log->cliques[log->count] = set;
+  }
+  log->count++;
+  log->sizes[size]++;
+  return log->stopAfter == 0 || log->count < log->stopAfter;
+}
+
+// Helper function returning the core number listed for v.
+static int CoreOf(const VertexCore *cores, int n, GVertex_t v) {
+  int i;
+
+  for (i = 0; i < n && cores[i].v != v; i++) {
+  }
+  ck_assert(i < n);
+  return cores[i].core;
+}
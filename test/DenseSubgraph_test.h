@@ -0,0 +1,11 @@
+// Test Suite for k-core decomposition and maximal clique enumeration.
+
+#include <check.h>
+
+#ifndef _DENSE_SUBGRAPH_TEST_H_
+#define _DENSE_SUBGRAPH_TEST_H_
+
+// Returns the test suite for dense subgraph detection.
+Suite *DenseSubgraphSuite();
+
+#endif
@@ -0,0 +1,218 @@
+// Test Suite for the pluggable Graph allocators and memory accounting.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./GraphAllocator_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphAllocator.h"
+#include "../src/GraphBuilder.h"
+
+#define VERTICES 300
+#define OPS 20000
+
+// Helper function declarations.
+static void RunOperations(Graph g, unsigned int seed);
+static void AssertSameGraph(Graph g1, Graph g2);
+
+// Tests that Graphs built from every allocator hold the same thing after
+// the same operations, with the arenas' chunks small enough that some
+// blocks get chunks of their own.
+START_TEST(allocators_agree_test)
+{
+  GraphAllocator *arena, *huge;
+  Graph g, ga, gh;
+  int directed;
+
+  arena = AllocateArenaAllocator(4096);
+  huge = AllocateHugePageAllocator(0);
+  ck_assert(arena != NULL);
+  ck_assert(huge != NULL);
+
+  for (directed = 0; directed < 2; directed++) {
+    g = AllocateGraphWithAllocator(directed, SystemGraphAllocator(), 0);
+    ga = AllocateGraphWithAllocator(directed, arena, 0);
+    gh = AllocateGraphWithAllocator(directed, huge, 0);
+    ck_assert(g != NULL && ga != NULL && gh != NULL);
+    ck_assert(IsDirectedGraph(ga) == directed);
+
+    RunOperations(g, 39);
+    RunOperations(ga, 39);
+    RunOperations(gh, 39);
+    AssertSameGraph(g, ga);
+    AssertSameGraph(g, gh);
+
+    // every Graph has counted the same blocks
+    ck_assert_uint_eq(GraphBytesAllocated(ga), GraphBytesAllocated(g));
+    ck_assert_uint_eq(GraphBytesAllocated(gh), GraphBytesAllocated(g));
+
+    FreeGraph(g);
+    FreeGraph(ga);
+    FreeGraph(gh);
+  }
+
+  FreeArenaAllocator(arena);
+  FreeArenaAllocator(huge);
+}
+END_TEST
+
+// Tests that a Graph counts what it holds, and gives it all back.
+START_TEST(accounting_test)
+{
+  GraphEdge edges[] = { { 1, 2, 1 }, { 2, 3, 1 }, { 3, 1, 1 } };
+  size_t empty, vertices, edge;
+  Graph g;
+  int i;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  empty = GraphBytesAllocated(g);
+  ck_assert(empty > 0);
+  ck_assert_uint_eq(GraphMemoryLimit(g), 0);
+
+  for (i = 0; i < 10; i++) {
+    ck_assert_int_eq(AddVertex(g, i), 0);
+  }
+  vertices = GraphBytesAllocated(g);
+  ck_assert(vertices > empty);
+
+  // an undirected edge is two items, each the same size
+  ck_assert_int_eq(AddGraphEdge(g, 0, 1, 5), 0);
+  edge = GraphBytesAllocated(g) - vertices;
+  ck_assert(edge > 0 && edge % 2 == 0);
+  ck_assert_int_eq(AddGraphEdge(g, 2, 3, 5), 0);
+  ck_assert_uint_eq(GraphBytesAllocated(g), vertices + 2 * edge);
+
+  RemoveGraphEdge(g, 0, 1);
+  RemoveGraphEdge(g, 3, 2);
+  ck_assert_uint_eq(GraphBytesAllocated(g), vertices);
+  FreeGraph(g);
+
+  // built Graphs count their slabs, and edges added to them
+  g = BuildGraphParallel(edges, 3, 1);
+  ck_assert(g != NULL);
+  vertices = GraphBytesAllocated(g);
+  ck_assert(vertices > empty);
+  ck_assert_int_eq(AddGraphEdge(g, 1, 4, 1), 0);
+  ck_assert(GraphBytesAllocated(g) > vertices);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a Graph refuses to grow past its limit, and that an operation
+// refused leaves it as it was.
+START_TEST(limit_test)
+{
+  GraphAllocator *arena;
+  GraphSummary before, after;
+  size_t limit;
+  Graph g, full;
+  int i, ret;
+
+  // too small for even an empty Graph
+  ck_assert(AllocateGraphWithAllocator(false, SystemGraphAllocator(), 16) ==
+            NULL);
+
+  arena = AllocateArenaAllocator(0);
+  ck_assert(arena != NULL);
+  g = AllocateGraphWithAllocator(false, arena, 0);
+  ck_assert(g != NULL);
+  limit = GraphBytesAllocated(g) + 4096;
+  FreeGraph(g);
+
+  full = AllocateGraphWithAllocator(false, arena, limit);
+  ck_assert(full != NULL);
+  ck_assert_uint_eq(GraphMemoryLimit(full), limit);
+  for (i = 0;; i++) {
+    GetGraphSummary(full, &before);
+    ret = AddGraphEdge(full, 0, i + 1, i);
+    ck_assert(GraphBytesAllocated(full) <= limit);
+    if (ret == -1) {
+      break;
+    }
+    ck_assert_int_eq(ret, 0);
+  }
+  ck_assert(i > 0);
+  GetGraphSummary(full, &after);
+  ck_assert_int_eq(after.vertices, before.vertices);
+  ck_assert_int_eq(after.edges, before.edges);
+  ck_assert(!ContainsVertex(full, i + 1));
+
+  // lifting the limit lets it grow again, and lowering it stops it
+  SetGraphMemoryLimit(full, 0);
+  ck_assert_int_eq(AddGraphEdge(full, 0, i + 1, i), 0);
+  SetGraphMemoryLimit(full, GraphBytesAllocated(full));
+  ck_assert_int_eq(AddGraphEdge(full, 0, i + 2, i), -1);
+  ck_assert(!ContainsVertex(full, i + 2));
+
+  // freeing an edge makes room for one
+  RemoveGraphEdge(full, 0, 1);
+  ck_assert_int_eq(AddGraphEdge(full, 0, 1, 1), 0);
+
+  FreeGraph(full);
+  FreeArenaAllocator(arena);
+}
+END_TEST
+
+Suite *GraphAllocatorSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphAllocator");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, allocators_agree_test);
+  tcase_add_test(tc_core, accounting_test);
+  tcase_add_test(tc_core, limit_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function applying a random sequence of operations to a Graph,
+// the same for the same seed.
+static void RunOperations(Graph g, unsigned int seed) {
+  Neighbor *out;
+  int i, op, v1, v2, ret;
+
+  for (i = 0; i < OPS; i++) {
+    op = rand_r(&seed) % 10;
+    v1 = rand_r(&seed) % VERTICES;
+    v2 = (op < 2) ? 0 : rand_r(&seed) % VERTICES;
+    if (op < 7) {
+      // vertex 0 becomes a hub, growing the degree table
+      AddGraphEdge(g, v1, v2, op);
+    } else if (op < 9) {
+      RemoveGraphEdge(g, v1, v2);
+    } else {
+      ret = GetInNeighbors(g, v1, &out);
+      if (ret > 0) {
+        free(out);
+      }
+    }
+  }
+}
+
+// Helper function asserting that two Graphs have the same vertices and
+// edges, in the same order.
+static void AssertSameGraph(Graph g1, Graph g2) {
+  Neighbor *out1, *out2;
+  int v, i, n1, n2;
+
+  for (v = 0; v < VERTICES; v++) {
+    ck_assert(ContainsVertex(g1, v) == ContainsVertex(g2, v));
+    n1 = GetNeighbors(g1, v, &out1);
+    n2 = GetNeighbors(g2, v, &out2);
+    ck_assert_int_eq(n1, n2);
+    for (i = 0; i < n1; i++) {
+      ck_assert(out1[i].v == out2[i].v);
+      ck_assert(out1[i].weight == out2[i].weight);
+    }
+    if (n1 > 0) {
+      free(out1);
+      free(out2);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Test Suite for the pluggable Graph allocators and memory accounting.
+
+#include <check.h>
+
+#ifndef _GRAPH_ALLOCATOR_TEST_H_
+#define _GRAPH_ALLOCATOR_TEST_H_
+
+// Returns the test suite for the Graph allocators.
+Suite *GraphAllocatorSuite();
+
+#endif
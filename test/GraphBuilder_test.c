@@ -0,0 +1,213 @@
+// Test Suite for the parallel Graph builder.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./GraphBuilder_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphBuilder.h"
+
+// Helper function declarations.
+static void AssertSameGraph(Graph a, Graph b, int range);
+
+// Tests building from no edges, and from nothing but self-loops.
+START_TEST(empty_build_test)
+{
+  GraphEdge loops[2] = { { 1, 1, 0 }, { 2, 2, 0 } };
+  GraphSummary s;
+  Graph g;
+
+  g = BuildGraphParallel(NULL, 0, 4);
+  ck_assert(g != NULL);
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0);
+  FreeGraph(g);
+
+  g = BuildGraphParallel(loops, 2, 4);
+  ck_assert(g != NULL);
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0);
+  ck_assert(!ContainsVertex(g, 1));
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that duplicate edges keep the weight of their last occurrence, in
+// either direction.
+START_TEST(duplicate_edges_test)
+{
+  GraphEdge edges[4] = { { 1, 2, 5 }, { 2, 3, 1 }, { 2, 1, 7 }, { 1, 2, 9 } };
+  GraphSummary s;
+  Neighbor *out;
+  Graph g;
+
+  g = BuildGraphParallel(edges, 4, 2);
+  ck_assert(g != NULL);
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 3);
+  ck_assert(s.edges == 2);
+  ck_assert(GetNeighbors(g, 1, &out) == 1);
+  ck_assert(out[0].v == 2);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || out[0].weight == 9);
+  free(out);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the builder produces the same Graph as adding the edges one at
+// a time, for several thread counts.
+START_TEST(matches_serial_test)
+{
+  GraphEdge *edges;
+  Graph serial, built;
+  int i, threads, n = 20000;
+
+  edges = (GraphEdge *)malloc(sizeof(GraphEdge) * n);
+  ck_assert(edges != NULL);
+  srand(30);
+  serial = AllocateGraph();
+  for (i = 0; i < n; i++) {
+    edges[i].v1 = rand() % 3000 - 1000;
+    edges[i].v2 = rand() % 3000 - 1000;
+    edges[i].weight = rand() % 100;
+    AddGraphEdge(serial, edges[i].v1, edges[i].v2, edges[i].weight);
+  }
+
+  for (threads = 1; threads <= 8; threads *= 2) {
+    built = BuildGraphParallel(edges, n, threads);
+    ck_assert(built != NULL);
+    AssertSameGraph(serial, built, 3000);
+    FreeGraph(built);
+  }
+
+  FreeGraph(serial);
+  free(edges);
+}
+END_TEST
+
+// Tests that a directed build matches adding the edges one at a time, in
+// both directions of adjacency.
+START_TEST(directed_matches_serial_test)
+{
+  GraphEdge *edges;
+  Graph serial, built;
+  Neighbor *na, *nb;
+  int i, v, threads, n = 5000;
+
+  edges = (GraphEdge *)malloc(sizeof(GraphEdge) * n);
+  ck_assert(edges != NULL);
+  srand(32);
+  serial = AllocateDirectedGraph();
+  for (i = 0; i < n; i++) {
+    edges[i].v1 = rand() % 1000 - 1000;
+    edges[i].v2 = rand() % 1000 - 1000;
+    edges[i].weight = rand() % 100;
+    AddGraphEdge(serial, edges[i].v1, edges[i].v2, edges[i].weight);
+  }
+
+  for (threads = 1; threads <= 4; threads *= 4) {
+    built = BuildDirectedGraphParallel(edges, n, threads);
+    ck_assert(built != NULL);
+    ck_assert(IsDirectedGraph(built));
+    AssertSameGraph(serial, built, 1000);
+    for (v = -1000; v < 0; v++) {
+      i = GetInNeighbors(serial, v, &na);
+      ck_assert(GetInNeighbors(built, v, &nb) == i);
+      if (i > 0) {
+        free(na);
+        free(nb);
+      }
+    }
+    FreeGraph(built);
+  }
+
+  FreeGraph(serial);
+  free(edges);
+}
+END_TEST
+
+// Tests that a built Graph can be modified like any other, mixing edges in
+// its slabs with edges added afterwards.
+START_TEST(modify_built_graph_test)
+{
+  GraphEdge edges[3] = { { 1, 2, 1 }, { 2, 3, 1 }, { 3, 1, 1 } };
+  GraphSummary s;
+  Graph g;
+
+  g = BuildGraphParallel(edges, 3, 3);
+  ck_assert(g != NULL);
+
+  RemoveGraphEdge(g, 1, 2);
+  ck_assert(!AreAdjacent(g, 1, 2));
+  ck_assert(AddGraphEdge(g, 1, 2, 4) == 0);
+  ck_assert(AddGraphEdge(g, 1, 4, 4) == 0);
+  ck_assert(AddGraphEdge(g, 3, 1, 8) == 0);
+  RemoveGraphEdge(g, 2, 3);
+
+  ck_assert(AreAdjacent(g, 1, 2));
+  ck_assert(AreAdjacent(g, 4, 1));
+  ck_assert(!AreAdjacent(g, 2, 3));
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 4);
+  ck_assert(s.edges == 3);
+  ck_assert(s.minDegree == 1);
+  ck_assert(s.maxDegree == 3);
+  FreeGraph(g);
+}
+END_TEST
+
+Suite *GraphBuilderSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphBuilder");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, empty_build_test);
+  tcase_add_test(tc_core, duplicate_edges_test);
+  tcase_add_test(tc_core, matches_serial_test);
+  tcase_add_test(tc_core, directed_matches_serial_test);
+  tcase_add_test(tc_core, modify_built_graph_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function asserting that two Graphs whose vertices all lie in
+// [-1000, range - 1000) have the same vertices, edges and counters.
+static void AssertSameGraph(Graph a, Graph b, int range) {
+  GraphSummary sa, sb;
+  Neighbor *na, *nb;
+  int v, i, j, n;
+
+  GetGraphSummary(a, &sa);
+  GetGraphSummary(b, &sb);
+  ck_assert(sa.vertices == sb.vertices);
+  ck_assert(sa.edges == sb.edges);
+  ck_assert(sa.minDegree == sb.minDegree);
+  ck_assert(sa.maxDegree == sb.maxDegree);
+  for (i = 0; i < GRAPH_DEGREE_BUCKETS; i++) {
+    ck_assert(sa.degreeHistogram[i] == sb.degreeHistogram[i]);
+  }
+
+  for (v = -1000; v < range - 1000; v++) {
+    ck_assert(ContainsVertex(a, v) == ContainsVertex(b, v));
+    n = GetNeighbors(a, v, &na);
+    ck_assert(GetNeighbors(b, v, &nb) == n);
+    for (i = 0; i < n; i++) {
+      for (j = 0; j < n; j++) {
+        if (na[i].v == nb[j].v) {
+          break;
+        }
+      }
+      ck_assert(j < n);
+      ck_assert(na[i].weight == nb[j].weight);
+    }
+    if (n > 0) {
+      free(na);
+      free(nb);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Test Suite for the parallel Graph builder.
+
+#include <check.h>
+
+#ifndef _GRAPH_BUILDER_TEST_H_
+#define _GRAPH_BUILDER_TEST_H_
+
+// Returns the test suite for the parallel Graph builder.
+Suite *GraphBuilderSuite();
+
+#endif
@@ -0,0 +1,397 @@
+// Test Suite for Graph diffs.
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./GraphDiff_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphAllocator.h"
+#include "../src/GraphDiff.h"
+#include "../src/WeightIndex.h"
+
+#define VERTICES 150
+#define EDGES 600
+
+// Helper function declarations.
+static Graph CopyGraph(Graph g);
+static void AssertSameGraph(Graph g1, Graph g2);
+static void AssertSameDiff(const GraphDiff *d1, const GraphDiff *d2);
+static void WriteEdgeFile(Graph g, const char *path);
+static int CompareEdges(const void *a, const void *b);
+
+// Tests the diff of two small Graphs, and applying it.
+START_TEST(small_test)
+{
+  GraphDiff diff;
+  Graph from, to;
+
+  from = AllocateGraph();
+  ck_assert_int_eq(AddGraphEdge(from, 1, 2, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(from, 3, 2, 2), 0);
+  ck_assert_int_eq(AddGraphEdge(from, 3, 4, 3), 0);
+  ck_assert_int_eq(AddVertex(from, 9), 0);
+  to = AllocateGraph();
+  ck_assert_int_eq(AddGraphEdge(to, 2, 1, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(to, 2, 3, 5), 0);
+  ck_assert_int_eq(AddGraphEdge(to, 5, 4, 1), 0);
+  ck_assert_int_eq(AddVertex(to, 7), 0);
+
+  ck_assert_int_eq(DiffGraphs(from, to, &diff), 0);
+  ck_assert(!diff.directed);
+  ck_assert_uint_eq(diff.numVertices, 2);
+  ck_assert(diff.vertices[0] == 5 && diff.vertices[1] == 7);
+  ck_assert_uint_eq(diff.added, 1);
+  ck_assert_uint_eq(diff.removed, 1);
+  if (GRAPH_WEIGHT != GRAPH_WEIGHT_NONE) {
+    ck_assert_uint_eq(diff.numChanges, 3);
+    ck_assert_uint_eq(diff.reweighted, 1);
+    ck_assert(diff.changes[0].kind == EDGE_REWEIGHTED);
+    ck_assert(diff.changes[0].v1 == 2 && diff.changes[0].v2 == 3);
+    ck_assert(diff.changes[0].weight == 5);
+  }
+  ck_assert(diff.changes[diff.numChanges - 2].kind == EDGE_REMOVED);
+  ck_assert(diff.changes[diff.numChanges - 2].v1 == 3);
+  ck_assert(diff.changes[diff.numChanges - 1].kind == EDGE_ADDED);
+  ck_assert(diff.changes[diff.numChanges - 1].v2 == 5);
+
+  ck_assert_int_eq(ApplyGraphDiff(from, &diff), 0);
+  FreeGraphDiff(&diff);
+  ck_assert(ContainsVertex(from, 9) && ContainsVertex(from, 7));
+  ck_assert(!AreAdjacent(from, 3, 4) && AreAdjacent(from, 4, 5));
+  ck_assert_int_eq(DiffGraphs(from, to, &diff), 0);
+  ck_assert_uint_eq(diff.numChanges, 0);
+  ck_assert_uint_eq(diff.numVertices, 0);
+  FreeGraphDiff(&diff);
+
+  FreeGraph(to);
+  to = AllocateDirectedGraph();
+  ck_assert_int_eq(DiffGraphs(from, to, &diff), -1);
+  FreeGraph(from);
+  FreeGraph(to);
+}
+END_TEST
+
+// Tests that the three ways of computing a diff agree on random changes to
+// random Graphs, and that applying the diff brings the old Graph to the
+// new one, indexes and in-adjacency included.
+START_TEST(random_test)
+{
+  char path[] = "/tmp/goldsberry_diff_XXXXXX";
+  unsigned int seed = 44;
+  GraphEdge *edges;
+  GraphDiff d1, d2, d3;
+  Graph from, to;
+  int fd, directed, i, n;
+  Neighbor *in1, *in2;
+
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+  edges = (GraphEdge *)malloc(sizeof(GraphEdge) * 2 * EDGES);
+
+  for (directed = 0; directed < 2; directed++) {
+    from = directed ? AllocateDirectedGraph() : AllocateGraph();
+    to = directed ? AllocateDirectedGraph() : AllocateGraph();
+    for (i = 0; i < VERTICES; i++) {
+      ck_assert_int_eq(AddVertex(from, i), 0);
+    }
+    for (i = 0; i < EDGES; i++) {
+      AddGraphEdge(from, rand_r(&seed) % VERTICES,
+                   rand_r(&seed) % VERTICES, rand_r(&seed) % 4);
+    }
+
+    // the new version keeps most edges, reweights some and drops some, and
+    // adds others, some more than once, among them a few new vertices
+    n = 0;
+    for (i = 0; i < VERTICES; i++) {
+      Neighbor *out;
+      int j, count;
+
+      ck_assert_int_eq(AddVertex(to, i), 0);
+      count = GetNeighbors(from, i, &out);
+      for (j = 0; j < count; j++) {
+        if ((!directed && out[j].v < i) || rand_r(&seed) % 5 == 0) {
+          continue;
+        }
+        edges[n].v1 = i;
+        edges[n].v2 = out[j].v;
+        edges[n++].weight = (rand_r(&seed) % 4 == 0) ? 9 : out[j].weight;
+      }
+      if (count > 0) {
+        free(out);
+      }
+    }
+    for (i = 0; i < EDGES / 4; i++) {
+      edges[n].v1 = rand_r(&seed) % (VERTICES + 10);
+      edges[n].v2 = rand_r(&seed) % VERTICES;
+      edges[n++].weight = rand_r(&seed) % 4;
+    }
+    for (i = 0; i < n; i++) {
+      AddGraphEdge(to, edges[i].v1, edges[i].v2, edges[i].weight);
+    }
+    WriteEdgeFile(to, path);
+
+    ck_assert_int_eq(DiffGraphs(from, to, &d1), 0);
+    ck_assert_int_eq(DiffGraphEdges(from, edges, n, &d2), 0);
+    ck_assert_int_eq(DiffGraphEdgeFile(from, path, &d3), 0);
+    ck_assert(d1.added > 0 && d1.removed > 0 && d1.numVertices > 0);
+    AssertSameDiff(&d1, &d2);
+    AssertSameDiff(&d1, &d3);
+
+    ck_assert_int_eq(EnableWeightIndex(from), 0);
+    if (directed) {
+      if (GetInNeighbors(from, 0, &in1) > 0) {
+        free(in1);
+      }
+    }
+    ck_assert_int_eq(ApplyGraphDiff(from, &d1), 0);
+    AssertSameGraph(from, to);
+    for (i = 0; directed && i < VERTICES; i++) {
+      n = GetInNeighbors(from, i, &in1);
+      ck_assert_int_eq(GetInNeighbors(to, i, &in2), n);
+      if (n > 0) {
+        free(in1);
+        free(in2);
+      }
+    }
+    for (i = 0; i < VERTICES; i++) {
+      const Neighbor *span;
+      Neighbor *out;
+
+      n = GetNeighbors(from, i, &out);
+      ck_assert_int_eq(GetLightestNeighbors(from, i, VERTICES, &span), n);
+      if (n > 0) {
+        free(out);
+      }
+    }
+
+    FreeGraphDiff(&d1);
+    FreeGraphDiff(&d2);
+    FreeGraphDiff(&d3);
+    FreeGraph(from);
+    FreeGraph(to);
+  }
+  free(edges);
+  unlink(path);
+}
+END_TEST
+
+// Tests that bad diffs and files are refused, and that a diff with no room
+// to apply leaves the Graph as it was.
+START_TEST(errors_test)
+{
+  char path[] = "/tmp/goldsberry_diff_XXXXXX";
+  EdgeChange changes[2];
+  GraphDiff diff, made;
+  Graph g, copy;
+  FILE *f;
+  int fd, i;
+
+  g = AllocateGraphWithAllocator(false, SystemGraphAllocator(), 0);
+  for (i = 0; i < 20; i++) {
+    ck_assert_int_eq(AddGraphEdge(g, i, i + 1, 1), 0);
+  }
+  copy = CopyGraph(g);
+
+  memset(&diff, 0, sizeof(GraphDiff));
+  diff.changes = changes;
+  diff.numChanges = 1;
+  changes[0] = (EdgeChange){EDGE_ADDED, 3, 3, 1};
+  ck_assert_int_eq(ApplyGraphDiff(g, &diff), -1);
+  changes[0] = (EdgeChange){EDGE_ADDED, 30, 31, 1};
+  changes[1] = (EdgeChange){EDGE_REMOVED, 31, 30, 1};
+  diff.numChanges = 2;
+  ck_assert_int_eq(ApplyGraphDiff(g, &diff), -1);
+  diff.directed = true;
+  diff.numChanges = 1;
+  ck_assert_int_eq(ApplyGraphDiff(g, &diff), -1);
+  AssertSameGraph(g, copy);
+
+  // a limit with no room for the new edges
+  diff.directed = false;
+  changes[1] = (EdgeChange){EDGE_REMOVED, 0, 1, 1};
+  diff.numChanges = 2;
+  SetGraphMemoryLimit(g, GraphBytesAllocated(g));
+  ck_assert_int_eq(ApplyGraphDiff(g, &diff), -1);
+  AssertSameGraph(g, copy);
+  ck_assert(!ContainsVertex(g, 30));
+  SetGraphMemoryLimit(g, 0);
+  ck_assert_int_eq(ApplyGraphDiff(g, &diff), 0);
+  ck_assert(AreAdjacent(g, 31, 30) && !AreAdjacent(g, 1, 0));
+
+  // files out of order, or missing
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+  f = fopen(path, "w");
+  fprintf(f, "1 2\n1 5\n1 3\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "2 1\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "# comment\n\n1 5 7\n1 5\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), 0);
+  ck_assert_uint_eq(made.added, 1);
+  ck_assert_uint_eq(made.removed, 20);
+  FreeGraphDiff(&made);
+
+  // a line longer than any buffer is read whole
+  f = fopen(path, "w");
+  fprintf(f, "1 5%500s7\n", "");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), 0);
+  ck_assert_uint_eq(made.added, 1);
+  FreeGraphDiff(&made);
+
+  // malformed lines
+  f = fopen(path, "w");
+  fprintf(f, "1 5 7 9\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "1 5 1e40\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "1 5 -2\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "1 99999999999999999999 7\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  f = fopen(path, "w");
+  fprintf(f, "1\n");
+  fclose(f);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+  unlink(path);
+  ck_assert_int_eq(DiffGraphEdgeFile(g, path, &made), -1);
+
+  FreeGraph(g);
+  FreeGraph(copy);
+}
+END_TEST
+
+Suite *GraphDiffSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphDiff");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, small_test);
+  tcase_add_test(tc_core, random_test);
+  tcase_add_test(tc_core, errors_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function returning a copy of an undirected Graph, edge by edge.
+static Graph CopyGraph(Graph g) {
+  GraphDiff diff;
+  Graph copy;
+
+  copy = AllocateGraph();
+  ck_assert_int_eq(DiffGraphs(copy, g, &diff), 0);
+  ck_assert_int_eq(ApplyGraphDiff(copy, &diff), 0);
+  FreeGraphDiff(&diff);
+  return copy;
+}
+
+// Helper function asserting that two Graphs have the same edges, and the
+// same counters.
+static void AssertSameGraph(Graph g1, Graph g2) {
+  GraphSummary s1, s2;
+  GraphDiff diff;
+  int i;
+
+  ck_assert_int_eq(DiffGraphs(g1, g2, &diff), 0);
+  ck_assert_uint_eq(diff.numChanges, 0);
+  FreeGraphDiff(&diff);
+
+  GetGraphSummary(g1, &s1);
+  GetGraphSummary(g2, &s2);
+  ck_assert_int_eq(s1.vertices, s2.vertices);
+  ck_assert_int_eq(s1.edges, s2.edges);
+  ck_assert_int_eq(s1.minDegree, s2.minDegree);
+  ck_assert_int_eq(s1.maxDegree, s2.maxDegree);
+  for (i = 0; i < GRAPH_DEGREE_BUCKETS; i++) {
+    ck_assert_int_eq(s1.degreeHistogram[i], s2.degreeHistogram[i]);
+  }
+}
+
+// Helper function asserting that two diffs are the same.
+static void AssertSameDiff(const GraphDiff *d1, const GraphDiff *d2) {
+  size_t i;
+
+  ck_assert(d1->directed == d2->directed);
+  ck_assert_uint_eq(d1->numVertices, d2->numVertices);
+  ck_assert_uint_eq(d1->numChanges, d2->numChanges);
+  ck_assert_uint_eq(d1->added, d2->added);
+  ck_assert_uint_eq(d1->removed, d2->removed);
+  ck_assert_uint_eq(d1->reweighted, d2->reweighted);
+  for (i = 0; i < d1->numVertices; i++) {
+    ck_assert(d1->vertices[i] == d2->vertices[i]);
+  }
+  for (i = 0; i < d1->numChanges; i++) {
+    ck_assert(d1->changes[i].kind == d2->changes[i].kind);
+    ck_assert(d1->changes[i].v1 == d2->changes[i].v1);
+    ck_assert(d1->changes[i].v2 == d2->changes[i].v2);
+    ck_assert(d1->changes[i].weight == d2->changes[i].weight);
+  }
+}
+
+// Helper function writing the edges of a Graph to a file, sorted, with
+// each undirected edge once.
+static void WriteEdgeFile(Graph g, const char *path) {
+  GraphEdge *edges = NULL;
+  Neighbor *out;
+  int v, i, count;
+  size_t n = 0;
+  FILE *f;
+
+  for (v = 0; v < VERTICES + 10; v++) {
+    count = GetNeighbors(g, v, &out);
+    for (i = 0; i < count; i++) {
+      if (IsDirectedGraph(g) || out[i].v > (GVertex_t)v) {
+        edges = (GraphEdge *)realloc(edges, sizeof(GraphEdge) * (n + 1));
+        edges[n].v1 = v;
+        edges[n].v2 = out[i].v;
+        edges[n++].weight = out[i].weight;
+      }
+    }
+    if (count > 0) {
+      free(out);
+    }
+  }
+  qsort(edges, n, sizeof(GraphEdge), CompareEdges);
+
+  f = fopen(path, "w");
+  ck_assert(f != NULL);
+  for (i = 0; i < (int)n; i++) {
+    fprintf(f, "%lld %lld %g\n", (long long)edges[i].v1,
+            (long long)edges[i].v2, (double)edges[i].weight);
+  }
+  fclose(f);
+  free(edges);
+}
+
+// Helper function ordering edges by v1 and then v2, for qsort.
+static int CompareEdges(const void *a, const void *b) {
+  const GraphEdge *x = (const GraphEdge *)a, *y = (const GraphEdge *)b;
+
+  if (x->v1 != y->v1) {
+    return (x->v1 > y->v1) - (x->v1 < y->v1);
+  }
+  return (x->v2 > y->v2) - (x->v2 < y->v2);
+}
@@ -0,0 +1,11 @@
+// Test Suite for Graph diffs.
+
+#include <check.h>
+
+#ifndef _GRAPH_DIFF_TEST_H_
+#define _GRAPH_DIFF_TEST_H_
+
+// Returns the test suite for Graph diffs.
+Suite *GraphDiffSuite();
+
+#endif
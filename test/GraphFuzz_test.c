@@ -0,0 +1,467 @@
+// Test Suite comparing the Graph against a reference model over long
+// random sequences of operations.
+//
+// The model is a plain adjacency matrix over a small universe of vertices,
+// simple enough to be obviously right. Every answer the Graph gives is
+// checked against it, and every so often (and after every failed
+// operation) the whole Graph is: its contents, its summary counters, and
+// the internal invariants of Graph_priv.h.
+//
+// Allocation failures are injected along the way by an allocator wrapping
+// the system one (see GraphAllocator.h). An operation must fail exactly when
+// one of its allocations does, and a failed operation must leave the Graph
+// as it was.
+//
+// The suite runs a few thousand operations per Graph. Set
+// GOLDSBERRY_FUZZ_OPS to run more, and GOLDSBERRY_FUZZ_SEED to change or
+// reproduce a run; failures report the seed and the operation they hit.
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./GraphFuzz_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphAllocator.h"
+#include "../src/Graph_priv.h"
+#include "../src/WeightIndex.h"
+
+#define MODEL_VERTICES 48
+#define DEFAULT_OPS 20000
+#define DEFAULT_SEED 38
+
+// An undirected edge is stored in both directions of the matrix, as in the
+// Graph. Weights are as the Graph reports them, so always 1 in an
+// unweighted build.
+typedef struct Model {
+  bool      directed;
+  bool      present[MODEL_VERTICES];
+  bool      edge[MODEL_VERTICES][MODEL_VERTICES];
+  GWeight_t weight[MODEL_VERTICES][MODEL_VERTICES];
+} Model;
+
+// The number of allocations to let through before failing one, or -1 to
+// fail none, and the number failed so far.
+static int failIn = -1;
+static int failed = 0;
+
+// Where in the run we are, for failure messages.
+static unsigned int seed;
+static int step;
+
+// Helper function declarations.
+static bool FailCountdown(void);
+static void *FailingAlloc(void *ctx, size_t size);
+static void *FailingRealloc(void *ctx, void *p, size_t oldSize, size_t size);
+static void FailingFree(void *ctx, void *p, size_t size);
+static void InjectFailure(int after);
+static bool StopInjecting(int before);
+static GVertex_t VertexOf(int i);
+static GWeight_t ModelWeight(GWeight_t w);
+static int ModelDegree(const Model *m, int i);
+static void AssertNeighbors(Graph g, const Model *m, int i, bool in);
+static void AssertWeightIndex(Graph g, const Model *m, int i);
+static void AssertMatchesModel(Graph g, const Model *m);
+static void RunOperations(bool directed, int ops);
+static int EnvInt(const char *name, int fallback);
+
+// The allocator every Graph here is made with.
+static const GraphAllocator failingAllocator = {
+  FailingAlloc, FailingRealloc, FailingFree, NULL
+};
+
+// Tests long random sequences of operations on an undirected Graph.
+START_TEST(undirected_test)
+{
+  seed = EnvInt("GOLDSBERRY_FUZZ_SEED", DEFAULT_SEED);
+  RunOperations(false, EnvInt("GOLDSBERRY_FUZZ_OPS", DEFAULT_OPS));
+}
+END_TEST
+
+// Tests long random sequences of operations on a directed Graph, whose
+// in-adjacency is built partway through.
+START_TEST(directed_test)
+{
+  seed = EnvInt("GOLDSBERRY_FUZZ_SEED", DEFAULT_SEED) + 1;
+  RunOperations(true, EnvInt("GOLDSBERRY_FUZZ_OPS", DEFAULT_OPS));
+}
+END_TEST
+
+// Tests every allocation AddGraphEdge can fail on, one at a time: failing
+// the first, then the second, and so on until the edge goes in. The edges
+// are chosen so that adding them has to grow the vertex index and the
+// degree table, and in a directed Graph, add an incoming edge too.
+START_TEST(add_edge_failure_sweep_test)
+{
+  int directed, i, k, ret, before;
+  Model m;
+  Graph g;
+
+  for (directed = 0; directed < 2; directed++) {
+    memset(&m, 0, sizeof(Model));
+    m.directed = directed;
+    g = AllocateGraphWithAllocator(directed, &failingAllocator, 0);
+    ck_assert(g != NULL);
+    if (directed) {
+      ck_assert(EnsureInAdjacency(g));
+    }
+    ck_assert_int_eq(EnableWeightIndex(g), 0);
+
+    // a star centered on vertex 0, whose degree passes every power of two
+    // the degree table grows at, while the new leaves grow the index
+    for (i = 1; i < MODEL_VERTICES; i++) {
+      for (k = 0;; k++) {
+        before = failed;
+        InjectFailure(k);
+        ret = AddGraphEdge(g, VertexOf(0), VertexOf(i), i);
+        ck_assert(StopInjecting(before) == (ret == -1));
+        if (ret == 0) {
+          break;
+        }
+        AssertMatchesModel(g, &m);
+      }
+      m.present[0] = m.present[i] = true;
+      m.edge[0][i] = true;
+      m.weight[0][i] = ModelWeight(i);
+      if (!directed) {
+        m.edge[i][0] = true;
+        m.weight[i][0] = ModelWeight(i);
+      }
+      AssertMatchesModel(g, &m);
+    }
+    FreeGraph(g);
+  }
+}
+END_TEST
+
+Suite *GraphFuzzSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphFuzz");
+
+  tc_core = tcase_create("Core");
+  tcase_set_timeout(tc_core, 0);
+
+  tcase_add_test(tc_core, undirected_test);
+  tcase_add_test(tc_core, directed_test);
+  tcase_add_test(tc_core, add_edge_failure_sweep_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function counting allocations down: returns true for the one the
+// countdown reaches, which should fail.
+static bool FailCountdown(void) {
+  if (failIn < 0) {
+    return false;
+  }
+  if (failIn-- == 0) {
+    failed++;
+    return true;
+  }
+  return false;
+}
+
+// Helper functions making up the failing allocator: the system allocator,
+// but for the allocations the countdown fails.
+static void *FailingAlloc(void *ctx, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  (void)ctx;
+  return FailCountdown() ? NULL : system->alloc(system->ctx, size);
+}
+
+static void *FailingRealloc(void *ctx, void *p, size_t oldSize, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  (void)ctx;
+  return FailCountdown() ? NULL :
+    system->realloc(system->ctx, p, oldSize, size);
+}
+
+static void FailingFree(void *ctx, void *p, size_t size) {
+  const GraphAllocator *system = SystemGraphAllocator();
+
+  (void)ctx;
+  system->free(system->ctx, p, size);
+}
+
+// Helper function arranging for the allocation after the given number of
+// successful ones to fail.
+static void InjectFailure(int after) {
+  failIn = after;
+}
+
+// Helper function stopping injection, and returning whether an allocation
+// was failed since the count was the given one.
+static bool StopInjecting(int before) {
+  failIn = -1;
+  return failed != before;
+}
+
+// Helper function mapping the model's vertex numbers to Graph vertices,
+// spread out and partly negative, so that they do not hash in order.
+static GVertex_t VertexOf(int i) {
+  return (GVertex_t)i * 40009 - 1000000;
+}
+
+// Helper function returning the weight the Graph reports for an edge
+// added with weight w.
+static GWeight_t ModelWeight(GWeight_t w) {
+  return GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ? 1 : w;
+}
+
+// Helper function returning the model's (out-)degree of a vertex.
+static int ModelDegree(const Model *m, int i) {
+  int j, degree = 0;
+
+  for (j = 0; j < MODEL_VERTICES; j++) {
+    degree += m->edge[i][j];
+  }
+  return degree;
+}
+
+// Helper function asserting that the Graph lists exactly the model's
+// edges out of (or, if in, into) a present vertex.
+static void AssertNeighbors(Graph g, const Model *m, int i, bool in) {
+  bool listed[MODEL_VERTICES] = { false };
+  Neighbor *out;
+  int n, k, j, expected = 0;
+
+  n = in ? GetInNeighbors(g, VertexOf(i), &out) :
+    GetNeighbors(g, VertexOf(i), &out);
+  for (j = 0; j < MODEL_VERTICES; j++) {
+    expected += in ? m->edge[j][i] : m->edge[i][j];
+  }
+  ck_assert_msg(n == expected, "seed %u, op %d: %d neighbors of %d, not %d",
+                seed, step, n, i, expected);
+
+  for (k = 0; k < n; k++) {
+    for (j = 0; j < MODEL_VERTICES && VertexOf(j) != out[k].v; j++) {
+    }
+    ck_assert_msg(j < MODEL_VERTICES && !listed[j], "seed %u, op %d", seed,
+                  step);
+    listed[j] = true;
+    ck_assert_msg(in ? m->edge[j][i] : m->edge[i][j], "seed %u, op %d", seed,
+                  step);
+    ck_assert_msg(out[k].weight == (in ? m->weight[j][i] : m->weight[i][j]),
+                  "seed %u, op %d", seed, step);
+  }
+  if (n > 0) {
+    free(out);
+  }
+}
+
+// Helper function asserting that the weight index lists exactly the model's
+// edges out of a present vertex, lightest first.
+static void AssertWeightIndex(Graph g, const Model *m, int i) {
+  const Neighbor *span;
+  int n, k, j, light = 0;
+
+  n = GetLightestNeighbors(g, VertexOf(i), MODEL_VERTICES, &span);
+  ck_assert_msg(n == ModelDegree(m, i), "seed %u, op %d", seed, step);
+  for (k = 0; k < n; k++) {
+    for (j = 0; j < MODEL_VERTICES && VertexOf(j) != span[k].v; j++) {
+    }
+    ck_assert_msg(j < MODEL_VERTICES && m->edge[i][j] &&
+                  span[k].weight == m->weight[i][j], "seed %u, op %d", seed,
+                  step);
+    ck_assert_msg(k == 0 || span[k - 1].weight <= span[k].weight,
+                  "seed %u, op %d", seed, step);
+  }
+
+  for (j = 0; j < MODEL_VERTICES; j++) {
+    light += m->edge[i][j] && m->weight[i][j] <= 50;
+  }
+  n = GetNeighborsUpToWeight(g, VertexOf(i), 50, &span);
+  ck_assert_msg(n == light, "seed %u, op %d", seed, step);
+}
+
+// Helper function asserting that the whole Graph matches the model, down
+// to its internal bookkeeping.
+static void AssertMatchesModel(Graph g, const Model *m) {
+  long histogram[GRAPH_DEGREE_BUCKETS] = { 0 };
+  int i, j, n = 0, minDegree = 0, maxDegree = 0, degree;
+  long edges = 0;
+  GraphSummary s;
+  ListItem *item;
+  EdgeItem *e;
+
+  for (i = 0; i < MODEL_VERTICES; i++) {
+    ck_assert_msg(ContainsVertex(g, VertexOf(i)) == m->present[i],
+                  "seed %u, op %d: vertex %d", seed, step, i);
+    if (!m->present[i]) {
+      continue;
+    }
+    degree = ModelDegree(m, i);
+    minDegree = (n == 0 || degree < minDegree) ? degree : minDegree;
+    maxDegree = (n == 0 || degree > maxDegree) ? degree : maxDegree;
+    histogram[degree == 0 ? 0 : 32 - __builtin_clz(degree)]++;
+    n++;
+    for (j = 0; j < MODEL_VERTICES; j++) {
+      edges += m->edge[i][j] && (m->directed || i < j);
+    }
+    AssertNeighbors(g, m, i, false);
+    if (g->hasInEdges) {
+      AssertNeighbors(g, m, i, true);
+    }
+    if (HasWeightIndex(g)) {
+      AssertWeightIndex(g, m, i);
+    }
+  }
+
+  GetGraphSummary(g, &s);
+  ck_assert_msg(s.vertices == n && s.edges == edges,
+                "seed %u, op %d: %d vertices and %ld edges, not %d and %ld",
+                seed, step, s.vertices, s.edges, n, edges);
+  ck_assert_msg(s.minDegree == minDegree && s.maxDegree == maxDegree,
+                "seed %u, op %d: degrees %d-%d, not %d-%d", seed, step,
+                s.minDegree, s.maxDegree, minDegree, maxDegree);
+  ck_assert_msg(memcmp(s.degreeHistogram, histogram, sizeof(histogram)) == 0,
+                "seed %u, op %d: degree histogram", seed, step);
+
+  // the list holds each vertex once, with dense ids in order, and counts
+  // that match the edge lists
+  i = 0;
+  for (item = g->front; item != NULL; item = item->next) {
+    ck_assert(item->id == i++);
+    ck_assert(FindVertex(g, item->data) == item);
+    degree = 0;
+    for (e = item->neighbors; e != NULL; e = e->next) {
+      degree++;
+    }
+    ck_assert(degree == item->count);
+    ck_assert(item->next != NULL || g->back == item);
+  }
+  ck_assert(i == n && g->index.count == n);
+}
+
+// Helper function running random operations on a fresh Graph, checking
+// each against the model.
+static void RunOperations(bool directed, int ops) {
+  bool results[4], expected[4], fired;
+  GVertex_t vs[4];
+  VertexPair pairs[4];
+  int op, i, j, k, ret, before;
+  GWeight_t w;
+  Model m;
+  Graph g;
+
+  memset(&m, 0, sizeof(Model));
+  m.directed = directed;
+  g = AllocateGraphWithAllocator(directed, &failingAllocator, 0);
+  ck_assert(g != NULL);
+  srand(seed);
+
+  for (step = 0; step < ops; step++) {
+    // build the weight index halfway through, from the edges there are
+    if (step == ops / 2) {
+      ck_assert_int_eq(EnableWeightIndex(g), 0);
+      AssertMatchesModel(g, &m);
+    }
+
+    op = rand() % 100;
+    i = rand() % MODEL_VERTICES;
+    j = rand() % MODEL_VERTICES;
+    w = rand() % 100;
+
+    // fail one of the allocations of a quarter of the operations
+    before = failed;
+    if (rand() % 4 == 0) {
+      InjectFailure(rand() % 3);
+    }
+
+    if (op < 10) {
+      ret = AddVertex(g, VertexOf(i));
+      fired = StopInjecting(before);
+      ck_assert_msg((ret == -1) == fired, "seed %u, op %d", seed, step);
+      if (ret == 0) {
+        m.present[i] = true;
+      }
+    } else if (op < 45) {
+      ret = AddGraphEdge(g, VertexOf(i), VertexOf(j), w);
+      fired = StopInjecting(before);
+      ck_assert_msg((ret == -1) == (fired || i == j), "seed %u, op %d", seed,
+                    step);
+      if (ret == 0) {
+        m.present[i] = m.present[j] = true;
+        m.edge[i][j] = true;
+        m.weight[i][j] = ModelWeight(w);
+        if (!directed) {
+          m.edge[j][i] = true;
+          m.weight[j][i] = ModelWeight(w);
+        }
+      }
+    } else if (op < 60) {
+      RemoveGraphEdge(g, VertexOf(i), VertexOf(j));
+      ck_assert_msg(!StopInjecting(before), "seed %u, op %d", seed, step);
+      m.edge[i][j] = false;
+      if (!directed) {
+        m.edge[j][i] = false;
+      }
+      ret = 0;
+    } else if (op < 70) {
+      StopInjecting(before);
+      for (k = 0; k < 4; k++) {
+        vs[k] = VertexOf((i + 7 * k) % MODEL_VERTICES);
+        expected[k] = m.present[(i + 7 * k) % MODEL_VERTICES];
+      }
+      ContainsVertexBatch(g, vs, 4, results);
+      ck_assert_msg(memcmp(results, expected, sizeof(results)) == 0,
+                    "seed %u, op %d", seed, step);
+      ret = 0;
+    } else if (op < 80) {
+      StopInjecting(before);
+      ck_assert_msg(AreAdjacent(g, VertexOf(i), VertexOf(j)) == m.edge[i][j],
+                    "seed %u, op %d", seed, step);
+      for (k = 0; k < 4; k++) {
+        pairs[k].v1 = VertexOf((i + k) % MODEL_VERTICES);
+        pairs[k].v2 = VertexOf((j + 3 * k) % MODEL_VERTICES);
+        expected[k] = m.edge[(i + k) % MODEL_VERTICES]
+          [(j + 3 * k) % MODEL_VERTICES];
+      }
+      AreAdjacentBatch(g, pairs, 4, results);
+      ck_assert_msg(memcmp(results, expected, sizeof(results)) == 0,
+                    "seed %u, op %d", seed, step);
+      ret = 0;
+    } else if (op < 95) {
+      // a query that fails for memory must not change anything either
+      Neighbor *out;
+      bool in = op >= 90;
+
+      ret = in ? GetInNeighbors(g, VertexOf(i), &out) :
+        GetNeighbors(g, VertexOf(i), &out);
+      fired = StopInjecting(before);
+      ck_assert_msg((ret == -2) == fired, "seed %u, op %d", seed, step);
+      if (ret > 0) {
+        free(out);
+      }
+      if (ret >= 0) {
+        AssertNeighbors(g, &m, i, in);
+      } else if (ret == -1) {
+        ck_assert(!m.present[i]);
+      }
+    } else {
+      StopInjecting(before);
+      ret = 0;
+      AssertMatchesModel(g, &m);
+    }
+
+    if (ret < 0) {
+      AssertMatchesModel(g, &m);
+    }
+  }
+
+  AssertMatchesModel(g, &m);
+  FreeGraph(g);
+}
+
+// Helper function reading a positive integer from the environment.
+static int EnvInt(const char *name, int fallback) {
+  const char *value = getenv(name);
+
+  return (value != NULL && atoi(value) > 0) ? atoi(value) : fallback;
+}
@@ -0,0 +1,12 @@
+// Test Suite comparing the Graph against a reference model over long
+// random sequences of operations.
+
+#include <check.h>
+
+#ifndef _GRAPH_FUZZ_TEST_H_
+#define _GRAPH_FUZZ_TEST_H_
+
+// Returns the differential test suite for the Graph.
+Suite *GraphFuzzSuite();
+
+#endif
@@ -0,0 +1,376 @@
+// Test Suite for the Graph write-ahead log.
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./GraphLog_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphLog.h"
+
+// Helper function declarations.
+static bool SameGraph(Graph a, Graph b, int range);
+static void CopyFile(const char *from, const char *to);
+static long FileSize(const char *path);
+
+// Each test gets a fresh log directory, and tears down whatever is left in
+// it afterwards.
+
+static char dir[64];
+static char logPath[96];
+static char checkpointPath[96];
+
+static void setup() {
+  strcpy(dir, "/tmp/goldsberry_log_XXXXXX");
+  ck_assert(mkdtemp(dir) != NULL);
+  sprintf(logPath, "%s/log", dir);
+  sprintf(checkpointPath, "%s/checkpoint", dir);
+}
+
+static void teardown() {
+  char path[96];
+
+  unlink(logPath);
+  unlink(checkpointPath);
+  sprintf(path, "%s/checkpoint.tmp", dir);
+  unlink(path);
+  rmdir(dir);
+}
+
+// Tests that a fresh directory recovers an empty Graph.
+START_TEST(empty_log_test)
+{
+  GraphLog log;
+  Graph g;
+  GraphSummary s;
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that logged mutations come back after reopening, including the
+// vertices of an edge that was later removed.
+START_TEST(reopen_test)
+{
+  GraphLog log;
+  Graph g;
+  Neighbor *out;
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(LogAddVertex(log, 7) == 0);
+  ck_assert(LogAddGraphEdge(log, 1, 2, 5) == 0);
+  ck_assert(LogAddGraphEdge(log, 2, 3, 6) == 0);
+  ck_assert(LogAddGraphEdge(log, 3, 2, 8) == 0);
+  ck_assert(LogAddGraphEdge(log, 4, 5, 1) == 0);
+  ck_assert(LogRemoveGraphEdge(log, 5, 4) == 0);
+  ck_assert(LogAddGraphEdge(log, 1, 1, 0) == -1);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(ContainsVertex(g, 7));
+  ck_assert(ContainsVertex(g, 4));
+  ck_assert(ContainsVertex(g, 5));
+  ck_assert(!AreAdjacent(g, 4, 5));
+  ck_assert(AreAdjacent(g, 1, 2));
+  ck_assert(GetNeighbors(g, 3, &out) == 1);
+  ck_assert(out[0].v == 2);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || out[0].weight == 8);
+  free(out);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a checkpoint empties the log, and that mutations before and
+// after it are both recovered.
+START_TEST(checkpoint_test)
+{
+  GraphLog log;
+  Graph g;
+  int i;
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  for (i = 0; i < 100; i++) {
+    ck_assert(LogAddGraphEdge(log, i, i + 1, i) == 0);
+  }
+  ck_assert(CheckpointGraphLog(log) == 0);
+  ck_assert(FileSize(logPath) < 100);
+  ck_assert(LogRemoveGraphEdge(log, 10, 11) == 0);
+  ck_assert(LogAddGraphEdge(log, 200, 201, 0) == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  for (i = 0; i < 100; i++) {
+    ck_assert(AreAdjacent(g, i, i + 1) == (i != 10));
+  }
+  ck_assert(AreAdjacent(g, 200, 201));
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the log checkpoints itself once it grows past the configured
+// size.
+START_TEST(auto_checkpoint_test)
+{
+  GraphLogOptions opts;
+  GraphLog log;
+  Graph g;
+  int i;
+
+  DefaultGraphLogOptions(&opts);
+  opts.checkpointBytes = 4096;
+  log = OpenGraphLog(dir, &opts, &g);
+  ck_assert(log != NULL);
+  for (i = 0; i < 1000; i++) {
+    ck_assert(LogAddGraphEdge(log, i, i + 1, i) == 0);
+  }
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  ck_assert(FileSize(checkpointPath) > 0);
+  ck_assert(FileSize(logPath) <= 4096);
+
+  log = OpenGraphLog(dir, &opts, &g);
+  ck_assert(log != NULL);
+  for (i = 0; i < 1000; i++) {
+    ck_assert(AreAdjacent(g, i, i + 1));
+  }
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a partially written record at the end of the log (as left by a
+// crash) is discarded, and that new records follow the last good one.
+START_TEST(torn_tail_test)
+{
+  GraphLog log;
+  Graph g;
+  FILE *f;
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(LogAddGraphEdge(log, 1, 2, 3) == 0);
+  ck_assert(LogAddGraphEdge(log, 2, 3, 4) == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  f = fopen(logPath, "ab");
+  ck_assert(f != NULL);
+  fwrite("\x01\x02\x03\x04\x02\x09", 6, 1, f);
+  fclose(f);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(AreAdjacent(g, 1, 2));
+  ck_assert(AreAdjacent(g, 2, 3));
+  ck_assert(LogAddGraphEdge(log, 3, 4, 5) == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(AreAdjacent(g, 1, 2));
+  ck_assert(AreAdjacent(g, 3, 4));
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests recovering from a crash between writing a checkpoint and emptying
+// the log: the log still holds records the checkpoint already covers.
+START_TEST(stale_log_test)
+{
+  char saved[128];
+  GraphLog log;
+  Graph g;
+
+  sprintf(saved, "%s.saved", logPath);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(LogAddGraphEdge(log, 1, 2, 3) == 0);
+  ck_assert(LogAddGraphEdge(log, 2, 3, 4) == 0);
+  ck_assert(SyncGraphLog(log) == 0);
+  CopyFile(logPath, saved);
+  ck_assert(LogRemoveGraphEdge(log, 1, 2) == 0);
+  ck_assert(CheckpointGraphLog(log) == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  // put the pre-checkpoint log back, as if it had never been emptied
+  ck_assert(rename(saved, logPath) == 0);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(!AreAdjacent(g, 1, 2));
+  ck_assert(AreAdjacent(g, 2, 3));
+  ck_assert(LogAddGraphEdge(log, 5, 6, 0) == 0);
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, NULL, &g);
+  ck_assert(log != NULL);
+  ck_assert(!AreAdjacent(g, 1, 2));
+  ck_assert(AreAdjacent(g, 5, 6));
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that parallel recovery of a long random sequence of mutations
+// produces the same Graph as applying them directly.
+START_TEST(parallel_replay_test)
+{
+  GraphLogOptions opts;
+  GraphLog log;
+  Graph g, expected;
+  int i, v1, v2, w;
+
+  DefaultGraphLogOptions(&opts);
+  opts.replayThreads = 4;
+  expected = AllocateGraph();
+  ck_assert(expected != NULL);
+
+  log = OpenGraphLog(dir, &opts, &g);
+  ck_assert(log != NULL);
+  srand(29);
+  for (i = 0; i < 20000; i++) {
+    v1 = rand() % 200;
+    v2 = rand() % 200;
+    w = rand() % 10;
+    if (rand() % 4 == 0) {
+      ck_assert(LogRemoveGraphEdge(log, v1, v2) == 0);
+      RemoveGraphEdge(expected, v1, v2);
+    } else if (rand() % 10 == 0) {
+      ck_assert(LogAddVertex(log, v1 + 1000) == 0);
+      AddVertex(expected, v1 + 1000);
+    } else if (v1 != v2) {
+      ck_assert(LogAddGraphEdge(log, v1, v2, w) == 0);
+      AddGraphEdge(expected, v1, v2, w);
+    }
+  }
+  ck_assert(SameGraph(g, expected, 1200));
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+
+  log = OpenGraphLog(dir, &opts, &g);
+  ck_assert(log != NULL);
+  ck_assert(SameGraph(g, expected, 1200));
+  ck_assert(CloseGraphLog(log) == 0);
+  FreeGraph(g);
+  FreeGraph(expected);
+}
+END_TEST
+
+Suite *GraphLogSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphLog");
+
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, empty_log_test);
+  tcase_add_test(tc_core, reopen_test);
+  tcase_add_test(tc_core, checkpoint_test);
+  tcase_add_test(tc_core, auto_checkpoint_test);
+  tcase_add_test(tc_core, torn_tail_test);
+  tcase_add_test(tc_core, stale_log_test);
+  tcase_add_test(tc_core, parallel_replay_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function to compare two Graphs whose vertices all lie in
+// [0, range). Returns true if they have the same vertices and edges.
+static bool SameGraph(Graph a, Graph b, int range) {
+  GraphSummary sa, sb;
+  Neighbor *na, *nb;
+  int v, i, j, n;
+  bool found;
+
+  GetGraphSummary(a, &sa);
+  GetGraphSummary(b, &sb);
+  if (sa.vertices != sb.vertices || sa.edges != sb.edges) {
+    return false;
+  }
+
+  for (v = 0; v < range; v++) {
+    n = GetNeighbors(a, v, &na);
+    if (n != GetNeighbors(b, v, &nb)) {
+      return false;
+    }
+    for (i = 0; i < n; i++) {
+      found = false;
+      for (j = 0; j < n; j++) {
+        if (na[i].v == nb[j].v && na[i].weight == nb[j].weight) {
+          found = true;
+        }
+      }
+      if (!found) {
+        return false;
+      }
+    }
+    if (n > 0) {
+      free(na);
+      free(nb);
+    }
+  }
+  return true;
+}
+
+// Helper function to copy a file.
+static void CopyFile(const char *from, const char *to) {
+  char buf[4096];
+  FILE *in, *out;
+  size_t n;
+
+  in = fopen(from, "rb");
+  out = fopen(to, "wb");
+  ck_assert(in != NULL && out != NULL);
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    fwrite(buf, 1, n, out);
+  }
+  fclose(in);
+  fclose(out);
+}
+
+// Helper function returning the size of a file, or -1 if it is missing.
+static long FileSize(const char *path) {
+  FILE *f;
+  long size;
+
+  f = fopen(path, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fclose(f);
+  return size;
+}
@@ -0,0 +1,11 @@
+// Test Suite for the Graph write-ahead log.
+
+#include <check.h>
+
+#ifndef _GRAPH_LOG_TEST_H_
+#define _GRAPH_LOG_TEST_H_
+
+// Returns the test suite for the Graph write-ahead log.
+Suite *GraphLogSuite();
+
+#endif
@@ -0,0 +1,283 @@
+// Test Suite for the Graph server and client.
+
+#include <check.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "./GraphServer_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphClient.h"
+#include "../src/GraphProtocol.h"
+#include "../src/GraphServer.h"
+
+#define PIPELINED_REQUESTS 10000
+#define WRITER_THREADS 4
+#define EDGES_PER_WRITER 500
+
+// Helper function declarations.
+static GraphServer StartTestServer(Graph g, int workers, char *path);
+static void StopTestServer(GraphServer s, char *path);
+static void *WriterThread(void *arg);
+
+// The Graph served by StartTestServer when it is given none.
+static Graph emptyGraph = NULL;
+
+// Tests each request against the Graph it was served from.
+START_TEST(basic_test)
+{
+  GraphResponse r;
+  GraphServer s;
+  GraphClient c;
+  char path[96];
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 5) == 0);
+  ck_assert(AddGraphEdge(g, 1, 3, 7) == 0);
+  s = StartTestServer(g, 2, path);
+  c = ConnectGraphClient(path);
+  ck_assert(c != NULL);
+
+  ck_assert(QueueContains(c, 10, 1) == 0);
+  ck_assert(QueueContains(c, 11, 4) == 0);
+  ck_assert(QueueAdjacent(c, 12, 2, 1) == 0);
+  ck_assert(QueueAdjacent(c, 13, 2, 3) == 0);
+  ck_assert(QueueAddEdge(c, 14, 2, 3, 9) == 0);
+  ck_assert(QueueAdjacent(c, 15, 3, 2) == 0);
+  ck_assert(QueueNeighbors(c, 16, 1) == 0);
+  ck_assert(QueueNeighbors(c, 17, 4) == 0);
+  ck_assert(FlushGraphClient(c) == 0);
+
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 10 && r.op == GRAPH_REQ_CONTAINS);
+  ck_assert(r.status == GRAPH_STATUS_OK && r.answer);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 11 && r.status == GRAPH_STATUS_OK && !r.answer);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 12 && r.op == GRAPH_REQ_ADJACENT && r.answer);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 13 && !r.answer);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 14 && r.op == GRAPH_REQ_ADD_EDGE);
+  ck_assert(r.status == GRAPH_STATUS_OK);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 15 && r.answer);
+
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 16 && r.op == GRAPH_REQ_NEIGHBORS);
+  ck_assert(r.status == GRAPH_STATUS_OK && r.count == 2);
+  ck_assert((r.neighbors[0].v == 2 && r.neighbors[1].v == 3) ||
+            (r.neighbors[0].v == 3 && r.neighbors[1].v == 2));
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ||
+            r.neighbors[0].weight == (r.neighbors[0].v == 2 ? 5 : 7));
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 17 && r.status == GRAPH_STATUS_NOT_FOUND);
+
+  CloseGraphClient(c);
+  StopTestServer(s, path);
+  ck_assert(AreAdjacent(g, 2, 3));
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a deep pipeline gets every response, in order.
+START_TEST(pipeline_test)
+{
+  GraphResponse r;
+  GraphServer s;
+  GraphClient c;
+  char path[96];
+  Graph g;
+  int i;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  for (i = 0; i < 100; i++) {
+    ck_assert(AddGraphEdge(g, i, i + 1, 1) == 0);
+  }
+  s = StartTestServer(g, 1, path);
+  c = ConnectGraphClient(path);
+  ck_assert(c != NULL);
+
+  for (i = 0; i < PIPELINED_REQUESTS; i++) {
+    if (i % 2 == 0) {
+      ck_assert(QueueNeighbors(c, i, i % 200) == 0);
+    } else {
+      ck_assert(QueueAdjacent(c, i, i % 100, i % 100 + 1) == 0);
+    }
+  }
+  ck_assert(FlushGraphClient(c) == 0);
+
+  for (i = 0; i < PIPELINED_REQUESTS; i++) {
+    ck_assert(ReadGraphResponse(c, &r) == 0);
+    ck_assert(r.id == (uint32_t)i);
+    if (i % 2 == 0) {
+      if (i % 200 <= 100) {
+        ck_assert(r.status == GRAPH_STATUS_OK);
+        ck_assert(r.count == ((i % 200 == 0 || i % 200 == 100) ? 1 : 2));
+      } else {
+        ck_assert(r.status == GRAPH_STATUS_NOT_FOUND);
+      }
+    } else {
+      ck_assert(r.status == GRAPH_STATUS_OK && r.answer);
+    }
+  }
+
+  CloseGraphClient(c);
+  StopTestServer(s, path);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests several clients adding edges at once.
+START_TEST(concurrent_writers_test)
+{
+  pthread_t threads[WRITER_THREADS];
+  GraphSummary summary;
+  GraphServer s;
+  char path[96];
+  Graph g;
+  int i;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  s = StartTestServer(g, 3, path);
+  for (i = 0; i < WRITER_THREADS; i++) {
+    ck_assert(pthread_create(&threads[i], NULL, WriterThread, path) == 0);
+  }
+  for (i = 0; i < WRITER_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  StopTestServer(s, path);
+
+  // every writer adds the same path, so the edges overlap
+  GetGraphSummary(g, &summary);
+  ck_assert(summary.vertices == EDGES_PER_WRITER + 1);
+  ck_assert(summary.edges == EDGES_PER_WRITER);
+  for (i = 0; i < EDGES_PER_WRITER; i++) {
+    ck_assert(AreAdjacent(g, i, i + 1));
+  }
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a malformed frame closes the connection, without disturbing
+// the server.
+START_TEST(malformed_test)
+{
+  struct sockaddr_un addr;
+  GraphResponse r;
+  GraphServer s;
+  GraphClient c;
+  char path[96], frame[16], reply[16];
+  uint32_t size = 5, id = 1;
+  int fd;
+
+  s = StartTestServer(NULL, 1, path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ck_assert(fd != -1);
+  ck_assert(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+  memcpy(frame, &size, 4);
+  memcpy(frame + 4, &id, 4);
+  frame[8] = 99;  // no such op
+  ck_assert(write(fd, frame, 9) == 9);
+  ck_assert(read(fd, reply, sizeof(reply)) == 0);
+  close(fd);
+
+  c = ConnectGraphClient(path);
+  ck_assert(c != NULL);
+  ck_assert(QueueContains(c, 2, 1) == 0);
+  ck_assert(FlushGraphClient(c) == 0);
+  ck_assert(ReadGraphResponse(c, &r) == 0);
+  ck_assert(r.id == 2 && !r.answer);
+  CloseGraphClient(c);
+
+  StopTestServer(s, path);
+}
+END_TEST
+
+Suite *GraphServerSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphServer");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, basic_test);
+  tcase_add_test(tc_core, pipeline_test);
+  tcase_add_test(tc_core, concurrent_writers_test);
+  tcase_add_test(tc_core, malformed_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function starting a server on a socket in a fresh temporary
+// directory, whose path is written to path. Serves an empty Graph if g is
+// NULL; StopTestServer frees it.
+static GraphServer StartTestServer(Graph g, int workers, char *path) {
+  GraphServerOptions opts;
+  GraphServer s;
+  char dir[] = "/tmp/goldsberryXXXXXX";
+
+  ck_assert(mkdtemp(dir) != NULL);
+  snprintf(path, 96, "%s/graph.sock", dir);
+  if (g == NULL) {
+    emptyGraph = AllocateGraph();
+    g = emptyGraph;
+  }
+  DefaultGraphServerOptions(&opts);
+  opts.workers = workers;
+  s = StartGraphServer(g, path, &opts);
+  ck_assert(s != NULL);
+  return s;
+}
+
+// Helper function stopping a test server and removing its directory.
+static void StopTestServer(GraphServer s, char *path) {
+  StopGraphServer(s);
+  ck_assert(access(path, F_OK) == -1);
+  *strrchr(path, '/') = '\0';
+  ck_assert(rmdir(path) == 0);
+  if (emptyGraph != NULL) {
+    FreeGraph(emptyGraph);
+    emptyGraph = NULL;
+  }
+}
+
+// Helper function adding a path of edges through the server, in batches.
+static void *WriterThread(void *arg) {
+  GraphResponse r;
+  GraphClient c;
+  int i, j;
+
+  c = ConnectGraphClient((const char *)arg);
+  ck_assert(c != NULL);
+  for (i = 0; i < EDGES_PER_WRITER; i += 50) {
+    for (j = i; j < i + 50; j++) {
+      ck_assert(QueueAddEdge(c, j, j, j + 1, 1) == 0);
+      ck_assert(QueueContains(c, j, j) == 0);
+    }
+    ck_assert(FlushGraphClient(c) == 0);
+    for (j = i; j < i + 50; j++) {
+      ck_assert(ReadGraphResponse(c, &r) == 0);
+      ck_assert(r.id == (uint32_t)j && r.status == GRAPH_STATUS_OK);
+      ck_assert(ReadGraphResponse(c, &r) == 0);
+      ck_assert(r.answer);
+    }
+  }
+  CloseGraphClient(c);
+  return NULL;
+}
@@ -0,0 +1,11 @@
+// Test Suite for the Graph server and client.
+
+#include <check.h>
+
+#ifndef _GRAPH_SERVER_TEST_H_
+#define _GRAPH_SERVER_TEST_H_
+
+// Returns the test suite for the Graph server and client.
+Suite *GraphServerSuite();
+
+#endif
@@ -0,0 +1,162 @@
+// Test Suite for the Graph instrumentation counters.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./GraphStats_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphStats.h"
+
+// Allocate a Graph and clear the counters on setup, Free it on teardown
+
+static Graph g;
+
+static void setup() {
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ResetGraphStats();
+}
+
+static void teardown() {
+  FreeGraph(g);
+}
+
+#ifdef GRAPH_STATS
+
+// Tests that each public operation is counted once per call.
+START_TEST(op_calls_test)
+{
+  GraphStats s;
+  Neighbor *out;
+
+  ck_assert(AddVertex(g, 1) == 0);
+  ck_assert(AddGraphEdge(g, 1, 2, 3) == 0);
+  ck_assert(ContainsVertex(g, 2));
+  ck_assert(ContainsVertex(g, 3) == false);
+  ck_assert(AreAdjacent(g, 1, 2));
+  ck_assert(GetNeighbors(g, 1, &out) == 1);
+  free(out);
+  RemoveGraphEdge(g, 1, 2);
+
+  ck_assert(GetGraphStats(&s) == 0);
+  ck_assert(s.ops[GRAPH_OP_ADD_VERTEX].calls == 1);
+  ck_assert(s.ops[GRAPH_OP_ADD_EDGE].calls == 1);
+  ck_assert(s.ops[GRAPH_OP_CONTAINS_VERTEX].calls == 2);
+  ck_assert(s.ops[GRAPH_OP_ARE_ADJACENT].calls == 1);
+  ck_assert(s.ops[GRAPH_OP_GET_NEIGHBORS].calls == 1);
+  ck_assert(s.ops[GRAPH_OP_REMOVE_EDGE].calls == 1);
+  ck_assert(s.neighborAllocs == 1);
+  ck_assert(s.edgeAllocs == 2);
+}
+END_TEST
+
+// Tests that the work counters reflect the cost of a lookup.
+START_TEST(work_counters_test)
+{
+  GraphStats s;
+  int i;
+
+  for (i = 0; i < 10; i++) {
+    ck_assert(AddVertex(g, i) == 0);
+  }
+  ResetGraphStats();
+
+  // a lookup probes at least one index slot, and never more than there
+  // are vertices plus the empty slot that ends the search
+  ck_assert(!ContainsVertex(g, 100));
+  ck_assert(GetGraphStats(&s) == 0);
+  ck_assert(s.vertexLookups == 1);
+  ck_assert(s.verticesScanned >= 1);
+  ck_assert(s.verticesScanned <= 11);
+}
+END_TEST
+
+// Tests that every recorded call lands in exactly one latency bucket.
+START_TEST(histogram_test)
+{
+  GraphStats s;
+  unsigned long long total;
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    ContainsVertex(g, i);
+  }
+
+  ck_assert(GetGraphStats(&s) == 0);
+  total = 0;
+  for (i = 0; i < GRAPH_STATS_BUCKETS; i++) {
+    total += s.ops[GRAPH_OP_CONTAINS_VERTEX].histogram[i];
+  }
+  ck_assert(total == 100);
+  ck_assert(GraphOpPercentile(&s.ops[GRAPH_OP_CONTAINS_VERTEX], 50) <=
+            GraphOpPercentile(&s.ops[GRAPH_OP_CONTAINS_VERTEX], 99));
+}
+END_TEST
+
+#else
+
+// Tests that the stats API reports itself as unavailable.
+START_TEST(stats_disabled_test)
+{
+  GraphStats s;
+
+  ck_assert(ContainsVertex(g, 1) == false);
+  ck_assert(GetGraphStats(&s) == -1);
+  ck_assert(s.ops[GRAPH_OP_CONTAINS_VERTEX].calls == 0);
+}
+END_TEST
+
+#endif
+
+// Tests the percentile estimate on a handmade histogram.
+START_TEST(percentile_test)
+{
+  GraphOpStats op = { 0 };
+
+  ck_assert(GraphOpPercentile(&op, 50) == 0);
+
+  op.calls = 10;
+  op.histogram[3] = 9;
+  op.histogram[10] = 1;
+  ck_assert(GraphOpPercentile(&op, 50) == 8);
+  ck_assert(GraphOpPercentile(&op, 90) == 8);
+  // the 99th percentile of 10 calls is the 10th
+  ck_assert(GraphOpPercentile(&op, 99) == 1024);
+  ck_assert(GraphOpPercentile(&op, 100) == 1024);
+
+  // ranks that are exact, though their products aren't in binary
+  op.calls = 100;
+  op.histogram[3] = 7;
+  op.histogram[10] = 93;
+  ck_assert(GraphOpPercentile(&op, 7) == 8);
+  ck_assert(GraphOpPercentile(&op, 7.001) == 1024);
+  op.calls = 1000;
+  op.histogram[3] = 999;
+  op.histogram[10] = 1;
+  ck_assert(GraphOpPercentile(&op, 99.9) == 8);
+  ck_assert(GraphOpPercentile(&op, 99.95) == 1024);
+}
+END_TEST
+
+Suite *GraphStatsSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphStats");
+
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+#ifdef GRAPH_STATS
+  tcase_add_test(tc_core, op_calls_test);
+  tcase_add_test(tc_core, work_counters_test);
+  tcase_add_test(tc_core, histogram_test);
+#else
+  tcase_add_test(tc_core, stats_disabled_test);
+#endif
+  tcase_add_test(tc_core, percentile_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
@@ -0,0 +1,11 @@
+// Test Suite for the Graph instrumentation counters.
+
+#include <check.h>
+
+#ifndef _GRAPH_STATS_TEST_H_
+#define _GRAPH_STATS_TEST_H_
+
+// Returns the test suite for the Graph instrumentation counters.
+Suite *GraphStatsSuite();
+
+#endif
@@ -0,0 +1,280 @@
+// Test Suite for Graph views.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./GraphView_test.h"
+#include "../src/Graph.h"
+#include "../src/DenseSubgraph.h"
+#include "../src/GraphDiff.h"
+#include "../src/GraphView.h"
+#include "../src/Neighborhood.h"
+#include "../src/ShortestPath.h"
+#include "../src/WeightIndex.h"
+
+#define VERTICES 200
+#define EDGES 800
+
+// Helper function declarations.
+static bool SkipOneThree(GVertex_t v1, GVertex_t v2, GWeight_t w, void *arg);
+static bool SkipSomeEdges(GVertex_t v1, GVertex_t v2, GWeight_t w,
+                          void *arg);
+static bool CountClique(const GVertex_t *clique, int size, void *arg);
+static void AssertSameEdges(Graph g1, Graph g2);
+
+// Tests what a view of a small undirected Graph shows, and that it can't be
+// changed.
+START_TEST(small_test)
+{
+  GraphSummary summary;
+  Neighbor *out;
+  GVertex_t shown[] = { 1, 2, 3, 9, 42 };
+  Graph g, view, inner;
+  int n;
+
+  g = AllocateGraph();
+  ck_assert_int_eq(AddGraphEdge(g, 1, 2, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 2, 3, 2), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 3, 4, 3), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 4, 1, 4), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 3, 1, 5), 0);
+  ck_assert_int_eq(AddVertex(g, 9), 0);
+
+  // 42 isn't in the Graph, so it is left out
+  view = CreateGraphView(g, shown, 5, NULL, NULL);
+  ck_assert(view != NULL);
+  ck_assert(IsGraphView(view));
+  ck_assert(!IsGraphView(g));
+  ck_assert(ContainsVertex(view, 9));
+  ck_assert(!ContainsVertex(view, 4));
+  ck_assert(!ContainsVertex(view, 42));
+  ck_assert(AreAdjacent(view, 2, 1));
+  ck_assert(AreAdjacent(view, 1, 3));
+  ck_assert(!AreAdjacent(view, 3, 4));
+  ck_assert_int_eq(GetNeighbors(view, 4, &out), -1);
+  n = GetNeighbors(view, 1, &out);
+  ck_assert_int_eq(n, 2);
+  ck_assert(out[0].v != 4 && out[1].v != 4);
+  free(out);
+  ck_assert_int_eq(GetNeighbors(view, 9, &out), 0);
+  GetGraphSummary(view, &summary);
+  ck_assert_int_eq(summary.vertices, 4);
+  ck_assert_int_eq(summary.edges, 3);
+  ck_assert_int_eq(summary.minDegree, 0);
+  ck_assert_int_eq(summary.maxDegree, 2);
+
+  // a view is read only
+  ck_assert_int_eq(AddVertex(view, 7), -1);
+  ck_assert_int_eq(AddGraphEdge(view, 1, 2, 7), -1);
+  RemoveGraphEdge(view, 1, 2);
+  ck_assert(AreAdjacent(view, 1, 2));
+  ck_assert(!ContainsVertex(g, 7));
+
+  // a view of the view, filtering {1,3} from either end
+  inner = CreateGraphView(view, NULL, 0, SkipOneThree, NULL);
+  ck_assert(inner != NULL);
+  ck_assert(!ContainsVertex(inner, 4));
+  ck_assert(!AreAdjacent(inner, 1, 3));
+  ck_assert(!AreAdjacent(inner, 3, 1));
+  ck_assert(AreAdjacent(inner, 2, 3));
+  ck_assert_int_eq(GetNeighbors(inner, 3, &out), 1);
+  ck_assert(out[0].v == 2);
+  free(out);
+  GetGraphSummary(inner, &summary);
+  ck_assert_int_eq(summary.vertices, 4);
+  ck_assert_int_eq(summary.edges, 2);
+
+  // the Graph itself is untouched
+  ck_assert(AreAdjacent(g, 1, 3));
+  GetGraphSummary(g, &summary);
+  ck_assert_int_eq(summary.vertices, 5);
+  ck_assert_int_eq(summary.edges, 5);
+
+  FreeGraph(inner);
+  FreeGraph(view);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a view of a directed Graph shows edges one way, in and out.
+START_TEST(directed_test)
+{
+  GVertex_t shown[] = { 1, 2, 3 };
+  GraphSummary before, after;
+  Neighbor *out;
+  Graph g, view, copy;
+
+  g = AllocateDirectedGraph();
+  ck_assert_int_eq(AddGraphEdge(g, 1, 2, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 2, 3, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 3, 1, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 4, 1, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 1, 4, 1), 0);
+
+  // the in-adjacency is only built once a query on the view needs it
+  GetGraphSummary(g, &before);
+  view = CreateGraphView(g, shown, 3, NULL, NULL);
+  ck_assert(view != NULL);
+  GetGraphSummary(g, &after);
+  ck_assert_uint_eq(after.edgeBytes, before.edgeBytes);
+  ck_assert(AreAdjacent(view, 1, 2));
+  ck_assert(!AreAdjacent(view, 2, 1));
+  ck_assert_int_eq(GetNeighbors(view, 1, &out), 1);
+  ck_assert(out[0].v == 2);
+  free(out);
+  ck_assert_int_eq(GetInNeighbors(view, 1, &out), 1);
+  ck_assert(out[0].v == 3);
+  free(out);
+  GetGraphSummary(g, &after);
+  ck_assert(after.edgeBytes > before.edgeBytes);
+  ck_assert_int_eq(GetInNeighbors(g, 1, &out), 2);
+  free(out);
+
+  copy = MaterializeGraphView(view, 2);
+  ck_assert(copy != NULL);
+  ck_assert(IsDirectedGraph(copy));
+  ck_assert(!IsGraphView(copy));
+  AssertSameEdges(view, copy);
+  ck_assert_int_eq(AddGraphEdge(copy, 2, 1, 1), 0);
+  ck_assert(!AreAdjacent(view, 2, 1));
+
+  FreeGraph(copy);
+  FreeGraph(view);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that queries on a view of a random Graph answer what they do on
+// the view materialized, with one thread and with several.
+START_TEST(random_test)
+{
+  unsigned int seed = 45;
+  GVertex_t shown[VERTICES];
+  const HopVertex *hops;
+  const Neighbor *n1, *n2;
+  PathResult p1, p2;
+  VertexCore *c1, *c2;
+  long cliques1, cliques2;
+  Graph g, view, copy;
+  int i, threads, r1, r2, count;
+
+  g = AllocateGraph();
+  for (i = 0; i < VERTICES; i++) {
+    ck_assert_int_eq(AddVertex(g, i), 0);
+  }
+  for (i = 0; i < EDGES; i++) {
+    AddGraphEdge(g, rand_r(&seed) % VERTICES, rand_r(&seed) % VERTICES,
+                 rand_r(&seed) % 8 + 1);
+  }
+  count = 0;
+  for (i = 0; i < VERTICES; i++) {
+    if (rand_r(&seed) % 3 != 0) {
+      shown[count++] = i;
+    }
+  }
+  view = CreateGraphView(g, shown, count, SkipSomeEdges, NULL);
+  ck_assert(view != NULL);
+
+  for (threads = 1; threads <= 4; threads += 3) {
+    copy = MaterializeGraphView(view, threads);
+    ck_assert(copy != NULL);
+    AssertSameEdges(view, copy);
+
+    for (i = 0; i < 20; i++) {
+      r1 = GetKHopNeighborhood(view, shown[i], 2, &hops);
+      r2 = GetKHopNeighborhood(copy, shown[i], 2, &hops);
+      ck_assert_int_eq(r1, r2);
+      r1 = DijkstraPath(view, shown[i], shown[count - 1 - i], &p1);
+      r2 = DijkstraPath(copy, shown[i], shown[count - 1 - i], &p2);
+      ck_assert_int_eq(r1, r2);
+      if (r1 == 1) {
+        ck_assert(p1.distance == p2.distance);
+      }
+    }
+    ck_assert_int_eq(DijkstraPath(view, shown[0], VERTICES, &p1), -1);
+
+    r1 = GetCoreNumbers(view, &c1);
+    r2 = GetCoreNumbers(copy, &c2);
+    ck_assert_int_eq(r1, count);
+    ck_assert_int_eq(r2, count);
+    ck_assert_int_eq(c1[count - 1].core, c2[count - 1].core);
+    free(c1);
+    free(c2);
+    cliques1 = ForEachMaximalClique(view, 3, CountClique, NULL);
+    cliques2 = ForEachMaximalClique(copy, 3, CountClique, NULL);
+    ck_assert_int_eq(cliques1, cliques2);
+
+    // the view's weight index holds only the edges it shows
+    ck_assert_int_eq(EnableWeightIndex(view), 0);
+    ck_assert_int_eq(EnableWeightIndex(copy), 0);
+    ck_assert(!HasWeightIndex(g));
+    for (i = 0; i < count; i++) {
+      r1 = GetNeighborsUpToWeight(view, shown[i], 4, &n1);
+      r2 = GetNeighborsUpToWeight(copy, shown[i], 4, &n2);
+      ck_assert_int_eq(r1, r2);
+    }
+    DisableWeightIndex(view);
+
+    FreeGraph(copy);
+  }
+
+  FreeGraph(view);
+  FreeGraph(g);
+}
+END_TEST
+
+Suite *GraphViewSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("GraphView");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, small_test);
+  tcase_add_test(tc_core, directed_test);
+  tcase_add_test(tc_core, random_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function filtering out the edge {1,3}.
+static bool SkipOneThree(GVertex_t v1, GVertex_t v2, GWeight_t w, void *arg) {
+  return !(v1 == 1 && v2 == 3);
+}
+
+// Helper function filtering out an arbitrary third of the edges.
+static bool SkipSomeEdges(GVertex_t v1, GVertex_t v2, GWeight_t w,
+                          void *arg) {
+  return (v1 + 2 * v2) % 3 != 0;
+}
+
+// Helper function taking every clique, which ForEachMaximalClique counts.
+static bool CountClique(const GVertex_t *clique, int size, void *arg) {
+  return true;
+}
+
+// Helper function asserting that two Graphs show the same vertices and
+// edges, and the same counters.
+static void AssertSameEdges(Graph g1, Graph g2) {
+  GraphSummary s1, s2;
+  GraphDiff diff;
+
+  ck_assert_int_eq(DiffGraphs(g1, g2, &diff), 0);
+  ck_assert_uint_eq(diff.numVertices, 0);
+  ck_assert_uint_eq(diff.numChanges, 0);
+  FreeGraphDiff(&diff);
+  ck_assert_int_eq(DiffGraphs(g2, g1, &diff), 0);
+  ck_assert_uint_eq(diff.numVertices, 0);
+  ck_assert_uint_eq(diff.numChanges, 0);
+  FreeGraphDiff(&diff);
+
+  GetGraphSummary(g1, &s1);
+  GetGraphSummary(g2, &s2);
+  ck_assert_int_eq(s1.vertices, s2.vertices);
+  ck_assert_int_eq(s1.edges, s2.edges);
+  ck_assert_int_eq(s1.minDegree, s2.minDegree);
+  ck_assert_int_eq(s1.maxDegree, s2.maxDegree);
+}
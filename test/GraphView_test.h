@@ -0,0 +1,11 @@
+// Test Suite for Graph views.
+
+#include <check.h>
+
+#ifndef _GRAPH_VIEW_TEST_H_
+#define _GRAPH_VIEW_TEST_H_
+
+// Returns the test suite for Graph views.
+Suite *GraphViewSuite();
+
+#endif
@@ -5,6 +5,7 @@
 #include <check.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "./Graph_test.h"
 #include "../src/Graph.h"
@@ -304,6 +305,358 @@ START_TEST(pseudo_end_to_end_test)
 }
 END_TEST
 
+// Tests that adding an edge that is already present updates its weight
+// rather than adding a second edge.
+START_TEST(duplicate_edge_test)
+{
+  Neighbor *out;
+
+  ck_assert(AddGraphEdge(g, 1, 2, 1) == 0);
+  ck_assert(AddGraphEdge(g, 2, 1, 7) == 0);
+
+  ck_assert(GetNeighbors(g, 1, &out) == 1);
+  ck_assert(ContainsNeighbor(out, 1, 2, 7));
+  free(out);
+  ck_assert(GetNeighbors(g, 2, &out) == 1);
+  ck_assert(ContainsNeighbor(out, 1, 1, 7));
+  free(out);
+
+  RemoveGraphEdge(g, 1, 2);
+  ck_assert(!AreAdjacent(g, 1, 2));
+}
+END_TEST
+
+// Tests that self-loops are rejected and leave the Graph untouched.
+START_TEST(self_loop_test)
+{
+  ck_assert(AddGraphEdge(g, 1, 1, 0) == -1);
+  ck_assert(!ContainsVertex(g, 1));
+}
+END_TEST
+
+// Tests the summary of an empty Graph.
+START_TEST(empty_summary_test)
+{
+  GraphSummary s;
+
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 0);
+  ck_assert(s.edges == 0);
+  ck_assert(s.minDegree == 0);
+  ck_assert(s.maxDegree == 0);
+  ck_assert(s.vertexBytes == 0);
+  ck_assert(s.edgeBytes == 0);
+}
+END_TEST
+
+// Tests the summary of a star with an isolated vertex, and that it tracks
+// edges being removed again.
+START_TEST(summary_test)
+{
+  GraphSummary s;
+  int i;
+
+  for (i = 2; i <= 6; i++) {
+    ck_assert(AddGraphEdge(g, 1, i, i) == 0);
+  }
+  ck_assert(AddVertex(g, 7) == 0);
+
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 7);
+  ck_assert(s.edges == 5);
+  ck_assert(s.minDegree == 0);
+  ck_assert(s.maxDegree == 5);
+  ck_assert(s.meanDegree == 10.0 / 7);
+  ck_assert(s.degreeHistogram[0] == 1);  // vertex 7
+  ck_assert(s.degreeHistogram[1] == 5);  // the leaves
+  ck_assert(s.degreeHistogram[3] == 1);  // the center, degree in [4, 8)
+  ck_assert(s.vertexBytes >= 7 * sizeof(ListItem));
+  ck_assert(s.edgeBytes >= 10 * sizeof(EdgeItem));
+
+  // shrink the star down to a single edge
+  for (i = 3; i <= 6; i++) {
+    RemoveGraphEdge(g, 1, i);
+  }
+  RemoveGraphEdge(g, 1, 3);  // already gone, no effect
+
+  GetGraphSummary(g, &s);
+  ck_assert(s.vertices == 7);
+  ck_assert(s.edges == 1);
+  ck_assert(s.minDegree == 0);
+  ck_assert(s.maxDegree == 1);
+  ck_assert(s.degreeHistogram[0] == 5);
+  ck_assert(s.degreeHistogram[1] == 2);
+  ck_assert(s.degreeHistogram[3] == 0);
+}
+END_TEST
+
+// Tests that the incrementally maintained minimum and maximum degree agree
+// with the actual degrees over a longer sequence of operations.
+START_TEST(summary_min_max_test)
+{
+  GraphSummary s;
+  Neighbor *out;
+  int i, j, n, min, max;
+
+  srand(26);
+  for (i = 0; i < 2000; i++) {
+    if (rand() % 3 == 0) {
+      RemoveGraphEdge(g, rand() % 20, rand() % 20);
+    } else {
+      AddGraphEdge(g, rand() % 20, rand() % 20, 0);
+    }
+
+    if (i % 50 != 0) {
+      continue;
+    }
+
+    min = -1;
+    max = 0;
+    for (j = 0; j < 20; j++) {
+      n = GetNeighbors(g, j, &out);
+      if (n == -1) {
+        continue;
+      }
+      if (n > 0) {
+        free(out);
+      }
+      if (min == -1 || n < min) {
+        min = n;
+      }
+      if (n > max) {
+        max = n;
+      }
+    }
+
+    GetGraphSummary(g, &s);
+    ck_assert(s.minDegree == (min == -1 ? 0 : min));
+    ck_assert(s.maxDegree == max);
+  }
+}
+END_TEST
+
+// Tests that the batched membership query agrees with ContainsVertex.
+START_TEST(contains_vertex_batch_test)
+{
+  GVertex_t vs[100];
+  bool results[100];
+  int i;
+
+  for (i = 0; i < 100; i += 2) {
+    ck_assert(AddVertex(g, i) == 0);
+  }
+  for (i = 0; i < 100; i++) {
+    vs[i] = 99 - i;
+  }
+
+  ContainsVertexBatch(g, vs, 100, results);
+  for (i = 0; i < 100; i++) {
+    ck_assert(results[i] == ContainsVertex(g, vs[i]));
+  }
+
+  // batches smaller than the pipeline depth work too
+  ContainsVertexBatch(g, vs, 1, results);
+  ck_assert(!results[0]);
+  ContainsVertexBatch(g, vs, 0, results);
+}
+END_TEST
+
+// Tests that the batched adjacency query agrees with AreAdjacent, including
+// for pairs where one or both vertices are missing.
+START_TEST(are_adjacent_batch_test)
+{
+  VertexPair queries[500];
+  bool results[500];
+  int i;
+
+  srand(28);
+  for (i = 0; i < 200; i++) {
+    AddGraphEdge(g, rand() % 50, rand() % 50, i);
+  }
+  for (i = 0; i < 500; i++) {
+    queries[i].v1 = rand() % 60;
+    queries[i].v2 = rand() % 60;
+  }
+
+  AreAdjacentBatch(g, queries, 500, results);
+  for (i = 0; i < 500; i++) {
+    ck_assert(results[i] == AreAdjacent(g, queries[i].v1, queries[i].v2));
+  }
+
+  AreAdjacentBatch(g, queries, 3, results);
+  for (i = 0; i < 3; i++) {
+    ck_assert(results[i] == AreAdjacent(g, queries[i].v1, queries[i].v2));
+  }
+}
+END_TEST
+
+// Tests that a directed Graph stores each edge in one direction only.
+START_TEST(directed_edge_test)
+{
+  GraphSummary s;
+  Neighbor *out;
+  Graph d;
+
+  d = AllocateDirectedGraph();
+  ck_assert(d != NULL);
+  ck_assert(IsDirectedGraph(d));
+  ck_assert(!IsDirectedGraph(g));
+
+  ck_assert(AddGraphEdge(d, 1, 2, 5) == 0);
+  ck_assert(AddGraphEdge(d, 1, 3, 6) == 0);
+  ck_assert(AddGraphEdge(d, 3, 1, 7) == 0);
+  ck_assert(AreAdjacent(d, 1, 2));
+  ck_assert(!AreAdjacent(d, 2, 1));
+  ck_assert(AreAdjacent(d, 1, 3));
+  ck_assert(AreAdjacent(d, 3, 1));
+
+  ck_assert(GetNeighbors(d, 1, &out) == 2);
+  ck_assert(ContainsNeighbor(out, 2, 2, 5));
+  ck_assert(ContainsNeighbor(out, 2, 3, 6));
+  free(out);
+  ck_assert(GetNeighbors(d, 2, &out) == 0);
+
+  GetGraphSummary(d, &s);
+  ck_assert(s.vertices == 3);
+  ck_assert(s.edges == 3);
+  ck_assert(s.minDegree == 0);
+  ck_assert(s.maxDegree == 2);
+  ck_assert(s.meanDegree == 1.0);
+
+  RemoveGraphEdge(d, 2, 1);
+  ck_assert(AreAdjacent(d, 1, 2));
+  RemoveGraphEdge(d, 1, 3);
+  ck_assert(!AreAdjacent(d, 1, 3));
+  ck_assert(AreAdjacent(d, 3, 1));
+
+  FreeGraph(d);
+}
+END_TEST
+
+// Tests that the in-adjacency of a directed Graph is built on demand, and
+// then kept up to date as edges come and go.
+START_TEST(directed_in_neighbors_test)
+{
+  GraphSummary before, after;
+  Neighbor *out;
+  Graph d;
+
+  d = AllocateDirectedGraph();
+  ck_assert(d != NULL);
+  ck_assert(AddGraphEdge(d, 1, 3, 1) == 0);
+  ck_assert(AddGraphEdge(d, 2, 3, 2) == 0);
+  ck_assert(AddGraphEdge(d, 3, 4, 3) == 0);
+  GetGraphSummary(d, &before);
+
+  ck_assert(GetInNeighbors(d, 5, &out) == -1);
+  ck_assert(GetInNeighbors(d, 1, &out) == 0);
+  ck_assert(GetInNeighbors(d, 3, &out) == 2);
+  ck_assert(ContainsNeighbor(out, 2, 1, 1));
+  ck_assert(ContainsNeighbor(out, 2, 2, 2));
+  free(out);
+
+  // building the reverse lists doubles the edge storage
+  GetGraphSummary(d, &after);
+  ck_assert(after.edgeBytes == 2 * before.edgeBytes);
+
+  // mutations now update both directions
+  ck_assert(AddGraphEdge(d, 4, 3, 4) == 0);
+  ck_assert(AddGraphEdge(d, 2, 3, 9) == 0);
+  RemoveGraphEdge(d, 1, 3);
+  RemoveGraphEdge(d, 3, 4);
+  ck_assert(GetInNeighbors(d, 3, &out) == 2);
+  ck_assert(ContainsNeighbor(out, 2, 2, 9));
+  ck_assert(ContainsNeighbor(out, 2, 4, 4));
+  free(out);
+  ck_assert(GetInNeighbors(d, 4, &out) == 0);
+
+  FreeGraph(d);
+}
+END_TEST
+
+// Tests that an undirected Graph's in-neighbors are its neighbors.
+START_TEST(undirected_in_neighbors_test)
+{
+  Neighbor *out;
+
+  ck_assert(AddGraphEdge(g, 1, 2, 3) == 0);
+  ck_assert(GetInNeighbors(g, 1, &out) == 1);
+  ck_assert(ContainsNeighbor(out, 1, 2, 3));
+  free(out);
+  ck_assert(GetInNeighbors(g, 2, &out) == 1);
+  ck_assert(ContainsNeighbor(out, 1, 1, 3));
+  free(out);
+}
+END_TEST
+
+// Tests that vertex payloads start zeroed and keep what is written to them
+// as the Graph grows around them.
+START_TEST(vertex_payload_test)
+{
+  unsigned char zero[GRAPH_VERTEX_PAYLOAD + 1] = { 0 };
+  unsigned char *p;
+  int i;
+
+  ck_assert(GetVertexPayload(g, 1) == NULL);
+  ck_assert(AddVertex(g, 1) == 0);
+
+  p = (unsigned char *)GetVertexPayload(g, 1);
+#if GRAPH_VERTEX_PAYLOAD == 0
+  ck_assert(p == NULL);
+  (void)zero;
+  (void)i;
+#else
+  ck_assert(p != NULL);
+  ck_assert(memcmp(p, zero, GRAPH_VERTEX_PAYLOAD) == 0);
+  memset(p, 0xAB, GRAPH_VERTEX_PAYLOAD);
+
+  for (i = 2; i < 100; i++) {
+    ck_assert(AddGraphEdge(g, 1, i, i) == 0);
+  }
+  ck_assert(GetVertexPayload(g, 1) == p);
+  ck_assert(p[0] == 0xAB && p[GRAPH_VERTEX_PAYLOAD - 1] == 0xAB);
+  p = (unsigned char *)GetVertexPayload(g, 2);
+  ck_assert(memcmp(p, zero, GRAPH_VERTEX_PAYLOAD) == 0);
+#endif
+}
+END_TEST
+
+// Tests that edge payloads are shared by both directions of an edge, are
+// copied out by GetNeighbors, and survive a weight update.
+START_TEST(edge_payload_test)
+{
+  unsigned char data[GRAPH_EDGE_PAYLOAD + 1];
+  const unsigned char *p;
+  Neighbor *out;
+
+  memset(data, 0x5C, sizeof(data));
+  ck_assert(SetEdgePayload(g, 1, 2, data) == -1);
+  ck_assert(GetEdgePayload(g, 1, 2) == NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 3) == 0);
+
+  if (GRAPH_EDGE_PAYLOAD == 0) {
+    ck_assert(SetEdgePayload(g, 1, 2, data) == -1);
+    ck_assert(GetEdgePayload(g, 1, 2) == NULL);
+    return;
+  }
+  p = (const unsigned char *)GetEdgePayload(g, 2, 1);
+  ck_assert(p != NULL && p[0] == 0);
+
+  ck_assert(SetEdgePayload(g, 1, 2, data) == 0);
+  ck_assert(AddGraphEdge(g, 2, 1, 4) == 0);
+  ck_assert(memcmp(GetEdgePayload(g, 1, 2), data, GRAPH_EDGE_PAYLOAD) == 0);
+  ck_assert(memcmp(GetEdgePayload(g, 2, 1), data, GRAPH_EDGE_PAYLOAD) == 0);
+
+#if GRAPH_EDGE_PAYLOAD > 0
+  ck_assert(GetNeighbors(g, 2, &out) == 1);
+  ck_assert(memcmp(out[0].payload, data, GRAPH_EDGE_PAYLOAD) == 0);
+  free(out);
+#else
+  (void)out;
+#endif
+}
+END_TEST
+
 Suite *GraphSuite() {
   Suite *s;
   TCase *tc_core;
@@ -330,6 +683,18 @@ Suite *GraphSuite() {
   tcase_add_test(tc_core, get_neighbors_single_neighbor_test);
   tcase_add_test(tc_core, get_neighbors_multiple_neighbors_test);
   tcase_add_test(tc_core, pseudo_end_to_end_test);
+  tcase_add_test(tc_core, duplicate_edge_test);
+  tcase_add_test(tc_core, self_loop_test);
+  tcase_add_test(tc_core, empty_summary_test);
+  tcase_add_test(tc_core, summary_test);
+  tcase_add_test(tc_core, summary_min_max_test);
+  tcase_add_test(tc_core, contains_vertex_batch_test);
+  tcase_add_test(tc_core, are_adjacent_batch_test);
+  tcase_add_test(tc_core, directed_edge_test);
+  tcase_add_test(tc_core, directed_in_neighbors_test);
+  tcase_add_test(tc_core, undirected_in_neighbors_test);
+  tcase_add_test(tc_core, vertex_payload_test);
+  tcase_add_test(tc_core, edge_payload_test);
 
   suite_add_tcase(s, tc_core);
 
@@ -337,14 +702,15 @@ Suite *GraphSuite() {
 }
 
 // Helper function to determine if the given neighbor with the given weight
-// is present in the list specified by out.
+// is present in the list specified by out. In an unweighted Graph every
+// weight is 1, so only the vertex is checked.
 bool ContainsNeighbor(Neighbor *out, int capacity, GVertex_t v, int w) {
   Neighbor n;
   int i;
 
   for (i = 0; i < capacity; i++) {
     n = out[i];
-    if (n.v == v && n.weight == w) {
+    if (n.v == v && (GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || n.weight == w)) {
       return true;
     }
   }
@@ -0,0 +1,275 @@
+// Test Suite for k-hop neighborhood queries.
+
+#include <check.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "./Neighborhood_test.h"
+#include "../src/Graph.h"
+#include "../src/Neighborhood.h"
+
+#define RANDOM_VERTICES 300
+
+// Helper function declarations.
+static const HopVertex *FindHop(const HopVertex *hood, int n, GVertex_t v);
+static Graph RandomGraph(bool directed, unsigned int seed);
+static void AssertMatchesReference(Graph g, GVertex_t v, int k);
+static void *QueryThread(void *arg);
+
+// Tests the trivial cases: a missing vertex, and zero hops.
+START_TEST(trivial_test)
+{
+  const HopVertex *hood;
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert(GetKHopNeighborhood(g, 1, 2, &hood) == -1);
+  ck_assert(ExtractKHopSubgraph(g, 1, 2) == NULL);
+
+  ck_assert(AddGraphEdge(g, 1, 2, 3) == 0);
+  ck_assert(GetKHopNeighborhood(g, 1, 0, &hood) == 1);
+  ck_assert(hood[0].v == 1 && hood[0].hops == 0 && hood[0].distance == 0);
+
+  ck_assert(AddVertex(g, 3) == 0);
+  ck_assert(GetKHopNeighborhood(g, 3, 5, &hood) == 1);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that distances are the least weight over paths of at most k edges,
+// even where a longer path is lighter.
+START_TEST(hop_bounded_distance_test)
+{
+  const HopVertex *hood, *h;
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 5) == 0);
+  ck_assert(AddGraphEdge(g, 2, 3, 1) == 0);
+  ck_assert(AddGraphEdge(g, 1, 3, 10) == 0);
+  ck_assert(AddGraphEdge(g, 3, 4, 1) == 0);
+  ck_assert(AddGraphEdge(g, 5, 6, 1) == 0);
+
+  ck_assert(GetKHopNeighborhood(g, 1, 1, &hood) == 3);
+  ck_assert(hood[0].v == 1);
+  ck_assert((h = FindHop(hood, 3, 3)) != NULL && h->hops == 1);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || h->distance == 10);
+
+  ck_assert(GetKHopNeighborhood(g, 1, 2, &hood) == 4);
+  ck_assert((h = FindHop(hood, 4, 3)) != NULL && h->hops == 1);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || h->distance == 6);
+  ck_assert((h = FindHop(hood, 4, 4)) != NULL && h->hops == 2);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || h->distance == 11);
+
+  ck_assert(GetKHopNeighborhood(g, 1, 3, &hood) == 4);
+  ck_assert((h = FindHop(hood, 4, 4)) != NULL && h->hops == 2);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || h->distance == 7);
+  ck_assert(FindHop(hood, 4, 5) == NULL);
+
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests many queries against a straightforward reference built on
+// GetNeighbors, on undirected and directed Graphs. The queries share the
+// thread's scratch space, so this also checks that nothing leaks from one
+// query into the next.
+START_TEST(matches_reference_test)
+{
+  Graph g;
+  int i, directed;
+
+  for (directed = 0; directed < 2; directed++) {
+    g = RandomGraph(directed, 33 + directed);
+    for (i = 0; i < 60; i++) {
+      AssertMatchesReference(g, rand() % RANDOM_VERTICES, i % 5);
+    }
+    FreeGraph(g);
+  }
+}
+END_TEST
+
+// Tests that the induced subgraph has the neighborhood's vertices and
+// exactly the edges between them.
+START_TEST(extract_subgraph_test)
+{
+  GraphSummary s;
+  Graph g, sub;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 1) == 0);
+  ck_assert(AddGraphEdge(g, 2, 3, 2) == 0);
+  ck_assert(AddGraphEdge(g, 1, 3, 3) == 0);
+  ck_assert(AddGraphEdge(g, 3, 4, 4) == 0);
+  ck_assert(AddGraphEdge(g, 4, 5, 5) == 0);
+
+  sub = ExtractKHopSubgraph(g, 1, 1);
+  ck_assert(sub != NULL);
+  GetGraphSummary(sub, &s);
+  ck_assert(s.vertices == 3 && s.edges == 3);
+  ck_assert(AreAdjacent(sub, 2, 3));
+  ck_assert(!ContainsVertex(sub, 4));
+  FreeGraph(sub);
+
+  sub = ExtractKHopSubgraph(g, 5, 0);
+  ck_assert(sub != NULL);
+  GetGraphSummary(sub, &s);
+  ck_assert(s.vertices == 1 && s.edges == 0);
+  FreeGraph(sub);
+  FreeGraph(g);
+
+  // in a directed Graph, only edges between reachable vertices come along
+  g = AllocateDirectedGraph();
+  ck_assert(g != NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 1) == 0);
+  ck_assert(AddGraphEdge(g, 2, 1, 1) == 0);
+  ck_assert(AddGraphEdge(g, 3, 1, 1) == 0);
+  sub = ExtractKHopSubgraph(g, 1, 3);
+  ck_assert(sub != NULL);
+  ck_assert(IsDirectedGraph(sub));
+  GetGraphSummary(sub, &s);
+  ck_assert(s.vertices == 2 && s.edges == 2);
+  ck_assert(!ContainsVertex(sub, 3));
+  FreeGraph(sub);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests queries from several threads at once, each with its own scratch.
+START_TEST(concurrent_queries_test)
+{
+  pthread_t ids[4];
+  Graph g;
+  int t;
+
+  g = RandomGraph(false, 35);
+  for (t = 0; t < 4; t++) {
+    ck_assert(pthread_create(&ids[t], NULL, QueryThread, g) == 0);
+  }
+  for (t = 0; t < 4; t++) {
+    pthread_join(ids[t], NULL);
+  }
+  FreeGraph(g);
+}
+END_TEST
+
+Suite *NeighborhoodSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Neighborhood");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, trivial_test);
+  tcase_add_test(tc_core, hop_bounded_distance_test);
+  tcase_add_test(tc_core, matches_reference_test);
+  tcase_add_test(tc_core, extract_subgraph_test);
+  tcase_add_test(tc_core, concurrent_queries_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function returning the entry for v in a neighborhood, or NULL.
+static const HopVertex *FindHop(const HopVertex *hood, int n, GVertex_t v) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (hood[i].v == v) {
+      return &hood[i];
+    }
+  }
+  return NULL;
+}
+
+// Helper function building a sparse random Graph on [0, RANDOM_VERTICES).
+static Graph RandomGraph(bool directed, unsigned int seed) {
+  Graph g;
+  int i;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  ck_assert(g != NULL);
+  srand(seed);
+  for (i = 0; i < RANDOM_VERTICES; i++) {
+    ck_assert(AddVertex(g, i) == 0);
+  }
+  for (i = 0; i < 2 * RANDOM_VERTICES; i++) {
+    AddGraphEdge(g, rand() % RANDOM_VERTICES, rand() % RANDOM_VERTICES,
+                 rand() % 20);
+  }
+  return g;
+}
+
+// Helper function asserting that a query agrees with k rounds of
+// Bellman-Ford over GetNeighbors, on a Graph from RandomGraph.
+static void AssertMatchesReference(Graph g, GVertex_t v, int k) {
+  long dist[RANDOM_VERTICES], next[RANDOM_VERTICES];
+  int hops[RANDOM_VERTICES];
+  const HopVertex *hood, *h;
+  Neighbor *out;
+  int u, i, n, round, reached = 1;
+
+  for (u = 0; u < RANDOM_VERTICES; u++) {
+    dist[u] = LONG_MAX;
+    hops[u] = -1;
+  }
+  dist[v] = 0;
+  hops[v] = 0;
+
+  for (round = 1; round <= k; round++) {
+    for (u = 0; u < RANDOM_VERTICES; u++) {
+      next[u] = dist[u];
+    }
+    for (u = 0; u < RANDOM_VERTICES; u++) {
+      if (dist[u] == LONG_MAX) {
+        continue;
+      }
+      n = GetNeighbors(g, u, &out);
+      for (i = 0; i < n; i++) {
+        if (dist[u] + out[i].weight < next[out[i].v]) {
+          next[out[i].v] = dist[u] + out[i].weight;
+        }
+        if (hops[out[i].v] == -1) {
+          hops[out[i].v] = round;
+          reached++;
+        }
+      }
+      if (n > 0) {
+        free(out);
+      }
+    }
+    for (u = 0; u < RANDOM_VERTICES; u++) {
+      dist[u] = next[u];
+    }
+  }
+
+  ck_assert(GetKHopNeighborhood(g, v, k, &hood) == reached);
+  for (u = 0; u < RANDOM_VERTICES; u++) {
+    h = FindHop(hood, reached, u);
+    ck_assert((h != NULL) == (hops[u] != -1));
+    if (h != NULL) {
+      ck_assert(h->hops == hops[u]);
+      ck_assert(h->distance == dist[u]);
+    }
+  }
+  for (i = 1; i < reached; i++) {
+    ck_assert(hood[i - 1].hops <= hood[i].hops);
+  }
+}
+
+// Helper function running reference checks from a thread of its own.
+static void *QueryThread(void *arg) {
+  Graph g = (Graph)arg;
+  int i;
+
+  for (i = 0; i < 20; i++) {
+    AssertMatchesReference(g, (i * 37) % RANDOM_VERTICES, 1 + i % 4);
+  }
+  return NULL;
+}
@@ -0,0 +1,11 @@
+// Test Suite for k-hop neighborhood queries.
+
+#include <check.h>
+
+#ifndef _NEIGHBORHOOD_TEST_H_
+#define _NEIGHBORHOOD_TEST_H_
+
+// Returns the test suite for k-hop neighborhood queries.
+Suite *NeighborhoodSuite();
+
+#endif
@@ -0,0 +1,169 @@
+// Test Suite for Graph partitioning.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./Partition_test.h"
+#include "../src/Graph.h"
+#include "../src/Partition.h"
+
+#define CLUSTERS 8
+#define CLUSTER_SIZE 12
+#define SHARDS 4
+
+// Helper function declarations.
+static Graph ClusteredGraph(bool directed);
+static void AssertShardsCover(Graph g, GraphPartition p);
+static int CompareNeighbors(const void *a, const void *b);
+
+// Tests that the greedy method cuts fewer edges than hashing, and keeps
+// the shards balanced.
+START_TEST(edge_cut_test)
+{
+  PartitionSummary hashed, greedy;
+  GraphPartition p, q;
+  Graph g;
+
+  g = ClusteredGraph(false);
+  p = PartitionGraph(g, SHARDS, PARTITION_HASH);
+  q = PartitionGraph(g, SHARDS, PARTITION_LDG);
+  ck_assert(p != NULL && q != NULL);
+  ck_assert(PartitionShards(q) == SHARDS && !IsDirectedPartition(q));
+
+  ck_assert(GetPartitionSummary(g, p, &hashed) == 0);
+  ck_assert(GetPartitionSummary(g, q, &greedy) == 0);
+  ck_assert(hashed.edges == greedy.edges && greedy.shards == SHARDS);
+  ck_assert(greedy.edgeCut < hashed.edgeCut / 2);
+  ck_assert(greedy.ghosts < hashed.ghosts);
+  ck_assert(greedy.maxVertices <= CLUSTERS * CLUSTER_SIZE / SHARDS);
+  ck_assert(greedy.minVertices + greedy.maxVertices ==
+            2 * CLUSTERS * CLUSTER_SIZE / SHARDS);
+
+  // vertices the partition has not seen fall back on the hash
+  ck_assert(PartitionOwner(q, 100000) == PartitionOwner(p, 100000));
+
+  FreePartition(p);
+  FreePartition(q);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the shards hold every vertex's edges, for both methods and
+// both kinds of Graph.
+START_TEST(extract_test)
+{
+  GraphPartition p;
+  Graph g;
+  int d, m;
+
+  for (d = 0; d < 2; d++) {
+    g = ClusteredGraph(d == 1);
+    ck_assert(AddVertex(g, 5000) == 0);
+    for (m = 0; m < 2; m++) {
+      p = PartitionGraph(g, SHARDS, m == 0 ? PARTITION_HASH : PARTITION_LDG);
+      ck_assert(p != NULL);
+      ck_assert(IsDirectedPartition(p) == (d == 1));
+      AssertShardsCover(g, p);
+      FreePartition(p);
+    }
+    FreeGraph(g);
+  }
+}
+END_TEST
+
+Suite *PartitionSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Partition");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, edge_cut_test);
+  tcase_add_test(tc_core, extract_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function building a ring of dense clusters, whose vertices are
+// numbered so that hashing scatters each cluster. In a directed Graph, the
+// edges run from smaller to larger vertices.
+static Graph ClusteredGraph(bool directed) {
+  unsigned int seed = 5;
+  GVertex_t base, next;
+  Graph g;
+  int c, i, j;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  ck_assert(g != NULL);
+  for (c = 0; c < CLUSTERS; c++) {
+    base = c * 100;
+    for (i = 0; i < CLUSTER_SIZE; i++) {
+      for (j = i + 1; j < CLUSTER_SIZE; j++) {
+        if (rand_r(&seed) % 4 != 0) {
+          ck_assert(AddGraphEdge(g, base + i, base + j, 1 + i) == 0);
+        }
+      }
+    }
+    next = ((c + 1) % CLUSTERS) * 100;
+    ck_assert(AddGraphEdge(g, base, next + 1, 1) == 0);
+  }
+  return g;
+}
+
+// Helper function asserting that every vertex is owned by exactly one
+// shard, which holds all of its edges, and that the ghosts are exactly the
+// far ends of the cut edges.
+static void AssertShardsCover(Graph g, GraphPartition p) {
+  Neighbor *expected, *actual;
+  ShardGhost *ghosts;
+  GraphSummary gs, ss;
+  Graph shard;
+  int s, count, owned = 0, n, i, j;
+  GVertex_t v;
+
+  GetGraphSummary(g, &gs);
+  for (s = 0; s < PartitionShards(p); s++) {
+    shard = ExtractShard(g, p, s, &ghosts, &count);
+    ck_assert(shard != NULL);
+    GetGraphSummary(shard, &ss);
+
+    for (i = 0; i < count; i++) {
+      ck_assert(ghosts[i].owner == PartitionOwner(p, ghosts[i].v));
+      ck_assert(ghosts[i].owner != s);
+      ck_assert(ContainsVertex(shard, ghosts[i].v));
+    }
+    // every vertex in the shard is owned or a ghost
+    for (v = 0; v <= 5000; v++) {
+      if (!ContainsVertex(g, v) || PartitionOwner(p, v) != s) {
+        continue;
+      }
+      owned++;
+      ck_assert(ContainsVertex(shard, v));
+      n = GetNeighbors(g, v, &expected);
+      ck_assert(GetNeighbors(shard, v, &actual) == n);
+      if (n > 0) {
+        qsort(expected, n, sizeof(Neighbor), CompareNeighbors);
+        qsort(actual, n, sizeof(Neighbor), CompareNeighbors);
+        for (j = 0; j < n; j++) {
+          ck_assert(expected[j].v == actual[j].v);
+          ck_assert(expected[j].weight == actual[j].weight);
+        }
+        free(expected);
+        free(actual);
+      }
+    }
+    ck_assert(ss.vertices >= count);
+    free(ghosts);
+    FreeGraph(shard);
+  }
+  ck_assert(owned == gs.vertices);
+}
+
+// Helper function ordering neighbors by vertex.
+static int CompareNeighbors(const void *a, const void *b) {
+  GVertex_t x = ((const Neighbor *)a)->v, y = ((const Neighbor *)b)->v;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,11 @@
+// Test Suite for Graph partitioning.
+
+#include <check.h>
+
+#ifndef _PARTITION_TEST_H_
+#define _PARTITION_TEST_H_
+
+// Returns the test suite for Graph partitioning.
+Suite *PartitionSuite();
+
+#endif
@@ -0,0 +1,294 @@
+// Test Suite for random walks and neighbor sampling.
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "./RandomWalk_test.h"
+#include "../src/Graph.h"
+#include "../src/RandomWalk.h"
+
+#define CYCLE 12
+#define SAMPLES 100000
+#define RANDOM_VERTICES 200
+#define HEADER_SIZE 24
+
+// Helper function declarations.
+static Graph Cycle();
+static char *ReadFile(const char *path, long *size);
+static void AssertWalks(Graph g, const char *file, long size,
+                        const WalkOptions *opts);
+
+// Tests that walks follow edges, and end at vertices with no way out.
+START_TEST(walks_test)
+{
+  GVertex_t walk[8];
+  WalkOptions opts;
+  WalkSampler s;
+  WalkRng rng;
+  Graph g;
+  int i, n;
+
+  DefaultWalkOptions(&opts);
+  opts.length = 8;
+  SeedWalkRng(&rng, 5);
+
+  g = Cycle();
+  s = AllocateWalkSampler(g, false);
+  ck_assert(s != NULL);
+  for (i = 0; i < 100; i++) {
+    ck_assert_int_eq(RandomWalk(s, i % CYCLE, &opts, &rng, walk), 8);
+    ck_assert(walk[0] == (GVertex_t)(i % CYCLE));
+    for (n = 1; n < 8; n++) {
+      ck_assert(AreAdjacent(g, walk[n - 1], walk[n]));
+    }
+  }
+  ck_assert_int_eq(RandomWalk(s, 100, &opts, &rng, walk), -1);
+
+  // the sampler knows nothing of vertices added after it
+  ck_assert_int_eq(AddGraphEdge(g, 0, 100, 1), 0);
+  ck_assert_int_eq(RandomWalk(s, 100, &opts, &rng, walk), -1);
+  FreeWalkSampler(s);
+  FreeGraph(g);
+
+  g = AllocateDirectedGraph();
+  ck_assert_int_eq(AddGraphEdge(g, 0, 1, 1), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 1, 2, 1), 0);
+  s = AllocateWalkSampler(g, true);
+  ck_assert(s != NULL);
+  ck_assert_int_eq(RandomWalk(s, 0, &opts, &rng, walk), 3);
+  ck_assert(walk[0] == 0 && walk[1] == 1 && walk[2] == 2);
+  ck_assert_int_eq(RandomWalk(s, 2, &opts, &rng, walk), 1);
+  FreeWalkSampler(s);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that neighbors are sampled in proportion to their weights, or
+// uniformly.
+START_TEST(sampling_test)
+{
+  int counts[6] = {0}, i, weighted;
+  GVertex_t *out;
+  WalkSampler s;
+  WalkRng rng;
+  Graph g;
+
+  out = (GVertex_t *)malloc(sizeof(GVertex_t) * SAMPLES);
+  g = AllocateGraph();
+  for (i = 1; i <= 4; i++) {
+    ck_assert_int_eq(AddGraphEdge(g, 0, i, i), 0);
+  }
+  ck_assert_int_eq(AddGraphEdge(g, 0, 5, 0), 0);
+  ck_assert_int_eq(AddVertex(g, 9), 0);
+
+  for (weighted = 0; weighted < 2; weighted++) {
+    s = AllocateWalkSampler(g, weighted);
+    ck_assert(s != NULL);
+    SeedWalkRng(&rng, 11);
+    ck_assert_int_eq(SampleNeighbors(s, 0, SAMPLES, &rng, out), SAMPLES);
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < SAMPLES; i++) {
+      ck_assert(out[i] >= 1 && out[i] <= 5);
+      counts[out[i]]++;
+    }
+    if (weighted && GRAPH_WEIGHT != GRAPH_WEIGHT_NONE) {
+      for (i = 1; i <= 4; i++) {
+        ck_assert(abs(counts[i] - SAMPLES / 10 * i) < SAMPLES / 100);
+      }
+      ck_assert_int_eq(counts[5], 0);
+    } else {
+      for (i = 1; i <= 5; i++) {
+        ck_assert(abs(counts[i] - SAMPLES / 5) < SAMPLES / 100);
+      }
+    }
+    ck_assert_int_eq(SampleNeighbors(s, 9, 3, &rng, out), 0);
+    ck_assert_int_eq(SampleNeighbors(s, 7, 3, &rng, out), -1);
+    FreeWalkSampler(s);
+  }
+  FreeGraph(g);
+  free(out);
+}
+END_TEST
+
+// Tests that node2vec's p and q steer walks back, or onward, around a
+// cycle.
+START_TEST(node2vec_test)
+{
+  GVertex_t walk[3];
+  WalkOptions opts;
+  WalkSampler s;
+  WalkRng rng;
+  int i, back;
+  Graph g;
+
+  g = Cycle();
+  s = AllocateWalkSampler(g, false);
+  ck_assert(s != NULL);
+  SeedWalkRng(&rng, 3);
+  DefaultWalkOptions(&opts);
+  opts.length = 3;
+
+  opts.p = 0.001;
+  for (back = 0, i = 0; i < 1000; i++) {
+    ck_assert_int_eq(RandomWalk(s, 0, &opts, &rng, walk), 3);
+    back += walk[2] == walk[0];
+  }
+  ck_assert(back > 990);
+
+  opts.p = 1;
+  opts.q = 0.001;
+  for (back = 0, i = 0; i < 1000; i++) {
+    ck_assert_int_eq(RandomWalk(s, 0, &opts, &rng, walk), 3);
+    back += walk[2] == walk[0];
+  }
+  ck_assert(back < 10);
+  FreeWalkSampler(s);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the walks written are well formed, and the same however many
+// threads write them.
+START_TEST(write_test)
+{
+  char path[] = "/tmp/goldsberry_walks_XXXXXX";
+  unsigned int seed = 43;
+  char *first, *file;
+  long size, firstSize;
+  WalkOptions opts;
+  WalkSampler s;
+  int fd, i, threads;
+  Graph g;
+
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+
+  g = AllocateGraph();
+  for (i = 0; i < RANDOM_VERTICES; i++) {
+    ck_assert_int_eq(AddVertex(g, i), 0);
+  }
+  for (i = 0; i < RANDOM_VERTICES * 2; i++) {
+    AddGraphEdge(g, rand_r(&seed) % RANDOM_VERTICES,
+                 rand_r(&seed) % RANDOM_VERTICES, 1 + rand_r(&seed) % 5);
+  }
+  s = AllocateWalkSampler(g, true);
+  ck_assert(s != NULL);
+  DefaultWalkOptions(&opts);
+  opts.length = 6;
+  opts.walksPerVertex = 3;
+  opts.q = 0.5;
+
+  opts.threads = 1;
+  ck_assert_int_eq(WriteRandomWalks(s, &opts, path), RANDOM_VERTICES * 3);
+  first = ReadFile(path, &firstSize);
+  AssertWalks(g, first, firstSize, &opts);
+  for (threads = 0; threads < 4; threads += 3) {
+    opts.threads = threads;
+    ck_assert_int_eq(WriteRandomWalks(s, &opts, path), RANDOM_VERTICES * 3);
+    file = ReadFile(path, &size);
+    ck_assert(size == firstSize && memcmp(file, first, size) == 0);
+    free(file);
+  }
+
+  // another seed, other walks
+  opts.seed = 2;
+  ck_assert_int_eq(WriteRandomWalks(s, &opts, path), RANDOM_VERTICES * 3);
+  file = ReadFile(path, &size);
+  ck_assert(size == firstSize && memcmp(file, first, size) != 0);
+  free(file);
+  free(first);
+
+  ck_assert_int_eq(WriteRandomWalks(s, &opts, "/nonexistent/walks"), -1);
+  FreeWalkSampler(s);
+  FreeGraph(g);
+  unlink(path);
+}
+END_TEST
+
+Suite *RandomWalkSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("RandomWalk");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, walks_test);
+  tcase_add_test(tc_core, sampling_test);
+  tcase_add_test(tc_core, node2vec_test);
+  tcase_add_test(tc_core, write_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function returning an undirected cycle on 0 to CYCLE - 1.
+static Graph Cycle() {
+  Graph g;
+  int i;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  for (i = 0; i < CYCLE; i++) {
+    ck_assert_int_eq(AddGraphEdge(g, i, (i + 1) % CYCLE, 1), 0);
+  }
+  return g;
+}
+
+// Helper function returning the contents of a file, and its size.
+static char *ReadFile(const char *path, long *size) {
+  char *contents;
+  FILE *f;
+
+  f = fopen(path, "rb");
+  ck_assert(f != NULL);
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  contents = (char *)malloc(*size);
+  ck_assert(fread(contents, 1, *size, f) == (size_t)*size);
+  fclose(f);
+  return contents;
+}
+
+// Helper function asserting that a walks file holds a walk from every
+// vertex of g, whose ids are its vertices, in every round, along its edges.
+static void AssertWalks(Graph g, const char *file, long size,
+                        const WalkOptions *opts) {
+  size_t recordSize = 4 + sizeof(GVertex_t) * opts->length;
+  GVertex_t walk[opts->length];
+  const char *record;
+  uint32_t u32, count;
+  uint64_t walks, i;
+  int j;
+
+  ck_assert(memcmp(file, "GBWLK001", 8) == 0);
+  memcpy(&u32, file + 8, 4);
+  ck_assert_uint_eq(u32, sizeof(GVertex_t));
+  memcpy(&u32, file + 12, 4);
+  ck_assert_uint_eq(u32, opts->length);
+  memcpy(&walks, file + 16, 8);
+  ck_assert_uint_eq(walks, RANDOM_VERTICES * opts->walksPerVertex);
+  ck_assert_int_eq(size, HEADER_SIZE + walks * recordSize);
+
+  for (i = 0; i < walks; i++) {
+    record = file + HEADER_SIZE + i * recordSize;
+    memcpy(&count, record, 4);
+    memcpy(walk, record + 4, sizeof(walk));
+    ck_assert(count >= 1 && count <= (uint32_t)opts->length);
+    ck_assert(walk[0] == (GVertex_t)(i % RANDOM_VERTICES));
+    for (j = 1; j < opts->length; j++) {
+      if ((uint32_t)j < count) {
+        ck_assert(AreAdjacent(g, walk[j - 1], walk[j]));
+      } else {
+        ck_assert(walk[j] == 0);
+      }
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Test Suite for random walks and neighbor sampling.
+
+#include <check.h>
+
+#ifndef _RANDOM_WALK_TEST_H_
+#define _RANDOM_WALK_TEST_H_
+
+// Returns the test suite for random walks.
+Suite *RandomWalkSuite();
+
+#endif
@@ -0,0 +1,171 @@
+// Test Suite for sharded Graph serving.
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "./ShardCluster_test.h"
+#include "../src/Graph.h"
+#include "../src/Partition.h"
+#include "../src/ShardCluster.h"
+
+#define SHARDS 3
+#define VERTICES 200
+#define EDGES 800
+#define QUERIES 2000
+
+// Helper function declarations.
+static Graph RandomGraph(bool directed);
+static void AssertRoutesMatch(Graph g, Coordinator c);
+static int CompareNeighbors(const void *a, const void *b);
+
+// Tests that queries routed to the shard processes agree with the Graph
+// they were split from, before and after routing some updates.
+START_TEST(routing_test)
+{
+  char dir[] = "/tmp/goldsberryXXXXXX";
+  GraphPartition p;
+  ShardCluster cluster;
+  Coordinator c;
+  Graph g;
+  int d, i;
+
+  ck_assert(mkdtemp(dir) != NULL);
+  for (d = 0; d < 2; d++) {
+    g = RandomGraph(d == 1);
+    p = PartitionGraph(g, SHARDS, d == 0 ? PARTITION_LDG : PARTITION_HASH);
+    ck_assert(p != NULL);
+    cluster = StartShardCluster(g, p, dir, 1);
+    ck_assert(cluster != NULL);
+    c = ConnectCoordinator(p, dir);
+    ck_assert(c != NULL);
+
+    AssertRoutesMatch(g, c);
+    ck_assert(CoordinatorAddEdge(c, 7, 7, 1) == -1);
+    for (i = 0; i < 50; i++) {
+      ck_assert(AddGraphEdge(g, i, VERTICES + i, 3) == 0);
+      ck_assert(CoordinatorAddEdge(c, i, VERTICES + i, 3) == 0);
+    }
+    AssertRoutesMatch(g, c);
+
+    CloseCoordinator(c);
+    StopShardCluster(cluster);
+    FreePartition(p);
+    FreeGraph(g);
+  }
+  ck_assert(rmdir(dir) == 0);
+}
+END_TEST
+
+// Tests that a coordinator cannot connect once the shards are gone.
+START_TEST(stopped_test)
+{
+  char dir[] = "/tmp/goldsberryXXXXXX";
+  GraphPartition p;
+  ShardCluster cluster;
+  Coordinator c;
+  Graph g;
+
+  ck_assert(mkdtemp(dir) != NULL);
+  g = RandomGraph(false);
+  p = PartitionGraph(g, SHARDS, PARTITION_HASH);
+  ck_assert(p != NULL);
+  cluster = StartShardCluster(g, p, dir, 1);
+  ck_assert(cluster != NULL);
+  c = ConnectCoordinator(p, dir);
+  ck_assert(c != NULL);
+  ck_assert(CoordinatorContainsVertex(c, 1) == ContainsVertex(g, 1));
+
+  StopShardCluster(cluster);
+  ck_assert(CoordinatorContainsVertex(c, 1) == -1);
+  CloseCoordinator(c);
+  ck_assert(ConnectCoordinator(p, dir) == NULL);
+
+  FreePartition(p);
+  FreeGraph(g);
+  ck_assert(rmdir(dir) == 0);
+}
+END_TEST
+
+Suite *ShardClusterSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("ShardCluster");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, routing_test);
+  tcase_add_test(tc_core, stopped_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function building a random Graph.
+static Graph RandomGraph(bool directed) {
+  unsigned int seed = 3;
+  GVertex_t v1, v2;
+  Graph g;
+  int i;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  ck_assert(g != NULL);
+  for (i = 0; i < EDGES; i++) {
+    v1 = rand_r(&seed) % VERTICES;
+    v2 = rand_r(&seed) % VERTICES;
+    if (v1 != v2) {
+      ck_assert(AddGraphEdge(g, v1, v2, 1 + i % 9) == 0);
+    }
+  }
+  return g;
+}
+
+// Helper function asserting that the coordinator answers as the Graph does.
+static void AssertRoutesMatch(Graph g, Coordinator c) {
+  VertexPair queries[QUERIES];
+  bool results[QUERIES];
+  Neighbor *expected, *actual;
+  unsigned int seed = 8;
+  GVertex_t v;
+  int n, i;
+
+  for (v = 0; v < 2 * VERTICES + 10; v++) {
+    ck_assert(CoordinatorContainsVertex(c, v) == ContainsVertex(g, v));
+    n = GetNeighbors(g, v, &expected);
+    ck_assert(CoordinatorGetNeighbors(c, v, &actual) == n);
+    if (n <= 0) {
+      continue;
+    }
+    qsort(expected, n, sizeof(Neighbor), CompareNeighbors);
+    qsort(actual, n, sizeof(Neighbor), CompareNeighbors);
+    for (i = 0; i < n; i++) {
+      ck_assert(expected[i].v == actual[i].v);
+      ck_assert(expected[i].weight == actual[i].weight);
+    }
+    free(expected);
+    free(actual);
+  }
+
+  for (i = 0; i < QUERIES; i++) {
+    queries[i].v1 = rand_r(&seed) % (VERTICES + 50);
+    queries[i].v2 = (i % 4 == 0) ? queries[i].v1 + VERTICES :
+      (GVertex_t)(rand_r(&seed) % VERTICES);
+  }
+  ck_assert(CoordinatorAreAdjacentBatch(c, queries, QUERIES, results) == 0);
+  for (i = 0; i < QUERIES; i++) {
+    ck_assert(results[i] == AreAdjacent(g, queries[i].v1, queries[i].v2));
+    if (i % 50 == 0) {
+      ck_assert(CoordinatorAreAdjacent(c, queries[i].v1, queries[i].v2) ==
+                (int)results[i]);
+    }
+  }
+}
+
+// Helper function ordering neighbors by vertex.
+static int CompareNeighbors(const void *a, const void *b) {
+  GVertex_t x = ((const Neighbor *)a)->v, y = ((const Neighbor *)b)->v;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,11 @@
+// Test Suite for sharded Graph serving.
+
+#include <check.h>
+
+#ifndef _SHARD_CLUSTER_TEST_H_
+#define _SHARD_CLUSTER_TEST_H_
+
+// Returns the test suite for sharded Graph serving.
+Suite *ShardClusterSuite();
+
+#endif
@@ -0,0 +1,406 @@
+// Test Suite for point-to-point shortest path queries.
+
+#include <check.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "./ShortestPath_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphView.h"
+#include "../src/ShortestPath.h"
+
+#define RANDOM_VERTICES 300
+#define GRID_SIDE 50
+
+// Helper function declarations.
+static Graph RandomGraph(bool directed, unsigned int seed);
+static Graph GridGraph(unsigned int seed);
+static GWeight_t EdgeWeightOf(Graph g, GVertex_t v1, GVertex_t v2);
+static void AssertValidPath(Graph g, GVertex_t s, GVertex_t t,
+                            const PathResult *r);
+static void AssertEnginesAgree(Graph g, Landmarks l, GVertex_t s,
+                               GVertex_t t);
+
+// Tests the trivial cases: missing vertices, a path to itself, and no path.
+START_TEST(trivial_test)
+{
+  PathResult r;
+  Landmarks l;
+  Graph g;
+
+  g = AllocateDirectedGraph();
+  ck_assert(g != NULL);
+  ck_assert(DijkstraPath(g, 1, 2, &r) == -1);
+  ck_assert(BidirectionalPath(g, 1, 2, &r) == -1);
+  ck_assert(ComputeLandmarks(g, 2) == NULL);
+
+  ck_assert(AddGraphEdge(g, 1, 2, 3) == 0);
+  ck_assert(AddVertex(g, 3) == 0);
+  l = ComputeLandmarks(g, 8);
+  ck_assert(l != NULL);
+  ck_assert(LandmarkCount(l) <= 3);
+
+  ck_assert(DijkstraPath(g, 1, 1, &r) == 1);
+  ck_assert(r.distance == 0 && r.hops == 0 && r.path[0] == 1);
+  ck_assert(BidirectionalPath(g, 1, 1, &r) == 1);
+  ck_assert(r.distance == 0 && r.hops == 0 && r.path[0] == 1);
+  ck_assert(ALTPath(g, l, 1, 1, &r) == 1);
+  ck_assert(r.distance == 0 && r.hops == 0 && r.path[0] == 1);
+
+  ck_assert(BidirectionalPath(g, 1, 2, &r) == 1);
+  ck_assert(r.hops == 1 && r.path[0] == 1 && r.path[1] == 2);
+  ck_assert(GRAPH_WEIGHT == GRAPH_WEIGHT_NONE || r.distance == 3);
+
+  // edges only go one way, and 3 is on its own
+  ck_assert(DijkstraPath(g, 2, 1, &r) == 0);
+  ck_assert(BidirectionalPath(g, 2, 1, &r) == 0);
+  ck_assert(ALTPath(g, l, 2, 1, &r) == 0);
+  ck_assert(BidirectionalPath(g, 1, 3, &r) == 0);
+  ck_assert(ALTPath(g, l, 3, 1, &r) == 0);
+
+  FreeLandmarks(l);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that a lighter path with more edges wins over a heavier direct one.
+START_TEST(lighter_path_test)
+{
+  PathResult r;
+  Graph g;
+
+  if (GRAPH_WEIGHT == GRAPH_WEIGHT_NONE) {
+    return;
+  }
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert(AddGraphEdge(g, 1, 2, 2) == 0);
+  ck_assert(AddGraphEdge(g, 2, 3, 2) == 0);
+  ck_assert(AddGraphEdge(g, 3, 4, 2) == 0);
+  ck_assert(AddGraphEdge(g, 1, 4, 10) == 0);
+
+  ck_assert(DijkstraPath(g, 1, 4, &r) == 1);
+  ck_assert(r.distance == 6 && r.hops == 3);
+  ck_assert(BidirectionalPath(g, 4, 1, &r) == 1);
+  ck_assert(r.distance == 6 && r.hops == 3);
+  ck_assert(r.path[0] == 4 && r.path[1] == 3 && r.path[2] == 2 &&
+            r.path[3] == 1);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the three engines agree on many queries over random directed
+// and undirected Graphs, and that every path they give is real.
+START_TEST(engines_agree_test)
+{
+  Landmarks l;
+  Graph g;
+  int i, directed;
+
+  for (directed = 0; directed < 2; directed++) {
+    g = RandomGraph(directed, 41 + directed);
+    l = ComputeLandmarks(g, 4);
+    ck_assert(l != NULL);
+    ck_assert(LandmarkCount(l) == 4);
+    for (i = 0; i < 100; i++) {
+      AssertEnginesAgree(g, l, rand() % RANDOM_VERTICES,
+                         rand() % RANDOM_VERTICES);
+    }
+    FreeLandmarks(l);
+    FreeGraph(g);
+  }
+}
+END_TEST
+
+// Tests that the landmarks steer ALT well clear of most of a grid, and
+// that bidirectional search settles fewer vertices than Dijkstra's.
+START_TEST(settles_fewer_test)
+{
+  long dijkstra = 0, bidirectional = 0, alt = 0;
+  PathResult r;
+  Landmarks l;
+  Graph g;
+  int i, n = GRID_SIDE * GRID_SIDE;
+
+  g = GridGraph(43);
+  l = ComputeLandmarks(g, 8);
+  ck_assert(l != NULL);
+  srand(44);
+  for (i = 0; i < 50; i++) {
+    GVertex_t s = rand() % n, t = rand() % n;
+
+    AssertEnginesAgree(g, l, s, t);
+    ck_assert(DijkstraPath(g, s, t, &r) == 1);
+    dijkstra += r.settled;
+    ck_assert(BidirectionalPath(g, s, t, &r) == 1);
+    bidirectional += r.settled;
+    ck_assert(ALTPath(g, l, s, t, &r) == 1);
+    alt += r.settled;
+  }
+  ck_assert(bidirectional < dijkstra);
+  ck_assert(4 * alt < dijkstra);
+  FreeLandmarks(l);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that saved landmarks load back with the same answers, and are
+// refused for a Graph that has changed.
+START_TEST(save_load_test)
+{
+  char path[] = "/tmp/goldsberry_landmarks_XXXXXX";
+  PathResult r1, r2;
+  Landmarks l, loaded;
+  Graph g;
+  int fd, i;
+
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+
+  g = RandomGraph(true, 45);
+  l = ComputeLandmarks(g, 3);
+  ck_assert(l != NULL);
+  ck_assert(SaveLandmarks(l, path) == 0);
+  loaded = LoadLandmarks(g, path);
+  ck_assert(loaded != NULL);
+  ck_assert(LandmarkCount(loaded) == 3);
+  for (i = 0; i < 30; i++) {
+    GVertex_t s = rand() % RANDOM_VERTICES, t = rand() % RANDOM_VERTICES;
+
+    ck_assert(ALTPath(g, l, s, t, &r1) == ALTPath(g, loaded, s, t, &r2));
+    ck_assert(r1.settled == r2.settled);
+  }
+  FreeLandmarks(loaded);
+
+  ck_assert(AddGraphEdge(g, 1000, 1001, 1) == 0);
+  ck_assert(LoadLandmarks(g, path) == NULL);
+  FreeGraph(g);
+
+  g = RandomGraph(false, 45);
+  ck_assert(LoadLandmarks(g, path) == NULL);
+  FreeGraph(g);
+
+  FreeLandmarks(l);
+  unlink(path);
+}
+END_TEST
+
+// Tests that landmarks stop guiding ALT once the Graph changes under them,
+// and that a file is refused for a Graph with the same counts but other
+// edges.
+START_TEST(stale_landmarks_test)
+{
+  char path[] = "/tmp/goldsberry_landmarks_XXXXXX";
+  Landmarks l;
+  Graph g, other;
+  int fd, i;
+
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+
+  g = AllocateGraph();
+  other = AllocateGraph();
+  for (i = 0; i < 9; i++) {
+    ck_assert(AddGraphEdge(g, i, i + 1, 10) == 0);
+    ck_assert(AddGraphEdge(other, i, i + 1, 10) == 0);
+  }
+  l = ComputeLandmarks(g, 2);
+  ck_assert(l != NULL);
+  ck_assert(SaveLandmarks(l, path) == 0);
+
+  // a shortcut makes the tables overestimate
+  ck_assert(AddGraphEdge(g, 0, 9, 1) == 0);
+  AssertEnginesAgree(g, l, 1, 9);
+  AssertEnginesAgree(g, l, 8, 0);
+  ck_assert(LoadLandmarks(g, path) == NULL);
+  FreeLandmarks(l);
+
+  // the same counts, but one edge moved
+  RemoveGraphEdge(other, 4, 5);
+  ck_assert(AddGraphEdge(other, 4, 6, 10) == 0);
+  ck_assert(LoadLandmarks(other, path) == NULL);
+  RemoveGraphEdge(other, 4, 6);
+  ck_assert(AddGraphEdge(other, 5, 4, 10) == 0);
+  l = LoadLandmarks(other, path);
+  ck_assert(l != NULL);
+  AssertEnginesAgree(other, l, 1, 9);
+
+  // tables from one Graph don't guide queries on another
+  AssertEnginesAgree(g, l, 1, 9);
+
+  FreeLandmarks(l);
+  FreeGraph(other);
+  FreeGraph(g);
+  unlink(path);
+}
+END_TEST
+
+// Tests that landmarks saved from a view that hides vertices load back
+// into a view showing the same, but not into the Graph it views.
+START_TEST(view_save_load_test)
+{
+  char path[] = "/tmp/goldsberry_landmarks_XXXXXX";
+  GVertex_t shown[RANDOM_VERTICES / 2];
+  PathResult r1, r2;
+  Landmarks l, loaded;
+  Graph g, view, again;
+  int fd, i;
+
+  fd = mkstemp(path);
+  ck_assert(fd != -1);
+  close(fd);
+
+  g = RandomGraph(false, 46);
+  for (i = 0; i < RANDOM_VERTICES / 2; i++) {
+    shown[i] = 2 * i;
+  }
+  view = CreateGraphView(g, shown, RANDOM_VERTICES / 2, NULL, NULL);
+  ck_assert(view != NULL);
+  l = ComputeLandmarks(view, 3);
+  ck_assert(l != NULL);
+  ck_assert(SaveLandmarks(l, path) == 0);
+
+  again = CreateGraphView(g, shown, RANDOM_VERTICES / 2, NULL, NULL);
+  ck_assert(again != NULL);
+  loaded = LoadLandmarks(again, path);
+  ck_assert(loaded != NULL);
+  ck_assert(LandmarkCount(loaded) == 3);
+  for (i = 0; i < 30; i++) {
+    GVertex_t s = shown[rand() % (RANDOM_VERTICES / 2)];
+    GVertex_t t = shown[rand() % (RANDOM_VERTICES / 2)];
+
+    ck_assert(ALTPath(view, l, s, t, &r1) ==
+              ALTPath(again, loaded, s, t, &r2));
+    ck_assert(r1.settled == r2.settled);
+  }
+  FreeLandmarks(loaded);
+
+  ck_assert(LoadLandmarks(g, path) == NULL);
+
+  FreeLandmarks(l);
+  FreeGraph(again);
+  FreeGraph(view);
+  FreeGraph(g);
+  unlink(path);
+}
+END_TEST
+
+Suite *ShortestPathSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("ShortestPath");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, trivial_test);
+  tcase_add_test(tc_core, lighter_path_test);
+  tcase_add_test(tc_core, engines_agree_test);
+  tcase_add_test(tc_core, settles_fewer_test);
+  tcase_add_test(tc_core, save_load_test);
+  tcase_add_test(tc_core, stale_landmarks_test);
+  tcase_add_test(tc_core, view_save_load_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function building a sparse random Graph on [0, RANDOM_VERTICES).
+static Graph RandomGraph(bool directed, unsigned int seed) {
+  Graph g;
+  int i;
+
+  g = directed ? AllocateDirectedGraph() : AllocateGraph();
+  ck_assert(g != NULL);
+  srand(seed);
+  for (i = 0; i < RANDOM_VERTICES; i++) {
+    ck_assert(AddVertex(g, i) == 0);
+  }
+  for (i = 0; i < 3 * RANDOM_VERTICES; i++) {
+    AddGraphEdge(g, rand() % RANDOM_VERTICES, rand() % RANDOM_VERTICES,
+                 rand() % 20);
+  }
+  return g;
+}
+
+// Helper function building a GRID_SIDE by GRID_SIDE grid, each vertex
+// joined to its right and lower neighbors by edges of weight 1 to 10.
+static Graph GridGraph(unsigned int seed) {
+  Graph g;
+  int x, y;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  srand(seed);
+  for (y = 0; y < GRID_SIDE; y++) {
+    for (x = 0; x < GRID_SIDE; x++) {
+      if (x + 1 < GRID_SIDE) {
+        ck_assert(AddGraphEdge(g, y * GRID_SIDE + x, y * GRID_SIDE + x + 1,
+                               1 + rand() % 10) == 0);
+      }
+      if (y + 1 < GRID_SIDE) {
+        ck_assert(AddGraphEdge(g, y * GRID_SIDE + x, (y + 1) * GRID_SIDE + x,
+                               1 + rand() % 10) == 0);
+      }
+    }
+  }
+  return g;
+}
+
+// Helper function returning the weight of the edge from v1 to v2, which
+// must exist.
+static GWeight_t EdgeWeightOf(Graph g, GVertex_t v1, GVertex_t v2) {
+  GWeight_t w = 0;
+  Neighbor *out;
+  int i, n;
+
+  n = GetNeighbors(g, v1, &out);
+  for (i = 0; i < n && out[i].v != v2; i++) {
+  }
+  ck_assert(i < n);
+  w = out[i].weight;
+  free(out);
+  return w;
+}
+
+// Helper function asserting that a path runs from s to t over edges of
+// the Graph whose weights add up to its distance.
+static void AssertValidPath(Graph g, GVertex_t s, GVertex_t t,
+                            const PathResult *r) {
+  GWeight_t total = 0;
+  int i;
+
+  ck_assert(r->path[0] == s && r->path[r->hops] == t);
+  for (i = 0; i < r->hops; i++) {
+    total += EdgeWeightOf(g, r->path[i], r->path[i + 1]);
+  }
+  ck_assert(total == r->distance);
+}
+
+// Helper function asserting that every engine gives the same answer.
+static void AssertEnginesAgree(Graph g, Landmarks l, GVertex_t s,
+                               GVertex_t t) {
+  PathResult d, b, a;
+  int ret;
+
+  ret = DijkstraPath(g, s, t, &d);
+  ck_assert(ret == 0 || ret == 1);
+  ck_assert(BidirectionalPath(g, s, t, &b) == ret);
+  if (ret == 1) {
+    AssertValidPath(g, s, t, &b);
+    ck_assert(b.distance == d.distance);
+  }
+  ck_assert(ALTPath(g, l, s, t, &a) == ret);
+  if (ret == 1) {
+    AssertValidPath(g, s, t, &a);
+    ck_assert(a.distance == d.distance);
+  }
+  // checked last, as the path belongs to the thread's latest query
+  ck_assert(DijkstraPath(g, s, t, &d) == ret);
+  if (ret == 1) {
+    AssertValidPath(g, s, t, &d);
+  }
+}
@@ -0,0 +1,11 @@
+// Test Suite for point-to-point shortest path queries.
+
+#include <check.h>
+
+#ifndef _SHORTEST_PATH_TEST_H_
+#define _SHORTEST_PATH_TEST_H_
+
+// Returns the test suite for point-to-point shortest path queries.
+Suite *ShortestPathSuite();
+
+#endif
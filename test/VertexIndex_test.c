@@ -0,0 +1,110 @@
+// Test Suite for the vertex hash index.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./VertexIndex_test.h"
+#include "../src/VertexIndex.h"
+
+// The index never dereferences the items it stores, so the tests use fake
+// pointers derived from the key.
+#define ITEM(v) ((struct ListItem *)(intptr_t)(((v) + 1) * 16))
+
+static VertexIndex idx;
+
+static void setup() {
+  ck_assert(InitVertexIndex(&idx, NULL));
+}
+
+static void teardown() {
+  FreeVertexIndex(&idx);
+}
+
+// Tests lookups in an empty index.
+START_TEST(empty_index_test)
+{
+  int probes;
+
+  ck_assert(VertexIndexFind(&idx, 0, &probes) == NULL);
+  ck_assert(VertexIndexFind(&idx, -5, &probes) == NULL);
+  ck_assert(probes >= 1);
+}
+END_TEST
+
+// Tests inserting enough keys to force several resizes, including negative
+// keys, and finding them all again.
+START_TEST(insert_find_test)
+{
+  int i, probes;
+
+  for (i = -500; i < 500; i++) {
+    ck_assert(VertexIndexInsert(&idx, i, ITEM(i)));
+  }
+  ck_assert(idx.count == 1000);
+  ck_assert(2 * (uint32_t)idx.count <= idx.mask + 1);
+
+  for (i = -500; i < 500; i++) {
+    ck_assert(VertexIndexFind(&idx, i, &probes) == ITEM(i));
+  }
+  ck_assert(VertexIndexFind(&idx, 500, &probes) == NULL);
+}
+END_TEST
+
+// Tests that removal keeps every other key reachable, whatever order the
+// keys are removed in.
+START_TEST(remove_test)
+{
+  int i, j, probes;
+
+  for (i = 0; i < 300; i++) {
+    ck_assert(VertexIndexInsert(&idx, i * 7, ITEM(i * 7)));
+  }
+
+  // remove every third key, plus one that was never there
+  for (i = 0; i < 300; i += 3) {
+    VertexIndexRemove(&idx, i * 7);
+  }
+  VertexIndexRemove(&idx, 1);
+  ck_assert(idx.count == 200);
+
+  for (i = 0; i < 300; i++) {
+    if (i % 3 == 0) {
+      ck_assert(VertexIndexFind(&idx, i * 7, &probes) == NULL);
+    } else {
+      ck_assert(VertexIndexFind(&idx, i * 7, &probes) == ITEM(i * 7));
+    }
+  }
+
+  // remove the rest in reverse, checking a few survivors as we go
+  for (i = 299; i >= 0; i--) {
+    if (i % 3 == 0) {
+      continue;
+    }
+    VertexIndexRemove(&idx, i * 7);
+    for (j = 0; j < i; j += 17) {
+      if (j % 3 != 0) {
+        ck_assert(VertexIndexFind(&idx, j * 7, &probes) == ITEM(j * 7));
+      }
+    }
+  }
+  ck_assert(idx.count == 0);
+}
+END_TEST
+
+Suite *VertexIndexSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("VertexIndex");
+
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, empty_index_test);
+  tcase_add_test(tc_core, insert_find_test);
+  tcase_add_test(tc_core, remove_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
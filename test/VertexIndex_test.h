@@ -0,0 +1,11 @@
+// Test Suite for the vertex hash index.
+
+#include <check.h>
+
+#ifndef _VERTEX_INDEX_TEST_H_
+#define _VERTEX_INDEX_TEST_H_
+
+// Returns the test suite for the vertex hash index.
+Suite *VertexIndexSuite();
+
+#endif
@@ -0,0 +1,194 @@
+// Test Suite for the weight index and the queries it answers.
+
+#include <check.h>
+#include <stdlib.h>
+
+#include "./WeightIndex_test.h"
+#include "../src/Graph.h"
+#include "../src/GraphAllocator.h"
+#include "../src/WeightIndex.h"
+
+#define VERTICES 64
+#define OPS 20000
+
+// Helper function declarations.
+static GWeight_t Reported(GWeight_t w);
+static void AssertIndexMatches(Graph g);
+
+// Tests the queries on a small star.
+START_TEST(queries_test)
+{
+  const Neighbor *span;
+  Graph g;
+
+  g = AllocateGraph();
+  ck_assert(g != NULL);
+  ck_assert_int_eq(AddGraphEdge(g, 0, 1, 30), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 0, 2, 10), 0);
+  ck_assert_int_eq(AddVertex(g, 5), 0);
+
+  // nothing to answer from until the index is built
+  ck_assert(!HasWeightIndex(g));
+  ck_assert_int_eq(GetLightestNeighbors(g, 0, 1, &span), -2);
+  ck_assert_int_eq(EnableWeightIndex(g), 0);
+  ck_assert(HasWeightIndex(g));
+  ck_assert_int_eq(EnableWeightIndex(g), 0);
+
+  ck_assert_int_eq(AddGraphEdge(g, 0, 3, 20), 0);
+  ck_assert_int_eq(AddGraphEdge(g, 0, 4, 20), 0);
+  ck_assert_int_eq(GetLightestNeighbors(g, 0, 10, &span), 4);
+  if (GRAPH_WEIGHT != GRAPH_WEIGHT_NONE) {
+    ck_assert(span[0].v == 2 && span[0].weight == 10);
+    ck_assert(span[1].v == 3 && span[2].v == 4);
+    ck_assert(span[3].v == 1 && span[3].weight == 30);
+    ck_assert_int_eq(GetNeighborsUpToWeight(g, 0, 20, &span), 3);
+    ck_assert_int_eq(GetNeighborsUpToWeight(g, 0, 9, &span), 0);
+
+    // reweighting an edge moves it
+    ck_assert_int_eq(AddGraphEdge(g, 1, 0, 5), 0);
+    ck_assert_int_eq(GetLightestNeighbors(g, 0, 1, &span), 1);
+    ck_assert(span[0].v == 1 && span[0].weight == 5);
+    ck_assert_int_eq(GetLightestNeighbors(g, 1, 1, &span), 1);
+    ck_assert(span[0].v == 0 && span[0].weight == 5);
+  }
+  ck_assert_int_eq(GetLightestNeighbors(g, 0, 2, &span), 2);
+  ck_assert_int_eq(GetLightestNeighbors(g, 0, 0, &span), 0);
+  ck_assert_int_eq(GetLightestNeighbors(g, 5, 3, &span), 0);
+  ck_assert_int_eq(GetNeighborsUpToWeight(g, 9, 100, &span), -1);
+
+  RemoveGraphEdge(g, 2, 0);
+  ck_assert_int_eq(GetNeighborsUpToWeight(g, 0, 100, &span), 3);
+  ck_assert_int_eq(GetNeighborsUpToWeight(g, 2, 100, &span), 0);
+
+  DisableWeightIndex(g);
+  ck_assert(!HasWeightIndex(g));
+  ck_assert_int_eq(GetNeighborsUpToWeight(g, 0, 100, &span), -2);
+  FreeGraph(g);
+}
+END_TEST
+
+// Tests that the index keeps up with random changes, whether built before
+// or after them.
+START_TEST(kept_in_sync_test)
+{
+  unsigned int seed = 40;
+  int directed, i, op, v1, v2;
+  Graph g;
+
+  for (directed = 0; directed < 2; directed++) {
+    g = directed ? AllocateDirectedGraph() : AllocateGraph();
+    ck_assert(g != NULL);
+    for (i = 0; i < OPS; i++) {
+      if (i == OPS / 4) {
+        ck_assert_int_eq(EnableWeightIndex(g), 0);
+        AssertIndexMatches(g);
+      }
+      op = rand_r(&seed) % 10;
+      v1 = rand_r(&seed) % VERTICES;
+      v2 = rand_r(&seed) % VERTICES;
+      if (op < 6) {
+        AddGraphEdge(g, v1, v2, rand_r(&seed) % 8);
+      } else {
+        RemoveGraphEdge(g, v1, v2);
+      }
+      if (i % 1000 == 0 && HasWeightIndex(g)) {
+        AssertIndexMatches(g);
+      }
+    }
+    AssertIndexMatches(g);
+    FreeGraph(g);
+  }
+}
+END_TEST
+
+// Tests that a Graph with no room for the index is left without one, and
+// that an edge with no room in the index is not added.
+START_TEST(out_of_memory_test)
+{
+  const Neighbor *span;
+  size_t bytes;
+  Graph g;
+  int i;
+
+  g = AllocateGraphWithAllocator(false, SystemGraphAllocator(), 0);
+  ck_assert(g != NULL);
+  for (i = 1; i < 20; i++) {
+    ck_assert_int_eq(AddGraphEdge(g, 0, i, i), 0);
+  }
+  bytes = GraphBytesAllocated(g);
+  SetGraphMemoryLimit(g, bytes);
+  ck_assert_int_eq(EnableWeightIndex(g), -1);
+  ck_assert(!HasWeightIndex(g));
+  ck_assert_uint_eq(GraphBytesAllocated(g), bytes);
+
+  SetGraphMemoryLimit(g, 0);
+  ck_assert_int_eq(EnableWeightIndex(g), 0);
+  AssertIndexMatches(g);
+
+  // vertex 0's span is full, so growing it must fail
+  SetGraphMemoryLimit(g, GraphBytesAllocated(g));
+  for (i = 20; AddGraphEdge(g, 0, i, i) == 0; i++) {
+  }
+  ck_assert(!ContainsVertex(g, i));
+  ck_assert_int_eq(GetLightestNeighbors(g, 0, 100, &span), i - 1);
+  AssertIndexMatches(g);
+  FreeGraph(g);
+}
+END_TEST
+
+Suite *WeightIndexSuite() {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("WeightIndex");
+
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, queries_test);
+  tcase_add_test(tc_core, kept_in_sync_test);
+  tcase_add_test(tc_core, out_of_memory_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+// Helper function returning the weight the Graph reports for an edge added
+// with weight w.
+static GWeight_t Reported(GWeight_t w) {
+  return GRAPH_WEIGHT == GRAPH_WEIGHT_NONE ? 1 : w;
+}
+
+// Helper function asserting that the index of every vertex holds exactly
+// the edges GetNeighbors lists, lightest first, and answers each weight
+// threshold with those no heavier.
+static void AssertIndexMatches(Graph g) {
+  const Neighbor *span;
+  Neighbor *out;
+  int v, i, j, n, light;
+  GWeight_t w;
+
+  for (v = 0; v < VERTICES; v++) {
+    n = GetNeighbors(g, v, &out);
+    ck_assert_int_eq(GetLightestNeighbors(g, v, VERTICES, &span), n);
+    for (i = 0; i < n; i++) {
+      for (j = 0; j < n && out[j].v != span[i].v; j++) {
+      }
+      ck_assert(j < n && out[j].weight == span[i].weight);
+      ck_assert(i == 0 || span[i - 1].weight < span[i].weight ||
+                (span[i - 1].weight == span[i].weight &&
+                 span[i - 1].v < span[i].v));
+    }
+    for (w = 0; w < 8; w++) {
+      light = 0;
+      for (i = 0; i < n; i++) {
+        light += out[i].weight <= Reported(w);
+      }
+      ck_assert_int_eq(GetNeighborsUpToWeight(g, v, Reported(w), &span),
+                       n < 0 ? -1 : light);
+    }
+    if (n > 0) {
+      free(out);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+// Test Suite for the weight index and the queries it answers.
+
+#include <check.h>
+
+#ifndef _WEIGHT_INDEX_TEST_H_
+#define _WEIGHT_INDEX_TEST_H_
+
+// Returns the test suite for the weight index.
+Suite *WeightIndexSuite();
+
+#endif
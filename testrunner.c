@@ -6,6 +6,25 @@
 #include <check.h>
 
 #include "test/Graph_test.h"
+#include "test/VertexIndex_test.h"
+#include "test/GraphStats_test.h"
+#include "test/GraphLog_test.h"
+#include "test/GraphBuilder_test.h"
+#include "test/Neighborhood_test.h"
+#include "test/GraphServer_test.h"
+#include "test/DeltaGraph_test.h"
+#include "test/Partition_test.h"
+#include "test/ShardCluster_test.h"
+#include "test/ShortestPath_test.h"
+#include "test/Command_test.h"
+#include "test/CommandBatch_test.h"
+#include "test/GraphFuzz_test.h"
+#include "test/GraphAllocator_test.h"
+#include "test/WeightIndex_test.h"
+#include "test/DenseSubgraph_test.h"
+#include "test/RandomWalk_test.h"
+#include "test/GraphDiff_test.h"
+#include "test/GraphView_test.h"
 
 int main() {
   Suite *s;
@@ -14,6 +33,25 @@ int main() {
 
   s = GraphSuite();
   runner = srunner_create(s);
+  srunner_add_suite(runner, VertexIndexSuite());
+  srunner_add_suite(runner, GraphStatsSuite());
+  srunner_add_suite(runner, GraphLogSuite());
+  srunner_add_suite(runner, GraphBuilderSuite());
+  srunner_add_suite(runner, NeighborhoodSuite());
+  srunner_add_suite(runner, GraphServerSuite());
+  srunner_add_suite(runner, DeltaGraphSuite());
+  srunner_add_suite(runner, PartitionSuite());
+  srunner_add_suite(runner, ShardClusterSuite());
+  srunner_add_suite(runner, ShortestPathSuite());
+  srunner_add_suite(runner, CommandSuite());
+  srunner_add_suite(runner, CommandBatchSuite());
+  srunner_add_suite(runner, GraphFuzzSuite());
+  srunner_add_suite(runner, GraphAllocatorSuite());
+  srunner_add_suite(runner, WeightIndexSuite());
+  srunner_add_suite(runner, DenseSubgraphSuite());
+  srunner_add_suite(runner, RandomWalkSuite());
+  srunner_add_suite(runner, GraphDiffSuite());
+  srunner_add_suite(runner, GraphViewSuite());
 
   // for debugging
   srunner_set_fork_status(runner, CK_NOFORK);